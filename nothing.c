@@ -1,3 +1,8 @@
+// See src/system/file.c
+#if !defined(_WIN32) && !defined(__APPLE__) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "src/color.c"
 #include "src/game.c"
 #include "src/game/camera.c"
@@ -10,19 +15,28 @@
 #include "src/game/level/lava/wavy_rect.c"
 #include "src/game/level/platforms.c"
 #include "src/game/level/player.c"
-#include "src/game/level/explosion.c"
+#include "src/game/level/particles.c"
 #include "src/game/level/regions.c"
 #include "src/game/level/rigid_bodies.c"
 #include "src/game/level_picker.c"
+#include "src/game/level_preloader.c"
+#include "src/game/level_metadata.c"
+#include "src/game/level_reloader.c"
 #include "src/game/credits.c"
 #include "src/game/settings.c"
 #include "src/game/sound_samples.c"
 #include "src/game/sprite_font.c"
 #include "src/main.c"
+#include "src/math/affine.c"
 #include "src/math/rand.c"
 #include "src/math/rect.c"
 #include "src/math/triangle.c"
 #include "src/sdl/renderer.c"
+#include "src/sdl/draw_list.c"
+#include "src/sdl/event_queue.c"
+#include "src/sdl/raster.c"
+#include "src/sdl/draw_stats.c"
+#include "src/sdl/atlas.c"
 #include "src/sdl/texture.c"
 #include "src/ui/cursor.c"
 #include "src/ui/console.c"
@@ -32,6 +46,8 @@
 #include "src/ui/wiggly_text.c"
 #include "src/ui/slider.c"
 #include "src/game/level/level_editor.c"
+#include "src/game/level/level_file.c"
+#include "src/game/level/level_stream.c"
 #include "src/game/level/level_editor/color_picker.c"
 #include "src/game/level/level_editor/rect_layer.c"
 #include "src/game/level/level_editor/layer_picker.c"
@@ -41,12 +57,22 @@
 #include "src/game/level/level_editor/label_layer.c"
 #include "src/game/level/level_editor/background_layer.c"
 #include "src/game/level/level_editor/undo_history.c"
+#include "src/game/level/level_editor/level_load_bench.c"
+#include "src/game/level/level_editor/level_binary.c"
+#include "src/game/level/level_editor/level_sectors.c"
+#include "src/game/level/level_editor/level_saver.c"
+#include "src/game/level/level_editor/level_journal.c"
 #include "src/system/log.c"
 #include "src/system/lt_adapters.c"
 #include "src/system/nth_alloc.c"
+#include "src/system/memory.c"
 #include "src/system/stacktrace.c"
 #include "src/system/str.c"
+#include "src/system/string_builder.c"
 #include "src/dynarray.c"
 #include "src/system/file.c"
+#include "src/system/file_watcher.c"
+#include "src/system/frame_scheduler.c"
+#include "src/system/render_scaler.c"
 #include "src/ring_buffer.c"
 #include "src/game/level/phantom_platforms.c"
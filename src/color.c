@@ -48,26 +48,9 @@ Color hsla(float h, float s, float l, float a)
     return color;
 }
 
-static Uint8 hex2dec_digit(char c)
+static float parse_color_component(const char *component)
 {
-    if (c >= '0' && c <= '9') {
-        return (Uint8) (c - '0');
-    }
-
-    if (c >= 'A' && c <= 'F') {
-        return (Uint8) (10 + c - 'A');
-    }
-
-    if (c >= 'a' && c <= 'f') {
-        return (Uint8) (10 + c - 'a');
-    }
-
-    return 0;
-}
-
-static Uint8 parse_color_component(const char *component)
-{
-    return (Uint8) (hex2dec_digit(component[0]) * 16 + hex2dec_digit(component[1]));
+    return (float) string_hex_to_ulong(string(2, component)) / 255.0f;
 }
 
 Color hexstr(const char *hexstr)
@@ -76,11 +59,7 @@ Color hexstr(const char *hexstr)
         return rgba(0.0f, 0.0f, 0.0f, 1.0f);
     }
 
-    return rgba(
-        parse_color_component(hexstr) / 255.0f,
-        parse_color_component(hexstr + 2) / 255.0f,
-        parse_color_component(hexstr + 4) / 255.0f,
-        1.0f);
+    return hexs(string(6, hexstr));
 }
 
 Color hexs(String input)
@@ -88,9 +67,9 @@ Color hexs(String input)
     if (input.count < 6) return COLOR_BLACK;
 
     return rgba(
-        parse_color_component(input.data) / 255.0f,
-        parse_color_component(input.data + 2) / 255.0f,
-        parse_color_component(input.data + 4) / 255.0f,
+        parse_color_component(input.data),
+        parse_color_component(input.data + 2),
+        parse_color_component(input.data + 4),
         1.0f);
 }
 
@@ -134,10 +113,12 @@ Color color_scale(Color c, Color fc)
         fmaxf(fminf(c.a * fc.a, 1.0f), 0.0f));
 }
 
-int color_hex_to_stream(Color color, FILE *stream)
+void color_hex_to_sb(Color color, StringBuilder *sb)
 {
     SDL_Color sdl = color_for_sdl(color);
-    return fprintf(stream, "%02x%02x%02x", sdl.r, sdl.g, sdl.b);
+    sb_append_hex_byte(sb, sdl.r);
+    sb_append_hex_byte(sb, sdl.g);
+    sb_append_hex_byte(sb, sdl.b);
 }
 
 int color_hex_to_string(Color color, char *buffer, size_t buffer_size)
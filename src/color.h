@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <SDL.h>
 #include "./system/s.h"
+#include "./system/string_builder.h"
 
 #define COLOR_BLACK rgba(0.0f, 0.0f, 0.0f, 1.0f)
 #define COLOR_WHITE rgba(1.0f, 1.0f, 1.0f, 1.0f)
@@ -20,7 +21,7 @@ Color hexstr(const char *hexstr);
 Color hexs(String input);
 SDL_Color color_for_sdl(Color color);
 
-int color_hex_to_stream(Color color, FILE *stream);
+void color_hex_to_sb(Color color, StringBuilder *sb);
 int color_hex_to_string(Color color, char *buffer, size_t buffer_size);
 
 Color color_darker(Color color, float d);
@@ -31,7 +31,25 @@
 // #define RENDERER_CONFIG SDL_RENDERER_SOFTWARE
 #define RENDERER_CONFIG (SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC)
 
+// How long (in seconds) the ambient menu animations keep playing after the last input
+#define RENDER_ON_DEMAND_IDLE_TIMEOUT 2.0f
+// Upper bound (in milliseconds) for blocking on the event queue while idle
+#define RENDER_ON_DEMAND_WAIT_TIMEOUT 500
+
+// Dynamic resolution scaling (see system/render_scaler.h)
+#define RENDER_SCALE_MIN 0.5f
+#define RENDER_SCALE_STEP 0.05f
+// Fraction of the frame duration the rendering may take
+#define RENDER_SCALE_BUDGET 0.5f
+// Go back up only when the render time is below this fraction of the budget
+#define RENDER_SCALE_HEADROOM 0.6f
+#define RENDER_SCALE_SMOOTHING 0.1f
+// Frames to wait after every adjustment
+#define RENDER_SCALE_COOLDOWN 30
+
 #define UNDO_HISTORY_CAPACITY 256
+// The edits and their contexts share this many bytes
+#define UNDO_HISTORY_BYTES_CAPACITY (128 * KILO)
 
 #define EDIT_FIELD_CAPACITY 256
 
@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "system/log.h"
 #include "system/stacktrace.h"
 #include "system/lt.h"
 #include "system/nth_alloc.h"
@@ -13,6 +14,54 @@ void *dynarray_pointer_at(const Dynarray *dynarray, size_t index)
     return (uint8_t *)dynarray->data + index * dynarray->element_size;
 }
 
+int dynarray_reserve(Dynarray *dynarray, size_t capacity)
+{
+    trace_assert(dynarray);
+
+    if (capacity <= dynarray->capacity) {
+        return 0;
+    }
+
+    if (capacity > SIZE_MAX / dynarray->element_size) {
+        log_fail("%zu elements of %zu bytes are too many\n",
+                 capacity, dynarray->element_size);
+        return -1;
+    }
+
+    const size_t old_size = dynarray->capacity * dynarray->element_size;
+    const size_t new_size = capacity * dynarray->element_size;
+
+    // The arena either grows the data in place or moves it and takes
+    // the old block back. It is never asked whether the data fits,
+    // since a full arena chains another block or returns NULL.
+    void *data = dynarray->memory
+        ? memory_realloc(dynarray->memory, dynarray->data, old_size, new_size)
+        : realloc(dynarray->data, new_size);
+    if (data == NULL) {
+        log_fail("Could not allocate %zu elements of %zu bytes\n",
+                 capacity, dynarray->element_size);
+        return -1;
+    }
+    dynarray->data = data;
+    dynarray->capacity = capacity;
+
+    return 0;
+}
+
+// Doubles the capacity when the dynarray is full
+static void dynarray_grow(Dynarray *dynarray)
+{
+    if (dynarray->count < dynarray->capacity) {
+        return;
+    }
+
+    const size_t capacity = dynarray->capacity == 0
+        ? DYNARRAY_INITIAL_CAPACITY
+        : dynarray->capacity * 2;
+    const int result = dynarray_reserve(dynarray, capacity);
+    trace_assert(result == 0);
+}
+
 void dynarray_clear(Dynarray *dynarray)
 {
     trace_assert(dynarray);
@@ -23,7 +72,7 @@ int dynarray_push(Dynarray *dynarray, const void *element)
 {
     trace_assert(dynarray);
     trace_assert(element);
-    trace_assert(dynarray->count < DYNARRAY_CAPACITY);
+    dynarray_grow(dynarray);
 
     memcpy(
         (char*) dynarray->data + dynarray->count * dynarray->element_size,
@@ -66,7 +115,7 @@ void dynarray_delete_at(Dynarray *dynarray, size_t index)
 void dynarray_insert_before(Dynarray *dynarray, size_t index, void *element)
 {
     trace_assert(dynarray);
-    trace_assert(dynarray->count < DYNARRAY_CAPACITY);
+    dynarray_grow(dynarray);
     trace_assert(element);
     trace_assert(index <= dynarray->count);
 
@@ -91,7 +140,7 @@ void dynarray_insert_before(Dynarray *dynarray, size_t index, void *element)
 int dynarray_push_empty(Dynarray *dynarray)
 {
     trace_assert(dynarray);
-    trace_assert(dynarray->count < DYNARRAY_CAPACITY);
+    dynarray_grow(dynarray);
 
     memset(
         (char*) dynarray->data + dynarray->count * dynarray->element_size,
@@ -7,12 +7,15 @@
 #include "system/memory.h"
 #include "system/stacktrace.h"
 
-#define DYNARRAY_CAPACITY 256
+#define DYNARRAY_INITIAL_CAPACITY 16
 
 typedef struct {
     size_t element_size;
     size_t count;
+    size_t capacity;
     void *data;
+    // The memory the data is allocated in. NULL means malloc.
+    Memory *memory;
 } Dynarray;
 
 static inline
@@ -21,7 +24,9 @@ Dynarray create_dynarray_malloc(size_t element_size)
     Dynarray result = {
         .element_size = element_size,
         .count = 0,
-        .data = malloc(DYNARRAY_CAPACITY * element_size)
+        .capacity = DYNARRAY_INITIAL_CAPACITY,
+        .data = malloc(DYNARRAY_INITIAL_CAPACITY * element_size),
+        .memory = NULL
     };
     trace_assert(result.data);
     return result;
@@ -34,11 +39,17 @@ Dynarray create_dynarray(Memory *memory, size_t element_size)
     Dynarray result = {
         .element_size = element_size,
         .count = 0,
-        .data = memory_alloc(memory, DYNARRAY_CAPACITY * element_size)
+        .capacity = DYNARRAY_INITIAL_CAPACITY,
+        .data = memory_alloc(memory, DYNARRAY_INITIAL_CAPACITY * element_size),
+        .memory = memory
     };
     return result;
 }
 
+// Makes room for capacity elements at once, so the dynarray does not
+// grow again until it has that many. Returns -1 when they do not fit
+// into the memory.
+int dynarray_reserve(Dynarray *dynarray, size_t capacity);
 void *dynarray_pointer_at(const Dynarray *dynarray, size_t index);
 void dynarray_replace_at(Dynarray *dynarray, size_t index, void *element);
 void dynarray_copy_to(Dynarray *dynarray, void *dest, size_t index);
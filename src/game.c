@@ -1,59 +1,247 @@
 #include <SDL.h>
 #include "system/stacktrace.h"
 #include <stdio.h>
+#include <string.h>
 
 #include "game.h"
 #include "game/level.h"
 #include "game/sound_samples.h"
 #include "game/level_picker.h"
+#include "game/level_preloader.h"
+#include "game/level_reloader.h"
+#include "game/level/level_editor/level_saver.h"
 #include "system/log.h"
 #include "system/lt.h"
 #include "system/nth_alloc.h"
+#include "system/file_watcher.h"
 #include "ui/console.h"
 #include "ui/edit_field.h"
 #include "ui/cursor.h"
 #include "system/str.h"
-#include "sdl/texture.h"
+#include "sdl/atlas.h"
 #include "game/level/level_editor/background_layer.h"
 #include "game/level/level_editor.h"
 #include "game/settings.h"
 #include "game/credits.h"
+#include "sdl/draw_stats.h"
 
 typedef struct Game {
     Lt *lt;
 
     Game_state state;
+    // All the UI bitmaps: the charmaps and the cursors
+    Atlas atlas;
     Sprite_font font;
     Memory level_editor_memory;
     LevelPicker level_picker;
+    // Builds the level under the cursor of the level picker
+    LevelPreloader *level_preloader;
+    // NULL while a level loaded from a file is only played. Built
+    // from level_file_name when the player opens the editor.
     LevelEditor *level_editor;
+    char level_file_name[METADATA_FILEPATH_MAX_SIZE];
+    // Picks up the levels changed by other programs. The watcher is
+    // NULL when the folder can not be watched, the levels are just
+    // not reloaded then.
+    FileWatcher *file_watcher;
+    LevelReloader *level_reloader;
+    // The level file changed while the editor was saving it, so it
+    // is looked at again once the save is done
+    bool level_reload_deferred;
+    // Writes the levels saved by the level editor in the background
+    LevelSaver *level_saver;
+    // Keeps the unsaved edits of the level editor
+    LevelJournal *level_journal;
     Credits credits;
     Level *level;
     Settings settings;
     Sound_samples *sound_samples;
     Camera camera;
     SDL_Renderer *renderer;
+    DrawList *draw_list;
     Console *console;
     Cursor cursor;
     int console_enabled;
+
+    int render_dirty;
+    float idle_time;
+
+    // Bumped every time the level gets paused so the renderer knows
+    // when to capture a new frozen frame (see draw_list_freeze())
+    Uint32 freeze_id;
+    int level_paused;
+
+    // Statistics of the last recorded frame for the debug overlay
+    DrawStats draw_stats;
+    DrawOverdraw overdraw;
 } Game;
 
+// The charmaps go first in the atlas followed by the cursors in the
+// order of Cursor_Style
+#define GAME_ATLAS_CHARMAPS_COUNT 4
+#define GAME_ATLAS_FONT 0
+
+static const char *const game_atlas_charmaps[GAME_ATLAS_CHARMAPS_COUNT] = {
+    "./assets/images/charmap-oldschool.bmp",
+    "./assets/images/charmap-cellphone_black.bmp",
+    "./assets/images/charmap-cellphone_white_0.bmp",
+    "./assets/images/charmap-futuristic_black_0.bmp"
+};
+
+#define GAME_DRAW_STATS_TEXT_CAPACITY 1024
+#define GAME_DRAW_STATS_PADDING 10.0f
+
+static void game_render_draw_stats(const Game *game)
+{
+    trace_assert(game);
+
+    char text[GAME_DRAW_STATS_TEXT_CAPACITY];
+    if (draw_stats_format(&game->draw_stats, text, GAME_DRAW_STATS_TEXT_CAPACITY) < 0) {
+        return;
+    }
+
+    const Memory *memory = &game->level_editor_memory;
+    const size_t n = strlen(text);
+    snprintf(text + n, GAME_DRAW_STATS_TEXT_CAPACITY - n,
+             "Editor memory: %lu KB (%lu KB at most)\n"
+             "Editor memory blocks: %lu (%lu at most)\n",
+             (unsigned long) (memory_used(memory) / KILO),
+             (unsigned long) (memory->high_water / KILO),
+             (unsigned long) memory->blocks_count + 1,
+             (unsigned long) memory->blocks_high_water + 1);
+
+    const Vec2f size = vec(2.0f, 2.0f);
+    const Vec2f position = vec(GAME_DRAW_STATS_PADDING, GAME_DRAW_STATS_PADDING);
+    const Rect box = sprite_font_boundary_box(position, size, text);
+
+    camera_fill_rect_screen(
+        &game->camera,
+        rect(box.x - GAME_DRAW_STATS_PADDING,
+             box.y - GAME_DRAW_STATS_PADDING,
+             box.w + 2.0f * GAME_DRAW_STATS_PADDING,
+             box.h + 2.0f * GAME_DRAW_STATS_PADDING),
+        rgba(0.0f, 0.0f, 0.0f, 0.75f));
+    camera_render_text_screen(
+        &game->camera,
+        text,
+        size,
+        rgba(1.0f, 1.0f, 1.0f, 1.0f),
+        position);
+}
+
+#define GAME_OVERDRAW_LEVELS 4
+
+// Blue for the cells filled once, then green, yellow and red for
+// four times and more
+static const Color game_overdraw_colors[GAME_OVERDRAW_LEVELS] = {
+    {0.0f, 0.0f, 1.0f, 0.35f},
+    {0.0f, 1.0f, 0.0f, 0.35f},
+    {1.0f, 1.0f, 0.0f, 0.35f},
+    {1.0f, 0.0f, 0.0f, 0.35f}
+};
+
+static int game_overdraw_level(const DrawOverdraw *overdraw, int row, int column)
+{
+    const int count = overdraw->cells[row][column];
+    return count < GAME_OVERDRAW_LEVELS ? count : GAME_OVERDRAW_LEVELS;
+}
+
+static void game_render_overdraw(const Game *game)
+{
+    trace_assert(game);
+
+    const DrawOverdraw *overdraw = &game->overdraw;
+    const float cell_w = (float) overdraw->view_port.w / DRAW_OVERDRAW_COLUMNS;
+    const float cell_h = (float) overdraw->view_port.h / DRAW_OVERDRAW_ROWS;
+
+    for (int row = 0; row < DRAW_OVERDRAW_ROWS; ++row) {
+        // One rect per run of the cells of the same level
+        int begin = 0;
+        for (int column = 1; column <= DRAW_OVERDRAW_COLUMNS; ++column) {
+            const int level = game_overdraw_level(overdraw, row, begin);
+            if (column < DRAW_OVERDRAW_COLUMNS &&
+                game_overdraw_level(overdraw, row, column) == level) {
+                continue;
+            }
+
+            if (level > 0) {
+                camera_fill_rect_screen(
+                    &game->camera,
+                    rect((float) begin * cell_w,
+                         (float) row * cell_h,
+                         (float) (column - begin) * cell_w,
+                         cell_h),
+                    game_overdraw_colors[level - 1]);
+            }
+            begin = column;
+        }
+    }
+}
+
+static int game_render_on_demand(const Game *game)
+{
+    trace_assert(game);
+
+    switch (game->state) {
+    case GAME_STATE_LEVEL_PICKER:
+    case GAME_STATE_LEVEL_EDITOR:
+    case GAME_STATE_CREDITS:
+    case GAME_STATE_SETTINGS:
+        return 1;
+
+    case GAME_STATE_LEVEL:
+        return game->level_paused;
+
+    case GAME_STATE_QUIT:
+        return 0;
+    }
+
+    return 0;
+}
+
+// Menus have ambient animations (drifting background, wiggly
+// titles) that would keep them dirty forever. They only play for a
+// while after the last input and then the screen settles down.
+static int game_ambient_animation(const Game *game)
+{
+    trace_assert(game);
+
+    switch (game->state) {
+    case GAME_STATE_LEVEL_PICKER:
+    case GAME_STATE_CREDITS:
+    case GAME_STATE_SETTINGS:
+        return game->idle_time < RENDER_ON_DEMAND_IDLE_TIMEOUT;
+
+    case GAME_STATE_LEVEL:
+    case GAME_STATE_LEVEL_EDITOR:
+    case GAME_STATE_QUIT:
+        return 0;
+    }
+
+    return 0;
+}
+
 void game_switch_state(Game *game, Game_state state)
 {
     game->cursor.style = CURSOR_STYLE_POINTER;
     if (state == GAME_STATE_LEVEL_PICKER) {
         level_picker_clean_selection(&game->level_picker);
     }
-    game->camera = create_camera(game->renderer, game->font);
+    game->camera = create_camera(game->draw_list, game->font);
     game->state = state;
+    game->render_dirty = 1;
+    game->idle_time = 0.0f;
+    game->level_paused = 0;
 }
 
 Game *create_game(const char *level_folder,
                   const char *sound_sample_files[],
                   size_t sound_sample_files_count,
-                  SDL_Renderer *renderer)
+                  SDL_Renderer *renderer,
+                  DrawList *draw_list)
 {
     trace_assert(level_folder);
+    trace_assert(draw_list);
 
     Lt *lt = create_lt();
 
@@ -63,9 +251,26 @@ Game *create_game(const char *level_folder,
     }
     game->lt = lt;
 
-    game->font.texture = load_bmp_font_texture(
-        renderer,
-        "./assets/images/charmap-oldschool.bmp");
+    const char *atlas_files[GAME_ATLAS_CHARMAPS_COUNT + CURSOR_STYLE_N];
+    for (size_t i = 0; i < GAME_ATLAS_CHARMAPS_COUNT; ++i) {
+        atlas_files[i] = game_atlas_charmaps[i];
+    }
+    for (Cursor_Style style = 0; style < CURSOR_STYLE_N; ++style) {
+        atlas_files[GAME_ATLAS_CHARMAPS_COUNT + style] = cursor_style_tex_files[style];
+    }
+
+    if (atlas_load_bmps(
+            &game->atlas,
+            renderer,
+            atlas_files,
+            GAME_ATLAS_CHARMAPS_COUNT + CURSOR_STYLE_N) < 0) {
+        RETURN_LT(lt, NULL);
+    }
+    PUSH_LT(lt, &game->atlas, destroy_atlas);
+
+    game->font.texture = game->atlas.texture;
+    game->font.surface = game->atlas.surface;
+    game->font.charmap = atlas_rect(&game->atlas, GAME_ATLAS_FONT);
 
     game->level_editor_memory.capacity = LEVEL_EDITOR_MEMORY_CAPACITY;
     game->level_editor_memory.buffer = malloc(LEVEL_EDITOR_MEMORY_CAPACITY);
@@ -73,6 +278,33 @@ Game *create_game(const char *level_folder,
 
     level_picker_populate(&game->level_picker, level_folder);
 
+    game->level_preloader = PUSH_LT(lt, create_level_preloader(), destroy_level_preloader);
+    if (game->level_preloader == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    game->level_reloader = PUSH_LT(lt, create_level_reloader(), destroy_level_reloader);
+    if (game->level_reloader == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    game->level_saver = PUSH_LT(lt, create_level_saver(), destroy_level_saver);
+    if (game->level_saver == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    game->level_journal = PUSH_LT(lt, create_level_journal(), destroy_level_journal);
+    if (game->level_journal == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    game->file_watcher = create_file_watcher(level_folder);
+    if (game->file_watcher != NULL) {
+        PUSH_LT(lt, game->file_watcher, destroy_file_watcher);
+    } else {
+        log_warn("The levels changed on disk are not going to be reloaded\n");
+    }
+
     game->credits = create_credits();
 
     game->sound_samples = PUSH_LT(
@@ -88,30 +320,19 @@ Game *create_game(const char *level_folder,
     game->settings = create_settings();
 
     game->renderer = renderer;
+    game->draw_list = draw_list;
 
+    game->cursor.texture = game->atlas.texture;
+    game->cursor.surface = game->atlas.surface;
     for (Cursor_Style style = 0; style < CURSOR_STYLE_N; ++style) {
-        game->cursor.texs[style] = PUSH_LT(
-            lt,
-            texture_from_bmp(cursor_style_tex_files[style], renderer),
-            SDL_DestroyTexture);
-        if (SDL_SetTextureBlendMode(
-                game->cursor.texs[style],
-                SDL_ComposeCustomBlendMode(
-                    SDL_BLENDFACTOR_ONE_MINUS_DST_COLOR,
-                    SDL_BLENDFACTOR_ONE_MINUS_SRC_COLOR,
-                    SDL_BLENDOPERATION_ADD,
-                    SDL_BLENDFACTOR_ONE,
-                    SDL_BLENDFACTOR_ZERO,
-                    SDL_BLENDOPERATION_ADD)) < 0) {
-            log_warn("SDL error while setting blending mode for `%s': %s\n",
-                     cursor_style_tex_files[style],
-                     SDL_GetError());
-        }
+        game->cursor.rects[style] = atlas_rect(&game->atlas, GAME_ATLAS_CHARMAPS_COUNT + style);
     }
 
     game->level_editor = create_level_editor(
         &game->level_editor_memory,
-        &game->cursor);
+        &game->cursor,
+        game->level_saver,
+        game->level_journal);
 
     game->console = PUSH_LT(
         lt,
@@ -127,10 +348,28 @@ Game *create_game(const char *level_folder,
     return game;
 }
 
+// The editor lives in level_editor_memory, so it is just forgotten.
+// A save that is still running is finished first.
+static void game_drop_level_editor(Game *game)
+{
+    trace_assert(game);
+
+    if (game->level_editor != NULL) {
+        level_editor_finish_save(game->level_editor);
+        game->level_editor = NULL;
+    }
+}
+
 void destroy_game(Game *game)
 {
     trace_assert(game);
+    game_drop_level_editor(game);
     destroy_level_picker(game->level_picker);
+    // What the default capacity of the memory should be
+    log_info("The level editor used %lu bytes of memory at most in %lu blocks\n",
+             (unsigned long) game->level_editor_memory.high_water,
+             (unsigned long) game->level_editor_memory.blocks_high_water + 1);
+    memory_clean(&game->level_editor_memory);
     free(game->level_editor_memory.buffer);
     RETURN_LT0(game->lt);
 }
@@ -139,11 +378,19 @@ int game_render(const Game *game)
 {
     trace_assert(game);
 
+    draw_list_subsystem(game->draw_list, DRAW_SUBSYSTEM_OTHER);
+
     switch(game->state) {
     case GAME_STATE_LEVEL: {
         if (level_render(game->level, &game->camera) < 0) {
             return -1;
         }
+
+        // The world does not change while paused, so everything
+        // recorded so far is captured once and reused
+        if (game->level_paused) {
+            draw_list_freeze(game->draw_list, game->freeze_id);
+        }
     } break;
 
     case GAME_STATE_LEVEL_PICKER: {
@@ -171,13 +418,22 @@ int game_render(const Game *game)
     case GAME_STATE_QUIT: break;
     }
 
+    if (game->camera.debug_mode) {
+        draw_list_subsystem(game->draw_list, DRAW_SUBSYSTEM_DEBUG);
+        game_render_overdraw(game);
+        game_render_draw_stats(game);
+    }
+
     if (game->console_enabled) {
+        draw_list_subsystem(game->draw_list, DRAW_SUBSYSTEM_CONSOLE);
         if (console_render(game->console, &game->camera) < 0) {
             return -1;
         }
     }
 
-    if (cursor_render(&game->cursor, game->renderer) < 0) {
+    draw_list_subsystem(game->draw_list, DRAW_SUBSYSTEM_OTHER);
+    draw_list_pass(game->draw_list, DRAW_PASS_SCREEN);
+    if (cursor_render(&game->cursor, game->draw_list) < 0) {
         return -1;
     }
 
@@ -202,22 +458,133 @@ int game_sound(Game *game)
     return 0;
 }
 
+// The file the level being played or edited comes from. NULL for a
+// new level that was never saved.
+static const char *game_level_file(const Game *game)
+{
+    if (game->level_editor != NULL) {
+        return game->level_editor->file_name;
+    }
+
+    return game->level_file_name[0] != '\0' ? game->level_file_name : NULL;
+}
+
+// The watcher reports the names relative to the level folder
+static bool game_is_level_file(const Game *game, const char *name)
+{
+    const char *file_name = game_level_file(game);
+    if (file_name == NULL) {
+        return false;
+    }
+
+    const char *slash = strrchr(file_name, '/');
+    return strcmp(slash ? slash + 1 : file_name, name) == 0;
+}
+
+static int game_reload_levels(Game *game)
+{
+    trace_assert(game);
+
+    // A save that is still running when its result is polled may
+    // report its events before its stamp
+    const bool saving = game->level_editor != NULL && level_saver_busy(game->level_saver);
+
+    // The stamp of the level that was just saved has to be known
+    // before its events are looked at
+    if (game->level_editor != NULL) {
+        level_editor_poll_save(game->level_editor);
+    }
+
+    bool level_changed = game->level_reload_deferred;
+    game->level_reload_deferred = false;
+
+    FileWatchEvent event;
+    while (game->file_watcher && file_watcher_poll(game->file_watcher, &event)) {
+        if (event.type == FILE_WATCH_REMOVED) {
+            level_picker_file_removed(&game->level_picker, event.name);
+            game->render_dirty = 1;
+            continue;
+        }
+
+        level_picker_file_written(&game->level_picker, event.name);
+        game->render_dirty = 1;
+
+        if (game_is_level_file(game, event.name)) {
+            level_changed = true;
+        }
+    }
+
+    // The player may have left the level since it was deferred
+    const char *changed = game_level_file(game);
+    if (level_changed && changed != NULL) {
+        // The level editor saving the level is not a change
+        FileStamp stamp;
+        const bool saved =
+            game->level_editor != NULL &&
+            file_stamp(&stamp, changed) == 0 &&
+            file_stamps_equal(stamp, game->level_editor->file_stamp);
+
+        if (saving && !saved) {
+            game->level_reload_deferred = true;
+        } else if (!saved) {
+            level_reloader_request(game->level_reloader, changed);
+        }
+    }
+
+    const char *file_name = NULL;
+    const LevelFile *level_file = level_reloader_take(game->level_reloader, &file_name);
+    if (level_file == NULL) {
+        return 0;
+    }
+
+    int result = 0;
+    // The player may have left the level while it was being parsed
+    const char *current = game_level_file(game);
+    if (current != NULL && strcmp(current, file_name) == 0) {
+        if (game->level_editor != NULL) {
+            level_editor_apply_file(game->level_editor, level_file);
+        }
+
+        if (game->level != NULL) {
+            result = level_apply_file(game->level, level_file);
+        }
+
+        log_info("Reloaded level `%s`\n", file_name);
+        game->render_dirty = 1;
+    }
+
+    level_reloader_release(game->level_reloader);
+
+    return result;
+}
+
 int game_update(Game *game, float delta_time)
 {
     trace_assert(game);
     trace_assert(delta_time > 0.0f);
 
     // TODO(#1218): effective scale recalculation should be probably done only when the size of the window is changed
-    SDL_Rect view_port;
-    SDL_RenderGetViewport(game->camera.renderer, &view_port);
-    game->camera.effective_scale = effective_scale(&view_port);
+    game->camera.effective_scale = effective_scale(&game->draw_list->view_port);
+
+    const Vec2f camera_position = game->camera.position;
+    const float camera_scale = game->camera.scale;
+    const float ambient_dt = game_ambient_animation(game) ? delta_time : 0.0f;
+    game->idle_time += delta_time;
 
     if (game->console_enabled) {
+        if (console_sliding(game->console)) {
+            game->render_dirty = 1;
+        }
+
         if (console_update(game->console, delta_time) < 0) {
             return -1;
         }
     }
 
+    if (game_reload_levels(game) < 0) {
+        return -1;
+    }
+
     switch (game->state) {
     case GAME_STATE_LEVEL: {
         if (level_update(game->level, delta_time) < 0) {
@@ -228,17 +595,38 @@ int game_update(Game *game, float delta_time)
             return -1;
         }
 
+        const int paused = level_pause_check(game->level);
+        if (paused != game->level_paused) {
+            if (paused) {
+                game->freeze_id += 1;
+            }
+            game->level_paused = paused;
+            game->render_dirty = 1;
+        }
     } break;
 
     case GAME_STATE_LEVEL_PICKER: {
-        if (level_picker_update(&game->level_picker, &game->camera, delta_time) < 0) {
+        const Vec2f items_scroll = game->level_picker.items_scroll;
+        const size_t metadata_version = game->level_picker.metadata_version;
+
+        if (level_picker_update(&game->level_picker, &game->camera, ambient_dt) < 0) {
             return -1;
         }
 
+        if (items_scroll.y != game->level_picker.items_scroll.y
+            || metadata_version != game->level_picker.metadata_version) {
+            game->render_dirty = 1;
+        }
+
         if (level_picker_enter_camera_event(&game->level_picker, &game->camera) < 0) {
             return -1;
         }
 
+        const char *cursor_level = level_picker_cursor_level(&game->level_picker);
+        if (cursor_level != NULL) {
+            level_preloader_request(game->level_preloader, cursor_level);
+        }
+
         const char *level_filename = level_picker_selected_level(&game->level_picker);
 
         if (level_filename != NULL) {
@@ -255,17 +643,21 @@ int game_update(Game *game, float delta_time)
             return -1;
         }
 
+        if (fading_wiggly_text_visible(&game->level_editor->notice)) {
+            game->render_dirty = 1;
+        }
+
         level_editor_update(game->level_editor, delta_time);
     } break;
 
     case GAME_STATE_CREDITS: {
-        if (credits_update(&game->credits, &game->camera, delta_time) < 0) {
+        if (credits_update(&game->credits, &game->camera, ambient_dt) < 0) {
             return -1;
         }
     } break;
 
     case GAME_STATE_SETTINGS: {
-        settings_update(&game->settings, &game->camera, delta_time);
+        settings_update(&game->settings, &game->camera, ambient_dt);
         sound_samples_update_volume(
             game->sound_samples,
             game->settings.volume_slider.value);
@@ -275,9 +667,54 @@ int game_update(Game *game, float delta_time)
         break;
     }
 
+    if (ambient_dt > 0.0f ||
+        camera_position.x != game->camera.position.x ||
+        camera_position.y != game->camera.position.y ||
+        camera_scale != game->camera.scale) {
+        game->render_dirty = 1;
+    }
+
     return 0;
 }
 
+// Builds the level editor for the level that is being played if it
+// was not built yet
+static LevelEditor *game_level_editor(Game *game)
+{
+    trace_assert(game);
+
+    if (game->level_editor == NULL) {
+        memory_clean(&game->level_editor_memory);
+        game->level_editor = create_level_editor_from_file(
+            &game->level_editor_memory,
+            &game->cursor,
+            game->level_saver,
+            game->level_journal,
+            game->level_file_name);
+    }
+
+    return game->level_editor;
+}
+
+// Creates the level for the current level editor if there is one or
+// straight from the level file otherwise
+static Level *game_create_level(Game *game)
+{
+    trace_assert(game);
+
+    if (game->level_editor != NULL) {
+        return create_level_from_level_editor(game->level_editor);
+    }
+
+    memory_clean(&game->level_editor_memory);
+    Level *level = create_level_from_file(
+        game->level_file_name,
+        &game->level_editor_memory);
+    memory_clean(&game->level_editor_memory);
+
+    return level;
+}
+
 static int game_event_running(Game *game, const SDL_Event *event)
 {
     trace_assert(game);
@@ -291,8 +728,7 @@ static int game_event_running(Game *game, const SDL_Event *event)
                 game->level = RESET_LT(
                     game->lt,
                     game->level,
-                    create_level_from_level_editor(
-                        game->level_editor));
+                    game_create_level(game));
                 if (game->level == NULL) {
                     game_switch_state(game, GAME_STATE_QUIT);
                     return -1;
@@ -306,7 +742,9 @@ static int game_event_running(Game *game, const SDL_Event *event)
             } break;
 
             case SDLK_TAB: {
-                game_switch_state(game, GAME_STATE_LEVEL_EDITOR);
+                if (game_level_editor(game) != NULL) {
+                    game_switch_state(game, GAME_STATE_LEVEL_EDITOR);
+                }
             } break;
             }
         } break;
@@ -321,6 +759,11 @@ static int game_event_level_picker(Game *game, const SDL_Event *event)
     trace_assert(game);
     trace_assert(event);
 
+    // The keys are typed into the search instead of being shortcuts
+    if (game->level_picker.searching) {
+        return level_picker_event(&game->level_picker, event);
+    }
+
     switch (event->type) {
     case SDL_KEYDOWN: {
         switch(event->key.keysym.sym) {
@@ -342,10 +785,14 @@ static int game_event_level_picker(Game *game, const SDL_Event *event)
             if (event->key.keysym.mod & KMOD_CTRL) {
                 level_picker_cursor_down(&game->level_picker);
             } else {
+                game_drop_level_editor(game);
                 memory_clean(&game->level_editor_memory);
                 game->level_editor = create_level_editor(
                     &game->level_editor_memory,
-                    &game->cursor);
+                    &game->cursor,
+                    game->level_saver,
+                    game->level_journal);
+                game->level_file_name[0] = '\0';
 
                 if (game->level == NULL) {
                     game->level = PUSH_LT(
@@ -414,6 +861,9 @@ int game_event(Game *game, const SDL_Event *event)
     trace_assert(game);
     trace_assert(event);
 
+    game->render_dirty = 1;
+    game->idle_time = 0.0f;
+
     // Global event handling
     switch (event->type) {
     case SDL_QUIT: {
@@ -452,6 +902,10 @@ int game_event(Game *game, const SDL_Event *event)
             switch (event->key.keysym.sym) {
             case SDLK_BACKQUOTE:
             case SDLK_c: {
+                if (game->state == GAME_STATE_LEVEL_PICKER && game->level_picker.searching) {
+                    break;
+                }
+
                 if (event->key.keysym.mod == KMOD_NONE || event->key.keysym.mod == KMOD_NUM) {
                     SDL_StartTextInput();
                     game->console_enabled = 1;
@@ -544,39 +998,69 @@ int game_over_check(const Game *game)
     return game->state == GAME_STATE_QUIT;
 }
 
+int game_needs_render(const Game *game)
+{
+    trace_assert(game);
+    return !game_render_on_demand(game) || game->render_dirty;
+}
+
+void game_mark_rendered(Game *game)
+{
+    trace_assert(game);
+    game->render_dirty = 0;
+    draw_stats_collect(&game->draw_stats, game->draw_list);
+    if (game->camera.debug_mode) {
+        draw_overdraw_collect(&game->overdraw, game->draw_list);
+    }
+}
+
+const DrawStats *game_draw_stats(const Game *game)
+{
+    trace_assert(game);
+    return &game->draw_stats;
+}
+
+int game_idle_check(const Game *game)
+{
+    trace_assert(game);
+    return game_render_on_demand(game) && !game->render_dirty;
+}
+
+int game_level_check(const Game *game)
+{
+    trace_assert(game);
+    return game->state == GAME_STATE_LEVEL;
+}
+
 int game_load_level(Game *game, const char *level_filename)
 {
     trace_assert(game);
     trace_assert(level_filename);
 
-    memory_clean(&game->level_editor_memory);
-    game->level_editor =
-        create_level_editor_from_file(
-            &game->level_editor_memory,
-            &game->cursor,
-            level_filename);
+    if (strlen(level_filename) >= METADATA_FILEPATH_MAX_SIZE) {
+        log_fail("Level file path is too long: %s\n", level_filename);
+        return -1;
+    }
 
-    if (!game->level_editor) {
+    // Playing the level does not need the editor, so it is only
+    // built when the player opens it
+    game_drop_level_editor(game);
+    game->level_reload_deferred = false;
+    snprintf(game->level_file_name, METADATA_FILEPATH_MAX_SIZE, "%s", level_filename);
+
+    Level *level = level_preloader_take(game->level_preloader, level_filename);
+    if (level == NULL) {
+        level = game_create_level(game);
+    }
+    if (level == NULL) {
         game_switch_state(game, GAME_STATE_LEVEL_PICKER);
         return 0;
     }
 
     if (game->level == NULL) {
-        game->level = PUSH_LT(
-            game->lt,
-            create_level_from_level_editor(
-                game->level_editor),
-            destroy_level);
+        game->level = PUSH_LT(game->lt, level, destroy_level);
     } else {
-        game->level = RESET_LT(
-            game->lt,
-            game->level,
-            create_level_from_level_editor(
-                game->level_editor));
-    }
-
-    if (game->level == NULL) {
-        return -1;
+        game->level = RESET_LT(game->lt, game->level, level);
     }
 
     game_switch_state(game, GAME_STATE_LEVEL);
@@ -4,13 +4,18 @@
 #include <SDL.h>
 
 #include "game/sound_samples.h"
+#include "sdl/draw_list.h"
+#include "sdl/draw_stats.h"
 
 typedef struct Game Game;
 
+// The renderer is only used for loading the textures. All the
+// drawing is recorded into the draw_list.
 Game *create_game(const char *platforms_file_path,
                     const char *sound_sample_files[],
                     size_t sound_sample_files_count,
-                    SDL_Renderer *renderer);
+                    SDL_Renderer *renderer,
+                    DrawList *draw_list);
 void destroy_game(Game *game);
 
 int game_render(const Game *game);
@@ -24,6 +29,17 @@ int game_input(Game *game,
 
 int game_over_check(const Game *game);
 
+// Render-on-demand: the editor and the menus are only redrawn when
+// there was an input event, an animation is playing or the camera
+// moved. While the game is idle main() blocks on the event queue.
+int game_needs_render(const Game *game);
+// Must be called after game_render() before the draw list is handed
+// over. Also collects the draw statistics of the recorded frame.
+void game_mark_rendered(Game *game);
+const DrawStats *game_draw_stats(const Game *game);
+int game_idle_check(const Game *game);
+int game_level_check(const Game *game);
+
 typedef enum Game_state {
     GAME_STATE_LEVEL = 0,
     GAME_STATE_LEVEL_PICKER,
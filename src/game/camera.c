@@ -6,27 +6,82 @@
 #include <SDL.h>
 
 #include "camera.h"
-#include "sdl/renderer.h"
+#include "math/affine.h"
+#include "sdl/draw_list.h"
 #include "system/nth_alloc.h"
 #include "system/log.h"
 #include "system/stacktrace.h"
 
+#define CAMERA_TRIANGLES_BATCH 64
+
 static Triangle camera_triangle(const Camera *camera,
                                 const Triangle t);
 
+// Commands of the world pass are recorded in the coordinates of the
+// (possibly downscaled) offscreen target. Everything else about the
+// camera, including camera_point() and camera_map_screen(), stays
+// in the native screen coordinates.
+static DrawList *camera_world(const Camera *camera)
+{
+    draw_list_pass(camera->draw_list, DRAW_PASS_WORLD);
+    return camera->draw_list;
+}
+
+static DrawList *camera_screen(const Camera *camera)
+{
+    draw_list_pass(camera->draw_list, DRAW_PASS_SCREEN);
+    return camera->draw_list;
+}
+
+static Vec2f camera_world_point(const Camera *camera, Vec2f p)
+{
+    return vec_scala_mult(
+        camera_point(camera, p),
+        draw_list_render_scale(camera->draw_list));
+}
+
+static Rect camera_world_rect(const Camera *camera, Rect r)
+{
+    return rect_from_points(
+        camera_world_point(camera, vec(r.x, r.y)),
+        camera_world_point(camera, vec(r.x + r.w, r.y + r.h)));
+}
+
+// camera_world_point() as a single affine transformation
+static Affine camera_world_affine(const Camera *camera)
+{
+    const SDL_Rect view_port = camera->draw_list->view_port;
+    const float render_scale = draw_list_render_scale(camera->draw_list);
+    const float sx = camera->effective_scale.x * camera->scale;
+    const float sy = camera->effective_scale.y * camera->scale;
+
+    return affine(
+        sx * render_scale, 0.0f, ((float) view_port.w * 0.5f - camera->position.x * sx) * render_scale,
+        0.0f, sy * render_scale, ((float) view_port.h * 0.5f - camera->position.y * sy) * render_scale);
+}
+
 static SDL_Color camera_sdl_color(const Camera *camera, Color color)
 {
     return color_for_sdl(camera->blackwhite_mode ? color_desaturate(color) : color);
 }
 
-Camera create_camera(SDL_Renderer *renderer,
+static SDL_Color camera_sdl_debug_color(const Camera *camera, Color color)
+{
+    SDL_Color sdl_color = camera_sdl_color(camera, color);
+    if (camera->debug_mode) {
+        sdl_color.a = sdl_color.a / 2;
+    }
+    return sdl_color;
+}
+
+Camera create_camera(DrawList *draw_list,
                      Sprite_font font)
 {
-    trace_assert(renderer);
+    trace_assert(draw_list);
 
     Camera camera = {
         .scale = 1.0f,
-        .renderer = renderer,
+        .draw_list = draw_list,
         .font = font
     };
 
@@ -40,26 +95,11 @@ int camera_fill_rect(const Camera *camera,
     trace_assert(camera);
 
     const SDL_Rect sdl_rect = rect_for_sdl(
-        camera_rect(camera, rect));
-
-    const SDL_Color sdl_color = camera_sdl_color(camera, color);
-
-    if (camera->debug_mode) {
-        if (SDL_SetRenderDrawColor(camera->renderer, sdl_color.r, sdl_color.g, sdl_color.b, sdl_color.a / 2) < 0) {
-            log_fail("SDL_SetRenderDrawColor: %s\n", SDL_GetError());
-            return -1;
-        }
-    } else {
-        if (SDL_SetRenderDrawColor(camera->renderer, sdl_color.r, sdl_color.g, sdl_color.b, sdl_color.a) < 0) {
-            log_fail("SDL_SetRenderDrawColor: %s\n", SDL_GetError());
-            return -1;
-        }
-    }
+        camera_world_rect(camera, rect));
 
-    if (SDL_RenderFillRect(camera->renderer, &sdl_rect) < 0) {
-        log_fail("SDL_RenderFillRect: %s\n", SDL_GetError());
-        return -1;
-    }
+    DrawList *draw_list = camera_world(camera);
+    draw_list_color(draw_list, camera_sdl_debug_color(camera, color));
+    draw_list_fill_rect(draw_list, sdl_rect);
 
     return 0;
 }
@@ -71,19 +111,11 @@ int camera_draw_rect(const Camera *camera,
     trace_assert(camera);
 
     const SDL_Rect sdl_rect = rect_for_sdl(
-        camera_rect(camera, rect));
+        camera_world_rect(camera, rect));
 
-    const SDL_Color sdl_color = camera_sdl_color(camera, color);
-
-    if (SDL_SetRenderDrawColor(camera->renderer, sdl_color.r, sdl_color.g, sdl_color.b, sdl_color.a) < 0) {
-        log_fail("SDL_SetRenderDrawColor: %s\n", SDL_GetError());
-        return -1;
-    }
-
-    if (SDL_RenderDrawRect(camera->renderer, &sdl_rect) < 0) {
-        log_fail("SDL_RenderDrawRect: %s\n", SDL_GetError());
-        return -1;
-    }
+    DrawList *draw_list = camera_world(camera);
+    draw_list_color(draw_list, camera_sdl_color(camera, color));
+    draw_list_draw_rect(draw_list, sdl_rect);
 
     return 0;
 }
@@ -95,17 +127,10 @@ int camera_draw_rect_screen(const Camera *camera,
     trace_assert(camera);
 
     const SDL_Rect sdl_rect = rect_for_sdl(rect);
-    const SDL_Color sdl_color = camera_sdl_color(camera, color);
 
-    if (SDL_SetRenderDrawColor(camera->renderer, sdl_color.r, sdl_color.g, sdl_color.b, sdl_color.a) < 0) {
-        log_fail("SDL_SetRenderDrawColor: %s\n", SDL_GetError());
-        return -1;
-    }
-
-    if (SDL_RenderDrawRect(camera->renderer, &sdl_rect) < 0) {
-        log_fail("SDL_RenderDrawRect: %s\n", SDL_GetError());
-        return -1;
-    }
+    DrawList *draw_list = camera_screen(camera);
+    draw_list_color(draw_list, camera_sdl_color(camera, color));
+    draw_list_draw_rect(draw_list, sdl_rect);
 
     return 0;
 }
@@ -116,16 +141,9 @@ int camera_draw_triangle(Camera *camera,
 {
     trace_assert(camera);
 
-    const SDL_Color sdl_color = camera_sdl_color(camera, color);
-
-    if (SDL_SetRenderDrawColor(camera->renderer, sdl_color.r, sdl_color.g, sdl_color.b, sdl_color.a) < 0) {
-        log_fail("SDL_SetRenderDrawColor: %s\n", SDL_GetError());
-        return -1;
-    }
-
-    if (draw_triangle(camera->renderer, camera_triangle(camera, t)) < 0) {
-        return -1;
-    }
+    DrawList *draw_list = camera_world(camera);
+    draw_list_color(draw_list, camera_sdl_color(camera, color));
+    draw_list_draw_triangle(draw_list, camera_triangle(camera, t));
 
     return 0;
 }
@@ -136,22 +154,32 @@ int camera_fill_triangle(const Camera *camera,
 {
     trace_assert(camera);
 
-    const SDL_Color sdl_color = camera_sdl_color(camera, color);
+    DrawList *draw_list = camera_world(camera);
+    draw_list_color(draw_list, camera_sdl_debug_color(camera, color));
+    draw_list_fill_triangle(draw_list, camera_triangle(camera, t));
 
-    if (camera->debug_mode) {
-        if (SDL_SetRenderDrawColor(camera->renderer, sdl_color.r, sdl_color.g, sdl_color.b, sdl_color.a / 2) < 0) {
-            log_fail("SDL_SetRenderDrawColor: %s\n", SDL_GetError());
-            return -1;
-        }
-    } else {
-        if (SDL_SetRenderDrawColor(camera->renderer, sdl_color.r, sdl_color.g, sdl_color.b, sdl_color.a) < 0) {
-            log_fail("SDL_SetRenderDrawColor: %s\n", SDL_GetError());
-            return -1;
-        }
-    }
+    return 0;
+}
 
-    if (fill_triangle(camera->renderer, camera_triangle(camera, t)) < 0) {
-        return -1;
+int camera_fill_triangles(const Camera *camera,
+                          const Triangle *ts,
+                          size_t n,
+                          Color color)
+{
+    trace_assert(camera);
+    trace_assert(ts);
+
+    const Affine m = camera_world_affine(camera);
+    Triangle batch[CAMERA_TRIANGLES_BATCH];
+
+    DrawList *draw_list = camera_world(camera);
+    draw_list_color(draw_list, camera_sdl_debug_color(camera, color));
+    for (size_t i = 0; i < n; i += CAMERA_TRIANGLES_BATCH) {
+        const size_t k = n - i < CAMERA_TRIANGLES_BATCH ? n - i : CAMERA_TRIANGLES_BATCH;
+        affine_transform_triangles(m, ts + i, batch, k);
+        for (size_t j = 0; j < k; ++j) {
+            draw_list_fill_triangle(draw_list, batch[j]);
+        }
     }
 
     return 0;
@@ -163,17 +191,15 @@ int camera_render_text(const Camera *camera,
                        Color c,
                        Vec2f position)
 {
-    SDL_Rect view_port;
-    SDL_RenderGetViewport(camera->renderer, &view_port);
-
-    const Vec2f scale = camera->effective_scale;
-    const Vec2f screen_position = camera_point(camera, position);
+    const float render_scale = draw_list_render_scale(camera->draw_list);
+    const Vec2f scale = vec_scala_mult(camera->effective_scale, camera->scale * render_scale);
+    const Vec2f screen_position = camera_world_point(camera, position);
 
     sprite_font_render_text(
         &camera->font,
-        camera->renderer,
+        camera_world(camera),
         screen_position,
-        vec(size.x * scale.x * camera->scale, size.y * scale.y * camera->scale),
+        vec(size.x * scale.x, size.y * scale.y),
         camera->blackwhite_mode ? color_desaturate(c) : c,
         text);
 
@@ -206,17 +232,9 @@ int camera_render_debug_text(const Camera *camera,
 int camera_clear_background(const Camera *camera,
                             Color color)
 {
-    const SDL_Color sdl_color = camera_sdl_color(camera, color);
-
-    if (SDL_SetRenderDrawColor(camera->renderer, sdl_color.r, sdl_color.g, sdl_color.b, sdl_color.a) < 0) {
-        log_fail("SDL_SetRenderDrawColor: %s\n", SDL_GetError());
-        return -1;
-    }
-
-    if (SDL_RenderClear(camera->renderer) < 0) {
-        log_fail("SDL_RenderClear: %s\n", SDL_GetError());
-        return -1;
-    }
+    DrawList *draw_list = camera_world(camera);
+    draw_list_color(draw_list, camera_sdl_color(camera, color));
+    draw_list_clear(draw_list);
 
     return 0;
 }
@@ -247,8 +265,7 @@ void camera_disable_debug_mode(Camera *camera)
 
 int camera_is_point_visible(const Camera *camera, Vec2f p)
 {
-    SDL_Rect view_port;
-    SDL_RenderGetViewport(camera->renderer, &view_port);
+    const SDL_Rect view_port = camera->draw_list->view_port;
 
     return rect_contains_point(
         rect_from_sdl(&view_port),
@@ -259,8 +276,7 @@ Rect camera_view_port(const Camera *camera)
 {
     trace_assert(camera);
 
-    SDL_Rect view_port;
-    SDL_RenderGetViewport(camera->renderer, &view_port);
+    const SDL_Rect view_port = camera->draw_list->view_port;
 
     Vec2f p1 = camera_map_screen(
         camera,
@@ -278,8 +294,7 @@ Rect camera_view_port_screen(const Camera *camera)
 {
     trace_assert(camera);
 
-    SDL_Rect view_port;
-    SDL_RenderGetViewport(camera->renderer, &view_port);
+    const SDL_Rect view_port = camera->draw_list->view_port;
 
     return rect_from_sdl(&view_port);
 }
@@ -292,8 +307,7 @@ int camera_is_text_visible(const Camera *camera,
     trace_assert(camera);
     trace_assert(text);
 
-    SDL_Rect view_port;
-    SDL_RenderGetViewport(camera->renderer, &view_port);
+    const SDL_Rect view_port = camera->draw_list->view_port;
 
     return rects_overlap(
         camera_rect(
@@ -306,8 +320,7 @@ int camera_is_text_visible(const Camera *camera,
 
 Vec2f camera_point(const Camera *camera, const Vec2f p)
 {
-    SDL_Rect view_port;
-    SDL_RenderGetViewport(camera->renderer, &view_port);
+    const SDL_Rect view_port = camera->draw_list->view_port;
 
     return vec_sum(
         vec_scala_mult(
@@ -322,10 +335,7 @@ Vec2f camera_point(const Camera *camera, const Vec2f p)
 static Triangle camera_triangle(const Camera *camera,
                                 const Triangle t)
 {
-    return triangle(
-        camera_point(camera, t.p1),
-        camera_point(camera, t.p2),
-        camera_point(camera, t.p3));
+    return affine_triangle(camera_world_affine(camera), t);
 }
 
 Rect camera_rect(const Camera *camera, const Rect rect)
@@ -361,8 +371,7 @@ Vec2f camera_map_screen(const Camera *camera,
 {
     trace_assert(camera);
 
-    SDL_Rect view_port;
-    SDL_RenderGetViewport(camera->renderer, &view_port);
+    const SDL_Rect view_port = camera->draw_list->view_port;
 
     Vec2f es = camera->effective_scale;
     es.x = 1.0f / es.x;
@@ -389,24 +398,10 @@ int camera_fill_rect_screen(const Camera *camera,
     trace_assert(camera);
 
     const SDL_Rect sdl_rect = rect_for_sdl(rect);
-    const SDL_Color sdl_color = camera_sdl_color(camera, color);
-
-    if (camera->debug_mode) {
-        if (SDL_SetRenderDrawColor(camera->renderer, sdl_color.r, sdl_color.g, sdl_color.b, sdl_color.a / 2) < 0) {
-            log_fail("SDL_SetRenderDrawColor: %s\n", SDL_GetError());
-            return -1;
-        }
-    } else {
-        if (SDL_SetRenderDrawColor(camera->renderer, sdl_color.r, sdl_color.g, sdl_color.b, sdl_color.a) < 0) {
-            log_fail("SDL_SetRenderDrawColor: %s\n", SDL_GetError());
-            return -1;
-        }
-    }
 
-    if (SDL_RenderFillRect(camera->renderer, &sdl_rect) < 0) {
-        log_fail("SDL_RenderFillRect: %s\n", SDL_GetError());
-        return -1;
-    }
+    DrawList *draw_list = camera_screen(camera);
+    draw_list_color(draw_list, camera_sdl_debug_color(camera, color));
+    draw_list_fill_rect(draw_list, sdl_rect);
 
     return 0;
 
@@ -423,7 +418,7 @@ void camera_render_text_screen(const Camera *camera,
 
     sprite_font_render_text(
         &camera->font,
-        camera->renderer,
+        camera_screen(camera),
         position,
         size,
         color,
@@ -494,25 +489,17 @@ int camera_draw_line(const Camera *camera,
 {
     trace_assert(camera);
 
-    const Vec2f camera_begin = camera_point(camera, begin);
-    const Vec2f camera_end = camera_point(camera, end);
-
-    const SDL_Color sdl_color = camera_sdl_color(camera, color);
-
-    if (SDL_SetRenderDrawColor(camera->renderer, sdl_color.r, sdl_color.g, sdl_color.b, sdl_color.a) < 0) {
-        log_fail("SDL_SetRenderDrawColor: %s\n", SDL_GetError());
-        return -1;
-    }
-
-    if (SDL_RenderDrawLine(
-            camera->renderer,
-            (int)roundf(camera_begin.x),
-            (int)roundf(camera_begin.y),
-            (int)roundf(camera_end.x),
-            (int)roundf(camera_end.y)) < 0) {
-        log_fail("SDL_RenderDrawRect: %s\n", SDL_GetError());
-        return -1;
-    }
+    const Vec2f camera_begin = camera_world_point(camera, begin);
+    const Vec2f camera_end = camera_world_point(camera, end);
+
+    DrawList *draw_list = camera_world(camera);
+    draw_list_color(draw_list, camera_sdl_color(camera, color));
+    draw_list_line(
+        draw_list,
+        (int)roundf(camera_begin.x),
+        (int)roundf(camera_begin.y),
+        (int)roundf(camera_end.x),
+        (int)roundf(camera_end.y));
 
     return 0;
 }
@@ -8,6 +8,7 @@
 #include "math/vec.h"
 #include "math/rect.h"
 #include "math/triangle.h"
+#include "sdl/draw_list.h"
 #include "config.h"
 
 typedef struct {
@@ -15,12 +16,12 @@ typedef struct {
     bool blackwhite_mode;
     Vec2f position;
     float scale;
-    SDL_Renderer *renderer;
+    DrawList *draw_list;
     Sprite_font font;
     Vec2f effective_scale;
 } Camera;
 
-Camera create_camera(SDL_Renderer *renderer,
+Camera create_camera(DrawList *draw_list,
                      Sprite_font font);
 
 int camera_clear_background(const Camera *camera,
@@ -55,6 +56,12 @@ int camera_fill_triangle(const Camera *camera,
                          Triangle t,
                          Color color);
 
+// Same color for the whole batch, so it is set only once
+int camera_fill_triangles(const Camera *camera,
+                          const Triangle *ts,
+                          size_t n,
+                          Color color);
+
 int camera_render_text(const Camera *camera,
                        const char *text,
                        Vec2f size,
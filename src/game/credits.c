@@ -31,7 +31,7 @@ int credits_render(const Credits *credits, const Camera *camera)
 
     const Rect viewport = camera_view_port_screen(camera);
 
-    if (background_render(&credits->background, camera) < 0) {
+    if (background_render(&credits->background, camera, NULL) < 0) {
         return -1;
     }
 
@@ -8,17 +8,15 @@
 #include "game/level/boxes.h"
 #include "game/level/goals.h"
 #include "game/level/labels.h"
+#include "game/level/level_file.h"
+#include "game/level/level_stream.h"
 #include "game/level/lava.h"
 #include "game/level/platforms.h"
 #include "game/level/phantom_platforms.h"
+#include "game/level/particles.h"
 #include "game/level/player.h"
 #include "game/level/regions.h"
 #include "game/level/rigid_bodies.h"
-#include "game/level/level_editor/rect_layer.h"
-#include "game/level/level_editor/point_layer.h"
-#include "game/level/level_editor/player_layer.h"
-#include "game/level/level_editor/label_layer.h"
-#include "game/level/level_editor/background_layer.h"
 #include "system/log.h"
 #include "system/lt.h"
 #include "system/nth_alloc.h"
@@ -28,6 +26,10 @@
 
 #define LEVEL_GRAVITY 1500.0f
 #define JOYSTICK_THRESHOLD 1000
+// How far the player goes before the chunk around them is requested
+// again. Way less than LEVEL_STREAM_RADIUS, so the next chunk is
+// normally built long before the player gets out of the current one.
+#define LEVEL_STREAM_REFRESH_DISTANCE 1024.0f
 
 typedef enum {
     LEVEL_STATE_IDLE = 0,
@@ -41,6 +43,7 @@ struct Level
     LevelState state;
     Background background;
     RigidBodies *rigid_bodies;
+    Particles *particles;
     Player *player;
     Platforms *platforms;
     Goals *goals;
@@ -50,14 +53,63 @@ struct Level
     Labels *labels;
     Regions *regions;
     Phantom_Platforms pp;
+
+    // Only the sectored levels are streamed. Then the platforms,
+    // back_platforms, lava and labels are the ones of the chunk
+    // around stream_center.
+    LevelStream *stream;
+    Vec2f stream_center;
+    Rect stream_area;
+
+    // What the level was created from, so a reloaded level file only
+    // rebuilds the layers that changed
+    LevelFileHashes hashes;
 };
 
-Level *create_level_from_level_editor(const LevelEditor *level_editor)
+// Creates the stores that are streamed for the sectored levels
+static int level_create_chunk(Level *level, const LevelFile *level_file)
 {
-    trace_assert(level_editor);
+    LevelChunk chunk;
+
+    if (level->stream) {
+        level->stream_center = level_file->player_position;
+        if (level_stream_load(level->stream, level->stream_center, &chunk) < 0) {
+            return -1;
+        }
+    } else {
+        memset(&chunk, 0, sizeof(chunk));
+
+        chunk.platforms = create_platforms(&level_file->platforms);
+        chunk.back_platforms = create_platforms(&level_file->back_platforms);
+        chunk.lava = create_lava(&level_file->lava);
+        chunk.labels = create_labels(&level_file->labels);
+        if (chunk.platforms == NULL || chunk.back_platforms == NULL ||
+            chunk.lava == NULL || chunk.labels == NULL) {
+            destroy_level_chunk(&chunk);
+            return -1;
+        }
+        platforms_cull_occluded(chunk.back_platforms, chunk.platforms);
+    }
+
+    level->platforms = PUSH_LT(level->lt, chunk.platforms, destroy_platforms);
+    level->back_platforms = PUSH_LT(level->lt, chunk.back_platforms, destroy_platforms);
+    level->lava = PUSH_LT(level->lt, chunk.lava, destroy_lava);
+    level->labels = PUSH_LT(level->lt, chunk.labels, destroy_labels);
+    level->stream_area = chunk.area;
+
+    return 0;
+}
+
+static Level *level_create(const LevelFile *level_file, LevelStream *stream)
+{
+    trace_assert(level_file);
 
     Lt *lt = create_lt();
 
+    if (stream) {
+        PUSH_LT(lt, stream, destroy_level_stream);
+    }
+
     Level *level = PUSH_LT(
         lt,
         nth_calloc(1, sizeof(Level)),
@@ -66,78 +118,57 @@ Level *create_level_from_level_editor(const LevelEditor *level_editor)
         RETURN_LT(lt, NULL);
     }
     level->lt = lt;
+    level->stream = stream;
+    level->hashes = level_file_hashes(level_file);
 
-    level->background = create_background(
-        color_picker_rgba(
-            &level_editor->background_layer.color_picker));
+    level->background = create_background(level_file->background_color);
 
     level->rigid_bodies = PUSH_LT(lt, create_rigid_bodies(1024), destroy_rigid_bodies);
     if (level->rigid_bodies == NULL) {
         RETURN_LT(lt, NULL);
     }
 
+    level->particles = PUSH_LT(lt, create_particles(1024), destroy_particles);
+    if (level->particles == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
     level->player = PUSH_LT(
         lt,
-        create_player_from_player_layer(
-            &level_editor->player_layer,
-            level->rigid_bodies),
+        create_player(
+            level_file->player_position,
+            level_file->player_color,
+            level->rigid_bodies,
+            level->particles),
         destroy_player);
     if (level->player == NULL) {
         RETURN_LT(lt, NULL);
     }
 
-    level->platforms = PUSH_LT(
-        lt,
-        create_platforms_from_rect_layer(level_editor->platforms_layer),
-        destroy_platforms);
-    if (level->platforms == NULL) {
+    if (level_create_chunk(level, level_file) < 0) {
         RETURN_LT(lt, NULL);
     }
 
     level->goals = PUSH_LT(
         lt,
-        create_goals_from_point_layer(level_editor->goals_layer),
+        create_goals(&level_file->goals),
         destroy_goals);
     if (level->goals == NULL) {
         RETURN_LT(lt, NULL);
     }
 
-    level->lava = PUSH_LT(
-        lt,
-        create_lava_from_rect_layer(level_editor->lava_layer),
-        destroy_lava);
-    if (level->lava == NULL) {
-        RETURN_LT(lt, NULL);
-    }
-
-    level->back_platforms = PUSH_LT(
-        lt,
-        create_platforms_from_rect_layer(level_editor->back_platforms_layer),
-        destroy_platforms);
-    if (level->back_platforms == NULL) {
-        RETURN_LT(lt, NULL);
-    }
-
     level->boxes = PUSH_LT(
         lt,
-        create_boxes_from_rect_layer(level_editor->boxes_layer, level->rigid_bodies),
+        create_boxes(&level_file->boxes, level->rigid_bodies),
         destroy_boxes);
     if (level->boxes == NULL) {
         RETURN_LT(lt, NULL);
     }
 
-    level->labels = PUSH_LT(
-        lt,
-        create_labels_from_label_layer(level_editor->label_layer),
-        destroy_labels);
-    if (level->labels == NULL) {
-        RETURN_LT(lt, NULL);
-    }
-
     level->regions = PUSH_LT(
         lt,
-        create_regions_from_rect_layer(
-            level_editor->regions_layer,
+        create_regions(
+            &level_file->regions,
             level->labels,
             level->goals),
         destroy_regions);
@@ -145,11 +176,151 @@ Level *create_level_from_level_editor(const LevelEditor *level_editor)
         RETURN_LT(lt, NULL);
     }
 
-    level->pp = create_phantom_platforms(level_editor->pp_layer);
+    level->pp = create_phantom_platforms(&level_file->pp);
+
+    return level;
+}
+
+Level *create_level(const LevelFile *level_file)
+{
+    return level_create(level_file, NULL);
+}
+
+Level *create_level_from_level_editor(const LevelEditor *level_editor)
+{
+    trace_assert(level_editor);
+
+    const LevelFile level_file = level_editor_level_file(level_editor);
+    return create_level(&level_file);
+}
+
+Level *create_level_from_file(const char *file_name, Memory *memory)
+{
+    trace_assert(file_name);
+    trace_assert(memory);
+
+    LevelFile level_file;
+    if (level_file_load(&level_file, memory, file_name) < 0) {
+        return NULL;
+    }
+
+    Level *level = NULL;
+    if (level_file.sectors.count > 0) {
+        // The stream keeps a copy of the sectors, the mapped file is
+        // unloaded right away
+        LevelStream *stream = create_level_stream(&level_file);
+        if (stream != NULL) {
+            level = level_create(&level_file, stream);
+        }
+    } else {
+        level = create_level(&level_file);
+    }
+    level_file_unload(&level_file);
 
     return level;
 }
 
+int level_apply_file(Level *level, const LevelFile *level_file)
+{
+    trace_assert(level);
+    trace_assert(level_file);
+
+    if (level->stream) {
+        log_warn("Streamed levels are not reloaded\n");
+        return 0;
+    }
+
+    const LevelFileHashes hashes = level_file_hashes(level_file);
+    const unsigned diff = level_file_hashes_diff(&level->hashes, &hashes);
+
+#define LEVEL_LAYER_CHANGED(layer) (diff & (1u << (layer)))
+
+    if (LEVEL_LAYER_CHANGED(LEVEL_FILE_BACKGROUND)) {
+        level->background = create_background(level_file->background_color);
+    }
+
+    // The back platforms are culled against the front ones
+    if (LEVEL_LAYER_CHANGED(LEVEL_FILE_PLATFORMS) ||
+        LEVEL_LAYER_CHANGED(LEVEL_FILE_BACK_PLATFORMS)) {
+        Platforms *platforms = create_platforms(&level_file->platforms);
+        if (platforms == NULL) {
+            return -1;
+        }
+        Platforms *back_platforms = create_platforms(&level_file->back_platforms);
+        if (back_platforms == NULL) {
+            destroy_platforms(platforms);
+            return -1;
+        }
+        platforms_cull_occluded(back_platforms, platforms);
+
+        level->platforms = RESET_LT(level->lt, level->platforms, platforms);
+        level->back_platforms = RESET_LT(level->lt, level->back_platforms, back_platforms);
+    }
+
+    if (LEVEL_LAYER_CHANGED(LEVEL_FILE_LAVA)) {
+        Lava *lava = create_lava(&level_file->lava);
+        if (lava == NULL) {
+            return -1;
+        }
+        level->lava = RESET_LT(level->lt, level->lava, lava);
+    }
+
+    if (LEVEL_LAYER_CHANGED(LEVEL_FILE_LABELS)) {
+        Labels *labels = create_labels(&level_file->labels);
+        if (labels == NULL) {
+            return -1;
+        }
+        labels_copy_state(labels, level->labels);
+        regions_set_labels(level->regions, labels);
+        level->labels = RESET_LT(level->lt, level->labels, labels);
+    }
+
+    if (LEVEL_LAYER_CHANGED(LEVEL_FILE_BOXES)) {
+        Boxes *boxes = create_boxes(&level_file->boxes, level->rigid_bodies);
+        if (boxes == NULL) {
+            return -1;
+        }
+        level->boxes = RESET_LT(level->lt, level->boxes, boxes);
+    }
+
+    // The regions point at the goals, so they go together
+    if (LEVEL_LAYER_CHANGED(LEVEL_FILE_GOALS) ||
+        LEVEL_LAYER_CHANGED(LEVEL_FILE_REGIONS)) {
+        Goals *goals = level->goals;
+        if (LEVEL_LAYER_CHANGED(LEVEL_FILE_GOALS)) {
+            goals = create_goals(&level_file->goals);
+            if (goals == NULL) {
+                return -1;
+            }
+        }
+
+        Regions *regions = create_regions(&level_file->regions, level->labels, goals);
+        if (regions == NULL) {
+            if (goals != level->goals) {
+                destroy_goals(goals);
+            }
+            return -1;
+        }
+
+        level->regions = RESET_LT(level->lt, level->regions, regions);
+        if (goals != level->goals) {
+            level->goals = RESET_LT(level->lt, level->goals, goals);
+        }
+    }
+
+    if (LEVEL_LAYER_CHANGED(LEVEL_FILE_PP)) {
+        destroy_phantom_platforms(level->pp);
+        level->pp = create_phantom_platforms(&level_file->pp);
+    }
+
+#undef LEVEL_LAYER_CHANGED
+
+    // The player keeps playing where they are
+    level->hashes = hashes;
+
+    return 0;
+}
+
 void destroy_level(Level *level)
 {
     trace_assert(level);
@@ -161,44 +332,106 @@ int level_render(const Level *level, const Camera *camera)
 {
     trace_assert(level);
 
-    if (background_render(&level->background, camera) < 0) {
+    draw_list_subsystem(camera->draw_list, DRAW_SUBSYSTEM_BACKGROUND);
+    if (background_render(&level->background, camera, level->platforms) < 0) {
         return -1;
     }
 
+    draw_list_subsystem(camera->draw_list, DRAW_SUBSYSTEM_PLATFORMS);
     if (platforms_render(level->back_platforms, camera) < 0) {
         return -1;
     }
 
     phantom_platforms_render(&level->pp, camera);
 
+    draw_list_subsystem(camera->draw_list, DRAW_SUBSYSTEM_PLAYER);
     if (player_render(level->player, camera) < 0) {
         return -1;
     }
 
+    draw_list_subsystem(camera->draw_list, DRAW_SUBSYSTEM_PARTICLES);
+    if (particles_render(level->particles, camera) < 0) {
+        return -1;
+    }
+
+    draw_list_subsystem(camera->draw_list, DRAW_SUBSYSTEM_BOXES);
     if (boxes_render(level->boxes, camera) < 0) {
         return -1;
     }
 
+    draw_list_subsystem(camera->draw_list, DRAW_SUBSYSTEM_LAVA);
     if (lava_render(level->lava, camera) < 0) {
         return -1;
     }
 
+    draw_list_subsystem(camera->draw_list, DRAW_SUBSYSTEM_PLATFORMS);
     if (platforms_render(level->platforms, camera) < 0) {
         return -1;
     }
 
+    draw_list_subsystem(camera->draw_list, DRAW_SUBSYSTEM_GOALS);
     if (goals_render(level->goals, camera) < 0) {
         return -1;
     }
 
+    draw_list_subsystem(camera->draw_list, DRAW_SUBSYSTEM_LABELS);
     if (labels_render(level->labels, camera) < 0) {
         return -1;
     }
 
+    draw_list_subsystem(camera->draw_list, DRAW_SUBSYSTEM_REGIONS);
     if (regions_render(level->regions, camera) < 0) {
         return -1;
     }
 
+    draw_list_subsystem(camera->draw_list, DRAW_SUBSYSTEM_OTHER);
+
+    return 0;
+}
+
+static void level_swap_chunk(Level *level, LevelChunk *chunk)
+{
+    level_stream_swap_labels(level->stream, chunk->labels, level->labels);
+    regions_set_labels(level->regions, chunk->labels);
+
+    level->platforms = RESET_LT(level->lt, level->platforms, chunk->platforms);
+    level->back_platforms = RESET_LT(level->lt, level->back_platforms, chunk->back_platforms);
+    level->lava = RESET_LT(level->lt, level->lava, chunk->lava);
+    level->labels = RESET_LT(level->lt, level->labels, chunk->labels);
+    level->stream_area = chunk->area;
+}
+
+static int level_update_stream(Level *level)
+{
+    const Rect hitbox = player_hitbox(level->player);
+    const Vec2f center = rect_center(hitbox);
+
+    if (vec_length(vec_sub(center, level->stream_center)) > LEVEL_STREAM_REFRESH_DISTANCE) {
+        level_stream_request(level->stream, center);
+        level->stream_center = center;
+    }
+
+    // The player never gets out of the loaded area. If the loader
+    // falls behind (or the player is respawned far away) the level
+    // waits for it.
+    bool wait = !rect_contains_rect(level->stream_area, hitbox);
+    for (;;) {
+        LevelChunk chunk;
+        const int taken = level_stream_take(level->stream, &chunk, wait);
+        if (taken < 0) {
+            return -1;
+        }
+
+        if (taken == 0) {
+            break;
+        }
+
+        level_swap_chunk(level, &chunk);
+        wait = !rect_contains_rect(level->stream_area, hitbox);
+    }
+
+    boxes_freeze_outside(level->boxes, level->stream_area);
+
     return 0;
 }
 
@@ -211,10 +444,15 @@ int level_update(Level *level, float delta_time)
         return 0;
     }
 
+    if (level->stream && level_update_stream(level) < 0) {
+        return -1;
+    }
+
     boxes_float_in_lava(level->boxes, level->lava);
     rigid_bodies_apply_omniforce(level->rigid_bodies, vec(0.0f, LEVEL_GRAVITY));
 
     boxes_update(level->boxes, delta_time);
+    particles_update(level->particles, delta_time);
     player_update(level->player, delta_time);
 
     rigid_bodies_collide(level->rigid_bodies, level->platforms);
@@ -369,6 +607,12 @@ int level_enter_camera_event(Level *level, Camera *camera)
     return 0;
 }
 
+int level_pause_check(const Level *level)
+{
+    trace_assert(level);
+    return level->state == LEVEL_STATE_PAUSE;
+}
+
 void level_disable_pause_mode(Level *level, Camera *camera,
                               Sound_samples *sound_samples)
 {
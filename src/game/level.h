@@ -4,6 +4,7 @@
 #include <SDL.h>
 
 #include "game/camera.h"
+#include "game/level/level_file.h"
 #include "game/level/platforms.h"
 #include "game/level/player.h"
 #include "sound_samples.h"
@@ -11,9 +12,17 @@
 typedef struct Level Level;
 typedef struct LevelEditor LevelEditor;
 
+Level *create_level(const LevelFile *level_file);
 Level *create_level_from_level_editor(const LevelEditor *level_editor);
+// Reads the level file straight into the level without building the
+// level editor. memory is only used while the level is created.
+Level *create_level_from_file(const char *file_name, Memory *memory);
 void destroy_level(Level *level);
 
+// Rebuilds only the layers of the level that differ from level_file.
+// The player stays where they are. Streamed levels are left alone.
+int level_apply_file(Level *level, const LevelFile *level_file);
+
 int level_render(const Level *level, const Camera *camera);
 
 int level_sound(Level *level, Sound_samples *sound_samples);
@@ -26,6 +35,7 @@ int level_input(Level *level,
                 SDL_Joystick *the_stick_of_joy);
 int level_enter_camera_event(Level *level, Camera *camera);
 
+int level_pause_check(const Level *level);
 void level_disable_pause_mode(Level *level, Camera *camera,
                               Sound_samples *sound_samples);
 
@@ -1,6 +1,7 @@
 #include <stdio.h>
 
 #include "game/level/background.h"
+#include "game/level/platforms.h"
 #include "math/rand.h"
 #include "math/rect.h"
 #include "system/lt.h"
@@ -21,8 +22,19 @@ int render_chunk(const Camera *camera,
                  Vec2i chunk,
                  Color color);
 
+// Everything render_chunk() may draw for the chunk
+static inline
+Rect chunk_bounds(Vec2i chunk)
+{
+    return rect((float) chunk.x * BACKGROUND_CHUNK_WIDTH,
+                (float) chunk.y * BACKGROUND_CHUNK_HEIGHT,
+                BACKGROUND_CHUNK_WIDTH * 1.5f,
+                BACKGROUND_CHUNK_HEIGHT + BACKGROUND_CHUNK_WIDTH * 0.75f);
+}
+
 int background_render(const Background *background,
-                      const Camera *camera0)
+                      const Camera *camera0,
+                      const Platforms *occluders)
 {
     trace_assert(background);
     trace_assert(camera0);
@@ -46,6 +58,14 @@ int background_render(const Background *background,
 
         for (int x = min.x - 1; x <= max.x; ++x) {
             for (int y = min.y - 1; y <= max.y; ++y) {
+                if (occluders != NULL &&
+                    platforms_occlude_screen_rect(
+                        occluders,
+                        camera0,
+                        camera_rect(&camera, chunk_bounds(vec2i(x, y))))) {
+                    continue;
+                }
+
                 if (render_chunk(
                         &camera,
                         vec2i(x, y),
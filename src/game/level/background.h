@@ -17,8 +17,13 @@ Background create_background(Color base_color)
     return result;
 }
 
+typedef struct Platforms Platforms;
+
+// The chunks that end up entirely behind an opaque platform of
+// occluders are skipped. occluders may be NULL.
 int background_render(const Background *background,
-                      const Camera *camera);
+                      const Camera *camera,
+                      const Platforms *occluders);
 
 Color background_base_color(const Background *background);
 
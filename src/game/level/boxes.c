@@ -2,7 +2,6 @@
 
 #include "dynarray.h"
 #include "game/level/boxes.h"
-#include "game/level/level_editor/rect_layer.h"
 #include "game/level/player.h"
 #include "game/level/rigid_bodies.h"
 #include "math/rand.h"
@@ -21,9 +20,9 @@ struct Boxes
     Dynarray body_colors;
 };
 
-Boxes *create_boxes_from_rect_layer(const RectLayer *layer, RigidBodies *rigid_bodies)
+Boxes *create_boxes(const LevelRects *level_rects, RigidBodies *rigid_bodies)
 {
-    trace_assert(layer);
+    trace_assert(level_rects);
     trace_assert(rigid_bodies);
 
     Lt *lt = create_lt();
@@ -40,10 +39,10 @@ Boxes *create_boxes_from_rect_layer(const RectLayer *layer, RigidBodies *rigid_b
 
     boxes->rigid_bodies = rigid_bodies;
 
-    const size_t count = rect_layer_count(layer);
-    Rect const *rects = rect_layer_rects(layer);
-    Color const *colors = rect_layer_colors(layer);
-    const char *ids = rect_layer_ids(layer);
+    const size_t count = level_rects->count;
+    Rect const *rects = level_rects->rects;
+    Color const *colors = level_rects->colors;
+    const char *ids = level_rects->ids;
 
     for (size_t i = 0; i < count; ++i) {
         RigidBodyId body_id = rigid_bodies_add(rigid_bodies, rects[i]);
@@ -123,6 +122,22 @@ void boxes_float_in_lava(Boxes *boxes, Lava *lava)
     }
 }
 
+void boxes_freeze_outside(Boxes *boxes, Rect area)
+{
+    trace_assert(boxes);
+
+    const size_t count = boxes->body_ids.count;
+    RigidBodyId *body_ids = (RigidBodyId*)boxes->body_ids.data;
+
+    for (size_t i = 0; i < count; ++i) {
+        const Rect hitbox = rigid_bodies_hitbox(boxes->rigid_bodies, body_ids[i]);
+        rigid_bodies_disable(
+            boxes->rigid_bodies,
+            body_ids[i],
+            !rect_contains_rect(area, hitbox));
+    }
+}
+
 int boxes_add_box(Boxes *boxes, Rect rect, Color color)
 {
     trace_assert(boxes);
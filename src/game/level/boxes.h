@@ -7,16 +7,17 @@
 
 typedef struct Boxes Boxes;
 typedef struct Player Player;
-typedef struct Player Player;
-typedef struct RectLayer RectLayer;
 
-Boxes *create_boxes_from_rect_layer(const RectLayer *layer, RigidBodies *rigid_bodies);
+Boxes *create_boxes(const LevelRects *level_rects, RigidBodies *rigid_bodies);
 void destroy_boxes(Boxes *boxes);
 
 int boxes_render(Boxes *boxes, const Camera *camera);
 int boxes_update(Boxes *boxes, float delta_time);
 
 void boxes_float_in_lava(Boxes *boxes, Lava *lava);
+// Stops simulating the boxes that are not entirely inside of area,
+// so they do not fall through the platforms that are not loaded
+void boxes_freeze_outside(Boxes *boxes, Rect area);
 
 int boxes_add_box(Boxes *boxes, Rect rect, Color color);
 int boxes_delete_at(Boxes *boxes, Vec2f position);
@@ -3,8 +3,8 @@
 
 #include <SDL.h>
 
-#include "game/level/level_editor/point_layer.h"
 #include "goals.h"
+#include "math/affine.h"
 #include "math/pi.h"
 #include "math/triangle.h"
 #include "system/log.h"
@@ -34,9 +34,9 @@ struct Goals {
     float angle;
 };
 
-Goals *create_goals_from_point_layer(const PointLayer *point_layer)
+Goals *create_goals(const LevelPoints *level_points)
 {
-    trace_assert(point_layer);
+    trace_assert(level_points);
 
     Lt *lt = create_lt();
 
@@ -45,7 +45,7 @@ Goals *create_goals_from_point_layer(const PointLayer *point_layer)
         RETURN_LT(lt, NULL);
     }
 
-    goals->count = point_layer_count(point_layer);
+    goals->count = level_points->count;
 
     goals->ids = PUSH_LT(
         lt,
@@ -81,15 +81,15 @@ Goals *create_goals_from_point_layer(const PointLayer *point_layer)
         RETURN_LT(lt, NULL);
     }
 
-    const Vec2f *positions = point_layer_positions(point_layer);
-    const Color *colors = point_layer_colors(point_layer);
-    const char *ids = point_layer_ids(point_layer);
+    const Vec2f *positions = level_points->positions;
+    const Color *colors = level_points->colors;
+    const char *ids = level_points->ids;
 
-    // TODO(#835): we could use memcpy in create_goals_from_point_layer
+    // TODO(#835): we could use memcpy in create_goals
     for (size_t i = 0; i < goals->count; ++i) {
         goals->positions[i] = positions[i];
         goals->colors[i] = colors[i];
-        memcpy(goals->ids[i], ids + ID_MAX_SIZE * i, ID_MAX_SIZE);
+        memcpy(goals->ids[i], ids + ENTITY_MAX_ID_SIZE * i, ENTITY_MAX_ID_SIZE);
         goals->cue_states[i] = CUE_STATE_VIRGIN;
         goals->visible[i] = true;
     }
@@ -119,12 +119,13 @@ static int goals_render_core(const Goals *goals,
 
     if (camera_fill_triangle(
             camera,
-            triangle_mat3x3_product(
-                equilateral_triangle(),
-                mat3x3_product2(
-                    trans_mat(position.x, position.y),
-                    rot_mat(PI * -0.5f + goals->angle),
-                    scale_mat(GOAL_RADIUS))),
+            affine_triangle(
+                affine_compose(
+                    affine_translate_vec(position),
+                    affine_compose(
+                        affine_rotate(PI * -0.5f + goals->angle),
+                        affine_scale(GOAL_RADIUS, GOAL_RADIUS))),
+                equilateral_triangle()),
             goals->colors[goal_index]) < 0) {
         return -1;
     }
@@ -6,12 +6,12 @@
 #include "game/camera.h"
 #include "game/level/player.h"
 #include "game/sound_samples.h"
-#include "game/level/level_editor/point_layer.h"
+#include "game/level/level_file.h"
 #include "config.h"
 
 typedef struct Goals Goals;
 
-Goals *create_goals_from_point_layer(const PointLayer *point_layer);
+Goals *create_goals(const LevelPoints *level_points);
 void destroy_goals(Goals *goals);
 
 Rect goals_hitbox(const Goals *goals);
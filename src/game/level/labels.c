@@ -4,7 +4,6 @@
 #include "config.h"
 #include "game/camera.h"
 #include "game/level/labels.h"
-#include "game/level/level_editor/label_layer.h"
 #include "system/log.h"
 #include "system/lt.h"
 #include "system/nth_alloc.h"
@@ -33,9 +32,9 @@ struct Labels
     enum LabelState *states;
 };
 
-Labels *create_labels_from_label_layer(const LabelLayer *label_layer)
+Labels *create_labels(const LevelLabels *level_labels)
 {
-    trace_assert(label_layer);
+    trace_assert(level_labels);
 
     Lt *lt = create_lt();
 
@@ -45,14 +44,14 @@ Labels *create_labels_from_label_layer(const LabelLayer *label_layer)
     }
     labels->lt = lt;
 
-    labels->count = label_layer_count(label_layer);
+    labels->count = level_labels->count;
 
     labels->ids = PUSH_LT(lt, nth_calloc(labels->count, sizeof(char) * ENTITY_MAX_ID_SIZE), free);
     if (labels->ids == NULL) {
         RETURN_LT(lt, NULL);
     }
     memcpy(labels->ids,
-           label_layer_ids(label_layer),
+           level_labels->ids,
            labels->count * sizeof(char) * ENTITY_MAX_ID_SIZE);
 
     labels->positions = PUSH_LT(lt, nth_calloc(1, sizeof(Vec2f) * labels->count), free);
@@ -60,7 +59,7 @@ Labels *create_labels_from_label_layer(const LabelLayer *label_layer)
         RETURN_LT(lt, NULL);
     }
     memcpy(labels->positions,
-           label_layer_positions(label_layer),
+           level_labels->positions,
            labels->count * sizeof(Vec2f));
 
     labels->colors = PUSH_LT(lt, nth_calloc(1, sizeof(Color) * labels->count), free);
@@ -68,7 +67,7 @@ Labels *create_labels_from_label_layer(const LabelLayer *label_layer)
         RETURN_LT(lt, NULL);
     }
     memcpy(labels->colors,
-           label_layer_colors(label_layer),
+           level_labels->colors,
            labels->count * sizeof(Color));
 
     labels->texts = PUSH_LT(lt, nth_calloc(1, sizeof(char*) * labels->count), free);
@@ -76,11 +75,11 @@ Labels *create_labels_from_label_layer(const LabelLayer *label_layer)
         RETURN_LT(lt, NULL);
     }
 
-    char *texts = labels_layer_texts(label_layer);
+    const char *texts = level_labels->texts;
     for (size_t i = 0; i < labels->count; ++i) {
         labels->texts[i] = PUSH_LT(
             labels->lt,
-            string_duplicate(texts + i * LABEL_LAYER_TEXT_MAX_SIZE, NULL),
+            string_duplicate(texts + i * LEVEL_FILE_LABEL_TEXT_MAX_SIZE, NULL),
             free);
     }
 
@@ -192,3 +191,21 @@ void labels_hide(Labels *labels, char id[ENTITY_MAX_ID_SIZE])
         }
     }
 }
+
+void labels_copy_state(Labels *labels, const Labels *previous)
+{
+    trace_assert(labels);
+    trace_assert(previous);
+
+    for (size_t i = 0; i < labels->count; ++i) {
+        const char *id = labels->ids + i * ENTITY_MAX_ID_SIZE;
+        for (size_t j = 0; j < previous->count; ++j) {
+            if (strncmp(id, previous->ids + j * ENTITY_MAX_ID_SIZE, ENTITY_MAX_ID_SIZE) == 0) {
+                labels->alphas[i] = previous->alphas[j];
+                labels->delta_alphas[i] = previous->delta_alphas[j];
+                labels->states[i] = previous->states[j];
+                break;
+            }
+        }
+    }
+}
@@ -4,11 +4,14 @@
 #include "math/vec.h"
 #include "color.h"
 #include "config.h"
-#include "game/level/level_editor/label_layer.h"
+#include "game/camera.h"
+#include "game/level/level_file.h"
+
+#define LABELS_SIZE vec(2.0f, 2.0f)
 
 typedef struct Labels Labels;
 
-Labels *create_labels_from_label_layer(const LabelLayer *label_layer);
+Labels *create_labels(const LevelLabels *level_labels);
 void destroy_labels(Labels *label);
 
 int labels_render(const Labels *label,
@@ -18,5 +21,8 @@ void labels_update(Labels *label,
 void labels_enter_camera_event(Labels *label,
                                const Camera *camera);
 void labels_hide(Labels *label, char id[ENTITY_MAX_ID_SIZE]);
+// Carries the animation state of the labels that are also in
+// previous over (see level_stream_swap_labels)
+void labels_copy_state(Labels *labels, const Labels *previous);
 
 #endif  // LABELS_H_
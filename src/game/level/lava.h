@@ -4,13 +4,13 @@
 #include <stdbool.h>
 
 #include "game/camera.h"
+#include "game/level/level_file.h"
 #include "game/level/rigid_bodies.h"
 #include "math/rect.h"
 
 typedef struct Lava Lava;
-typedef struct RectLayer RectLayer;
 
-Lava *create_lava_from_rect_layer(const RectLayer *rect_layer);
+Lava *create_lava(const LevelRects *rects);
 void destroy_lava(Lava *lava);
 
 int lava_render(const Lava *lava,
@@ -1,3 +1,4 @@
+#include <errno.h>
 #include <stdbool.h>
 
 #include "game/camera.h"
@@ -9,6 +10,7 @@
 #include "game/level/level_editor/player_layer.h"
 #include "game/level/level_editor/label_layer.h"
 #include "game/level/level_editor/background_layer.h"
+#include "game/level/level_editor/level_sectors.h"
 #include "ui/edit_field.h"
 #include "system/stacktrace.h"
 #include "system/nth_alloc.h"
@@ -30,9 +32,33 @@
 
 static int level_editor_dump(LevelEditor *level_editor);
 
+static LayerPicker level_format_layer_order[LAYER_PICKER_N] = {
+    LAYER_PICKER_BACKGROUND,
+    LAYER_PICKER_PLAYER,
+    LAYER_PICKER_PLATFORMS,
+    LAYER_PICKER_GOALS,
+    LAYER_PICKER_LAVA,
+    LAYER_PICKER_BACK_PLATFORMS,
+    LAYER_PICKER_BOXES,
+    LAYER_PICKER_LABELS,
+    LAYER_PICKER_REGIONS,
+    LAYER_PICKER_PP
+};
+
+// The layers of LevelSectorLayer
+static LayerPicker level_sector_layer_pickers[LEVEL_SECTOR_LAYERS_N] = {
+    LAYER_PICKER_PLATFORMS,
+    LAYER_PICKER_BACK_PLATFORMS,
+    LAYER_PICKER_LAVA,
+    LAYER_PICKER_LABELS
+};
+
 // TODO(#994): too much duplicate code between create_level_editor and create_level_editor_from_file
 
-LevelEditor *create_level_editor(Memory *memory, Cursor *cursor)
+LevelEditor *create_level_editor(Memory *memory,
+                                 Cursor *cursor,
+                                 LevelSaver *saver,
+                                 LevelJournal *journal)
 {
     LevelEditor *level_editor = memory_alloc(memory, sizeof(LevelEditor));
     memset(level_editor, 0, sizeof(*level_editor));
@@ -75,22 +101,19 @@ LevelEditor *create_level_editor(Memory *memory, Cursor *cursor)
 
     level_editor->camera_scale = 1.0f;
     level_editor->undo_history = create_undo_history(memory);
+    level_editor->saver = saver;
+    level_editor->journal = journal;
+    if (journal) {
+        level_journal_reset(journal, level_editor->layers);
+    }
 
     return level_editor;
 }
 
-LevelEditor *create_level_editor_from_file(Memory *memory, Cursor *cursor, const char *file_name)
+static int level_editor_load_text(LevelEditor *level_editor,
+                                  Memory *memory,
+                                  String input)
 {
-    trace_assert(memory);
-    trace_assert(cursor);
-    trace_assert(file_name);
-
-    LevelEditor *level_editor = create_level_editor(memory, cursor);
-    level_editor->file_name = strdup_to_memory(memory, file_name);
-
-    String input = read_whole_file(memory, file_name);
-    trace_assert(input.data);
-
     String version = trim(chop_by_delim(&input, '\n'));
 
     if (string_equal(version, STRING_LIT("1"))) {
@@ -98,27 +121,163 @@ LevelEditor *create_level_editor_from_file(Memory *memory, Cursor *cursor, const
     } else if (string_equal(version, STRING_LIT("2"))) {
         // Nothing
     } else {
-        log_fail("Version `%s` is not supported. Expected version `%s`.\n",
-                 string_to_cstr(memory, version),
-                 VERSION);
-        return NULL;
+        log_fail("Version `%.*s` is not supported. Expected version `%s` or `%s`.\n",
+                 (int) version.count, version.data,
+                 VERSION, LEVEL_BINARY_VERSION);
+        return -1;
     }
 
     level_editor->background_layer = chop_background_layer(&input);
     level_editor->player_layer = chop_player_layer(memory, &input);
-    rect_layer_load(level_editor->platforms_layer, memory, &input);
-    point_layer_load(level_editor->goals_layer, memory, &input);
-    rect_layer_load(level_editor->lava_layer, memory, &input);
-    rect_layer_load(level_editor->back_platforms_layer, memory, &input);
-    rect_layer_load(level_editor->boxes_layer, memory, &input);
-    label_layer_load(level_editor->label_layer, memory, &input);
-    rect_layer_load(level_editor->regions_layer, memory, &input);
-    rect_layer_load(level_editor->pp_layer, memory, &input);
+    if (rect_layer_load(level_editor->platforms_layer, memory, &input) < 0 ||
+        point_layer_load(level_editor->goals_layer, memory, &input) < 0 ||
+        rect_layer_load(level_editor->lava_layer, memory, &input) < 0 ||
+        rect_layer_load(level_editor->back_platforms_layer, memory, &input) < 0 ||
+        rect_layer_load(level_editor->boxes_layer, memory, &input) < 0 ||
+        label_layer_load(level_editor->label_layer, memory, &input) < 0 ||
+        rect_layer_load(level_editor->regions_layer, memory, &input) < 0 ||
+        rect_layer_load(level_editor->pp_layer, memory, &input) < 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static int level_editor_load_binary(LevelEditor *level_editor,
+                                    String input)
+{
+    LevelBinaryReader reader;
+    if (level_binary_reader_begin(&reader, input) < 0) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < LAYER_PICKER_N; ++i) {
+        LevelBinarySlice slice;
+        if (level_binary_next_section(&reader, level_format_layer_order[i], &slice) < 0) {
+            return -1;
+        }
+
+        if (layer_load_binary(level_editor->layers[level_format_layer_order[i]], &slice) < 0) {
+            return -1;
+        }
+    }
+
+    // The sector index is rebuilt on every save, so it is enough to
+    // know that the level had one
+    level_editor->file_format = level_binary_has_next_section(&reader)
+        ? LEVEL_FORMAT_SECTORED
+        : LEVEL_FORMAT_BINARY;
+
+    return 0;
+}
+
+LevelEditor *create_level_editor_from_file(Memory *memory,
+                                           Cursor *cursor,
+                                           LevelSaver *saver,
+                                           LevelJournal *journal,
+                                           const char *file_name)
+{
+    trace_assert(memory);
+    trace_assert(cursor);
+    trace_assert(file_name);
+
+    // A level editor that failed to load gives its memory back
+    const MemoryMark mark = memory_mark(memory);
+
+    LevelEditor *level_editor = create_level_editor(memory, cursor, saver, journal);
+    level_editor->file_name = strdup_to_memory(memory, file_name);
+
+    // The layers copy everything they need out of the file, so it
+    // is mapped instead of being read into the memory
+    MappedFile file;
+    if (map_whole_file(&file, file_name) < 0) {
+        memory_rollback(memory, mark);
+        return NULL;
+    }
+
+    String input = mapped_file_content(&file);
+    String rest = input;
+    String version = trim(chop_by_delim(&rest, '\n'));
+    int result = 0;
+    if (string_equal(version, STRING_LIT(LEVEL_BINARY_VERSION))) {
+        result = level_editor_load_binary(level_editor, input);
+    } else {
+        level_editor->file_format = LEVEL_FORMAT_TEXT;
+        result = level_editor_load_text(level_editor, memory, input);
+    }
+
+    unmap_whole_file(&file);
+
+    if (result < 0) {
+        memory_rollback(memory, mark);
+        return NULL;
+    }
+
+    file_stamp(&level_editor->file_stamp, file_name);
     undo_history_clean(level_editor->undo_history);
 
+    if (journal && level_journal_open(
+            journal,
+            file_name,
+            level_editor->file_stamp,
+            level_editor->undo_history) > 0) {
+        log_info("Restored the unsaved edits of `%s`\n", file_name);
+        level_editor->notice.wiggly_text.text = "Unsaved edits restored";
+        fading_wiggly_text_reset(&level_editor->notice);
+    }
+
     return level_editor;
 }
 
+static LevelRects level_editor_rects(const RectLayer *layer)
+{
+    return (LevelRects) {
+        .count = rect_layer_count(layer),
+        .ids = rect_layer_ids(layer),
+        .rects = rect_layer_rects(layer),
+        .colors = rect_layer_colors(layer),
+        .actions = rect_layer_actions(layer)
+    };
+}
+
+LevelFile level_editor_level_file(const LevelEditor *level_editor)
+{
+    trace_assert(level_editor);
+    trace_assert(ID_MAX_SIZE == ENTITY_MAX_ID_SIZE);
+    trace_assert(LABEL_LAYER_ID_MAX_SIZE == ENTITY_MAX_ID_SIZE);
+
+    LevelFile level_file;
+    memset(&level_file, 0, sizeof(level_file));
+
+    level_file.background_color = color_picker_rgba(&level_editor->background_layer.color_picker);
+    level_file.player_position = level_editor->player_layer.position;
+    level_file.player_color = color_picker_rgba(&level_editor->player_layer.color_picker);
+
+    level_file.platforms = level_editor_rects(level_editor->platforms_layer);
+    level_file.lava = level_editor_rects(level_editor->lava_layer);
+    level_file.back_platforms = level_editor_rects(level_editor->back_platforms_layer);
+    level_file.boxes = level_editor_rects(level_editor->boxes_layer);
+    level_file.regions = level_editor_rects(level_editor->regions_layer);
+    level_file.pp = level_editor_rects(level_editor->pp_layer);
+
+    level_file.goals = (LevelPoints) {
+        .count = point_layer_count(level_editor->goals_layer),
+        .ids = point_layer_ids(level_editor->goals_layer),
+        .positions = point_layer_positions(level_editor->goals_layer),
+        .colors = point_layer_colors(level_editor->goals_layer)
+    };
+
+    level_file.labels = (LevelLabels) {
+        .count = label_layer_count(level_editor->label_layer),
+        .ids = label_layer_ids(level_editor->label_layer),
+        .positions = label_layer_positions(level_editor->label_layer),
+        .colors = label_layer_colors(level_editor->label_layer),
+        .texts = labels_layer_texts(level_editor->label_layer)
+    };
+
+    return level_file;
+}
+
 int level_editor_render(const LevelEditor *level_editor,
                         const Camera *camera)
 {
@@ -142,6 +301,7 @@ int level_editor_render(const LevelEditor *level_editor,
         }
     }
 
+    draw_list_subsystem(camera->draw_list, DRAW_SUBSYSTEM_EDITOR_LAYERS);
     for (size_t i = 0; i < LAYER_PICKER_N; ++i) {
         if (layer_render(
                 level_editor->layers[i],
@@ -150,6 +310,7 @@ int level_editor_render(const LevelEditor *level_editor,
             return -1;
         }
     }
+    draw_list_subsystem(camera->draw_list, DRAW_SUBSYSTEM_OTHER);
 
     if (layer_picker_render(&level_editor->layer_picker, camera) < 0) {
         return -1;
@@ -204,12 +365,17 @@ int level_editor_saveas_event(LevelEditor *level_editor,
     case SDL_KEYDOWN: {
         if (event->key.keysym.sym == SDLK_RETURN) {
             trace_assert(level_editor->file_name == NULL);
+            const char *name = edit_field_as_text(&level_editor->edit_field_filename);
+            // Levels are saved as text unless the name asks for the
+            // binary format explicitly
+            level_editor->file_format = level_format_of_file_name(name);
             char path[LEVEL_FOLDER_MAX_LENGTH];
             snprintf(
                 path,
                 LEVEL_FOLDER_MAX_LENGTH,
-                "./assets/levels/%s.txt",
-                edit_field_as_text(&level_editor->edit_field_filename));
+                "./assets/levels/%s%s",
+                name,
+                level_editor->file_format == LEVEL_FORMAT_TEXT ? ".txt" : "");
             level_editor->file_name = strdup_to_memory(memory, path);
             level_editor_dump(level_editor);
             SDL_StopTextInput();
@@ -338,15 +504,21 @@ int level_editor_event(LevelEditor *level_editor,
     trace_assert(event);
     trace_assert(camera);
 
+    int result = 0;
     switch (level_editor->state) {
     case LEVEL_EDITOR_IDLE:
-        return level_editor_idle_event(level_editor, event, camera);
+        result = level_editor_idle_event(level_editor, event, camera);
+        break;
 
     case LEVEL_EDITOR_SAVEAS:
-        return level_editor_saveas_event(level_editor, event, camera, memory);
+        result = level_editor_saveas_event(level_editor, event, camera, memory);
+        break;
     }
 
-    return 0;
+    // Whatever the event edited is done by now
+    undo_history_flush(level_editor->undo_history);
+
+    return result;
 }
 
 int level_editor_focus_camera(LevelEditor *level_editor,
@@ -357,47 +529,345 @@ int level_editor_focus_camera(LevelEditor *level_editor,
     return 0;
 }
 
-static LayerPicker level_format_layer_order[LAYER_PICKER_N] = {
-    LAYER_PICKER_BACKGROUND,
-    LAYER_PICKER_PLAYER,
-    LAYER_PICKER_PLATFORMS,
-    LAYER_PICKER_GOALS,
-    LAYER_PICKER_LAVA,
-    LAYER_PICKER_BACK_PLATFORMS,
-    LAYER_PICKER_BOXES,
-    LAYER_PICKER_LABELS,
-    LAYER_PICKER_REGIONS,
-    LAYER_PICKER_PP
-};
 
-/* TODO(#904): LevelEditor does not check that the saved level file is modified by external program */
-static int level_editor_dump(LevelEditor *level_editor)
+static int level_editor_dump_text(const LevelEditor *level_editor, StringBuilder *sb)
 {
-    trace_assert(level_editor);
+    sb_append_cstr(sb, VERSION);
+    sb_append_char(sb, '\n');
+
+    for (size_t i = 0; i < LAYER_PICKER_N; ++i) {
+        if (layer_dump_text(
+                level_editor->layers[level_format_layer_order[i]],
+                sb) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
 
-    FILE *filedump = fopen(level_editor->file_name, "w");
-    trace_assert(filedump);
+static int level_editor_sector_index(const LevelEditor *level_editor,
+                                     LevelSectorIndex *index)
+{
+    const Rect *bounds[LEVEL_SECTOR_LAYERS_N];
+    size_t counts[LEVEL_SECTOR_LAYERS_N];
+
+    for (size_t layer = 0; layer < LEVEL_SECTOR_LAYERS_N; ++layer) {
+        if (layer == LEVEL_SECTOR_LABELS) {
+            continue;
+        }
 
-    if (fprintf(filedump, "%s\n", VERSION) < 0) {
+        const RectLayer *rect_layer =
+            level_editor->layers[level_sector_layer_pickers[layer]].ptr;
+        bounds[layer] = rect_layer_rects(rect_layer);
+        counts[layer] = rect_layer_count(rect_layer);
+    }
+
+    // Labels are bucketed by their positions
+    const size_t labels_count = label_layer_count(level_editor->label_layer);
+    const Vec2f *positions = label_layer_positions(level_editor->label_layer);
+    Rect *labels_bounds = nth_calloc(labels_count + 1, sizeof(Rect));
+    if (labels_bounds == NULL) {
         return -1;
     }
+    for (size_t i = 0; i < labels_count; ++i) {
+        labels_bounds[i] = rect_from_vecs(positions[i], vec(0.0f, 0.0f));
+    }
+    bounds[LEVEL_SECTOR_LABELS] = labels_bounds;
+    counts[LEVEL_SECTOR_LABELS] = labels_count;
+
+    const int result = create_level_sector_index(index, bounds, counts);
+    free(labels_bounds);
+
+    return result;
+}
+
+// The order of the entities of layer within a sectored level
+static const uint32_t *level_editor_sector_order(const LevelSectorIndex *index,
+                                                 LayerPicker layer)
+{
+    for (size_t i = 0; i < LEVEL_SECTOR_LAYERS_N; ++i) {
+        if (level_sector_layer_pickers[i] == layer) {
+            return index->orders[i];
+        }
+    }
 
+    return NULL;
+}
+
+static int level_editor_dump_binary_sections(const LevelEditor *level_editor,
+                                             LevelBinaryWriter *writer,
+                                             const LevelSectorIndex *index)
+{
     for (size_t i = 0; i < LAYER_PICKER_N; ++i) {
-        if (layer_dump_stream(
+        if (level_binary_section_begin(writer, level_format_layer_order[i]) < 0) {
+            return -1;
+        }
+
+        if (index) {
+            level_binary_write_order(
+                writer,
+                level_editor_sector_order(index, level_format_layer_order[i]));
+        }
+
+        if (layer_dump_binary(
                 level_editor->layers[level_format_layer_order[i]],
-                filedump) < 0) {
+                writer) < 0) {
+            return -1;
+        }
+    }
+
+    if (index) {
+        if (level_binary_section_begin(writer, LEVEL_BINARY_SECTOR_INDEX) < 0) {
+            return -1;
+        }
+
+        if (level_sector_index_dump_binary(index, writer) < 0) {
             return -1;
         }
     }
 
-    fclose(filedump);
+    return level_binary_writer_end(writer);
+}
+
+static int level_editor_dump_binary(const LevelEditor *level_editor,
+                                    StringBuilder *sb,
+                                    bool sectored)
+{
+    LevelSectorIndex index;
+    if (sectored && level_editor_sector_index(level_editor, &index) < 0) {
+        return -1;
+    }
+
+    LevelBinaryWriter writer;
+    int result = level_binary_writer_begin(
+        &writer,
+        sb,
+        LAYER_PICKER_N + (sectored ? 1 : 0));
+    if (result == 0) {
+        result = level_editor_dump_binary_sections(
+            level_editor,
+            &writer,
+            sectored ? &index : NULL);
+    }
+
+    if (sectored) {
+        destroy_level_sector_index(&index);
+    }
 
+    return result;
+}
+
+// The whole level file in memory, so it can be written by somebody
+// else while the level keeps being edited
+static int level_editor_snapshot(const LevelEditor *level_editor,
+                                 LevelFormat format,
+                                 StringBuilder *sb)
+{
+    sb_clean(sb);
+
+    return format == LEVEL_FORMAT_TEXT
+        ? level_editor_dump_text(level_editor, sb)
+        : level_editor_dump_binary(
+            level_editor,
+            sb,
+            format == LEVEL_FORMAT_SECTORED);
+}
+
+int level_editor_dump_file(const LevelEditor *level_editor,
+                           const char *file_name,
+                           LevelFormat format)
+{
+    trace_assert(level_editor);
+    trace_assert(file_name);
+
+    StringBuilder sb = {0};
+    int result = level_editor_snapshot(level_editor, format, &sb);
+    if (result == 0) {
+        result = write_whole_file_atomic(file_name, sb.data, sb.count);
+    }
+    destroy_string_builder(&sb);
+
+    return result;
+}
+
+static void level_editor_saved(LevelEditor *level_editor, FileStamp stamp)
+{
+    level_editor->file_stamp = stamp;
+
+    // Another save is on its way and the mark belongs to it
+    if (level_editor->journal &&
+        !(level_editor->saver && level_saver_busy(level_editor->saver))) {
+        level_journal_compact(
+            level_editor->journal,
+            level_editor->file_name,
+            stamp,
+            level_editor->undo_history);
+    }
+
+    level_editor->notice.wiggly_text.text = "Level saved";
     fading_wiggly_text_reset(&level_editor->notice);
     level_editor->save = 1;
+}
+
+/* TODO(#904): A change of the level file by another program that was not reloaded yet
+ * (no file watcher, or the save races the watcher) is overwritten without a warning.
+ * The stamp of the file is not compared with file_stamp before the save. */
+static int level_editor_dump(LevelEditor *level_editor)
+{
+    trace_assert(level_editor);
+
+    if (level_editor->saver == NULL) {
+        if (level_editor_dump_file(
+                level_editor,
+                level_editor->file_name,
+                level_editor->file_format) < 0) {
+            return -1;
+        }
+
+        FileStamp stamp = {0};
+        file_stamp(&stamp, level_editor->file_name);
+        level_editor_saved(level_editor, stamp);
+
+        return 0;
+    }
+
+    // Only the snapshot is taken here. The notice shows up once the
+    // file is actually on the disk (see level_editor_poll_save).
+    undo_history_flush(level_editor->undo_history);
+    if (level_editor->journal) {
+        level_journal_mark(level_editor->journal);
+    }
+
+    StringBuilder *sb = level_saver_buffer(level_editor->saver);
+    if (level_editor_snapshot(level_editor, level_editor->file_format, sb) < 0) {
+        return -1;
+    }
+
+    level_saver_request(level_editor->saver, level_editor->file_name);
 
     return 0;
 }
 
+void level_editor_poll_save(LevelEditor *level_editor)
+{
+    trace_assert(level_editor);
+
+    // A new level is not saved anywhere until it gets a name
+    if (level_editor->saver == NULL || level_editor->file_name == NULL) {
+        return;
+    }
+
+    FileStamp stamp;
+    const int result = level_saver_poll(
+        level_editor->saver,
+        level_editor->file_name,
+        &stamp);
+    if (result > 0) {
+        level_editor_saved(level_editor, stamp);
+    } else if (result < 0) {
+        level_editor->notice.wiggly_text.text = "Could not save the level";
+        fading_wiggly_text_reset(&level_editor->notice);
+        level_editor->bell = 1;
+    }
+}
+
+void level_editor_finish_save(LevelEditor *level_editor)
+{
+    trace_assert(level_editor);
+
+    if (level_editor->saver == NULL) {
+        return;
+    }
+
+    level_saver_wait(level_editor->saver);
+    level_editor_poll_save(level_editor);
+}
+
+size_t level_editor_apply_file(LevelEditor *level_editor,
+                               const LevelFile *level_file)
+{
+    trace_assert(level_editor);
+    trace_assert(level_file);
+
+    UndoHistory *undo_history = level_editor->undo_history;
+
+    size_t changes = 0;
+    changes += background_layer_apply(
+        &level_editor->background_layer,
+        level_file->background_color,
+        undo_history);
+    changes += player_layer_apply(
+        &level_editor->player_layer,
+        level_file->player_position,
+        level_file->player_color,
+        undo_history);
+    changes += rect_layer_apply(level_editor->platforms_layer, &level_file->platforms, undo_history);
+    changes += point_layer_apply(level_editor->goals_layer, &level_file->goals, undo_history);
+    changes += rect_layer_apply(level_editor->lava_layer, &level_file->lava, undo_history);
+    changes += rect_layer_apply(level_editor->back_platforms_layer, &level_file->back_platforms, undo_history);
+    changes += rect_layer_apply(level_editor->boxes_layer, &level_file->boxes, undo_history);
+    changes += label_layer_apply(level_editor->label_layer, &level_file->labels, undo_history);
+    changes += rect_layer_apply(level_editor->regions_layer, &level_file->regions, undo_history);
+    changes += rect_layer_apply(level_editor->pp_layer, &level_file->pp, undo_history);
+
+    if (changes > 0) {
+        level_editor->notice.wiggly_text.text = "Level reloaded";
+        fading_wiggly_text_reset(&level_editor->notice);
+    }
+
+    // The layers are the file now, so the journal starts over on top
+    // of it
+    undo_history_flush(undo_history);
+    if (level_editor->file_name == NULL) {
+        return changes;
+    }
+
+    file_stamp(&level_editor->file_stamp, level_editor->file_name);
+    if (level_editor->journal) {
+        level_journal_mark(level_editor->journal);
+        level_journal_compact(
+            level_editor->journal,
+            level_editor->file_name,
+            level_editor->file_stamp,
+            undo_history);
+    }
+
+    return changes;
+}
+
+int level_editor_convert_file(const char *input_file,
+                              const char *output_file)
+{
+    trace_assert(input_file);
+    trace_assert(output_file);
+
+    Memory memory = {
+        .capacity = LEVEL_EDITOR_MEMORY_CAPACITY,
+        .buffer = nth_calloc(LEVEL_EDITOR_MEMORY_CAPACITY, sizeof(uint8_t))
+    };
+    if (memory.buffer == NULL) {
+        return -1;
+    }
+
+    // Nothing is going to be edited, so the cursor is never touched
+    static Cursor cursor;
+
+    int result = -1;
+    LevelEditor *level_editor = create_level_editor_from_file(&memory, &cursor, NULL, NULL, input_file);
+    if (level_editor != NULL) {
+        result = level_editor_dump_file(
+            level_editor,
+            output_file,
+            level_format_of_file_name(output_file));
+    }
+
+    memory_clean(&memory);
+    free(memory.buffer);
+
+    return result;
+}
+
 int level_editor_update(LevelEditor *level_editor, float delta_time)
 {
     return fading_wiggly_text_update(&level_editor->notice, delta_time);
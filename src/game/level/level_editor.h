@@ -7,8 +7,13 @@
 #include "game/level/level_editor/rect_layer.h"
 #include "game/level/level_editor/point_layer.h"
 #include "game/level/level_editor/label_layer.h"
+#include "game/level/level_editor/player_layer.h"
+#include "game/level/level_editor/background_layer.h"
+#include "game/level/level_editor/level_saver.h"
+#include "game/level/level_editor/level_journal.h"
 #include "ui/wiggly_text.h"
 #include "ui/cursor.h"
+#include "system/file.h"
 
 typedef struct LevelEditor LevelEditor;
 typedef struct Sound_samples Sound_samples;
@@ -48,10 +53,55 @@ struct LevelEditor
     int save;
 
     char *file_name;
+    // The format the level is saved in. Same as the loaded file.
+    LevelFormat file_format;
+    // The file as the editor last loaded or saved it. Anything else
+    // was written by somebody else.
+    FileStamp file_stamp;
+    // Writes the saved level in the background. The level is saved
+    // synchronously without it.
+    LevelSaver *saver;
+    // Keeps the edits that were not saved yet. May be NULL.
+    LevelJournal *journal;
 };
 
-LevelEditor *create_level_editor(Memory *memory, Cursor *cursor);
-LevelEditor *create_level_editor_from_file(Memory *memory, Cursor *cursor, const char *file_name);
+// saver and journal may be NULL. The edits left in the journal of
+// the file are replayed when it is loaded.
+LevelEditor *create_level_editor(Memory *memory,
+                                 Cursor *cursor,
+                                 LevelSaver *saver,
+                                 LevelJournal *journal);
+LevelEditor *create_level_editor_from_file(Memory *memory,
+                                           Cursor *cursor,
+                                           LevelSaver *saver,
+                                           LevelJournal *journal,
+                                           const char *file_name);
+// The level being edited as plain arrays. Points into the layers, so
+// it is valid until the next edit.
+LevelFile level_editor_level_file(const LevelEditor *level_editor);
+
+int level_editor_dump_file(const LevelEditor *level_editor,
+                           const char *file_name,
+                           LevelFormat format);
+// Loads the level in either format and saves it in the format
+// implied by the extension of output_file (see LEVEL_BINARY_EXTENSION
+// and LEVEL_BINARY_SECTORED_EXTENSION)
+int level_editor_convert_file(const char *input_file,
+                              const char *output_file);
+
+// Picks up the result of the background save, if any. Called once a
+// frame by the game before it looks at the changed level files.
+void level_editor_poll_save(LevelEditor *level_editor);
+// Waits for the background save and picks up its result, so the
+// journal is compacted before the editor goes away
+void level_editor_finish_save(LevelEditor *level_editor);
+
+// Brings the layers in line with a level file that was changed by
+// somebody else. Only the changed entities are touched and every
+// change can be undone. The file on the disk is taken for the saved
+// level from now on. Returns how many entities changed.
+size_t level_editor_apply_file(LevelEditor *level_editor,
+                               const LevelFile *level_file);
 
 int level_editor_render(const LevelEditor *level_editor,
                         const Camera *camera);
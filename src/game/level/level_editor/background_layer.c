@@ -7,6 +7,7 @@
 #include "color.h"
 #include "background_layer.h"
 #include "undo_history.h"
+#include "game/level/level_file.h"
 
 BackgroundLayer create_background_layer(Color color)
 {
@@ -19,8 +20,7 @@ BackgroundLayer create_background_layer(Color color)
 
 BackgroundLayer chop_background_layer(String *input)
 {
-    String line = trim(chop_by_delim(input, '\n'));
-    return create_background_layer(hexs(line));
+    return create_background_layer(level_file_chop_color_line(input));
 }
 
 int background_layer_render(BackgroundLayer *layer,
@@ -56,6 +56,22 @@ void background_undo_color(void *context, size_t context_size)
     background_layer->color_picker = create_color_picker_from_rgba(undo_context->color);
 }
 
+static
+void background_journal_color(const void *context, size_t context_size,
+                              int reverted, LevelJournal *journal)
+{
+    trace_assert(context);
+    trace_assert(sizeof(BackgroundUndoContext) == context_size);
+    (void) reverted;
+
+    const BackgroundUndoContext *undo_context = context;
+    const Color color = color_picker_rgba(&undo_context->layer->color_picker);
+
+    level_journal_write(
+        journal, undo_context->layer, LEVEL_JOURNAL_UPDATE,
+        0, 0, &color, sizeof(color));
+}
+
 int background_layer_event(BackgroundLayer *layer,
                            const SDL_Event *event,
                            const Camera *camera,
@@ -85,6 +101,7 @@ int background_layer_event(BackgroundLayer *layer,
         undo_history_push(
             undo_history,
             background_undo_color,
+            background_journal_color,
             &context, sizeof(context));
         layer->prev_color = color_picker_rgba(&layer->color_picker);
     }
@@ -92,15 +109,92 @@ int background_layer_event(BackgroundLayer *layer,
     return 0;
 }
 
-int background_layer_dump_stream(BackgroundLayer *layer,
-                                 FILE *stream)
+size_t background_layer_apply(BackgroundLayer *layer,
+                              Color color,
+                              UndoHistory *undo_history)
+{
+    trace_assert(layer);
+    trace_assert(undo_history);
+
+    if (memcmp(&layer->prev_color, &color, sizeof(Color)) == 0) {
+        return 0;
+    }
+
+    BackgroundUndoContext context = {
+        .layer = layer,
+        .color = layer->prev_color
+    };
+    undo_history_push(
+        undo_history,
+        background_undo_color,
+        background_journal_color,
+        &context, sizeof(context));
+
+    layer->color_picker = create_color_picker_from_rgba(color);
+    layer->prev_color = color;
+
+    return 1;
+}
+
+int background_layer_replay(BackgroundLayer *layer,
+                            LevelJournalOp op,
+                            const void *entity,
+                            UndoHistory *undo_history)
+{
+    trace_assert(layer);
+    trace_assert(entity);
+    trace_assert(undo_history);
+
+    if (op != LEVEL_JOURNAL_UPDATE) {
+        return -1;
+    }
+
+    Color color;
+    memcpy(&color, entity, sizeof(color));
+    background_layer_apply(layer, color, undo_history);
+
+    return 0;
+}
+
+int background_layer_dump_text(BackgroundLayer *layer,
+                               StringBuilder *sb)
 {
     trace_assert(layer);
-    trace_assert(stream);
+    trace_assert(sb);
 
-    color_hex_to_stream(
+    color_hex_to_sb(
         color_picker_rgba(&layer->color_picker),
-        stream);
+        sb);
+    sb_append_char(sb, '\n');
+
+    return 0;
+}
+
+int background_layer_load_binary(BackgroundLayer *layer,
+                                 LevelBinarySlice *slice)
+{
+    trace_assert(layer);
+    trace_assert(slice);
+
+    Color color;
+    if (level_binary_read(slice, &color, sizeof(color)) < 0) {
+        return -1;
+    }
+
+    *layer = create_background_layer(color);
+
+    return 0;
+}
+
+int background_layer_dump_binary(const BackgroundLayer *layer,
+                                 LevelBinaryWriter *writer)
+{
+    trace_assert(layer);
+    trace_assert(writer);
+
+    const Color color = color_picker_rgba(&layer->color_picker);
+
+    level_binary_write_count(writer, 1);
 
-    return fprintf(stream, "\n");
+    return level_binary_write(writer, &color, sizeof(color));
 }
@@ -2,6 +2,7 @@
 #define BACKGROUND_LAYER_H_
 
 #include "color_picker.h"
+#include "level_journal.h"
 #include "system/s.h"
 
 typedef struct {
@@ -28,7 +29,23 @@ int background_layer_event(BackgroundLayer *layer,
                            const SDL_Event *event,
                            const Camera *camera,
                            UndoHistory *undo_history);
-int background_layer_dump_stream(BackgroundLayer *layer,
-                                 FILE *stream);
+// Recolors the background as a reloaded level file says. Undoable.
+// Returns 1 if the color changed.
+size_t background_layer_apply(BackgroundLayer *layer,
+                              Color color,
+                              UndoHistory *undo_history);
+// Redoes an edit read from the level journal. Undoable. Returns -1
+// if the edit does not fit the layer.
+int background_layer_replay(BackgroundLayer *layer,
+                            LevelJournalOp op,
+                            const void *entity,
+                            UndoHistory *undo_history);
+
+int background_layer_dump_text(BackgroundLayer *layer,
+                               StringBuilder *sb);
+int background_layer_load_binary(BackgroundLayer *layer,
+                                 LevelBinarySlice *slice);
+int background_layer_dump_binary(const BackgroundLayer *layer,
+                                 LevelBinaryWriter *writer);
 
 #endif  // BACKGROUND_LAYER_H_
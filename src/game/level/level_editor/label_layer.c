@@ -120,12 +120,67 @@ void label_layer_undo(void *context, size_t context_size)
     }
 }
 
+// What the journal keeps of a label. The text goes last, so the
+// zeros after it are not written.
+typedef struct {
+    Vec2f position;
+    Color color;
+    char id[LABEL_LAYER_ID_MAX_SIZE];
+    char text[LABEL_LAYER_TEXT_MAX_SIZE];
+} LabelJournalEntity;
+
+static
+void label_layer_journal(const void *context, size_t context_size,
+                         int reverted, LevelJournal *journal)
+{
+    trace_assert(context);
+    trace_assert(sizeof(LabelUndoContext) == context_size);
+
+    const LabelUndoContext *undo_context = context;
+    LabelLayer *label_layer = undo_context->layer;
+    const LevelJournalOp op = level_journal_op((int) undo_context->type, reverted);
+
+    if (op == LEVEL_JOURNAL_DELETE || op == LEVEL_JOURNAL_SWAP) {
+        level_journal_write(
+            journal, label_layer, op,
+            undo_context->index, op == LEVEL_JOURNAL_SWAP ? undo_context->index2 : 0,
+            NULL, 0);
+        return;
+    }
+
+    LabelJournalEntity entity;
+    memset(&entity, 0, sizeof(entity));
+    dynarray_copy_to(&label_layer->positions, &entity.position, undo_context->index);
+    dynarray_copy_to(&label_layer->colors, &entity.color, undo_context->index);
+    dynarray_copy_to(&label_layer->ids, entity.id, undo_context->index);
+    dynarray_copy_to(&label_layer->texts, entity.text, undo_context->index);
+    level_journal_write(
+        journal, label_layer, op,
+        undo_context->index, 0,
+        &entity, sizeof(entity));
+}
+
 #define LABEL_UNDO_PUSH(HISTORY, CONTEXT)                                     \
     do {                                                                \
         LabelUndoContext context = (CONTEXT);                                \
         undo_history_push(                                              \
             HISTORY,                                                    \
             label_layer_undo,                                           \
+            label_layer_journal,                                        \
+            &context,                                                   \
+            sizeof(context));                                           \
+    } while(0)
+
+// For the moves of the label of an update context
+#define LABEL_UNDO_PUSH_COALESCED(HISTORY, CONTEXT)                     \
+    do {                                                                \
+        LabelUndoContext context = (CONTEXT);                           \
+        undo_history_push_coalesced(                                    \
+            HISTORY,                                                    \
+            label_layer_undo,                                           \
+            label_layer_journal,                                        \
+            context.layer,                                              \
+            context.index,                                              \
             &context,                                                   \
             sizeof(context));                                           \
     } while(0)
@@ -160,46 +215,36 @@ LabelLayer *create_label_layer(Memory *memory,
     return result;
 }
 
-void label_layer_load(LabelLayer *label_layer,
-                        Memory *memory,
-                        String *input)
+int label_layer_load(LabelLayer *label_layer,
+                     Memory *memory,
+                     String *input)
 {
     trace_assert(label_layer);
     trace_assert(memory);
     trace_assert(input);
 
-    int n = atoi(string_to_cstr(memory, trim(chop_by_delim(input, '\n'))));
-    char id[LABEL_LAYER_ID_MAX_SIZE];
-    char label_text[LABEL_LAYER_TEXT_MAX_SIZE];
-    for (int i = 0; i < n; ++i) {
-        String meta = trim(chop_by_delim(input, '\n'));
+    const size_t n = level_file_chop_count(input);
+    if (dynarray_reserve(&label_layer->ids, n) < 0 ||
+        dynarray_reserve(&label_layer->positions, n) < 0 ||
+        dynarray_reserve(&label_layer->colors, n) < 0 ||
+        dynarray_reserve(&label_layer->texts, n) < 0) {
+        return -1;
+    }
 
-        String string_id = trim(chop_word(&meta));
+    char id[ENTITY_MAX_ID_SIZE];
+    char label_text[LABEL_LAYER_TEXT_MAX_SIZE];
+    for (size_t i = 0; i < n; ++i) {
         Vec2f position;
-        position.x = strtof(string_to_cstr(memory, trim(chop_word(&meta))), NULL);
-        position.y = strtof(string_to_cstr(memory, trim(chop_word(&meta))), NULL);
-        Color color = hexs(trim(chop_word(&meta)));
-
-        memset(id, 0, LABEL_LAYER_ID_MAX_SIZE);
-        memcpy(
-            id,
-            string_id.data,
-            min_size_t(LABEL_LAYER_ID_MAX_SIZE - 1, string_id.count));
-
-        String label_text_string =
-            trim(chop_by_delim(input, '\n'));
-        memset(label_text, 0, LABEL_LAYER_TEXT_MAX_SIZE);
-        memcpy(
-            label_text,
-            label_text_string.data,
-            min_size_t(LABEL_LAYER_TEXT_MAX_SIZE - 1,
-                       label_text_string.count));
+        Color color;
+        level_file_chop_label(input, id, &position, &color, label_text);
 
         dynarray_push(&label_layer->ids, id);
         dynarray_push(&label_layer->positions, &position);
         dynarray_push(&label_layer->colors, &color);
         dynarray_push(&label_layer->texts, label_text);
     }
+
+    return 0;
 }
 
 static inline
@@ -672,13 +717,14 @@ int label_layer_move_event(LabelLayer *label_layer,
                         positions[label_layer->selection]));
 
             if (distance > 1e-6) {
-                LABEL_UNDO_PUSH(undo_history, create_label_undo_context(label_layer, LABEL_UNDO_UPDATE));
+                LABEL_UNDO_PUSH_COALESCED(undo_history, create_label_undo_context(label_layer, LABEL_UNDO_UPDATE));
 
                 dynarray_replace_at(
                     &label_layer->positions,
                     (size_t)label_layer->selection,
                     &label_layer->inter_position);
             }
+            undo_history_end_coalescing(undo_history);
 
             label_layer->state = LABEL_LAYER_IDLE;
         } break;
@@ -836,6 +882,138 @@ int label_layer_event(LabelLayer *label_layer,
     return 0;
 }
 
+size_t label_layer_apply(LabelLayer *label_layer,
+                         const LevelLabels *labels,
+                         UndoHistory *undo_history)
+{
+    trace_assert(label_layer);
+    trace_assert(labels);
+    trace_assert(undo_history);
+
+    size_t changes = 0;
+
+    for (size_t i = label_layer->ids.count; i-- > 0;) {
+        const char *id = (const char *)dynarray_pointer_at(&label_layer->ids, i);
+        if (level_file_find_id(labels->ids, labels->count, id, i) < 0) {
+            label_layer->selection = (int) i;
+            label_layer_delete_selected_label(label_layer, undo_history);
+            changes += 1;
+        }
+    }
+
+    for (size_t j = 0; j < labels->count; ++j) {
+        const char *id = labels->ids + j * ENTITY_MAX_ID_SIZE;
+        const char *text = labels->texts + j * LEVEL_FILE_LABEL_TEXT_MAX_SIZE;
+        const int i = level_file_find_id(
+            (const char *)label_layer->ids.data, label_layer->ids.count, id, j);
+
+        if (i < 0) {
+            dynarray_push(&label_layer->ids, id);
+            dynarray_push(&label_layer->positions, &labels->positions[j]);
+            dynarray_push(&label_layer->colors, &labels->colors[j]);
+            dynarray_push(&label_layer->texts, text);
+            LABEL_UNDO_PUSH(undo_history, create_label_undo_context(label_layer, LABEL_UNDO_ADD));
+            changes += 1;
+            continue;
+        }
+
+        const Vec2f *position = dynarray_pointer_at(&label_layer->positions, (size_t) i);
+        const Color *color = dynarray_pointer_at(&label_layer->colors, (size_t) i);
+        const char *old_text = dynarray_pointer_at(&label_layer->texts, (size_t) i);
+        if (memcmp(position, &labels->positions[j], sizeof(Vec2f)) != 0 ||
+            memcmp(color, &labels->colors[j], sizeof(Color)) != 0 ||
+            strncmp(old_text, text, LABEL_LAYER_TEXT_MAX_SIZE) != 0) {
+            label_layer->selection = i;
+            LABEL_UNDO_PUSH(undo_history, create_label_undo_context(label_layer, LABEL_UNDO_UPDATE));
+            Vec2f new_position = labels->positions[j];
+            Color new_color = labels->colors[j];
+            char new_text[LABEL_LAYER_TEXT_MAX_SIZE];
+            memcpy(new_text, text, LABEL_LAYER_TEXT_MAX_SIZE);
+            dynarray_replace_at(&label_layer->positions, (size_t) i, &new_position);
+            dynarray_replace_at(&label_layer->colors, (size_t) i, &new_color);
+            dynarray_replace_at(&label_layer->texts, (size_t) i, new_text);
+            changes += 1;
+        }
+    }
+
+    if (changes > 0) {
+        label_layer->selection = -1;
+        label_layer->state = LABEL_LAYER_IDLE;
+    }
+
+    return changes;
+}
+
+int label_layer_replay(LabelLayer *label_layer,
+                       LevelJournalOp op,
+                       size_t index,
+                       size_t index2,
+                       const void *entity,
+                       UndoHistory *undo_history)
+{
+    trace_assert(label_layer);
+    trace_assert(entity);
+    trace_assert(undo_history);
+
+    LabelJournalEntity e;
+    memcpy(&e, entity, sizeof(e));
+    e.id[LABEL_LAYER_ID_MAX_SIZE - 1] = '\0';
+    e.text[LABEL_LAYER_TEXT_MAX_SIZE - 1] = '\0';
+
+    const size_t count = label_layer->ids.count;
+
+    // The undo contexts take the element from the selection
+    switch (op) {
+    case LEVEL_JOURNAL_ADD: {
+        if (index > count) {
+            return -1;
+        }
+        dynarray_insert_before(&label_layer->ids, index, e.id);
+        dynarray_insert_before(&label_layer->positions, index, &e.position);
+        dynarray_insert_before(&label_layer->colors, index, &e.color);
+        dynarray_insert_before(&label_layer->texts, index, e.text);
+        LabelUndoContext add_context = create_label_undo_context(label_layer, LABEL_UNDO_ADD);
+        add_context.index = index;
+        LABEL_UNDO_PUSH(undo_history, add_context);
+    } break;
+
+    case LEVEL_JOURNAL_DELETE: {
+        if (index >= count) {
+            return -1;
+        }
+        label_layer->selection = (int) index;
+        label_layer_delete_selected_label(label_layer, undo_history);
+    } break;
+
+    case LEVEL_JOURNAL_UPDATE: {
+        if (index >= count) {
+            return -1;
+        }
+        label_layer->selection = (int) index;
+        LABEL_UNDO_PUSH(undo_history, create_label_undo_context(label_layer, LABEL_UNDO_UPDATE));
+        dynarray_replace_at(&label_layer->ids, index, e.id);
+        dynarray_replace_at(&label_layer->positions, index, &e.position);
+        dynarray_replace_at(&label_layer->colors, index, &e.color);
+        dynarray_replace_at(&label_layer->texts, index, e.text);
+    } break;
+
+    case LEVEL_JOURNAL_SWAP: {
+        if (index >= count || index2 >= count) {
+            return -1;
+        }
+        label_layer_swap_elements(label_layer, index, index2, undo_history);
+    } break;
+
+    default:
+        return -1;
+    }
+
+    label_layer->selection = -1;
+    label_layer->state = LABEL_LAYER_IDLE;
+
+    return 0;
+}
+
 size_t label_layer_count(const LabelLayer *label_layer)
 {
     return label_layer->ids.count;
@@ -861,10 +1039,49 @@ char *labels_layer_texts(const LabelLayer *label_layer)
     return (char *)label_layer->texts.data;
 }
 
-int label_layer_dump_stream(const LabelLayer *label_layer, FILE *filedump)
+int label_layer_load_binary(LabelLayer *label_layer, LevelBinarySlice *slice)
+{
+    trace_assert(label_layer);
+    trace_assert(slice);
+
+    if (level_binary_read_dynarray(slice, &label_layer->ids) < 0 ||
+        level_binary_read_dynarray(slice, &label_layer->positions) < 0 ||
+        level_binary_read_dynarray(slice, &label_layer->colors) < 0 ||
+        level_binary_read_dynarray(slice, &label_layer->texts) < 0) {
+        return -1;
+    }
+
+    char *ids = (char *)label_layer->ids.data;
+    char *texts = (char *)label_layer->texts.data;
+    for (size_t i = 0; i < label_layer->ids.count; ++i) {
+        ids[i * LABEL_LAYER_ID_MAX_SIZE + LABEL_LAYER_ID_MAX_SIZE - 1] = '\0';
+        texts[i * LABEL_LAYER_TEXT_MAX_SIZE + LABEL_LAYER_TEXT_MAX_SIZE - 1] = '\0';
+    }
+
+    return 0;
+}
+
+int label_layer_dump_binary(const LabelLayer *label_layer, LevelBinaryWriter *writer)
+{
+    trace_assert(label_layer);
+    trace_assert(writer);
+
+    level_binary_write_count(writer, label_layer->ids.count);
+
+    if (level_binary_write_dynarray(writer, &label_layer->ids) < 0 ||
+        level_binary_write_dynarray(writer, &label_layer->positions) < 0 ||
+        level_binary_write_dynarray(writer, &label_layer->colors) < 0 ||
+        level_binary_write_dynarray(writer, &label_layer->texts) < 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int label_layer_dump_text(const LabelLayer *label_layer, StringBuilder *sb)
 {
     trace_assert(label_layer);
-    trace_assert(filedump);
+    trace_assert(sb);
 
     size_t n = label_layer->ids.count;
     char *ids = (char *)label_layer->ids.data;
@@ -872,13 +1089,19 @@ int label_layer_dump_stream(const LabelLayer *label_layer, FILE *filedump)
     Color *colors = (Color *)label_layer->colors.data;
     char *texts = (char *)label_layer->texts.data;
 
-    fprintf(filedump, "%zd\n", n);
+    sb_append_size(sb, n);
+    sb_append_char(sb, '\n');
     for (size_t i = 0; i < n; ++i) {
-        fprintf(filedump, "%s %f %f ",
-                ids + LABEL_LAYER_ID_MAX_SIZE * i,
-                positions[i].x, positions[i].y);
-        color_hex_to_stream(colors[i], filedump);
-        fprintf(filedump, "\n%s\n", texts + i * LABEL_LAYER_TEXT_MAX_SIZE);
+        sb_append_cstr(sb, ids + LABEL_LAYER_ID_MAX_SIZE * i);
+        sb_append_char(sb, ' ');
+        sb_append_float(sb, positions[i].x);
+        sb_append_char(sb, ' ');
+        sb_append_float(sb, positions[i].y);
+        sb_append_char(sb, ' ');
+        color_hex_to_sb(colors[i], sb);
+        sb_append_char(sb, '\n');
+        sb_append_cstr(sb, texts + i * LABEL_LAYER_TEXT_MAX_SIZE);
+        sb_append_char(sb, '\n');
     }
 
     return 0;
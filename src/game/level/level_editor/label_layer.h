@@ -2,15 +2,17 @@
 #define LABEL_LAYER_H_
 
 #include "layer.h"
+#include "level_journal.h"
 #include "color.h"
 #include "math/vec.h"
 #include "dynarray.h"
 #include "game/level/level_editor/color_picker.h"
 #include "ui/edit_field.h"
+#include "game/level/level_file.h"
+#include "game/level/labels.h"
 
-#define LABELS_SIZE vec(2.0f, 2.0f)
 #define LABEL_LAYER_ID_MAX_SIZE 36
-#define LABEL_LAYER_TEXT_MAX_SIZE 256
+#define LABEL_LAYER_TEXT_MAX_SIZE LEVEL_FILE_LABEL_TEXT_MAX_SIZE
 
 typedef enum {
     LABEL_LAYER_IDLE = 0,
@@ -41,9 +43,9 @@ LayerPtr label_layer_as_layer(LabelLayer *label_layer);
 // NOTE: create_label_layer and create_label_layer_from_line_stream do
 // not own id_name_prefix
 LabelLayer *create_label_layer(Memory *memory, const char *id_name_prefix);
-void label_layer_load(LabelLayer *label_layer,
-                        Memory *memory,
-                        String *input);
+int label_layer_load(LabelLayer *label_layer,
+                     Memory *memory,
+                     String *input);
 
 static inline
 void destroy_label_layer(LabelLayer label_layer)
@@ -64,7 +66,24 @@ int label_layer_event(LabelLayer *label_layer,
 
 size_t label_layer_count(const LabelLayer *label_layer);
 
-int label_layer_dump_stream(const LabelLayer *label_layer, FILE *filedump);
+// Brings the layer in line with labels (a reloaded level file) by
+// their ids. Every change is undoable. Returns how many labels
+// changed.
+size_t label_layer_apply(LabelLayer *label_layer,
+                         const LevelLabels *labels,
+                         UndoHistory *undo_history);
+// Redoes an edit read from the level journal. Undoable. Returns -1
+// if the edit does not fit the layer.
+int label_layer_replay(LabelLayer *label_layer,
+                       LevelJournalOp op,
+                       size_t index,
+                       size_t index2,
+                       const void *entity,
+                       UndoHistory *undo_history);
+
+int label_layer_dump_text(const LabelLayer *label_layer, StringBuilder *sb);
+int label_layer_load_binary(LabelLayer *label_layer, LevelBinarySlice *slice);
+int label_layer_dump_binary(const LabelLayer *label_layer, LevelBinaryWriter *writer);
 
 char *label_layer_ids(const LabelLayer *label_layer);
 Vec2f *label_layer_positions(const LabelLayer *label_layer);
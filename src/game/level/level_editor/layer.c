@@ -53,25 +53,69 @@ int layer_event(LayerPtr layer,
     return -1;
 }
 
-int layer_dump_stream(LayerPtr layer,
-                      FILE *stream)
+int layer_dump_text(LayerPtr layer,
+                    StringBuilder *sb)
 {
     switch (layer.type) {
     case LAYER_RECT:
-        return rect_layer_dump_stream(layer.ptr, stream);
+        return rect_layer_dump_text(layer.ptr, sb);
 
     case LAYER_POINT:
-        return point_layer_dump_stream(layer.ptr, stream);
+        return point_layer_dump_text(layer.ptr, sb);
 
     case LAYER_PLAYER:
-        return player_layer_dump_stream(layer.ptr, stream);
+        return player_layer_dump_text(layer.ptr, sb);
 
     case LAYER_BACKGROUND: {
-        return background_layer_dump_stream(layer.ptr, stream);
+        return background_layer_dump_text(layer.ptr, sb);
     }
 
     case LAYER_LABEL:
-        return label_layer_dump_stream(layer.ptr, stream);
+        return label_layer_dump_text(layer.ptr, sb);
+    }
+
+    return -1;
+}
+
+int layer_load_binary(LayerPtr layer, LevelBinarySlice *slice)
+{
+    switch (layer.type) {
+    case LAYER_RECT:
+        return rect_layer_load_binary(layer.ptr, slice);
+
+    case LAYER_POINT:
+        return point_layer_load_binary(layer.ptr, slice);
+
+    case LAYER_PLAYER:
+        return player_layer_load_binary(layer.ptr, slice);
+
+    case LAYER_BACKGROUND:
+        return background_layer_load_binary(layer.ptr, slice);
+
+    case LAYER_LABEL:
+        return label_layer_load_binary(layer.ptr, slice);
+    }
+
+    return -1;
+}
+
+int layer_dump_binary(LayerPtr layer, LevelBinaryWriter *writer)
+{
+    switch (layer.type) {
+    case LAYER_RECT:
+        return rect_layer_dump_binary(layer.ptr, writer);
+
+    case LAYER_POINT:
+        return point_layer_dump_binary(layer.ptr, writer);
+
+    case LAYER_PLAYER:
+        return player_layer_dump_binary(layer.ptr, writer);
+
+    case LAYER_BACKGROUND:
+        return background_layer_dump_binary(layer.ptr, writer);
+
+    case LAYER_LABEL:
+        return label_layer_dump_binary(layer.ptr, writer);
     }
 
     return -1;
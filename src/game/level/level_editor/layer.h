@@ -3,6 +3,8 @@
 
 #include "game/camera.h"
 #include "undo_history.h"
+#include "level_binary.h"
+#include "system/string_builder.h"
 
 typedef enum {
     LAYER_RECT,
@@ -24,6 +26,8 @@ int layer_event(LayerPtr layer,
                 const SDL_Event *event,
                 const Camera *camera,
                 UndoHistory *undo_history);
-int layer_dump_stream(LayerPtr layer, FILE *stream);
+int layer_dump_text(LayerPtr layer, StringBuilder *sb);
+int layer_load_binary(LayerPtr layer, LevelBinarySlice *slice);
+int layer_dump_binary(LayerPtr layer, LevelBinaryWriter *writer);
 
 #endif  // LAYER_H_
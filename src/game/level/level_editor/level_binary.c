@@ -0,0 +1,296 @@
+#include <string.h>
+
+#include <SDL.h>
+
+#include "system/log.h"
+#include "system/stacktrace.h"
+#include "./level_binary.h"
+
+// The arrays of the layers are stored exactly as they are laid out
+// in memory of a little-endian machine. Big-endian machines would
+// have to swap every field of every element, so they just do not
+// support the format.
+static int level_binary_check_byte_order(void)
+{
+    if (SDL_BYTEORDER != SDL_LIL_ENDIAN) {
+        log_fail("Binary levels are not supported on big-endian machines\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int level_binary_ends_with(const char *s, const char *suffix)
+{
+    const size_t n = strlen(s);
+    const size_t m = strlen(suffix);
+    return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+LevelFormat level_format_of_file_name(const char *file_name)
+{
+    trace_assert(file_name);
+
+    if (level_binary_ends_with(file_name, LEVEL_BINARY_SECTORED_EXTENSION)) {
+        return LEVEL_FORMAT_SECTORED;
+    }
+
+    if (level_binary_ends_with(file_name, LEVEL_BINARY_EXTENSION)) {
+        return LEVEL_FORMAT_BINARY;
+    }
+
+    return LEVEL_FORMAT_TEXT;
+}
+
+static size_t level_binary_table_size(const LevelBinaryWriter *writer)
+{
+    return sizeof(writer->header)
+        + sizeof(LevelBinarySection) * writer->header.sections_count;
+}
+
+static void level_binary_write_table(LevelBinaryWriter *writer, char *dest)
+{
+    memcpy(dest, &writer->header, sizeof(writer->header));
+    memcpy(dest + sizeof(writer->header),
+           writer->sections,
+           sizeof(LevelBinarySection) * writer->header.sections_count);
+}
+
+int level_binary_writer_begin(LevelBinaryWriter *writer,
+                              StringBuilder *output,
+                              uint32_t sections_count)
+{
+    trace_assert(writer);
+    trace_assert(output);
+    trace_assert(sections_count <= LEVEL_BINARY_SECTIONS_CAPACITY);
+
+    if (level_binary_check_byte_order() < 0) {
+        return -1;
+    }
+
+    memset(writer, 0, sizeof(*writer));
+    writer->output = output;
+    writer->base = output->count;
+    memcpy(writer->header.version, LEVEL_BINARY_VERSION "\n", strlen(LEVEL_BINARY_VERSION "\n"));
+    writer->header.sections_count = sections_count;
+
+    // The table is filled in with the actual offsets at the end
+    const size_t table_size = level_binary_table_size(writer);
+    sb_reserve(output, table_size);
+    output->count += table_size;
+
+    return 0;
+}
+
+int level_binary_section_begin(LevelBinaryWriter *writer,
+                               uint32_t layer)
+{
+    trace_assert(writer);
+    trace_assert(writer->current < writer->header.sections_count);
+
+    const size_t offset = writer->output->count - writer->base;
+
+    LevelBinarySection *section = &writer->sections[writer->current++];
+    section->layer = layer;
+    section->count = 0;
+    section->offset = (uint32_t) offset;
+    section->size = 0;
+    writer->order = NULL;
+
+    return 0;
+}
+
+void level_binary_write_count(LevelBinaryWriter *writer, size_t count)
+{
+    trace_assert(writer);
+    trace_assert(writer->current > 0);
+    writer->sections[writer->current - 1].count = (uint32_t) count;
+}
+
+void level_binary_write_order(LevelBinaryWriter *writer, const uint32_t *order)
+{
+    trace_assert(writer);
+    trace_assert(writer->current > 0);
+    writer->order = order;
+}
+
+int level_binary_write(LevelBinaryWriter *writer,
+                       const void *data,
+                       size_t size)
+{
+    trace_assert(writer);
+    trace_assert(data || size == 0);
+
+    if (size == 0) {
+        return 0;
+    }
+
+    sb_append(writer->output, data, size);
+
+    trace_assert(writer->current > 0);
+    writer->sections[writer->current - 1].size += (uint32_t) size;
+
+    return 0;
+}
+
+int level_binary_write_dynarray(LevelBinaryWriter *writer,
+                                const Dynarray *dynarray)
+{
+    trace_assert(writer);
+    trace_assert(dynarray);
+
+    if (writer->order == NULL) {
+        return level_binary_write(
+            writer,
+            dynarray->data,
+            dynarray->count * dynarray->element_size);
+    }
+
+    const uint8_t *data = dynarray->data;
+    for (size_t i = 0; i < dynarray->count; ++i) {
+        trace_assert(writer->order[i] < dynarray->count);
+        if (level_binary_write(
+                writer,
+                data + writer->order[i] * dynarray->element_size,
+                dynarray->element_size) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int level_binary_writer_end(LevelBinaryWriter *writer)
+{
+    trace_assert(writer);
+    trace_assert(writer->current == writer->header.sections_count);
+
+    level_binary_write_table(writer, writer->output->data + writer->base);
+
+    return 0;
+}
+
+int level_binary_reader_begin(LevelBinaryReader *reader, String input)
+{
+    trace_assert(reader);
+
+    if (level_binary_check_byte_order() < 0) {
+        return -1;
+    }
+
+    LevelBinaryHeader header;
+    if (input.count < sizeof(header)) {
+        log_fail("Binary level is too small for the header\n");
+        return -1;
+    }
+    memcpy(&header, input.data, sizeof(header));
+
+    if (header.sections_count > LEVEL_BINARY_SECTIONS_CAPACITY ||
+        (input.count - sizeof(header)) / sizeof(LevelBinarySection) < header.sections_count) {
+        log_fail("Binary level has a broken section table\n");
+        return -1;
+    }
+
+    reader->data = (const uint8_t *) input.data;
+    reader->size = input.count;
+    reader->sections_count = header.sections_count;
+    reader->current = 0;
+
+    return 0;
+}
+
+int level_binary_next_section(LevelBinaryReader *reader,
+                              uint32_t layer,
+                              LevelBinarySlice *slice)
+{
+    trace_assert(reader);
+    trace_assert(slice);
+
+    if (reader->current >= reader->sections_count) {
+        log_fail("Binary level has no section for layer %u\n", layer);
+        return -1;
+    }
+
+    LevelBinarySection section;
+    memcpy(&section,
+           reader->data + sizeof(LevelBinaryHeader) + reader->current * sizeof(section),
+           sizeof(section));
+    reader->current++;
+
+    if (section.layer != layer) {
+        log_fail("Binary level has layer %u where layer %u was expected\n",
+                 section.layer, layer);
+        return -1;
+    }
+
+    // Every array in the payload is made of 32-bit fields, so the
+    // payload can be used in place only when it is aligned
+    if (section.offset % sizeof(uint32_t) != 0 ||
+        section.offset > reader->size ||
+        section.size > reader->size - section.offset) {
+        log_fail("Section of layer %u is out of the binary level\n", layer);
+        return -1;
+    }
+
+    slice->layer = section.layer;
+    slice->count = section.count;
+    slice->data = reader->data + section.offset;
+    slice->size = section.size;
+
+    return 0;
+}
+
+const void *level_binary_chop(LevelBinarySlice *slice, size_t size)
+{
+    trace_assert(slice);
+
+    if (size > slice->size) {
+        log_fail("Section of layer %u is truncated\n", slice->layer);
+        return NULL;
+    }
+
+    const void *result = slice->data;
+    slice->data += size;
+    slice->size -= size;
+
+    return result;
+}
+
+int level_binary_read(LevelBinarySlice *slice, void *data, size_t size)
+{
+    trace_assert(slice);
+    trace_assert(data || size == 0);
+
+    const void *chopped = level_binary_chop(slice, size);
+    if (chopped == NULL) {
+        return -1;
+    }
+
+    memcpy(data, chopped, size);
+
+    return 0;
+}
+
+int level_binary_read_dynarray(LevelBinarySlice *slice,
+                               Dynarray *dynarray)
+{
+    trace_assert(slice);
+    trace_assert(dynarray);
+
+    if (slice->count > slice->size / dynarray->element_size) {
+        log_fail("Layer %u is too short for %u entities\n",
+                 slice->layer, slice->count);
+        return -1;
+    }
+
+    if (dynarray_reserve(dynarray, slice->count) < 0) {
+        return -1;
+    }
+
+    if (level_binary_read(slice, dynarray->data, slice->count * dynarray->element_size) < 0) {
+        return -1;
+    }
+    dynarray->count = slice->count;
+
+    return 0;
+}
@@ -0,0 +1,144 @@
+#ifndef LEVEL_BINARY_H_
+#define LEVEL_BINARY_H_
+
+#include <stdint.h>
+
+#include "dynarray.h"
+#include "math/rect.h"
+#include "system/s.h"
+#include "system/string_builder.h"
+
+#define LEVEL_BINARY_VERSION "3"
+#define LEVEL_BINARY_EXTENSION ".bin"
+#define LEVEL_BINARY_SECTORED_EXTENSION ".sectors.bin"
+#define LEVEL_BINARY_SECTIONS_CAPACITY 16
+// Section of the optional sector index. Not a LayerPicker.
+#define LEVEL_BINARY_SECTOR_INDEX 0xffffu
+
+// Binary level format (version 3). All the numbers are
+// little-endian. The layout of the file:
+//
+//   LevelBinaryHeader
+//   LevelBinarySection[sections_count]
+//   payloads of the sections
+//
+// There is one section per layer in the same order as in the text
+// format. The payload of a section is the arrays of the layer (ids,
+// rects, colors, etc) stored one after another exactly as the layer
+// keeps them in memory, so loading a layer is a single memcpy per
+// array.
+//
+// A sectored level has one more section after the layers: the
+// sector index (see LevelSector). The readers that only know about
+// the layers never get to it.
+typedef struct {
+    // "3\n" padded with zeros, so the file starts with the same
+    // version line the text format has
+    char version[4];
+    uint32_t sections_count;
+} LevelBinaryHeader;
+
+typedef struct {
+    // LayerPicker of the layer stored in the section
+    uint32_t layer;
+    // Amount of entities in the layer
+    uint32_t count;
+    // Offset of the payload from the beginning of the file
+    uint32_t offset;
+    uint32_t size;
+} LevelBinarySection;
+
+// The layers that are split into sectors
+typedef enum {
+    LEVEL_SECTOR_PLATFORMS = 0,
+    LEVEL_SECTOR_BACK_PLATFORMS,
+    LEVEL_SECTOR_LAVA,
+    LEVEL_SECTOR_LABELS,
+    LEVEL_SECTOR_LAYERS_N
+} LevelSectorLayer;
+
+// The entities of the sectored layers are bucketed into square
+// sectors of the world by their centers and stored sector after
+// sector, so every sector is a range of every sectored layer
+typedef struct {
+    // Union of the entities of the sector. They may stick out of
+    // the sector itself.
+    Rect bounds;
+    uint32_t begin[LEVEL_SECTOR_LAYERS_N];
+    uint32_t count[LEVEL_SECTOR_LAYERS_N];
+} LevelSector;
+
+typedef enum {
+    LEVEL_FORMAT_TEXT = 0,
+    LEVEL_FORMAT_BINARY,
+    // Binary with the sector index
+    LEVEL_FORMAT_SECTORED
+} LevelFormat;
+
+LevelFormat level_format_of_file_name(const char *file_name);
+
+typedef struct {
+    StringBuilder *output;
+    // Where the level starts in the output
+    size_t base;
+    LevelBinaryHeader header;
+    LevelBinarySection sections[LEVEL_BINARY_SECTIONS_CAPACITY];
+    // The section the payload is currently written to is current - 1
+    uint32_t current;
+    // Order the elements of the dynarrays of the current section are
+    // written in. NULL means as they are.
+    const uint32_t *order;
+} LevelBinaryWriter;
+
+// Appends the level to output. The section table is filled in by
+// level_binary_writer_end() when the sizes of the sections are known.
+int level_binary_writer_begin(LevelBinaryWriter *writer,
+                              StringBuilder *output,
+                              uint32_t sections_count);
+int level_binary_section_begin(LevelBinaryWriter *writer,
+                               uint32_t layer);
+// Sets the amount of entities in the current section
+void level_binary_write_count(LevelBinaryWriter *writer, size_t count);
+// Permutes the dynarrays written to the current section
+void level_binary_write_order(LevelBinaryWriter *writer, const uint32_t *order);
+int level_binary_write(LevelBinaryWriter *writer,
+                       const void *data,
+                       size_t size);
+int level_binary_write_dynarray(LevelBinaryWriter *writer,
+                                const Dynarray *dynarray);
+int level_binary_writer_end(LevelBinaryWriter *writer);
+
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    uint32_t sections_count;
+    uint32_t current;
+} LevelBinaryReader;
+
+typedef struct {
+    uint32_t layer;
+    uint32_t count;
+    const uint8_t *data;
+    size_t size;
+} LevelBinarySlice;
+
+// input is the whole content of the file. The reader does not copy
+// it, so it must outlive the reader.
+int level_binary_reader_begin(LevelBinaryReader *reader, String input);
+int level_binary_next_section(LevelBinaryReader *reader,
+                              uint32_t layer,
+                              LevelBinarySlice *slice);
+static inline
+int level_binary_has_next_section(const LevelBinaryReader *reader)
+{
+    return reader->current < reader->sections_count;
+}
+// Returns the next size bytes of the slice in place, NULL if the
+// slice is shorter than that
+const void *level_binary_chop(LevelBinarySlice *slice, size_t size);
+int level_binary_read(LevelBinarySlice *slice, void *data, size_t size);
+// Replaces the content of the dynarray with slice->count elements
+int level_binary_read_dynarray(LevelBinarySlice *slice,
+                               Dynarray *dynarray);
+
+#endif  // LEVEL_BINARY_H_
@@ -0,0 +1,432 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "config.h"
+#include "level_journal.h"
+#include "rect_layer.h"
+#include "point_layer.h"
+#include "label_layer.h"
+#include "player_layer.h"
+#include "background_layer.h"
+#include "system/log.h"
+#include "system/lt.h"
+#include "system/nth_alloc.h"
+#include "system/stacktrace.h"
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    // FileStamp of the level file the edits are on top of, the mtime
+    // in nanoseconds since version 2
+    int64_t mtime;
+    int64_t size;
+} LevelJournalHeader;
+
+struct LevelJournal
+{
+    Lt *lt;
+    const LayerPtr *layers;
+
+    // Both are empty while no level is journaled
+    char file_name[METADATA_FILEPATH_MAX_SIZE];
+    char level_file_name[METADATA_FILEPATH_MAX_SIZE];
+    FileStamp stamp;
+
+    // NULL until the first edit. A journal without any edits is not
+    // kept on the disk.
+    FILE *file;
+    // The size of the records after the header
+    size_t records_size;
+    size_t mark;
+};
+
+static LevelJournalHeader level_journal_header(FileStamp stamp)
+{
+    LevelJournalHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LEVEL_JOURNAL_MAGIC, sizeof(header.magic));
+    header.version = LEVEL_JOURNAL_VERSION;
+    header.mtime = stamp.mtime;
+    header.size = stamp.size;
+    return header;
+}
+
+static void level_journal_close_file(LevelJournal *journal)
+{
+    if (journal->file) {
+        fclose(journal->file);
+        journal->file = NULL;
+    }
+}
+
+// Stops journaling after the journal could not be written, so the
+// same error is not reported on every edit
+static void level_journal_fail(LevelJournal *journal)
+{
+    log_fail("Could not write the journal %s: %s\n", journal->file_name, strerror(errno));
+    level_journal_close_file(journal);
+    journal->file_name[0] = '\0';
+    journal->level_file_name[0] = '\0';
+}
+
+// The journal is hidden next to the level, so the file watchers and
+// the level picker skip it
+static int level_journal_start(LevelJournal *journal,
+                               const char *level_file_name,
+                               FileStamp stamp)
+{
+    level_journal_close_file(journal);
+    journal->records_size = 0;
+    journal->mark = 0;
+    journal->stamp = stamp;
+
+    const char *slash = strrchr(level_file_name, '/');
+    const int dir_len = slash ? (int) (slash - level_file_name + 1) : 0;
+    if (snprintf(journal->file_name, METADATA_FILEPATH_MAX_SIZE, "%.*s.%s.journal",
+                 dir_len, level_file_name, level_file_name + dir_len)
+        >= METADATA_FILEPATH_MAX_SIZE) {
+        log_fail("Path %s is too long to be journaled\n", level_file_name);
+        journal->file_name[0] = '\0';
+        journal->level_file_name[0] = '\0';
+        return -1;
+    }
+    snprintf(journal->level_file_name, METADATA_FILEPATH_MAX_SIZE, "%s", level_file_name);
+
+    return 0;
+}
+
+// Everything from offset to the end or NULL if the file is not there
+static char *level_journal_read(const char *file_name, size_t offset, size_t *size)
+{
+    *size = 0;
+
+    FILE *f = fopen(file_name, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+
+    char *data = NULL;
+    if (fseek(f, 0, SEEK_END) < 0) goto end;
+    long end = ftell(f);
+    if (end < 0 || (size_t) end < offset) goto end;
+    if (fseek(f, (long) offset, SEEK_SET) < 0) goto end;
+
+    data = nth_calloc((size_t) end - offset + 1, sizeof(char));
+    if (data == NULL) goto end;
+    *size = fread(data, 1, (size_t) end - offset, f);
+
+end:
+    fclose(f);
+    return data;
+}
+
+static int level_journal_replay_record(LevelJournal *journal,
+                                       const LevelJournalRecord *record,
+                                       const void *entity,
+                                       UndoHistory *undo_history)
+{
+    const LayerPtr layer = journal->layers[record->layer];
+    const LevelJournalOp op = (LevelJournalOp) record->op;
+
+    switch (layer.type) {
+    case LAYER_RECT:
+        return rect_layer_replay(layer.ptr, op, record->index, record->index2, entity, undo_history);
+
+    case LAYER_POINT:
+        return point_layer_replay(layer.ptr, op, record->index, record->index2, entity, undo_history);
+
+    case LAYER_PLAYER:
+        return player_layer_replay(layer.ptr, op, entity, undo_history);
+
+    case LAYER_BACKGROUND:
+        return background_layer_replay(layer.ptr, op, entity, undo_history);
+
+    case LAYER_LABEL:
+        return label_layer_replay(layer.ptr, op, record->index, record->index2, entity, undo_history);
+    }
+
+    return -1;
+}
+
+// Stops at the first record that is cut short or makes no sense.
+// records_size is left at the end of the last replayed record.
+static int level_journal_replay(LevelJournal *journal,
+                                const char *records,
+                                size_t size,
+                                UndoHistory *undo_history)
+{
+    _Alignas(max_align_t) char entity[LEVEL_JOURNAL_ENTITY_MAX_SIZE];
+    int replayed = 0;
+
+    journal->records_size = 0;
+    while (size - journal->records_size >= sizeof(LevelJournalRecord)) {
+        LevelJournalRecord record;
+        memcpy(&record, records + journal->records_size, sizeof(record));
+
+        const size_t record_size = sizeof(record) + record.payload_size;
+        if (record.layer >= LAYER_PICKER_N ||
+            record.op >= LEVEL_JOURNAL_OP_N ||
+            record.payload_size > LEVEL_JOURNAL_ENTITY_MAX_SIZE ||
+            size - journal->records_size < record_size) {
+            break;
+        }
+
+        memset(entity, 0, sizeof(entity));
+        memcpy(entity, records + journal->records_size + sizeof(record), record.payload_size);
+
+        if (level_journal_replay_record(journal, &record, entity, undo_history) < 0) {
+            break;
+        }
+
+        journal->records_size += record_size;
+        replayed += 1;
+    }
+
+    if (journal->records_size < size) {
+        log_warn("The journal %s is damaged, only %d edits were replayed\n",
+                 journal->file_name, replayed);
+    }
+
+    return replayed;
+}
+
+LevelJournal *create_level_journal(void)
+{
+    Lt *lt = create_lt();
+
+    LevelJournal *journal = PUSH_LT(lt, nth_calloc(1, sizeof(LevelJournal)), free);
+    if (journal == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+    journal->lt = lt;
+
+    return journal;
+}
+
+void destroy_level_journal(LevelJournal *journal)
+{
+    trace_assert(journal);
+    // The journal stays on the disk with the edits that were not saved
+    level_journal_close_file(journal);
+    RETURN_LT0(journal->lt);
+}
+
+void level_journal_reset(LevelJournal *journal, const LayerPtr *layers)
+{
+    trace_assert(journal);
+    trace_assert(layers);
+
+    level_journal_close_file(journal);
+    journal->layers = layers;
+    journal->file_name[0] = '\0';
+    journal->level_file_name[0] = '\0';
+    journal->records_size = 0;
+    journal->mark = 0;
+}
+
+int level_journal_open(LevelJournal *journal,
+                       const char *level_file_name,
+                       FileStamp stamp,
+                       UndoHistory *undo_history)
+{
+    trace_assert(journal);
+    trace_assert(journal->layers);
+    trace_assert(level_file_name);
+    trace_assert(undo_history);
+
+    if (level_journal_start(journal, level_file_name, stamp) < 0) {
+        return -1;
+    }
+
+    size_t size = 0;
+    char *data = level_journal_read(journal->file_name, 0, &size);
+    if (data == NULL) {
+        undo_history->journal = journal;
+        return 0;
+    }
+
+    int replayed = 0;
+    const LevelJournalHeader header = level_journal_header(stamp);
+    if (size < sizeof(header) || memcmp(data, &header, sizeof(header)) != 0) {
+        log_warn("The level %s was changed after its journal was written, dropping the journal\n",
+                 level_file_name);
+    } else {
+        undo_history->journal = NULL;
+        replayed = level_journal_replay(
+            journal,
+            data + sizeof(header),
+            size - sizeof(header),
+            undo_history);
+        // The replayed edits are in the journal already
+        undo_history_flush(undo_history);
+    }
+
+    if (journal->records_size == 0) {
+        remove(journal->file_name);
+    } else {
+        // Whatever could not be replayed is cut off, the new edits
+        // would never be reached otherwise
+        if (sizeof(header) + journal->records_size < size &&
+            write_whole_file_atomic(
+                journal->file_name,
+                data,
+                sizeof(header) + journal->records_size) < 0) {
+            free(data);
+            level_journal_fail(journal);
+            return replayed;
+        }
+
+        journal->file = fopen(journal->file_name, "ab");
+        if (journal->file == NULL) {
+            free(data);
+            level_journal_fail(journal);
+            return replayed;
+        }
+    }
+
+    free(data);
+    undo_history->journal = journal;
+
+    return replayed;
+}
+
+void level_journal_mark(LevelJournal *journal)
+{
+    trace_assert(journal);
+    journal->mark = journal->records_size;
+}
+
+int level_journal_compact(LevelJournal *journal,
+                          const char *level_file_name,
+                          FileStamp stamp,
+                          UndoHistory *undo_history)
+{
+    trace_assert(journal);
+    trace_assert(journal->layers);
+    trace_assert(level_file_name);
+    trace_assert(undo_history);
+
+    // The level was saved under another name, so its journal starts
+    // from scratch
+    if (strcmp(journal->level_file_name, level_file_name) != 0) {
+        if (level_journal_start(journal, level_file_name, stamp) < 0) {
+            return -1;
+        }
+        remove(journal->file_name);
+        undo_history->journal = journal;
+        return 0;
+    }
+
+    level_journal_close_file(journal);
+    journal->stamp = stamp;
+
+    const size_t mark = journal->mark;
+    const size_t tail_size = journal->records_size - mark;
+    journal->records_size = 0;
+    journal->mark = 0;
+
+    if (tail_size == 0) {
+        remove(journal->file_name);
+        return 0;
+    }
+
+    // The edits made while the level was being saved
+    size_t size = 0;
+    char *data = level_journal_read(
+        journal->file_name,
+        sizeof(LevelJournalHeader) + mark,
+        &size);
+    if (data == NULL || size != tail_size) {
+        free(data);
+        level_journal_fail(journal);
+        return -1;
+    }
+
+    const size_t compacted_size = sizeof(LevelJournalHeader) + tail_size;
+    char *compacted = nth_calloc(compacted_size, sizeof(char));
+    if (compacted == NULL) {
+        free(data);
+        return -1;
+    }
+
+    const LevelJournalHeader header = level_journal_header(stamp);
+    memcpy(compacted, &header, sizeof(header));
+    memcpy(compacted + sizeof(header), data, tail_size);
+    free(data);
+
+    const int result = write_whole_file_atomic(journal->file_name, compacted, compacted_size);
+    free(compacted);
+    if (result < 0) {
+        level_journal_fail(journal);
+        return -1;
+    }
+
+    journal->file = fopen(journal->file_name, "ab");
+    if (journal->file == NULL) {
+        level_journal_fail(journal);
+        return -1;
+    }
+    journal->records_size = tail_size;
+
+    return 0;
+}
+
+void level_journal_write(LevelJournal *journal,
+                         const void *layer,
+                         LevelJournalOp op,
+                         size_t index,
+                         size_t index2,
+                         const void *entity,
+                         size_t entity_size)
+{
+    trace_assert(journal);
+    trace_assert(layer);
+    trace_assert(entity || entity_size == 0);
+    trace_assert(entity_size <= LEVEL_JOURNAL_ENTITY_MAX_SIZE);
+
+    if (journal->file_name[0] == '\0') {
+        return;
+    }
+
+    size_t layer_index = 0;
+    while (layer_index < LAYER_PICKER_N && journal->layers[layer_index].ptr != layer) {
+        layer_index += 1;
+    }
+    trace_assert(layer_index < LAYER_PICKER_N);
+
+    const char *bytes = entity;
+    size_t payload_size = entity_size;
+    while (payload_size > 0 && bytes[payload_size - 1] == 0) {
+        payload_size -= 1;
+    }
+
+    const LevelJournalRecord record = {
+        .layer = (uint8_t) layer_index,
+        .op = (uint8_t) op,
+        .payload_size = (uint16_t) payload_size,
+        .index = (uint32_t) index,
+        .index2 = (uint32_t) index2
+    };
+
+    if (journal->file == NULL) {
+        journal->file = fopen(journal->file_name, "wb");
+        const LevelJournalHeader header = level_journal_header(journal->stamp);
+        if (journal->file == NULL ||
+            fwrite(&header, sizeof(header), 1, journal->file) != 1) {
+            level_journal_fail(journal);
+            return;
+        }
+    }
+
+    if (fwrite(&record, sizeof(record), 1, journal->file) != 1 ||
+        (payload_size > 0 && fwrite(bytes, payload_size, 1, journal->file) != 1) ||
+        fflush(journal->file) != 0) {
+        level_journal_fail(journal);
+        return;
+    }
+
+    journal->records_size += sizeof(record) + payload_size;
+}
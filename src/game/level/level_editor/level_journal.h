@@ -0,0 +1,93 @@
+#ifndef LEVEL_JOURNAL_H_
+#define LEVEL_JOURNAL_H_
+
+#include <stdint.h>
+
+#include "layer.h"
+#include "layer_picker.h"
+#include "undo_history.h"
+#include "system/file.h"
+
+#define LEVEL_JOURNAL_MAGIC "NTHJ"
+#define LEVEL_JOURNAL_VERSION 2
+// The biggest entity any of the layers writes
+#define LEVEL_JOURNAL_ENTITY_MAX_SIZE 512
+
+// Ordered as the undo types of the rect, point and label layers
+typedef enum {
+    LEVEL_JOURNAL_ADD = 0,
+    LEVEL_JOURNAL_DELETE,
+    LEVEL_JOURNAL_UPDATE,
+    LEVEL_JOURNAL_SWAP,
+
+    LEVEL_JOURNAL_OP_N
+} LevelJournalOp;
+
+// Followed by payload_size bytes of the entity at index as it is
+// after the edit. The zeros at the end of the entity are left out.
+typedef struct {
+    uint8_t layer;              // LayerPicker
+    uint8_t op;                 // LevelJournalOp
+    uint16_t payload_size;
+    uint32_t index;
+    uint32_t index2;            // LEVEL_JOURNAL_SWAP only
+} LevelJournalRecord;
+
+// Every edit of the level editor appended to a hidden file next to
+// the level, so the edits that were not saved survive a crash
+// without dumping the whole level every time. The journal only makes
+// sense on top of the level file it was started for, so it
+// remembers the FileStamp of that file.
+typedef struct LevelJournal LevelJournal;
+
+LevelJournal *create_level_journal(void);
+void destroy_level_journal(LevelJournal *journal);
+
+// Stops journaling the previous level. The layers are indexed by
+// LayerPicker and are journaled once a level file is opened or saved.
+void level_journal_reset(LevelJournal *journal, const LayerPtr *layers);
+// Replays the edits left in the journal of level_file_name through
+// undo_history if the journal was written for the file with stamp.
+// Journals every edit of undo_history from now on. Returns how many
+// edits were replayed or -1.
+int level_journal_open(LevelJournal *journal,
+                       const char *level_file_name,
+                       FileStamp stamp,
+                       UndoHistory *undo_history);
+// Remembers where the journal is when the level is snapshotted for
+// a save
+void level_journal_mark(LevelJournal *journal);
+// The snapshot taken at the mark is now level_file_name with stamp,
+// so the edits before the mark are dropped
+int level_journal_compact(LevelJournal *journal,
+                          const char *level_file_name,
+                          FileStamp stamp,
+                          UndoHistory *undo_history);
+
+// Used by the JournalAction of the layers. entity is NULL for the
+// deletes and the swaps.
+void level_journal_write(LevelJournal *journal,
+                         const void *layer,
+                         LevelJournalOp op,
+                         size_t index,
+                         size_t index2,
+                         const void *entity,
+                         size_t entity_size);
+
+// The journal op of an undo type ordered as LevelJournalOp or of
+// reverting it
+static inline
+LevelJournalOp level_journal_op(int undo_type, int reverted)
+{
+    if (reverted && undo_type == LEVEL_JOURNAL_ADD) {
+        return LEVEL_JOURNAL_DELETE;
+    }
+
+    if (reverted && undo_type == LEVEL_JOURNAL_DELETE) {
+        return LEVEL_JOURNAL_ADD;
+    }
+
+    return (LevelJournalOp) undo_type;
+}
+
+#endif  // LEVEL_JOURNAL_H_
@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <SDL.h>
+
+#include "dynarray.h"
+#include "game/level/level_editor/label_layer.h"
+#include "game/level/level_editor/point_layer.h"
+#include "game/level/level_editor/rect_layer.h"
+#include "system/log.h"
+#include "system/memory.h"
+#include "system/nth_alloc.h"
+#include "system/stacktrace.h"
+#include "ui/cursor.h"
+#include "./level_load_bench.h"
+
+// The synthetic level is split into blocks and every block is loaded
+// into fresh layers, so the arena only ever holds a single block
+#define LEVEL_LOAD_BENCH_BLOCK 256
+#define LEVEL_LOAD_BENCH_LINE_SIZE 128
+#define LEVEL_LOAD_BENCH_ARENA_CAPACITY (4 * MEGA)
+
+typedef enum {
+    LEVEL_LOAD_BENCH_RECTS = 0,
+    LEVEL_LOAD_BENCH_POINTS,
+    LEVEL_LOAD_BENCH_LABELS,
+
+    LEVEL_LOAD_BENCH_N
+} LevelLoadBenchLayer;
+
+static const size_t level_load_bench_sizes[] = {1000, 10000, 100000};
+#define LEVEL_LOAD_BENCH_SIZES_COUNT (sizeof(level_load_bench_sizes) / sizeof(level_load_bench_sizes[0]))
+
+static float level_load_bench_float(void)
+{
+    return (float) rand() / (float) RAND_MAX * 10000.0f - 5000.0f;
+}
+
+static unsigned int level_load_bench_color(void)
+{
+    return (unsigned int) rand() & 0xFFFFFF;
+}
+
+// Appends a block of n entities in the level format of the layer
+static size_t level_load_bench_block(char *buffer,
+                                     LevelLoadBenchLayer layer,
+                                     size_t first,
+                                     size_t n)
+{
+    size_t size = (size_t) sprintf(buffer, "%lu\n", (unsigned long) n);
+
+    for (size_t i = first; i < first + n; ++i) {
+        switch (layer) {
+        case LEVEL_LOAD_BENCH_RECTS: {
+            size += (size_t) sprintf(
+                buffer + size, "rect_%lu %f %f %f %f %06x\n",
+                (unsigned long) i,
+                level_load_bench_float(), level_load_bench_float(),
+                level_load_bench_float(), level_load_bench_float(),
+                level_load_bench_color());
+        } break;
+
+        case LEVEL_LOAD_BENCH_POINTS: {
+            size += (size_t) sprintf(
+                buffer + size, "point_%lu %f %f %06x\n",
+                (unsigned long) i,
+                level_load_bench_float(), level_load_bench_float(),
+                level_load_bench_color());
+        } break;
+
+        case LEVEL_LOAD_BENCH_LABELS: {
+            size += (size_t) sprintf(
+                buffer + size, "label_%lu %f %f %06x\nLabel number %lu\n",
+                (unsigned long) i,
+                level_load_bench_float(), level_load_bench_float(),
+                level_load_bench_color(),
+                (unsigned long) i);
+        } break;
+
+        case LEVEL_LOAD_BENCH_N: {
+            trace_assert(0 && "Incorrect layer");
+        } break;
+        }
+    }
+
+    return size;
+}
+
+static int level_load_bench_size(Memory *memory, size_t entities)
+{
+    const size_t blocks = (entities + LEVEL_LOAD_BENCH_BLOCK - 1) / LEVEL_LOAD_BENCH_BLOCK;
+    const size_t capacity = blocks * (LEVEL_LOAD_BENCH_BLOCK + 1) * LEVEL_LOAD_BENCH_LINE_SIZE;
+
+    char *text = nth_calloc(capacity, sizeof(char));
+    if (text == NULL) {
+        return -1;
+    }
+
+    size_t size = 0;
+    for (size_t block = 0; block < blocks; ++block) {
+        const size_t first = block * LEVEL_LOAD_BENCH_BLOCK;
+        const size_t n = entities - first < LEVEL_LOAD_BENCH_BLOCK
+            ? entities - first
+            : LEVEL_LOAD_BENCH_BLOCK;
+        size += level_load_bench_block(
+            text + size,
+            (LevelLoadBenchLayer) (block % LEVEL_LOAD_BENCH_N),
+            first, n);
+    }
+
+    static Cursor cursor;
+    String input = string(size, text);
+    Uint64 ticks = 0;
+    size_t arena = 0;
+
+    for (size_t block = 0; block < blocks; ++block) {
+        memory_clean(memory);
+
+        RectLayer *rect_layer = create_rect_layer(memory, "rect", &cursor);
+        PointLayer *point_layer = create_point_layer(memory, "point");
+        LabelLayer *label_layer = create_label_layer(memory, "label");
+        const size_t before = memory_used(memory);
+
+        const Uint64 begin = SDL_GetPerformanceCounter();
+        int loaded = 0;
+        switch ((LevelLoadBenchLayer) (block % LEVEL_LOAD_BENCH_N)) {
+        case LEVEL_LOAD_BENCH_RECTS:
+            loaded = rect_layer_load(rect_layer, memory, &input);
+            break;
+        case LEVEL_LOAD_BENCH_POINTS:
+            loaded = point_layer_load(point_layer, memory, &input);
+            break;
+        case LEVEL_LOAD_BENCH_LABELS:
+            loaded = label_layer_load(label_layer, memory, &input);
+            break;
+        case LEVEL_LOAD_BENCH_N:
+            break;
+        }
+        ticks += SDL_GetPerformanceCounter() - begin;
+
+        if (loaded < 0) {
+            free(text);
+            memory_clean(memory);
+            return -1;
+        }
+
+        arena += memory_used(memory) - before;
+    }
+
+    const double seconds = (double) ticks / (double) SDL_GetPerformanceFrequency();
+    log_info("%lu entities (%lu bytes): %.3f ms, %.1f ns per entity, %lu bytes of the arena\n",
+             (unsigned long) entities,
+             (unsigned long) size,
+             seconds * 1000.0,
+             seconds * 1e9 / (double) entities,
+             (unsigned long) arena);
+
+    free(text);
+    memory_clean(memory);
+
+    return 0;
+}
+
+int level_load_bench(void)
+{
+    Memory memory = {
+        .capacity = LEVEL_LOAD_BENCH_ARENA_CAPACITY,
+        .size = 0,
+        .buffer = nth_calloc(LEVEL_LOAD_BENCH_ARENA_CAPACITY, sizeof(uint8_t))
+    };
+    if (memory.buffer == NULL) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < LEVEL_LOAD_BENCH_SIZES_COUNT; ++i) {
+        if (level_load_bench_size(&memory, level_load_bench_sizes[i]) < 0) {
+            free(memory.buffer);
+            return -1;
+        }
+    }
+
+    free(memory.buffer);
+
+    return 0;
+}
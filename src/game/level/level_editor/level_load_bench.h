@@ -0,0 +1,9 @@
+#ifndef LEVEL_LOAD_BENCH_H_
+#define LEVEL_LOAD_BENCH_H_
+
+// Measures how fast the level layers are parsed on synthetic levels
+// of 1k to 100k entities and how much of the memory arena the parsing
+// takes. The results are logged.
+int level_load_bench(void);
+
+#endif  // LEVEL_LOAD_BENCH_H_
@@ -0,0 +1,208 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "config.h"
+#include "game/level/level_editor/level_saver.h"
+#include "system/log.h"
+#include "system/lt.h"
+#include "system/nth_alloc.h"
+#include "system/stacktrace.h"
+
+typedef enum {
+    LEVEL_SAVE_NONE = 0,
+    LEVEL_SAVE_DONE,
+    LEVEL_SAVE_FAILED
+} LevelSaveResult;
+
+struct LevelSaver
+{
+    Lt *lt;
+    SDL_Thread *thread;
+
+    SDL_mutex *mutex;
+    SDL_cond *cond;
+    SDL_cond *done_cond;
+
+    // Formatted into by the main thread
+    StringBuilder front;
+    // Written by the saver thread
+    StringBuilder writing;
+
+    // Everything below is guarded by the mutex
+    StringBuilder pending;
+    char pending_file_name[METADATA_FILEPATH_MAX_SIZE];
+    bool requested;
+    bool writing_busy;
+    char saved_file_name[METADATA_FILEPATH_MAX_SIZE];
+    FileStamp saved_stamp;
+    LevelSaveResult result;
+    bool quit;
+};
+
+static void level_saver_swap(StringBuilder *a, StringBuilder *b)
+{
+    StringBuilder t = *a;
+    *a = *b;
+    *b = t;
+}
+
+static int level_saver_run(void *data)
+{
+    LevelSaver *saver = data;
+    char file_name[METADATA_FILEPATH_MAX_SIZE];
+
+    SDL_LockMutex(saver->mutex);
+    // The last request is written even if the saver is being
+    // destroyed already
+    while (!saver->quit || saver->requested) {
+        if (!saver->requested) {
+            SDL_CondWait(saver->cond, saver->mutex);
+            continue;
+        }
+
+        level_saver_swap(&saver->pending, &saver->writing);
+        memcpy(file_name, saver->pending_file_name, METADATA_FILEPATH_MAX_SIZE);
+        saver->requested = false;
+        saver->writing_busy = true;
+        SDL_UnlockMutex(saver->mutex);
+
+        FileStamp stamp = {0};
+        const int result =
+            write_whole_file_atomic(file_name, saver->writing.data, saver->writing.count) < 0
+            ? -1
+            : file_stamp(&stamp, file_name);
+
+        SDL_LockMutex(saver->mutex);
+        if (result < 0) {
+            log_fail("Could not save level %s\n", file_name);
+        }
+        memcpy(saver->saved_file_name, file_name, METADATA_FILEPATH_MAX_SIZE);
+        saver->saved_stamp = stamp;
+        saver->result = result < 0 ? LEVEL_SAVE_FAILED : LEVEL_SAVE_DONE;
+        saver->writing_busy = false;
+        SDL_CondBroadcast(saver->done_cond);
+    }
+    SDL_UnlockMutex(saver->mutex);
+
+    return 0;
+}
+
+LevelSaver *create_level_saver(void)
+{
+    Lt *lt = create_lt();
+
+    LevelSaver *saver = PUSH_LT(lt, nth_calloc(1, sizeof(LevelSaver)), free);
+    if (saver == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+    saver->lt = lt;
+
+    saver->mutex = PUSH_LT(lt, SDL_CreateMutex(), SDL_DestroyMutex);
+    if (saver->mutex == NULL) {
+        log_fail("SDL_CreateMutex: %s\n", SDL_GetError());
+        RETURN_LT(lt, NULL);
+    }
+
+    saver->cond = PUSH_LT(lt, SDL_CreateCond(), SDL_DestroyCond);
+    if (saver->cond == NULL) {
+        log_fail("SDL_CreateCond: %s\n", SDL_GetError());
+        RETURN_LT(lt, NULL);
+    }
+
+    saver->done_cond = PUSH_LT(lt, SDL_CreateCond(), SDL_DestroyCond);
+    if (saver->done_cond == NULL) {
+        log_fail("SDL_CreateCond: %s\n", SDL_GetError());
+        RETURN_LT(lt, NULL);
+    }
+
+    saver->thread = SDL_CreateThread(level_saver_run, "level saver", saver);
+    if (saver->thread == NULL) {
+        log_fail("Could not create the level saver thread: %s\n", SDL_GetError());
+        RETURN_LT(lt, NULL);
+    }
+
+    return saver;
+}
+
+void destroy_level_saver(LevelSaver *saver)
+{
+    trace_assert(saver);
+
+    SDL_LockMutex(saver->mutex);
+    saver->quit = true;
+    SDL_CondSignal(saver->cond);
+    SDL_UnlockMutex(saver->mutex);
+
+    SDL_WaitThread(saver->thread, NULL);
+
+    destroy_string_builder(&saver->front);
+    destroy_string_builder(&saver->pending);
+    destroy_string_builder(&saver->writing);
+
+    RETURN_LT0(saver->lt);
+}
+
+StringBuilder *level_saver_buffer(LevelSaver *saver)
+{
+    trace_assert(saver);
+    return &saver->front;
+}
+
+void level_saver_request(LevelSaver *saver, const char *file_name)
+{
+    trace_assert(saver);
+    trace_assert(file_name);
+
+    SDL_LockMutex(saver->mutex);
+    level_saver_swap(&saver->front, &saver->pending);
+    snprintf(saver->pending_file_name, METADATA_FILEPATH_MAX_SIZE, "%s", file_name);
+    saver->requested = true;
+    SDL_CondSignal(saver->cond);
+    SDL_UnlockMutex(saver->mutex);
+}
+
+int level_saver_poll(LevelSaver *saver, const char *file_name, FileStamp *stamp)
+{
+    trace_assert(saver);
+    trace_assert(file_name);
+    trace_assert(stamp);
+
+    int result = 0;
+
+    SDL_LockMutex(saver->mutex);
+    // The results of a level that is not edited anymore are dropped
+    if (saver->result != LEVEL_SAVE_NONE &&
+        strcmp(saver->saved_file_name, file_name) == 0) {
+        *stamp = saver->saved_stamp;
+        result = saver->result == LEVEL_SAVE_DONE ? 1 : -1;
+    }
+    saver->result = LEVEL_SAVE_NONE;
+    SDL_UnlockMutex(saver->mutex);
+
+    return result;
+}
+
+bool level_saver_busy(LevelSaver *saver)
+{
+    trace_assert(saver);
+
+    SDL_LockMutex(saver->mutex);
+    const bool busy = saver->requested || saver->writing_busy;
+    SDL_UnlockMutex(saver->mutex);
+
+    return busy;
+}
+
+void level_saver_wait(LevelSaver *saver)
+{
+    trace_assert(saver);
+
+    SDL_LockMutex(saver->mutex);
+    while (saver->requested || saver->writing_busy) {
+        SDL_CondWait(saver->done_cond, saver->mutex);
+    }
+    SDL_UnlockMutex(saver->mutex);
+}
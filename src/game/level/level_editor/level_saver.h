@@ -0,0 +1,33 @@
+#ifndef LEVEL_SAVER_H_
+#define LEVEL_SAVER_H_
+
+#include <stdbool.h>
+
+#include "system/file.h"
+#include "system/string_builder.h"
+
+// Writes the levels saved by the level editor in the background. The
+// editor only formats the level into memory and the file is replaced
+// atomically, so a crash in the middle of a save never leaves a
+// truncated level behind.
+typedef struct LevelSaver LevelSaver;
+
+LevelSaver *create_level_saver(void);
+// Waits for the save that was requested last to finish
+void destroy_level_saver(LevelSaver *saver);
+
+// Where the level is formatted before level_saver_request(). Belongs
+// to the caller until then.
+StringBuilder *level_saver_buffer(LevelSaver *saver);
+// Starts writing the buffer into file_name. A request that was not
+// picked up yet is replaced by it.
+void level_saver_request(LevelSaver *saver, const char *file_name);
+// Never blocks. Returns 1 and fills stamp when the last save of
+// file_name is on the disk, -1 when it failed and 0 otherwise.
+int level_saver_poll(LevelSaver *saver, const char *file_name, FileStamp *stamp);
+// Something is being written or about to be
+bool level_saver_busy(LevelSaver *saver);
+// Blocks until nothing is being written or about to be
+void level_saver_wait(LevelSaver *saver);
+
+#endif  // LEVEL_SAVER_H_
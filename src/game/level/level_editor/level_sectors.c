@@ -0,0 +1,149 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "system/log.h"
+#include "system/nth_alloc.h"
+#include "system/stacktrace.h"
+#include "./level_sectors.h"
+
+typedef struct {
+    int32_t x;
+    int32_t y;
+    uint32_t layer;
+    uint32_t index;
+} LevelSectorEntry;
+
+// Rows of sectors top to bottom, then the layers and the original
+// order of the entities within the sector
+static int level_sector_entry_compare(const void *a, const void *b)
+{
+    const LevelSectorEntry *e1 = a;
+    const LevelSectorEntry *e2 = b;
+
+    if (e1->y != e2->y) {
+        return (e1->y > e2->y) - (e1->y < e2->y);
+    }
+
+    if (e1->x != e2->x) {
+        return (e1->x > e2->x) - (e1->x < e2->x);
+    }
+
+    if (e1->layer != e2->layer) {
+        return (e1->layer > e2->layer) - (e1->layer < e2->layer);
+    }
+
+    return (e1->index > e2->index) - (e1->index < e2->index);
+}
+
+static int32_t level_sector_coord(float x)
+{
+    return (int32_t) floorf(x / LEVEL_SECTOR_SIZE);
+}
+
+int create_level_sector_index(LevelSectorIndex *index,
+                              const Rect *const bounds[LEVEL_SECTOR_LAYERS_N],
+                              const size_t counts[LEVEL_SECTOR_LAYERS_N])
+{
+    trace_assert(index);
+    trace_assert(bounds);
+    trace_assert(counts);
+
+    memset(index, 0, sizeof(*index));
+
+    size_t total = 0;
+    for (size_t layer = 0; layer < LEVEL_SECTOR_LAYERS_N; ++layer) {
+        trace_assert(bounds[layer] || counts[layer] == 0);
+        total += counts[layer];
+
+        // One extra element, so nothing is allocated with zero size
+        index->orders[layer] = nth_calloc(counts[layer] + 1, sizeof(uint32_t));
+        if (index->orders[layer] == NULL) {
+            destroy_level_sector_index(index);
+            return -1;
+        }
+    }
+
+    LevelSectorEntry *entries = nth_calloc(total + 1, sizeof(LevelSectorEntry));
+    if (entries == NULL) {
+        destroy_level_sector_index(index);
+        return -1;
+    }
+
+    size_t n = 0;
+    for (size_t layer = 0; layer < LEVEL_SECTOR_LAYERS_N; ++layer) {
+        for (size_t i = 0; i < counts[layer]; ++i) {
+            const Vec2f center = rect_center(bounds[layer][i]);
+            entries[n++] = (LevelSectorEntry) {
+                .x = level_sector_coord(center.x),
+                .y = level_sector_coord(center.y),
+                .layer = (uint32_t) layer,
+                .index = (uint32_t) i
+            };
+        }
+    }
+    qsort(entries, n, sizeof(LevelSectorEntry), level_sector_entry_compare);
+
+    // There are never more sectors than entities
+    index->sectors = nth_calloc(n + 1, sizeof(LevelSector));
+    if (index->sectors == NULL) {
+        free(entries);
+        destroy_level_sector_index(index);
+        return -1;
+    }
+
+    size_t positions[LEVEL_SECTOR_LAYERS_N] = {0};
+    LevelSector *sector = NULL;
+    for (size_t i = 0; i < n; ++i) {
+        const LevelSectorEntry *entry = &entries[i];
+        const Rect entity = bounds[entry->layer][entry->index];
+
+        if (i == 0 || entry->x != entries[i - 1].x || entry->y != entries[i - 1].y) {
+            sector = &index->sectors[index->count++];
+            sector->bounds = entity;
+            for (size_t layer = 0; layer < LEVEL_SECTOR_LAYERS_N; ++layer) {
+                sector->begin[layer] = (uint32_t) positions[layer];
+            }
+        }
+
+        sector->bounds = rect_boundary2(sector->bounds, entity);
+        sector->count[entry->layer]++;
+        index->orders[entry->layer][positions[entry->layer]++] = entry->index;
+    }
+
+    // So the rounding of rect_boundary2() never leaves a bit of an
+    // entity out of the bounds
+    for (size_t i = 0; i < index->count; ++i) {
+        index->sectors[i].bounds = rect_pad(index->sectors[i].bounds, 1.0f);
+    }
+
+    free(entries);
+
+    return 0;
+}
+
+void destroy_level_sector_index(LevelSectorIndex *index)
+{
+    trace_assert(index);
+
+    free(index->sectors);
+    for (size_t layer = 0; layer < LEVEL_SECTOR_LAYERS_N; ++layer) {
+        free(index->orders[layer]);
+    }
+
+    memset(index, 0, sizeof(*index));
+}
+
+int level_sector_index_dump_binary(const LevelSectorIndex *index,
+                                   LevelBinaryWriter *writer)
+{
+    trace_assert(index);
+    trace_assert(writer);
+
+    level_binary_write_count(writer, index->count);
+
+    return level_binary_write(
+        writer,
+        index->sectors,
+        index->count * sizeof(LevelSector));
+}
@@ -0,0 +1,27 @@
+#ifndef LEVEL_SECTORS_H_
+#define LEVEL_SECTORS_H_
+
+#include "game/level/level_editor/level_binary.h"
+
+#define LEVEL_SECTOR_SIZE 2048.0f
+
+// Sector index of a sectored binary level along with the order the
+// entities of the sectored layers have to be written in
+typedef struct {
+    size_t count;
+    LevelSector *sectors;
+    // orders[layer][i] is the index of the entity that goes i-th
+    uint32_t *orders[LEVEL_SECTOR_LAYERS_N];
+} LevelSectorIndex;
+
+// bounds[layer] are the bounding rects of the counts[layer] entities
+// of the sectored layer
+int create_level_sector_index(LevelSectorIndex *index,
+                              const Rect *const bounds[LEVEL_SECTOR_LAYERS_N],
+                              const size_t counts[LEVEL_SECTOR_LAYERS_N]);
+void destroy_level_sector_index(LevelSectorIndex *index);
+
+int level_sector_index_dump_binary(const LevelSectorIndex *index,
+                                   LevelBinaryWriter *writer);
+
+#endif  // LEVEL_SECTORS_H_
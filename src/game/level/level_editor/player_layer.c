@@ -9,6 +9,7 @@
 #include "system/log.h"
 #include "undo_history.h"
 #include "system/memory.h"
+#include "game/level/level_file.h"
 
 typedef struct {
     PlayerLayer *layer;
@@ -42,6 +43,31 @@ void player_layer_undo(void *context, size_t context_size)
     player_layer->prev_color = undo_context->color;
 }
 
+// What the journal keeps of the player
+typedef struct {
+    Vec2f position;
+    Color color;
+} PlayerJournalEntity;
+
+static
+void player_layer_journal(const void *context, size_t context_size,
+                          int reverted, LevelJournal *journal)
+{
+    trace_assert(context);
+    trace_assert(sizeof(PlayerUndoContext) == context_size);
+    (void) reverted;
+
+    const PlayerUndoContext *undo_context = context;
+    const PlayerJournalEntity entity = {
+        .position = undo_context->layer->position,
+        .color = color_picker_rgba(&undo_context->layer->color_picker)
+    };
+
+    level_journal_write(
+        journal, undo_context->layer, LEVEL_JOURNAL_UPDATE,
+        0, 0, &entity, sizeof(entity));
+}
+
 PlayerLayer create_player_layer(Vec2f position, Color color)
 {
     return (PlayerLayer) {
@@ -56,12 +82,11 @@ PlayerLayer chop_player_layer(Memory *memory, String *input)
     trace_assert(memory);
     trace_assert(input);
 
-    String line = chop_by_delim(input, '\n');
-    float x = strtof(string_to_cstr(memory, chop_word(&line)), NULL);
-    float y = strtof(string_to_cstr(memory, chop_word(&line)), NULL);
-    Color color = hexs(chop_word(&line));
+    Vec2f position;
+    Color color;
+    level_file_chop_player(input, &position, &color);
 
-    return create_player_layer(vec(x, y), color);
+    return create_player_layer(position, color);
 }
 
 LayerPtr player_layer_as_layer(PlayerLayer *player_layer)
@@ -100,6 +125,54 @@ int player_layer_render(const PlayerLayer *player_layer,
     return 0;
 }
 
+size_t player_layer_apply(PlayerLayer *player_layer,
+                          Vec2f position,
+                          Color color,
+                          UndoHistory *undo_history)
+{
+    trace_assert(player_layer);
+    trace_assert(undo_history);
+
+    if (memcmp(&player_layer->position, &position, sizeof(Vec2f)) == 0 &&
+        memcmp(&player_layer->prev_color, &color, sizeof(Color)) == 0) {
+        return 0;
+    }
+
+    PlayerUndoContext context =
+        player_layer_create_undo_context(player_layer);
+    undo_history_push(
+        undo_history,
+        player_layer_undo,
+        player_layer_journal,
+        &context, sizeof(context));
+
+    player_layer->position = position;
+    player_layer->color_picker = create_color_picker_from_rgba(color);
+    player_layer->prev_color = color;
+
+    return 1;
+}
+
+int player_layer_replay(PlayerLayer *player_layer,
+                        LevelJournalOp op,
+                        const void *entity,
+                        UndoHistory *undo_history)
+{
+    trace_assert(player_layer);
+    trace_assert(entity);
+    trace_assert(undo_history);
+
+    if (op != LEVEL_JOURNAL_UPDATE) {
+        return -1;
+    }
+
+    PlayerJournalEntity e;
+    memcpy(&e, entity, sizeof(e));
+    player_layer_apply(player_layer, e.position, e.color, undo_history);
+
+    return 0;
+}
+
 int player_layer_event(PlayerLayer *player_layer,
                        const SDL_Event *event,
                        const Camera *camera,
@@ -125,6 +198,7 @@ int player_layer_event(PlayerLayer *player_layer,
         undo_history_push(
             undo_history,
             player_layer_undo,
+            player_layer_journal,
             &context,
             sizeof(context));
         player_layer->prev_color = color_picker_rgba(&player_layer->color_picker);
@@ -137,9 +211,12 @@ int player_layer_event(PlayerLayer *player_layer,
         PlayerUndoContext context =
             player_layer_create_undo_context(player_layer);
 
-        undo_history_push(
+        // There is only one player, so its index is always 0
+        undo_history_push_coalesced(
             undo_history,
             player_layer_undo,
+            player_layer_journal,
+            player_layer, 0,
             &context, sizeof(context));
 
         player_layer->position =
@@ -151,15 +228,54 @@ int player_layer_event(PlayerLayer *player_layer,
     return 0;
 }
 
-int player_layer_dump_stream(const PlayerLayer *player_layer,
-                             FILE *filedump)
+int player_layer_dump_text(const PlayerLayer *player_layer,
+                           StringBuilder *sb)
+{
+    trace_assert(player_layer);
+    trace_assert(sb);
+
+    sb_append_float(sb, player_layer->position.x);
+    sb_append_char(sb, ' ');
+    sb_append_float(sb, player_layer->position.y);
+    sb_append_char(sb, ' ');
+    color_hex_to_sb(color_picker_rgba(&player_layer->color_picker), sb);
+    sb_append_char(sb, '\n');
+
+    return 0;
+}
+
+int player_layer_load_binary(PlayerLayer *player_layer,
+                             LevelBinarySlice *slice)
+{
+    trace_assert(player_layer);
+    trace_assert(slice);
+
+    Vec2f position;
+    Color color;
+    if (level_binary_read(slice, &position, sizeof(position)) < 0 ||
+        level_binary_read(slice, &color, sizeof(color)) < 0) {
+        return -1;
+    }
+
+    *player_layer = create_player_layer(position, color);
+
+    return 0;
+}
+
+int player_layer_dump_binary(const PlayerLayer *player_layer,
+                             LevelBinaryWriter *writer)
 {
     trace_assert(player_layer);
-    trace_assert(filedump);
+    trace_assert(writer);
+
+    const Color color = color_picker_rgba(&player_layer->color_picker);
 
-    fprintf(filedump, "%f %f ", player_layer->position.x, player_layer->position.y);
-    color_hex_to_stream(color_picker_rgba(&player_layer->color_picker), filedump);
-    fprintf(filedump, "\n");
+    level_binary_write_count(writer, 1);
+
+    if (level_binary_write(writer, &player_layer->position, sizeof(player_layer->position)) < 0 ||
+        level_binary_write(writer, &color, sizeof(color)) < 0) {
+        return -1;
+    }
 
     return 0;
 }
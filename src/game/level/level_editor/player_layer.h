@@ -3,6 +3,7 @@
 
 #include "color_picker.h"
 #include "layer.h"
+#include "level_journal.h"
 #include "system/memory.h"
 #include "system/s.h"
 
@@ -24,7 +25,24 @@ int player_layer_event(PlayerLayer *player_layer,
                        const Camera *camera,
                        UndoHistory *undo_history);
 
-int player_layer_dump_stream(const PlayerLayer *player_layer,
-                             FILE *filedump);
+// Moves and recolors the player as a reloaded level file says.
+// Undoable. Returns 1 if anything changed.
+size_t player_layer_apply(PlayerLayer *player_layer,
+                          Vec2f position,
+                          Color color,
+                          UndoHistory *undo_history);
+// Redoes an edit read from the level journal. Undoable. Returns -1
+// if the edit does not fit the layer.
+int player_layer_replay(PlayerLayer *player_layer,
+                        LevelJournalOp op,
+                        const void *entity,
+                        UndoHistory *undo_history);
+
+int player_layer_dump_text(const PlayerLayer *player_layer,
+                           StringBuilder *sb);
+int player_layer_load_binary(PlayerLayer *player_layer,
+                             LevelBinarySlice *slice);
+int player_layer_dump_binary(const PlayerLayer *player_layer,
+                             LevelBinaryWriter *writer);
 
 #endif  // PLAYER_LAYER_H_
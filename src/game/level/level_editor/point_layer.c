@@ -3,6 +3,7 @@
 #include <SDL.h>
 
 #include "dynarray.h"
+#include "game/level/level_file.h"
 #include "game/camera.h"
 #include "system/log.h"
 #include "system/nth_alloc.h"
@@ -11,7 +12,7 @@
 #include "ui/edit_field.h"
 #include "./point_layer.h"
 #include "math/extrema.h"
-#include "math/mat3x3.h"
+#include "math/affine.h"
 #include "./color_picker.h"
 #include "undo_history.h"
 
@@ -93,9 +94,9 @@ void point_layer_undo(void *context, size_t context_size)
 
     switch (undo_context->type) {
     case POINT_UNDO_ADD: {
-        dynarray_pop(&point_layer->positions, NULL);
-        dynarray_pop(&point_layer->colors, NULL);
-        dynarray_pop(&point_layer->ids, NULL);
+        dynarray_delete_at(&point_layer->positions, undo_context->index);
+        dynarray_delete_at(&point_layer->colors, undo_context->index);
+        dynarray_delete_at(&point_layer->ids, undo_context->index);
         point_layer->selection = -1;
     } break;
 
@@ -120,12 +121,65 @@ void point_layer_undo(void *context, size_t context_size)
     }
 }
 
+// What the journal keeps of a point. The id goes last, so the zeros
+// after it are not written.
+typedef struct {
+    Vec2f position;
+    Color color;
+    char id[ID_MAX_SIZE];
+} PointJournalEntity;
+
+static
+void point_layer_journal(const void *context, size_t context_size,
+                         int reverted, LevelJournal *journal)
+{
+    trace_assert(context);
+    trace_assert(sizeof(PointUndoContext) == context_size);
+
+    const PointUndoContext *undo_context = context;
+    PointLayer *point_layer = undo_context->layer;
+    const LevelJournalOp op = level_journal_op((int) undo_context->type, reverted);
+
+    if (op == LEVEL_JOURNAL_DELETE || op == LEVEL_JOURNAL_SWAP) {
+        level_journal_write(
+            journal, point_layer, op,
+            undo_context->index, op == LEVEL_JOURNAL_SWAP ? undo_context->index2 : 0,
+            NULL, 0);
+        return;
+    }
+
+    PointJournalEntity entity;
+    memset(&entity, 0, sizeof(entity));
+    dynarray_copy_to(&point_layer->positions, &entity.position, undo_context->index);
+    dynarray_copy_to(&point_layer->colors, &entity.color, undo_context->index);
+    dynarray_copy_to(&point_layer->ids, entity.id, undo_context->index);
+    level_journal_write(
+        journal, point_layer, op,
+        undo_context->index, 0,
+        &entity, sizeof(entity));
+}
+
 #define POINT_UNDO_PUSH(HISTORY, CONTEXT)                                     \
     do {                                                                \
         PointUndoContext context = (CONTEXT);                                \
         undo_history_push(                                              \
             HISTORY,                                                    \
             point_layer_undo,                                           \
+            point_layer_journal,                                        \
+            &context,                                                   \
+            sizeof(context));                                           \
+    } while(0)
+
+// For the moves of the point of an update context
+#define POINT_UNDO_PUSH_COALESCED(HISTORY, CONTEXT)                     \
+    do {                                                                \
+        PointUndoContext context = (CONTEXT);                           \
+        undo_history_push_coalesced(                                    \
+            HISTORY,                                                    \
+            point_layer_undo,                                           \
+            point_layer_journal,                                        \
+            context.layer,                                              \
+            context.index,                                              \
             &context,                                                   \
             sizeof(context));                                           \
     } while(0)
@@ -157,41 +211,42 @@ PointLayer *create_point_layer(Memory *memory,
     return result;
 }
 
-void point_layer_load(PointLayer *point_layer,
-                      Memory *memory,
-                      String *input)
+int point_layer_load(PointLayer *point_layer,
+                     Memory *memory,
+                     String *input)
 {
     trace_assert(point_layer);
     trace_assert(memory);
     trace_assert(input);
 
-    int n = atoi(string_to_cstr(memory, trim(chop_by_delim(input, '\n'))));
+    const size_t n = level_file_chop_count(input);
+    if (dynarray_reserve(&point_layer->positions, n) < 0 ||
+        dynarray_reserve(&point_layer->colors, n) < 0 ||
+        dynarray_reserve(&point_layer->ids, n) < 0) {
+        return -1;
+    }
+
     char id[ENTITY_MAX_ID_SIZE];
-    for (int i = 0; i < n; ++i) {
-        String line = trim(chop_by_delim(input, '\n'));
-        String string_id = trim(chop_word(&line));
+    for (size_t i = 0; i < n; ++i) {
         Vec2f point;
-        point.x = strtof(string_to_cstr(memory, trim(chop_word(&line))), NULL);
-        point.y = strtof(string_to_cstr(memory, trim(chop_word(&line))), NULL);
-        Color color = hexs(trim(chop_word(&line)));
-
-        memset(id, 0, ENTITY_MAX_ID_SIZE);
-        memcpy(id, string_id.data, min_size_t(ENTITY_MAX_ID_SIZE - 1, string_id.count));
+        Color color;
+        level_file_chop_point(input, id, &point, &color);
 
         dynarray_push(&point_layer->positions, &point);
         dynarray_push(&point_layer->colors, &color);
         dynarray_push(&point_layer->ids, id);
     }
+
+    return 0;
 }
 
 static inline
 Triangle element_shape(Vec2f position, float scale)
 {
-    return triangle_mat3x3_product(
-        equilateral_triangle(),
-        mat3x3_product(
-            trans_mat_vec(position),
-            scale_mat(scale)));
+    return affine_triangle(
+        affine(scale, 0.0f, position.x,
+               0.0f, scale, position.y),
+        equilateral_triangle());
 }
 
 int point_layer_render(const PointLayer *point_layer,
@@ -545,7 +600,7 @@ int point_layer_move_event(PointLayer *point_layer,
                         positions[point_layer->selection]));
 
             if (distance > 1e-6) {
-                POINT_UNDO_PUSH(
+                POINT_UNDO_PUSH_COALESCED(
                     undo_history,
                     create_point_undo_context(
                         point_layer,
@@ -556,6 +611,7 @@ int point_layer_move_event(PointLayer *point_layer,
                     (size_t) point_layer->selection,
                     &point_layer->inter_position);
             }
+            undo_history_end_coalescing(undo_history);
         } break;
         }
     } break;
@@ -654,6 +710,135 @@ int point_layer_event(PointLayer *point_layer,
     return 0;
 }
 
+size_t point_layer_apply(PointLayer *point_layer,
+                         const LevelPoints *points,
+                         UndoHistory *undo_history)
+{
+    trace_assert(point_layer);
+    trace_assert(points);
+    trace_assert(undo_history);
+
+    size_t changes = 0;
+
+    // The undo contexts take the element from the selection
+    for (size_t i = point_layer->positions.count; i-- > 0;) {
+        const char *id = (const char *)dynarray_pointer_at(&point_layer->ids, i);
+        if (level_file_find_id(points->ids, points->count, id, i) < 0) {
+            point_layer->selection = (int) i;
+            point_layer_delete_nth_element(point_layer, i, undo_history);
+            changes += 1;
+        }
+    }
+
+    for (size_t j = 0; j < points->count; ++j) {
+        const char *id = points->ids + j * ENTITY_MAX_ID_SIZE;
+        const int i = level_file_find_id(
+            (const char *)point_layer->ids.data, point_layer->ids.count, id, j);
+
+        if (i < 0) {
+            dynarray_push(&point_layer->positions, &points->positions[j]);
+            dynarray_push(&point_layer->colors, &points->colors[j]);
+            dynarray_push(&point_layer->ids, id);
+            POINT_UNDO_PUSH(
+                undo_history,
+                create_point_undo_context(point_layer, POINT_UNDO_ADD));
+            changes += 1;
+            continue;
+        }
+
+        const Vec2f *position = dynarray_pointer_at(&point_layer->positions, (size_t) i);
+        const Color *color = dynarray_pointer_at(&point_layer->colors, (size_t) i);
+        if (memcmp(position, &points->positions[j], sizeof(Vec2f)) != 0 ||
+            memcmp(color, &points->colors[j], sizeof(Color)) != 0) {
+            point_layer->selection = i;
+            POINT_UNDO_PUSH(
+                undo_history,
+                create_point_undo_context(point_layer, POINT_UNDO_UPDATE));
+            Vec2f new_position = points->positions[j];
+            Color new_color = points->colors[j];
+            dynarray_replace_at(&point_layer->positions, (size_t) i, &new_position);
+            dynarray_replace_at(&point_layer->colors, (size_t) i, &new_color);
+            changes += 1;
+        }
+    }
+
+    if (changes > 0) {
+        point_layer->selection = -1;
+        point_layer->state = POINT_LAYER_IDLE;
+    }
+
+    return changes;
+}
+
+int point_layer_replay(PointLayer *point_layer,
+                       LevelJournalOp op,
+                       size_t index,
+                       size_t index2,
+                       const void *entity,
+                       UndoHistory *undo_history)
+{
+    trace_assert(point_layer);
+    trace_assert(entity);
+    trace_assert(undo_history);
+
+    PointJournalEntity e;
+    memcpy(&e, entity, sizeof(e));
+    e.id[ID_MAX_SIZE - 1] = '\0';
+
+    const size_t count = point_layer->positions.count;
+
+    // The undo contexts take the element from the selection
+    switch (op) {
+    case LEVEL_JOURNAL_ADD: {
+        if (index > count) {
+            return -1;
+        }
+        dynarray_insert_before(&point_layer->positions, index, &e.position);
+        dynarray_insert_before(&point_layer->colors, index, &e.color);
+        dynarray_insert_before(&point_layer->ids, index, e.id);
+        PointUndoContext add_context = create_point_undo_context(point_layer, POINT_UNDO_ADD);
+        add_context.index = index;
+        POINT_UNDO_PUSH(undo_history, add_context);
+    } break;
+
+    case LEVEL_JOURNAL_DELETE: {
+        if (index >= count) {
+            return -1;
+        }
+        point_layer->selection = (int) index;
+        point_layer_delete_nth_element(point_layer, index, undo_history);
+    } break;
+
+    case LEVEL_JOURNAL_UPDATE: {
+        if (index >= count) {
+            return -1;
+        }
+        point_layer->selection = (int) index;
+        POINT_UNDO_PUSH(
+            undo_history,
+            create_point_undo_context(point_layer, POINT_UNDO_UPDATE));
+        dynarray_replace_at(&point_layer->positions, index, &e.position);
+        dynarray_replace_at(&point_layer->colors, index, &e.color);
+        dynarray_replace_at(&point_layer->ids, index, e.id);
+    } break;
+
+    case LEVEL_JOURNAL_SWAP: {
+        if (index >= count || index2 >= count) {
+            return -1;
+        }
+        point_layer_swap_elements(point_layer, index, index2, undo_history);
+    } break;
+
+    default:
+        return -1;
+    }
+
+    point_layer->selection = -1;
+    point_layer->state = POINT_LAYER_IDLE;
+
+    return 0;
+}
+
 size_t point_layer_count(const PointLayer *point_layer)
 {
     trace_assert(point_layer);
@@ -678,24 +863,65 @@ const char *point_layer_ids(const PointLayer *point_layer)
     return (const char *)point_layer->ids.data;
 }
 
-int point_layer_dump_stream(const PointLayer *point_layer,
-                            FILE *filedump)
+int point_layer_dump_text(const PointLayer *point_layer,
+                          StringBuilder *sb)
 {
     trace_assert(point_layer);
-    trace_assert(filedump);
+    trace_assert(sb);
 
     size_t n = point_layer->ids.count;
     char *ids = (char *) point_layer->ids.data;
     Vec2f *positions = (Vec2f *) point_layer->positions.data;
     Color *colors = (Color *) point_layer->colors.data;
 
-    fprintf(filedump, "%zd\n", n);
+    sb_append_size(sb, n);
+    sb_append_char(sb, '\n');
     for (size_t i = 0; i < n; ++i) {
-        fprintf(filedump, "%s %f %f ",
-                ids + ID_MAX_SIZE * i,
-                positions[i].x, positions[i].y);
-        color_hex_to_stream(colors[i], filedump);
-        fprintf(filedump, "\n");
+        sb_append_cstr(sb, ids + ID_MAX_SIZE * i);
+        sb_append_char(sb, ' ');
+        sb_append_float(sb, positions[i].x);
+        sb_append_char(sb, ' ');
+        sb_append_float(sb, positions[i].y);
+        sb_append_char(sb, ' ');
+        color_hex_to_sb(colors[i], sb);
+        sb_append_char(sb, '\n');
+    }
+
+    return 0;
+}
+
+int point_layer_load_binary(PointLayer *point_layer,
+                            LevelBinarySlice *slice)
+{
+    trace_assert(point_layer);
+    trace_assert(slice);
+
+    if (level_binary_read_dynarray(slice, &point_layer->positions) < 0 ||
+        level_binary_read_dynarray(slice, &point_layer->colors) < 0 ||
+        level_binary_read_dynarray(slice, &point_layer->ids) < 0) {
+        return -1;
+    }
+
+    char *ids = (char *) point_layer->ids.data;
+    for (size_t i = 0; i < point_layer->ids.count; ++i) {
+        ids[i * ID_MAX_SIZE + ID_MAX_SIZE - 1] = '\0';
+    }
+
+    return 0;
+}
+
+int point_layer_dump_binary(const PointLayer *point_layer,
+                            LevelBinaryWriter *writer)
+{
+    trace_assert(point_layer);
+    trace_assert(writer);
+
+    level_binary_write_count(writer, point_layer->ids.count);
+
+    if (level_binary_write_dynarray(writer, &point_layer->positions) < 0 ||
+        level_binary_write_dynarray(writer, &point_layer->colors) < 0 ||
+        level_binary_write_dynarray(writer, &point_layer->ids) < 0) {
+        return -1;
     }
 
     return 0;
@@ -4,7 +4,9 @@
 #include "math/vec.h"
 #include "color.h"
 #include "layer.h"
+#include "level_journal.h"
 #include "dynarray.h"
+#include "game/level/level_file.h"
 #include "game/level/level_editor/color_picker.h"
 #include "ui/edit_field.h"
 
@@ -38,9 +40,9 @@ LayerPtr point_layer_as_layer(PointLayer *point_layer);
 // NOTE: create_point_layer and create_point_layer_from_line_stream do
 // not own id_name_prefix
 PointLayer *create_point_layer(Memory *memory, const char *id_name_prefix);
-void point_layer_load(PointLayer *point_layer,
-                        Memory *memory,
-                        String *input);
+int point_layer_load(PointLayer *point_layer,
+                     Memory *memory,
+                     String *input);
 
 static inline
 void destroy_point_layer(PointLayer point_layer)
@@ -59,8 +61,27 @@ int point_layer_event(PointLayer *point_layer,
                       const Camera *camera,
                       UndoHistory *undo_history);
 
-int point_layer_dump_stream(const PointLayer *point_layer,
-                            FILE *filedump);
+// Brings the layer in line with points (a reloaded level file) by
+// their ids. Every change is undoable. Returns how many points
+// changed.
+size_t point_layer_apply(PointLayer *point_layer,
+                         const LevelPoints *points,
+                         UndoHistory *undo_history);
+// Redoes an edit read from the level journal. Undoable. Returns -1
+// if the edit does not fit the layer.
+int point_layer_replay(PointLayer *point_layer,
+                       LevelJournalOp op,
+                       size_t index,
+                       size_t index2,
+                       const void *entity,
+                       UndoHistory *undo_history);
+
+int point_layer_dump_text(const PointLayer *point_layer,
+                          StringBuilder *sb);
+int point_layer_load_binary(PointLayer *point_layer,
+                            LevelBinarySlice *slice);
+int point_layer_dump_binary(const PointLayer *point_layer,
+                            LevelBinaryWriter *writer);
 
 size_t point_layer_count(const PointLayer *point_layer);
 const Vec2f *point_layer_positions(const PointLayer *point_layer);
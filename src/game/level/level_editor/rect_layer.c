@@ -12,6 +12,7 @@
 #include "system/str.h"
 #include "undo_history.h"
 #include "game/level/action.h"
+#include "game/level/level_file.h"
 #include "game.h"
 #include "math/extrema.h"
 
@@ -180,12 +181,77 @@ void rect_layer_undo(void *context, size_t context_size)
     }
 }
 
+// What the journal keeps of a rect. The id goes last, so the zeros
+// after it are not written.
+typedef struct {
+    Rect rect;
+    Color color;
+    Action action;
+    char id[ENTITY_MAX_ID_SIZE];
+} RectJournalEntity;
+
+static
+void rect_layer_journal(const void *context, size_t context_size,
+                        int reverted, LevelJournal *journal)
+{
+    trace_assert(context);
+    trace_assert(sizeof(RectUndoContext) == context_size);
+
+    const RectUndoContext *undo_context = context;
+    const LevelJournalOp op = level_journal_op((int) undo_context->type, reverted);
+
+    switch (undo_context->type) {
+    case RECT_UNDO_SWAP: {
+        level_journal_write(
+            journal, undo_context->swap.layer, op,
+            undo_context->swap.index1, undo_context->swap.index2,
+            NULL, 0);
+    } break;
+
+    case RECT_UNDO_ADD:
+    case RECT_UNDO_DELETE:
+    case RECT_UNDO_UPDATE: {
+        // The add and element contexts start the same way
+        RectLayer *layer = undo_context->element.layer;
+        const size_t index = undo_context->element.index;
+
+        if (op == LEVEL_JOURNAL_DELETE) {
+            level_journal_write(journal, layer, op, index, 0, NULL, 0);
+            break;
+        }
+
+        RectJournalEntity entity;
+        memset(&entity, 0, sizeof(entity));
+        dynarray_copy_to(&layer->rects, &entity.rect, index);
+        dynarray_copy_to(&layer->colors, &entity.color, index);
+        dynarray_copy_to(&layer->actions, &entity.action, index);
+        dynarray_copy_to(&layer->ids, entity.id, index);
+        level_journal_write(journal, layer, op, index, 0, &entity, sizeof(entity));
+    } break;
+    }
+}
+
 #define RECT_UNDO_PUSH(HISTORY, CONTEXT)                                     \
     do {                                                                \
         RectUndoContext context = (CONTEXT);                                \
         undo_history_push(                                              \
             HISTORY,                                                    \
             rect_layer_undo,                                            \
+            rect_layer_journal,                                         \
+            &context,                                                   \
+            sizeof(context));                                           \
+    } while(0)
+
+// For the moves and the resizes of the element of an update context
+#define RECT_UNDO_PUSH_COALESCED(HISTORY, CONTEXT)                      \
+    do {                                                                \
+        RectUndoContext context = (CONTEXT);                            \
+        undo_history_push_coalesced(                                    \
+            HISTORY,                                                    \
+            rect_layer_undo,                                            \
+            rect_layer_journal,                                         \
+            context.element.layer,                                      \
+            context.element.index,                                      \
             &context,                                                   \
             sizeof(context));                                           \
     } while(0)
@@ -842,11 +908,12 @@ static int rect_layer_event_resize(RectLayer *layer,
 
     case SDL_MOUSEBUTTONUP: {
         layer->state = RECT_LAYER_IDLE;
-        RECT_UNDO_PUSH(
+        RECT_UNDO_PUSH_COALESCED(
             undo_history,
             create_rect_undo_update_context(
                 layer,
                 (size_t) layer->selection));
+        undo_history_end_coalescing(undo_history);
         dynarray_replace_at(&layer->rects, (size_t) layer->selection, &layer->inter_rect);
     } break;
     }
@@ -934,7 +1001,7 @@ static int rect_layer_event_move(RectLayer *layer,
                     rect_position(rects[layer->selection])));
 
         if (distance > 1e-6) {
-            RECT_UNDO_PUSH(
+            RECT_UNDO_PUSH_COALESCED(
                 undo_history,
                 create_rect_undo_update_context(
                     layer, (size_t) layer->selection));
@@ -943,6 +1010,7 @@ static int rect_layer_event_move(RectLayer *layer,
                 (size_t) layer->selection,
                 &layer->inter_rect);
         }
+        undo_history_end_coalescing(undo_history);
     } break;
     }
     return 0;
@@ -1019,62 +1087,34 @@ RectLayer *create_rect_layer(Memory *memory,
     return rect_layer;
 }
 
-void rect_layer_load(RectLayer *layer, Memory *memory, String *input)
+int rect_layer_load(RectLayer *layer, Memory *memory, String *input)
 {
     trace_assert(layer);
     trace_assert(memory);
     trace_assert(input);
 
-    int n = atoi(string_to_cstr(memory, trim(chop_by_delim(input, '\n'))));
+    const size_t n = level_file_chop_count(input);
+    if (dynarray_reserve(&layer->rects, n) < 0 ||
+        dynarray_reserve(&layer->colors, n) < 0 ||
+        dynarray_reserve(&layer->ids, n) < 0 ||
+        dynarray_reserve(&layer->actions, n) < 0) {
+        return -1;
+    }
+
     char id[ENTITY_MAX_ID_SIZE];
-    for (int i = 0; i < n; ++i) {
+    for (size_t i = 0; i < n; ++i) {
         Rect rect;
-        String line = trim(chop_by_delim(input, '\n'));
-        String string_id = trim(chop_word(&line));
-        rect.x = strtof(string_to_cstr(memory, trim(chop_word(&line))), NULL);
-        rect.y = strtof(string_to_cstr(memory, trim(chop_word(&line))), NULL);
-        rect.w = strtof(string_to_cstr(memory, trim(chop_word(&line))), NULL);
-        rect.h = strtof(string_to_cstr(memory, trim(chop_word(&line))), NULL);
-        Color color = hexs(trim(chop_word(&line)));
-
-        memset(id, 0, ENTITY_MAX_ID_SIZE);
-        memcpy(
-            id,
-            string_id.data,
-            min_size_t(ENTITY_MAX_ID_SIZE - 1, string_id.count));
+        Color color;
+        Action action;
+        level_file_chop_rect(input, id, &rect, &color, &action);
 
         dynarray_push(&layer->rects, &rect);
         dynarray_push(&layer->colors, &color);
         dynarray_push(&layer->ids, id);
-
-        Action action = {
-            .type = ACTION_NONE,
-            .entity_id = {0}
-        };
-
-        String action_string = trim(chop_word(&line));
-        if (action_string.count > 0) {
-            action.type = (ActionType)atol(string_to_cstr(memory, action_string));
-            switch (action.type) {
-            case ACTION_NONE: break;
-            case ACTION_TOGGLE_GOAL:
-            case ACTION_HIDE_LABEL: {
-                String label_id = trim(chop_word(&line));
-                trace_assert(label_id.count > 0);
-                memset(action.entity_id, 0, ENTITY_MAX_ID_SIZE);
-                memcpy(action.entity_id,
-                       label_id.data,
-                       min_size_t(
-                           ENTITY_MAX_ID_SIZE - 1,
-                           label_id.count));
-            } break;
-
-            case ACTION_N: break;
-            }
-        }
-
         dynarray_push(&layer->actions, &action);
     }
+
+    return 0;
 }
 
 static
@@ -1297,6 +1337,138 @@ int rect_layer_event(RectLayer *layer,
     return 0;
 }
 
+static bool rect_layer_actions_equal(const Action *a, const Action *b)
+{
+    return a->type == b->type
+        && strncmp(a->entity_id, b->entity_id, ENTITY_MAX_ID_SIZE) == 0;
+}
+
+size_t rect_layer_apply(RectLayer *layer,
+                        const LevelRects *rects,
+                        UndoHistory *undo_history)
+{
+    trace_assert(layer);
+    trace_assert(rects);
+    trace_assert(undo_history);
+
+    size_t changes = 0;
+
+    // Backwards, so the indices of the rects yet to check stay put
+    for (size_t i = layer->rects.count; i-- > 0;) {
+        const char *id = (const char *)dynarray_pointer_at(&layer->ids, i);
+        if (level_file_find_id(rects->ids, rects->count, id, i) < 0) {
+            rect_layer_delete_rect_at_index(layer, i, undo_history);
+            changes += 1;
+        }
+    }
+
+    for (size_t j = 0; j < rects->count; ++j) {
+        const char *id = rects->ids + j * ENTITY_MAX_ID_SIZE;
+        const int i = level_file_find_id(
+            (const char *)layer->ids.data, layer->ids.count, id, j);
+
+        if (i < 0) {
+            dynarray_push(&layer->ids, id);
+            dynarray_push(&layer->rects, &rects->rects[j]);
+            dynarray_push(&layer->colors, &rects->colors[j]);
+            dynarray_push(&layer->actions, &rects->actions[j]);
+            RECT_UNDO_PUSH(
+                undo_history,
+                create_rect_undo_add_context(layer, layer->rects.count - 1));
+            changes += 1;
+            continue;
+        }
+
+        const Rect *rect = dynarray_pointer_at(&layer->rects, (size_t) i);
+        const Color *color = dynarray_pointer_at(&layer->colors, (size_t) i);
+        const Action *action = dynarray_pointer_at(&layer->actions, (size_t) i);
+        if (memcmp(rect, &rects->rects[j], sizeof(Rect)) != 0 ||
+            memcmp(color, &rects->colors[j], sizeof(Color)) != 0 ||
+            !rect_layer_actions_equal(action, &rects->actions[j])) {
+            RECT_UNDO_PUSH(
+                undo_history,
+                create_rect_undo_update_context(layer, (size_t) i));
+            Rect new_rect = rects->rects[j];
+            Color new_color = rects->colors[j];
+            Action new_action = rects->actions[j];
+            dynarray_replace_at(&layer->rects, (size_t) i, &new_rect);
+            dynarray_replace_at(&layer->colors, (size_t) i, &new_color);
+            dynarray_replace_at(&layer->actions, (size_t) i, &new_action);
+            changes += 1;
+        }
+    }
+
+    if (changes > 0) {
+        layer->selection = -1;
+        layer->state = RECT_LAYER_IDLE;
+    }
+
+    return changes;
+}
+
+int rect_layer_replay(RectLayer *layer,
+                      LevelJournalOp op,
+                      size_t index,
+                      size_t index2,
+                      const void *entity,
+                      UndoHistory *undo_history)
+{
+    trace_assert(layer);
+    trace_assert(entity);
+    trace_assert(undo_history);
+
+    RectJournalEntity e;
+    memcpy(&e, entity, sizeof(e));
+    e.id[ENTITY_MAX_ID_SIZE - 1] = '\0';
+    e.action.entity_id[ENTITY_MAX_ID_SIZE - 1] = '\0';
+
+    switch (op) {
+    case LEVEL_JOURNAL_ADD: {
+        if (index > layer->rects.count) {
+            return -1;
+        }
+        dynarray_insert_before(&layer->rects, index, &e.rect);
+        dynarray_insert_before(&layer->colors, index, &e.color);
+        dynarray_insert_before(&layer->ids, index, e.id);
+        dynarray_insert_before(&layer->actions, index, &e.action);
+        RECT_UNDO_PUSH(undo_history, create_rect_undo_add_context(layer, index));
+    } break;
+
+    case LEVEL_JOURNAL_DELETE: {
+        if (index >= layer->rects.count) {
+            return -1;
+        }
+        rect_layer_delete_rect_at_index(layer, index, undo_history);
+    } break;
+
+    case LEVEL_JOURNAL_UPDATE: {
+        if (index >= layer->rects.count) {
+            return -1;
+        }
+        RECT_UNDO_PUSH(undo_history, create_rect_undo_update_context(layer, index));
+        dynarray_replace_at(&layer->rects, index, &e.rect);
+        dynarray_replace_at(&layer->colors, index, &e.color);
+        dynarray_replace_at(&layer->ids, index, e.id);
+        dynarray_replace_at(&layer->actions, index, &e.action);
+    } break;
+
+    case LEVEL_JOURNAL_SWAP: {
+        if (index >= layer->rects.count || index2 >= layer->rects.count) {
+            return -1;
+        }
+        rect_layer_swap_elements(layer, index, index2, undo_history);
+    } break;
+
+    default:
+        return -1;
+    }
+
+    layer->selection = -1;
+    layer->state = RECT_LAYER_IDLE;
+
+    return 0;
+}
+
 size_t rect_layer_count(const RectLayer *layer)
 {
     return layer->rects.count;
@@ -1317,10 +1489,10 @@ const char *rect_layer_ids(const RectLayer *layer)
     return (const char *)layer->ids.data;
 }
 
-int rect_layer_dump_stream(const RectLayer *layer, FILE *filedump)
+int rect_layer_dump_text(const RectLayer *layer, StringBuilder *sb)
 {
     trace_assert(layer);
-    trace_assert(filedump);
+    trace_assert(sb);
 
     size_t n = layer->ids.count;
     char *ids = (char *)layer->ids.data;
@@ -1328,26 +1500,80 @@ int rect_layer_dump_stream(const RectLayer *layer, FILE *filedump)
     Color *colors = (Color *)layer->colors.data;
     Action *actions = (Action *)layer->actions.data;
 
-    fprintf(filedump, "%zd\n", n);
+    sb_append_size(sb, n);
+    sb_append_char(sb, '\n');
     for (size_t i = 0; i < n; ++i) {
-        fprintf(filedump, "%s %f %f %f %f ",
-                ids + ENTITY_MAX_ID_SIZE * i,
-                rects[i].x, rects[i].y, rects[i].w, rects[i].h);
-        color_hex_to_stream(colors[i], filedump);
+        sb_append_cstr(sb, ids + ENTITY_MAX_ID_SIZE * i);
+        sb_append_char(sb, ' ');
+        sb_append_float(sb, rects[i].x);
+        sb_append_char(sb, ' ');
+        sb_append_float(sb, rects[i].y);
+        sb_append_char(sb, ' ');
+        sb_append_float(sb, rects[i].w);
+        sb_append_char(sb, ' ');
+        sb_append_float(sb, rects[i].h);
+        sb_append_char(sb, ' ');
+        color_hex_to_sb(colors[i], sb);
 
         switch (actions[i].type) {
         case ACTION_NONE: {} break;
 
         case ACTION_TOGGLE_GOAL:
         case ACTION_HIDE_LABEL: {
-            fprintf(filedump, " %d %.*s",
-                    (int)actions[i].type,
-                    ENTITY_MAX_ID_SIZE, actions[i].entity_id);
+            sb_append_char(sb, ' ');
+            sb_append_size(sb, (size_t) actions[i].type);
+            sb_append_char(sb, ' ');
+            sb_append_cstr_n(sb, actions[i].entity_id, ENTITY_MAX_ID_SIZE);
         } break;
         case ACTION_N: break;
         }
 
-        fprintf(filedump, "\n");
+        sb_append_char(sb, '\n');
+    }
+
+    return 0;
+}
+
+int rect_layer_load_binary(RectLayer *layer, LevelBinarySlice *slice)
+{
+    trace_assert(layer);
+    trace_assert(slice);
+
+    if (level_binary_read_dynarray(slice, &layer->ids) < 0 ||
+        level_binary_read_dynarray(slice, &layer->rects) < 0 ||
+        level_binary_read_dynarray(slice, &layer->colors) < 0 ||
+        level_binary_read_dynarray(slice, &layer->actions) < 0) {
+        return -1;
+    }
+
+    char *ids = (char *)layer->ids.data;
+    Action *actions = (Action *)layer->actions.data;
+    for (size_t i = 0; i < layer->ids.count; ++i) {
+        ids[i * ENTITY_MAX_ID_SIZE + ENTITY_MAX_ID_SIZE - 1] = '\0';
+
+        if ((unsigned int) actions[i].type >= ACTION_N) {
+            log_fail("Unknown action type %d of rect %s\n",
+                     (int) actions[i].type,
+                     ids + i * ENTITY_MAX_ID_SIZE);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int rect_layer_dump_binary(const RectLayer *layer, LevelBinaryWriter *writer)
+{
+    trace_assert(layer);
+    trace_assert(writer);
+
+    level_binary_write_count(writer, layer->ids.count);
+
+    if (level_binary_write_dynarray(writer, &layer->ids) < 0 ||
+        level_binary_write_dynarray(writer, &layer->rects) < 0 ||
+        level_binary_write_dynarray(writer, &layer->colors) < 0 ||
+        level_binary_write_dynarray(writer, &layer->actions) < 0) {
+        return -1;
     }
 
     return 0;
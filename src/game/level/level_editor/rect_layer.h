@@ -2,7 +2,9 @@
 #define RECT_LAYER_H_
 
 #include "layer.h"
+#include "level_journal.h"
 #include "game/level/action.h"
+#include "game/level/level_file.h"
 #include "ui/cursor.h"
 #include "dynarray.h"
 #include "color_picker.h"
@@ -51,7 +53,7 @@ LayerPtr rect_layer_as_layer(RectLayer *layer);
 RectLayer *create_rect_layer(Memory *memory,
                              const char *id_name_prefix,
                              Cursor *cursor);
-void rect_layer_load(RectLayer *rect_layer, Memory *memory, String *input);
+int rect_layer_load(RectLayer *rect_layer, Memory *memory, String *input);
 
 static inline
 void destroy_rect_layer(RectLayer layer)
@@ -69,7 +71,25 @@ int rect_layer_event(RectLayer *layer,
                      const Camera *camera,
                      UndoHistory *undo_history);
 
-int rect_layer_dump_stream(const RectLayer *layer, FILE *filedump);
+// Brings the layer in line with rects (a reloaded level file) by
+// their ids. Every change is undoable. Returns how many rects
+// changed.
+size_t rect_layer_apply(RectLayer *layer,
+                        const LevelRects *rects,
+                        UndoHistory *undo_history);
+
+// Redoes an edit read from the level journal. Undoable. Returns -1
+// if the edit does not fit the layer.
+int rect_layer_replay(RectLayer *layer,
+                      LevelJournalOp op,
+                      size_t index,
+                      size_t index2,
+                      const void *entity,
+                      UndoHistory *undo_history);
+
+int rect_layer_dump_text(const RectLayer *layer, StringBuilder *sb);
+int rect_layer_load_binary(RectLayer *layer, LevelBinarySlice *slice);
+int rect_layer_dump_binary(const RectLayer *layer, LevelBinaryWriter *writer);
 
 size_t rect_layer_count(const RectLayer *layer);
 const Rect *rect_layer_rects(const RectLayer *layer);
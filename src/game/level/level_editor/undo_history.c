@@ -1,5 +1,7 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 
 #include <SDL.h>
 
@@ -8,48 +10,258 @@
 #include "undo_history.h"
 #include "config.h"
 
+#define UNDO_HISTORY_ALIGNMENT _Alignof(max_align_t)
+// The next of the newest edit and the prev of the oldest one
+#define UNDO_HISTORY_NONE SIZE_MAX
+
+// Followed by the context of the edit
 typedef struct {
     RevertAction revert;
-    void *context_data;
+    JournalAction journal;
     size_t context_data_size;
+    // The element undo_history_push_coalesced() was called for. The
+    // layer is NULL for the edits that are never coalesced.
+    const void *layer;
+    size_t index;
+    // Whether the next coalesced edit of the same element may still be
+    // merged into this one. Only ever set on the newest edit.
+    int coalescable;
+    // Where the edits before and after this one begin
+    size_t prev;
+    size_t next;
 } HistoryItem;
 
+static size_t undo_history_align(size_t size)
+{
+    return (size + UNDO_HISTORY_ALIGNMENT - 1) / UNDO_HISTORY_ALIGNMENT * UNDO_HISTORY_ALIGNMENT;
+}
+
+// The memory is not aligned, but the edits and their contexts have to be
+static void *undo_history_alloc(Memory *memory, size_t size)
+{
+    uint8_t *result = memory_alloc(memory, size + UNDO_HISTORY_ALIGNMENT - 1);
+    return result + (UNDO_HISTORY_ALIGNMENT - (uintptr_t) result % UNDO_HISTORY_ALIGNMENT) % UNDO_HISTORY_ALIGNMENT;
+}
+
+static size_t history_item_size(size_t context_data_size)
+{
+    return undo_history_align(sizeof(HistoryItem)) + undo_history_align(context_data_size);
+}
+
+static HistoryItem *history_item_at(UndoHistory *undo_history, size_t offset)
+{
+    return (HistoryItem *) (undo_history->bytes + offset);
+}
+
+static void *history_item_context(HistoryItem *item)
+{
+    return (uint8_t *) item + undo_history_align(sizeof(HistoryItem));
+}
+
 UndoHistory *create_undo_history(Memory *memory)
 {
-    UndoHistory *result = memory_alloc(memory, sizeof(UndoHistory));
-    result->actions = create_ring_buffer_from_buffer(
-        memory,
-        sizeof(HistoryItem),
-        UNDO_HISTORY_CAPACITY);
-    result->memory = memory;
+    UndoHistory *result = undo_history_alloc(memory, sizeof(UndoHistory));
+    memset(result, 0, sizeof(*result));
+    result->capacity = UNDO_HISTORY_BYTES_CAPACITY;
+    result->bytes = undo_history_alloc(memory, result->capacity);
     return result;
 }
 
+void undo_history_flush(UndoHistory *undo_history)
+{
+    trace_assert(undo_history);
+
+    if (undo_history->pending_journal && undo_history->journal) {
+        undo_history->pending_journal(
+            undo_history->pending_context_data,
+            undo_history->pending_context_data_size,
+            0,
+            undo_history->journal);
+    }
+
+    undo_history->pending_journal = NULL;
+}
+
+static void undo_history_drop_oldest(UndoHistory *undo_history)
+{
+    trace_assert(undo_history->count > 0);
+
+    undo_history->count -= 1;
+    if (undo_history->count == 0) {
+        undo_history->begin = 0;
+        undo_history->top = 0;
+        undo_history->end = 0;
+        return;
+    }
+
+    undo_history->begin = history_item_at(undo_history, undo_history->begin)->next;
+    history_item_at(undo_history, undo_history->begin)->prev = UNDO_HISTORY_NONE;
+}
+
+// Where size bytes fit without overwriting any of the edits or
+// UNDO_HISTORY_NONE
+static size_t undo_history_fit(const UndoHistory *undo_history, size_t size)
+{
+    if (undo_history->count == 0) {
+        return 0;
+    }
+
+    // The edits do not wrap around, so there is room after them and
+    // before them
+    if (undo_history->begin < undo_history->end) {
+        if (size <= undo_history->capacity - undo_history->end) {
+            return undo_history->end;
+        }
+
+        if (size <= undo_history->begin) {
+            return 0;
+        }
+
+        return UNDO_HISTORY_NONE;
+    }
+
+    // The edits wrap around, so there is room only between the newest
+    // and the oldest one
+    if (size <= undo_history->begin - undo_history->end) {
+        return undo_history->end;
+    }
+
+    return UNDO_HISTORY_NONE;
+}
+
+static void undo_history_push_item(UndoHistory *undo_history,
+                                   RevertAction revert,
+                                   JournalAction journal,
+                                   const void *layer,
+                                   size_t index,
+                                   void *context_data,
+                                   size_t context_data_size)
+{
+    const size_t item_size = history_item_size(context_data_size);
+    trace_assert(item_size <= undo_history->capacity);
+
+    size_t offset = undo_history_fit(undo_history, item_size);
+    while (undo_history->count >= UNDO_HISTORY_CAPACITY || offset == UNDO_HISTORY_NONE) {
+        undo_history_drop_oldest(undo_history);
+        offset = undo_history_fit(undo_history, item_size);
+    }
+
+    HistoryItem *item = history_item_at(undo_history, offset);
+    item->revert = revert;
+    item->journal = journal;
+    item->context_data_size = context_data_size;
+    item->layer = layer;
+    item->index = index;
+    item->coalescable = layer != NULL;
+    item->prev = undo_history->count > 0 ? undo_history->top : UNDO_HISTORY_NONE;
+    item->next = UNDO_HISTORY_NONE;
+    memcpy(history_item_context(item), context_data, context_data_size);
+
+    if (undo_history->count > 0) {
+        history_item_at(undo_history, undo_history->top)->next = offset;
+    } else {
+        undo_history->begin = offset;
+    }
+    undo_history->top = offset;
+    undo_history->end = offset + item_size;
+    undo_history->count += 1;
+
+    undo_history->pending_journal = journal;
+    undo_history->pending_context_data = history_item_context(item);
+    undo_history->pending_context_data_size = context_data_size;
+}
+
 void undo_history_push(UndoHistory *undo_history,
                        RevertAction revert,
+                       JournalAction journal,
                        void *context_data,
                        size_t context_data_size)
 {
     trace_assert(undo_history);
 
-    // TODO(#1244): undo_history_push kinda leaks the memory
-    HistoryItem item = {
-        .revert = revert,
-        .context_data = memory_alloc(undo_history->memory, context_data_size),
-        .context_data_size = context_data_size
-    };
-    memcpy(item.context_data, context_data, context_data_size);
-    ring_buffer_push(&undo_history->actions, &item);
+    // The previous edit is done by the time the next one begins
+    undo_history_flush(undo_history);
+
+    undo_history_push_item(
+        undo_history, revert, journal,
+        NULL, 0,
+        context_data, context_data_size);
+}
+
+void undo_history_push_coalesced(UndoHistory *undo_history,
+                                 RevertAction revert,
+                                 JournalAction journal,
+                                 const void *layer,
+                                 size_t index,
+                                 void *context_data,
+                                 size_t context_data_size)
+{
+    trace_assert(undo_history);
+    trace_assert(layer);
+
+    undo_history_flush(undo_history);
+
+    if (undo_history->count > 0) {
+        HistoryItem *item = history_item_at(undo_history, undo_history->top);
+        if (item->coalescable
+            && item->layer == layer
+            && item->index == index
+            && item->revert == revert
+            && item->context_data_size == context_data_size) {
+            // The edit is journaled again once it is done
+            undo_history->pending_journal = journal;
+            undo_history->pending_context_data = history_item_context(item);
+            undo_history->pending_context_data_size = context_data_size;
+            return;
+        }
+    }
+
+    undo_history_push_item(
+        undo_history, revert, journal,
+        layer, index,
+        context_data, context_data_size);
 }
 
 void undo_history_pop(UndoHistory *undo_history)
 {
     trace_assert(undo_history);
 
-    if (undo_history->actions.count > 0) {
-        HistoryItem *item = ring_buffer_top(&undo_history->actions);
-        item->revert(item->context_data, item->context_data_size);
-        ring_buffer_pop(&undo_history->actions);
+    undo_history_flush(undo_history);
+
+    if (undo_history->count == 0) {
+        return;
+    }
+
+    HistoryItem *item = history_item_at(undo_history, undo_history->top);
+    void *context_data = history_item_context(item);
+    item->revert(context_data, item->context_data_size);
+    if (undo_history->journal) {
+        item->journal(context_data, item->context_data_size, 1, undo_history->journal);
+    }
+
+    undo_history->count -= 1;
+    if (undo_history->count == 0) {
+        undo_history->begin = 0;
+        undo_history->top = 0;
+        undo_history->end = 0;
+        return;
+    }
+
+    undo_history->top = item->prev;
+    HistoryItem *top = history_item_at(undo_history, undo_history->top);
+    top->next = UNDO_HISTORY_NONE;
+    // The edit was done before the one undone, so the next one is not
+    // consecutive to it
+    top->coalescable = 0;
+    undo_history->end = undo_history->top + history_item_size(top->context_data_size);
+}
+
+void undo_history_end_coalescing(UndoHistory *undo_history)
+{
+    trace_assert(undo_history);
+
+    if (undo_history->count > 0) {
+        history_item_at(undo_history, undo_history->top)->coalescable = 0;
     }
 }
 
@@ -57,7 +269,10 @@ void undo_history_clean(UndoHistory *undo_history)
 {
     trace_assert(undo_history);
 
-    while (undo_history->actions.count) {
-        ring_buffer_pop(&undo_history->actions);
-    }
+    undo_history_flush(undo_history);
+
+    undo_history->count = 0;
+    undo_history->begin = 0;
+    undo_history->top = 0;
+    undo_history->end = 0;
 }
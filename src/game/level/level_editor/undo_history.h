@@ -1,29 +1,74 @@
 #ifndef UNDO_HISTORY_H_
 #define UNDO_HISTORY_H_
 
-#include "ring_buffer.h"
+#include <stddef.h>
+
+#include "system/memory.h"
+
+typedef struct LevelJournal LevelJournal;
 
 typedef void (*RevertAction)(void *context, size_t context_size);
+// Writes what the edit of the context did into the journal once the
+// edit is done, or what reverting it did if reverted is set
+typedef void (*JournalAction)(const void *context,
+                              size_t context_size,
+                              int reverted,
+                              LevelJournal *journal);
 
+// The edits live in a ring of bytes, each one followed by its
+// context. Pushing an edit that does not fit drops the oldest ones.
 typedef struct {
-    RingBuffer actions;
-    Memory *memory;
+    uint8_t *bytes;
+    size_t capacity;
+    size_t count;
+    // Where the oldest and the newest edits begin and where the
+    // newest one ends
+    size_t begin;
+    size_t top;
+    size_t end;
+
+    // Every edit and revert is written into the journal unless it is
+    // NULL (see level_journal.h)
+    LevelJournal *journal;
+    // An edit is pushed before it is done, so it is journaled only
+    // when the next one is pushed or the history is flushed
+    JournalAction pending_journal;
+    void *pending_context_data;
+    size_t pending_context_data_size;
 } UndoHistory;
 
 UndoHistory *create_undo_history(Memory *memory);
 
 void undo_history_push(UndoHistory *undo_history,
                        RevertAction revert,
+                       JournalAction journal,
                        void *context_data,
                        size_t context_data_size);
+// Like undo_history_push(), but if the last edit changed the same
+// element of the same layer the same way right before, it is kept
+// instead. Its context already has the element as it was before both
+// edits, so they are undone at once. Any other push, a pop or
+// undo_history_end_coalescing() ends the run of merged edits.
+void undo_history_push_coalesced(UndoHistory *undo_history,
+                                 RevertAction revert,
+                                 JournalAction journal,
+                                 const void *layer,
+                                 size_t index,
+                                 void *context_data,
+                                 size_t context_data_size);
 void undo_history_pop(UndoHistory *undo_history);
+// Keeps the next coalesced edit from being merged into the last one.
+// Called once a mouse drag ends.
+void undo_history_end_coalescing(UndoHistory *undo_history);
+// Journals the last pushed edit. Called once the edit is surely done.
+void undo_history_flush(UndoHistory *undo_history);
 
 void undo_history_clean(UndoHistory *undo_history);
 
 static inline
 int undo_history_empty(UndoHistory *undo_history)
 {
-    return undo_history->actions.count == 0;
+    return undo_history->count == 0;
 }
 
 #endif  // UNDO_HISTORY_H_
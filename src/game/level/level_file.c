@@ -0,0 +1,605 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "game/level/level_editor/layer_picker.h"
+#include "game/level/level_editor/level_binary.h"
+#include "math/extrema.h"
+#include "system/log.h"
+#include "system/nth_alloc.h"
+#include "system/stacktrace.h"
+#include "./level_file.h"
+
+static void level_file_copy_id(char *dest, size_t dest_size, String id)
+{
+    memset(dest, 0, dest_size);
+    memcpy(dest, id.data, min_size_t(dest_size - 1, id.count));
+}
+
+size_t level_file_chop_count(String *input)
+{
+    trace_assert(input);
+    const long count = string_to_long(trim(chop_by_delim(input, '\n')));
+    return count < 0 ? 0 : (size_t) count;
+}
+
+Color level_file_chop_color_line(String *input)
+{
+    trace_assert(input);
+    return hexs(trim(chop_by_delim(input, '\n')));
+}
+
+void level_file_chop_player(String *input, Vec2f *position, Color *color)
+{
+    trace_assert(input);
+    trace_assert(position);
+    trace_assert(color);
+
+    String line = chop_by_delim(input, '\n');
+    position->x = string_to_float(chop_word(&line));
+    position->y = string_to_float(chop_word(&line));
+    *color = hexs(chop_word(&line));
+}
+
+void level_file_chop_rect(String *input,
+                          char id[ENTITY_MAX_ID_SIZE],
+                          Rect *rect,
+                          Color *color,
+                          Action *action)
+{
+    trace_assert(input);
+    trace_assert(id);
+    trace_assert(rect);
+    trace_assert(color);
+    trace_assert(action);
+
+    String line = trim(chop_by_delim(input, '\n'));
+    level_file_copy_id(id, ENTITY_MAX_ID_SIZE, trim(chop_word(&line)));
+    rect->x = string_to_float(trim(chop_word(&line)));
+    rect->y = string_to_float(trim(chop_word(&line)));
+    rect->w = string_to_float(trim(chop_word(&line)));
+    rect->h = string_to_float(trim(chop_word(&line)));
+    *color = hexs(trim(chop_word(&line)));
+
+    memset(action, 0, sizeof(*action));
+    action->type = ACTION_NONE;
+
+    String action_string = trim(chop_word(&line));
+    if (action_string.count > 0) {
+        action->type = (ActionType)string_to_long(action_string);
+        switch (action->type) {
+        case ACTION_NONE: break;
+        case ACTION_TOGGLE_GOAL:
+        case ACTION_HIDE_LABEL: {
+            String entity_id = trim(chop_word(&line));
+            trace_assert(entity_id.count > 0);
+            level_file_copy_id(action->entity_id, ENTITY_MAX_ID_SIZE, entity_id);
+        } break;
+
+        case ACTION_N: break;
+        }
+    }
+}
+
+void level_file_chop_point(String *input,
+                           char id[ENTITY_MAX_ID_SIZE],
+                           Vec2f *position,
+                           Color *color)
+{
+    trace_assert(input);
+    trace_assert(id);
+    trace_assert(position);
+    trace_assert(color);
+
+    String line = trim(chop_by_delim(input, '\n'));
+    level_file_copy_id(id, ENTITY_MAX_ID_SIZE, trim(chop_word(&line)));
+    position->x = string_to_float(trim(chop_word(&line)));
+    position->y = string_to_float(trim(chop_word(&line)));
+    *color = hexs(trim(chop_word(&line)));
+}
+
+void level_file_chop_label(String *input,
+                           char id[ENTITY_MAX_ID_SIZE],
+                           Vec2f *position,
+                           Color *color,
+                           char text[LEVEL_FILE_LABEL_TEXT_MAX_SIZE])
+{
+    trace_assert(text);
+
+    level_file_chop_point(input, id, position, color);
+    level_file_copy_id(
+        text,
+        LEVEL_FILE_LABEL_TEXT_MAX_SIZE,
+        trim(chop_by_delim(input, '\n')));
+}
+
+// Unlike memory_alloc() does not assert when the memory cannot grow,
+// because the size comes from the level file
+static void *level_file_alloc(Memory *memory, size_t count, size_t size)
+{
+    void *result = count > SIZE_MAX / size ? NULL : memory_try_alloc(memory, count * size);
+    if (result == NULL) {
+        log_fail("Could not allocate memory for %zu entities of the level\n", count);
+    }
+
+    return result;
+}
+
+static int level_file_chop_rects(LevelRects *rects, Memory *memory, String *input)
+{
+    const size_t n = level_file_chop_count(input);
+
+    char *ids = level_file_alloc(memory, n, ENTITY_MAX_ID_SIZE);
+    Rect *rects_data = level_file_alloc(memory, n, sizeof(Rect));
+    Color *colors = level_file_alloc(memory, n, sizeof(Color));
+    Action *actions = level_file_alloc(memory, n, sizeof(Action));
+    if (ids == NULL || rects_data == NULL || colors == NULL || actions == NULL) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        level_file_chop_rect(
+            input,
+            ids + i * ENTITY_MAX_ID_SIZE,
+            &rects_data[i],
+            &colors[i],
+            &actions[i]);
+    }
+
+    rects->count = n;
+    rects->ids = ids;
+    rects->rects = rects_data;
+    rects->colors = colors;
+    rects->actions = actions;
+
+    return 0;
+}
+
+static int level_file_chop_points(LevelPoints *points, Memory *memory, String *input)
+{
+    const size_t n = level_file_chop_count(input);
+
+    char *ids = level_file_alloc(memory, n, ENTITY_MAX_ID_SIZE);
+    Vec2f *positions = level_file_alloc(memory, n, sizeof(Vec2f));
+    Color *colors = level_file_alloc(memory, n, sizeof(Color));
+    if (ids == NULL || positions == NULL || colors == NULL) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        level_file_chop_point(
+            input,
+            ids + i * ENTITY_MAX_ID_SIZE,
+            &positions[i],
+            &colors[i]);
+    }
+
+    points->count = n;
+    points->ids = ids;
+    points->positions = positions;
+    points->colors = colors;
+
+    return 0;
+}
+
+static int level_file_chop_labels(LevelLabels *labels, Memory *memory, String *input)
+{
+    const size_t n = level_file_chop_count(input);
+
+    char *ids = level_file_alloc(memory, n, ENTITY_MAX_ID_SIZE);
+    Vec2f *positions = level_file_alloc(memory, n, sizeof(Vec2f));
+    Color *colors = level_file_alloc(memory, n, sizeof(Color));
+    char *texts = level_file_alloc(memory, n, LEVEL_FILE_LABEL_TEXT_MAX_SIZE);
+    if (ids == NULL || positions == NULL || colors == NULL || texts == NULL) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        level_file_chop_label(
+            input,
+            ids + i * ENTITY_MAX_ID_SIZE,
+            &positions[i],
+            &colors[i],
+            texts + i * LEVEL_FILE_LABEL_TEXT_MAX_SIZE);
+    }
+
+    labels->count = n;
+    labels->ids = ids;
+    labels->positions = positions;
+    labels->colors = colors;
+    labels->texts = texts;
+
+    return 0;
+}
+
+static int level_file_load_text(LevelFile *level_file, Memory *memory, String input)
+{
+    String version = trim(chop_by_delim(&input, '\n'));
+
+    if (string_equal(version, STRING_LIT("1"))) {
+        chop_by_delim(&input, '\n');
+    } else if (string_equal(version, STRING_LIT("2"))) {
+        // Nothing
+    } else {
+        log_fail("Version `%.*s` is not supported. Expected version `%s` or `%s`.\n",
+                 (int) version.count, version.data,
+                 VERSION, LEVEL_BINARY_VERSION);
+        return -1;
+    }
+
+    level_file->background_color = level_file_chop_color_line(&input);
+    level_file_chop_player(&input, &level_file->player_position, &level_file->player_color);
+
+    if (level_file_chop_rects(&level_file->platforms, memory, &input) < 0 ||
+        level_file_chop_points(&level_file->goals, memory, &input) < 0 ||
+        level_file_chop_rects(&level_file->lava, memory, &input) < 0 ||
+        level_file_chop_rects(&level_file->back_platforms, memory, &input) < 0 ||
+        level_file_chop_rects(&level_file->boxes, memory, &input) < 0 ||
+        level_file_chop_labels(&level_file->labels, memory, &input) < 0 ||
+        level_file_chop_rects(&level_file->regions, memory, &input) < 0 ||
+        level_file_chop_rects(&level_file->pp, memory, &input) < 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+// The mapped file is read-only, so instead of terminating the
+// strings in place like the editor layers do the binary loader just
+// refuses the ones that are not terminated
+static int level_file_check_strings(const char *strings, size_t count, size_t size)
+{
+    for (size_t i = 0; i < count; ++i) {
+        if (memchr(strings + i * size, '\0', size) == NULL) {
+            log_fail("Binary level has a string that is not terminated\n");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int level_file_next_section(LevelBinaryReader *reader,
+                                   LayerPicker layer,
+                                   LevelBinarySlice *slice)
+{
+    return level_binary_next_section(reader, (uint32_t) layer, slice);
+}
+
+static int level_file_view_rects(LevelRects *rects,
+                                 LevelBinaryReader *reader,
+                                 LayerPicker layer)
+{
+    LevelBinarySlice slice;
+    if (level_file_next_section(reader, layer, &slice) < 0) {
+        return -1;
+    }
+
+    const size_t n = slice.count;
+    rects->count = n;
+    rects->ids = level_binary_chop(&slice, n * ENTITY_MAX_ID_SIZE);
+    rects->rects = level_binary_chop(&slice, n * sizeof(Rect));
+    rects->colors = level_binary_chop(&slice, n * sizeof(Color));
+    rects->actions = level_binary_chop(&slice, n * sizeof(Action));
+    if (rects->ids == NULL || rects->rects == NULL ||
+        rects->colors == NULL || rects->actions == NULL) {
+        return -1;
+    }
+
+    if (level_file_check_strings(rects->ids, n, ENTITY_MAX_ID_SIZE) < 0) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        if ((unsigned int) rects->actions[i].type >= ACTION_N) {
+            log_fail("Binary level has an unknown action type %d\n",
+                     (int) rects->actions[i].type);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int level_file_view_points(LevelPoints *points,
+                                  LevelBinaryReader *reader,
+                                  LayerPicker layer)
+{
+    LevelBinarySlice slice;
+    if (level_file_next_section(reader, layer, &slice) < 0) {
+        return -1;
+    }
+
+    const size_t n = slice.count;
+    points->count = n;
+    points->positions = level_binary_chop(&slice, n * sizeof(Vec2f));
+    points->colors = level_binary_chop(&slice, n * sizeof(Color));
+    points->ids = level_binary_chop(&slice, n * ENTITY_MAX_ID_SIZE);
+    if (points->positions == NULL || points->colors == NULL || points->ids == NULL) {
+        return -1;
+    }
+
+    return level_file_check_strings(points->ids, n, ENTITY_MAX_ID_SIZE);
+}
+
+static int level_file_view_labels(LevelLabels *labels,
+                                  LevelBinaryReader *reader,
+                                  LayerPicker layer)
+{
+    LevelBinarySlice slice;
+    if (level_file_next_section(reader, layer, &slice) < 0) {
+        return -1;
+    }
+
+    const size_t n = slice.count;
+    labels->count = n;
+    labels->ids = level_binary_chop(&slice, n * ENTITY_MAX_ID_SIZE);
+    labels->positions = level_binary_chop(&slice, n * sizeof(Vec2f));
+    labels->colors = level_binary_chop(&slice, n * sizeof(Color));
+    labels->texts = level_binary_chop(&slice, n * LEVEL_FILE_LABEL_TEXT_MAX_SIZE);
+    if (labels->ids == NULL || labels->positions == NULL ||
+        labels->colors == NULL || labels->texts == NULL) {
+        return -1;
+    }
+
+    if (level_file_check_strings(labels->ids, n, ENTITY_MAX_ID_SIZE) < 0) {
+        return -1;
+    }
+
+    return level_file_check_strings(labels->texts, n, LEVEL_FILE_LABEL_TEXT_MAX_SIZE);
+}
+
+static int level_file_view_sectors(LevelFile *level_file,
+                                   LevelBinaryReader *reader)
+{
+    LevelBinarySlice slice;
+    if (level_binary_next_section(reader, LEVEL_BINARY_SECTOR_INDEX, &slice) < 0) {
+        return -1;
+    }
+
+    const size_t n = slice.count;
+    const LevelSector *sectors = level_binary_chop(&slice, n * sizeof(LevelSector));
+    if (sectors == NULL) {
+        return -1;
+    }
+
+    const size_t counts[LEVEL_SECTOR_LAYERS_N] = {
+        [LEVEL_SECTOR_PLATFORMS] = level_file->platforms.count,
+        [LEVEL_SECTOR_BACK_PLATFORMS] = level_file->back_platforms.count,
+        [LEVEL_SECTOR_LAVA] = level_file->lava.count,
+        [LEVEL_SECTOR_LABELS] = level_file->labels.count
+    };
+
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t layer = 0; layer < LEVEL_SECTOR_LAYERS_N; ++layer) {
+            if (sectors[i].begin[layer] > counts[layer] ||
+                sectors[i].count[layer] > counts[layer] - sectors[i].begin[layer]) {
+                log_fail("Sector %zu is out of the layer %zu\n", i, layer);
+                return -1;
+            }
+        }
+    }
+
+    level_file->sectors.count = n;
+    level_file->sectors.sectors = sectors;
+
+    return 0;
+}
+
+static int level_file_load_binary(LevelFile *level_file, String input)
+{
+    LevelBinaryReader reader;
+    if (level_binary_reader_begin(&reader, input) < 0) {
+        return -1;
+    }
+
+    LevelBinarySlice slice;
+    if (level_file_next_section(&reader, LAYER_PICKER_BACKGROUND, &slice) < 0 ||
+        level_binary_read(&slice, &level_file->background_color, sizeof(Color)) < 0) {
+        return -1;
+    }
+
+    if (level_file_next_section(&reader, LAYER_PICKER_PLAYER, &slice) < 0 ||
+        level_binary_read(&slice, &level_file->player_position, sizeof(Vec2f)) < 0 ||
+        level_binary_read(&slice, &level_file->player_color, sizeof(Color)) < 0) {
+        return -1;
+    }
+
+    if (level_file_view_rects(&level_file->platforms, &reader, LAYER_PICKER_PLATFORMS) < 0 ||
+        level_file_view_points(&level_file->goals, &reader, LAYER_PICKER_GOALS) < 0 ||
+        level_file_view_rects(&level_file->lava, &reader, LAYER_PICKER_LAVA) < 0 ||
+        level_file_view_rects(&level_file->back_platforms, &reader, LAYER_PICKER_BACK_PLATFORMS) < 0 ||
+        level_file_view_rects(&level_file->boxes, &reader, LAYER_PICKER_BOXES) < 0 ||
+        level_file_view_labels(&level_file->labels, &reader, LAYER_PICKER_LABELS) < 0 ||
+        level_file_view_rects(&level_file->regions, &reader, LAYER_PICKER_REGIONS) < 0 ||
+        level_file_view_rects(&level_file->pp, &reader, LAYER_PICKER_PP) < 0) {
+        return -1;
+    }
+
+    if (level_binary_has_next_section(&reader)) {
+        return level_file_view_sectors(level_file, &reader);
+    }
+
+    return 0;
+}
+
+int level_file_load(LevelFile *level_file, Memory *memory, const char *file_name)
+{
+    trace_assert(level_file);
+    trace_assert(memory);
+    trace_assert(file_name);
+
+    memset(level_file, 0, sizeof(*level_file));
+
+    if (map_whole_file(&level_file->mapped, file_name) < 0) {
+        return -1;
+    }
+
+    String input = mapped_file_content(&level_file->mapped);
+    String rest = input;
+    String version = trim(chop_by_delim(&rest, '\n'));
+
+    // Whatever the text got to before it failed is freed
+    const MemoryMark mark = memory_mark(memory);
+    int result = 0;
+    if (string_equal(version, STRING_LIT(LEVEL_BINARY_VERSION))) {
+        result = level_file_load_binary(level_file, input);
+    } else {
+        result = level_file_load_text(level_file, memory, input);
+        // Everything is copied out of the text
+        unmap_whole_file(&level_file->mapped);
+    }
+
+    if (result < 0) {
+        memory_rollback(memory, mark);
+        level_file_unload(level_file);
+        return -1;
+    }
+
+    return 0;
+}
+
+void level_file_unload(LevelFile *level_file)
+{
+    trace_assert(level_file);
+    unmap_whole_file(&level_file->mapped);
+    free(level_file->copy);
+    level_file->copy = NULL;
+}
+
+int level_file_copy(LevelFile *copy, const LevelFile *level_file)
+{
+    trace_assert(copy);
+    trace_assert(level_file);
+    // Only the binary levels point into the file
+    trace_assert(level_file->mapped.data);
+
+    memset(copy, 0, sizeof(*copy));
+
+    const size_t size = level_file->mapped.size;
+    copy->copy = nth_calloc(1, size);
+    if (copy->copy == NULL) {
+        return -1;
+    }
+    memcpy(copy->copy, level_file->mapped.data, size);
+
+    if (level_file_load_binary(copy, string(size, copy->copy)) < 0) {
+        level_file_unload(copy);
+        return -1;
+    }
+
+    return 0;
+}
+
+#define LEVEL_FILE_HASH_SEED 14695981039346656037ULL
+
+static uint64_t level_file_hash_bytes(uint64_t hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Only up to the NUL: whatever follows it in a binary level is
+// not part of the string
+static uint64_t level_file_hash_string(uint64_t hash, const char *s, size_t size)
+{
+    size_t n = 0;
+    while (n < size && s[n] != '\0') {
+        n += 1;
+    }
+    hash = level_file_hash_bytes(hash, &n, sizeof(n));
+    return level_file_hash_bytes(hash, s, n);
+}
+
+static uint64_t level_file_hash_rects(const LevelRects *rects)
+{
+    uint64_t hash = level_file_hash_bytes(LEVEL_FILE_HASH_SEED, &rects->count, sizeof(rects->count));
+    for (size_t i = 0; i < rects->count; ++i) {
+        hash = level_file_hash_string(hash, rects->ids + i * ENTITY_MAX_ID_SIZE, ENTITY_MAX_ID_SIZE);
+        hash = level_file_hash_bytes(hash, &rects->rects[i], sizeof(Rect));
+        hash = level_file_hash_bytes(hash, &rects->colors[i], sizeof(Color));
+        hash = level_file_hash_bytes(hash, &rects->actions[i].type, sizeof(ActionType));
+        hash = level_file_hash_string(hash, rects->actions[i].entity_id, ENTITY_MAX_ID_SIZE);
+    }
+    return hash;
+}
+
+static uint64_t level_file_hash_points(const LevelPoints *points)
+{
+    uint64_t hash = level_file_hash_bytes(LEVEL_FILE_HASH_SEED, &points->count, sizeof(points->count));
+    for (size_t i = 0; i < points->count; ++i) {
+        hash = level_file_hash_string(hash, points->ids + i * ENTITY_MAX_ID_SIZE, ENTITY_MAX_ID_SIZE);
+        hash = level_file_hash_bytes(hash, &points->positions[i], sizeof(Vec2f));
+        hash = level_file_hash_bytes(hash, &points->colors[i], sizeof(Color));
+    }
+    return hash;
+}
+
+static uint64_t level_file_hash_labels(const LevelLabels *labels)
+{
+    uint64_t hash = level_file_hash_bytes(LEVEL_FILE_HASH_SEED, &labels->count, sizeof(labels->count));
+    for (size_t i = 0; i < labels->count; ++i) {
+        hash = level_file_hash_string(hash, labels->ids + i * ENTITY_MAX_ID_SIZE, ENTITY_MAX_ID_SIZE);
+        hash = level_file_hash_bytes(hash, &labels->positions[i], sizeof(Vec2f));
+        hash = level_file_hash_bytes(hash, &labels->colors[i], sizeof(Color));
+        hash = level_file_hash_string(
+            hash,
+            labels->texts + i * LEVEL_FILE_LABEL_TEXT_MAX_SIZE,
+            LEVEL_FILE_LABEL_TEXT_MAX_SIZE);
+    }
+    return hash;
+}
+
+LevelFileHashes level_file_hashes(const LevelFile *level_file)
+{
+    trace_assert(level_file);
+
+    LevelFileHashes hashes;
+    hashes.layers[LEVEL_FILE_BACKGROUND] = level_file_hash_bytes(
+        LEVEL_FILE_HASH_SEED, &level_file->background_color, sizeof(Color));
+    hashes.layers[LEVEL_FILE_PLAYER] = level_file_hash_bytes(
+        level_file_hash_bytes(
+            LEVEL_FILE_HASH_SEED, &level_file->player_position, sizeof(Vec2f)),
+        &level_file->player_color, sizeof(Color));
+    hashes.layers[LEVEL_FILE_PLATFORMS] = level_file_hash_rects(&level_file->platforms);
+    hashes.layers[LEVEL_FILE_GOALS] = level_file_hash_points(&level_file->goals);
+    hashes.layers[LEVEL_FILE_LAVA] = level_file_hash_rects(&level_file->lava);
+    hashes.layers[LEVEL_FILE_BACK_PLATFORMS] = level_file_hash_rects(&level_file->back_platforms);
+    hashes.layers[LEVEL_FILE_BOXES] = level_file_hash_rects(&level_file->boxes);
+    hashes.layers[LEVEL_FILE_LABELS] = level_file_hash_labels(&level_file->labels);
+    hashes.layers[LEVEL_FILE_REGIONS] = level_file_hash_rects(&level_file->regions);
+    hashes.layers[LEVEL_FILE_PP] = level_file_hash_rects(&level_file->pp);
+
+    return hashes;
+}
+
+unsigned level_file_hashes_diff(const LevelFileHashes *a, const LevelFileHashes *b)
+{
+    trace_assert(a);
+    trace_assert(b);
+
+    unsigned diff = 0;
+    for (size_t i = 0; i < LEVEL_FILE_LAYER_N; ++i) {
+        if (a->layers[i] != b->layers[i]) {
+            diff |= 1u << i;
+        }
+    }
+    return diff;
+}
+
+int level_file_find_id(const char *ids, size_t count, const char *id, size_t hint)
+{
+    trace_assert(ids || count == 0);
+    trace_assert(id);
+
+    for (size_t k = 0; k < count; ++k) {
+        const size_t i = (hint + k) % count;
+        if (strncmp(ids + i * ENTITY_MAX_ID_SIZE, id, ENTITY_MAX_ID_SIZE) == 0) {
+            return (int) i;
+        }
+    }
+
+    return -1;
+}
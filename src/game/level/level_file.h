@@ -0,0 +1,132 @@
+#ifndef LEVEL_FILE_H_
+#define LEVEL_FILE_H_
+
+#include <stdint.h>
+
+#include "color.h"
+#include "config.h"
+#include "game/level/action.h"
+#include "game/level/level_editor/level_binary.h"
+#include "math/rect.h"
+#include "math/vec.h"
+#include "system/file.h"
+#include "system/memory.h"
+#include "system/s.h"
+
+#define LEVEL_FILE_LABEL_TEXT_MAX_SIZE 256
+
+// The entities of a level as plain arrays, without any of the state
+// of the level editor. Every id takes ENTITY_MAX_ID_SIZE bytes and
+// every label text takes LEVEL_FILE_LABEL_TEXT_MAX_SIZE bytes.
+typedef struct {
+    size_t count;
+    const char *ids;
+    const Rect *rects;
+    const Color *colors;
+    const Action *actions;
+} LevelRects;
+
+typedef struct {
+    size_t count;
+    const char *ids;
+    const Vec2f *positions;
+    const Color *colors;
+} LevelPoints;
+
+typedef struct {
+    size_t count;
+    const char *ids;
+    const Vec2f *positions;
+    const Color *colors;
+    const char *texts;
+} LevelLabels;
+
+// Sector index of a sectored binary level. The ranges of the sectors
+// index the platforms, back_platforms, lava and labels of the level
+// file (see LevelSectorLayer).
+typedef struct {
+    size_t count;
+    const LevelSector *sectors;
+} LevelSectors;
+
+typedef struct {
+    Color background_color;
+    Vec2f player_position;
+    Color player_color;
+    LevelRects platforms;
+    LevelPoints goals;
+    LevelRects lava;
+    LevelRects back_platforms;
+    LevelRects boxes;
+    LevelLabels labels;
+    LevelRects regions;
+    LevelRects pp;
+    // Empty unless the level is sectored
+    LevelSectors sectors;
+
+    // Binary levels are not copied anywhere: the arrays point
+    // straight into the mapped file
+    MappedFile mapped;
+    // Or into the copy of it made by level_file_copy()
+    void *copy;
+} LevelFile;
+
+typedef enum {
+    LEVEL_FILE_BACKGROUND = 0,
+    LEVEL_FILE_PLAYER,
+    LEVEL_FILE_PLATFORMS,
+    LEVEL_FILE_GOALS,
+    LEVEL_FILE_LAVA,
+    LEVEL_FILE_BACK_PLATFORMS,
+    LEVEL_FILE_BOXES,
+    LEVEL_FILE_LABELS,
+    LEVEL_FILE_REGIONS,
+    LEVEL_FILE_PP,
+
+    LEVEL_FILE_LAYER_N
+} LevelFileLayer;
+
+// A hash of every layer of a level file, so a reloaded level can
+// tell which of its layers actually changed
+typedef struct {
+    uint64_t layers[LEVEL_FILE_LAYER_N];
+} LevelFileHashes;
+
+// Loads the level in either format. The arrays of the text levels
+// are allocated in memory, so the level file is valid until both
+// level_file_unload() is called and memory is cleaned.
+int level_file_load(LevelFile *level_file, Memory *memory, const char *file_name);
+void level_file_unload(LevelFile *level_file);
+// Copies a binary level file into memory of its own, so it stays
+// valid no matter what happens to the file on the disk. The copy is
+// freed by level_file_unload().
+int level_file_copy(LevelFile *copy, const LevelFile *level_file);
+
+LevelFileHashes level_file_hashes(const LevelFile *level_file);
+// Bit (1 << layer) is set for every LevelFileLayer that differs
+unsigned level_file_hashes_diff(const LevelFileHashes *a, const LevelFileHashes *b);
+
+// The index of id among count ids of ENTITY_MAX_ID_SIZE bytes or -1.
+// The search starts at hint, where the entity most likely still is.
+int level_file_find_id(const char *ids, size_t count, const char *id, size_t hint);
+
+// Parsers of the text format shared with the level editor layers
+size_t level_file_chop_count(String *input);
+Color level_file_chop_color_line(String *input);
+void level_file_chop_player(String *input, Vec2f *position, Color *color);
+void level_file_chop_rect(String *input,
+                          char id[ENTITY_MAX_ID_SIZE],
+                          Rect *rect,
+                          Color *color,
+                          Action *action);
+void level_file_chop_point(String *input,
+                           char id[ENTITY_MAX_ID_SIZE],
+                           Vec2f *position,
+                           Color *color);
+void level_file_chop_label(String *input,
+                           char id[ENTITY_MAX_ID_SIZE],
+                           Vec2f *position,
+                           Color *color,
+                           char text[LEVEL_FILE_LABEL_TEXT_MAX_SIZE]);
+
+#endif  // LEVEL_FILE_H_
@@ -0,0 +1,396 @@
+#include <string.h>
+
+#include <SDL.h>
+
+#include "game/level/level_stream.h"
+#include "system/log.h"
+#include "system/lt.h"
+#include "system/nth_alloc.h"
+#include "system/stacktrace.h"
+
+struct LevelStream
+{
+    Lt *lt;
+    // Never changes after the stream is created, so the background
+    // thread reads it without locking
+    LevelFile level_file;
+    SDL_Thread *thread;
+    // Every label of the level. Keeps the state of the labels that
+    // were unloaded. Only touched by the main thread.
+    Labels *labels;
+
+    SDL_mutex *mutex;
+    SDL_cond *requested_cond;
+    SDL_cond *built_cond;
+
+    // Everything below is guarded by the mutex
+    bool requested;
+    Vec2f request;
+    bool building;
+    bool built;
+    int built_result;
+    LevelChunk chunk;
+    bool quit;
+};
+
+void destroy_level_chunk(LevelChunk *chunk)
+{
+    trace_assert(chunk);
+
+    if (chunk->platforms) {
+        destroy_platforms(chunk->platforms);
+    }
+
+    if (chunk->back_platforms) {
+        destroy_platforms(chunk->back_platforms);
+    }
+
+    if (chunk->lava) {
+        destroy_lava(chunk->lava);
+    }
+
+    if (chunk->labels) {
+        destroy_labels(chunk->labels);
+    }
+
+    memset(chunk, 0, sizeof(*chunk));
+}
+
+// Copies the ranges of the selected sectors out of one array of a
+// sectored layer
+static uint8_t *level_stream_copy(uint8_t *output,
+                                  const void *array,
+                                  size_t element_size,
+                                  const LevelSectors *sectors,
+                                  const size_t *selected, size_t n,
+                                  LevelSectorLayer layer)
+{
+    for (size_t i = 0; i < n; ++i) {
+        const LevelSector *sector = &sectors->sectors[selected[i]];
+        const size_t size = sector->count[layer] * element_size;
+        memcpy(output, (const uint8_t *) array + sector->begin[layer] * element_size, size);
+        output += size;
+    }
+
+    return output;
+}
+
+static size_t level_stream_count(const LevelSectors *sectors,
+                                 const size_t *selected, size_t n,
+                                 LevelSectorLayer layer)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        count += sectors->sectors[selected[i]].count[layer];
+    }
+    return count;
+}
+
+// Returns the block all the arrays of rects are allocated in
+static void *level_stream_gather_rects(const LevelStream *stream,
+                                       const size_t *selected, size_t n,
+                                       LevelSectorLayer layer,
+                                       const LevelRects *all,
+                                       LevelRects *rects)
+{
+    const LevelSectors *sectors = &stream->level_file.sectors;
+    const size_t count = level_stream_count(sectors, selected, n, layer);
+
+    uint8_t *block = nth_calloc(
+        1,
+        count * (ENTITY_MAX_ID_SIZE + sizeof(Rect) + sizeof(Color) + sizeof(Action)) + 1);
+    if (block == NULL) {
+        return NULL;
+    }
+
+    uint8_t *p = block;
+    rects->count = count;
+    rects->ids = (const char *) p;
+    p = level_stream_copy(p, all->ids, ENTITY_MAX_ID_SIZE, sectors, selected, n, layer);
+    rects->rects = (const Rect *) p;
+    p = level_stream_copy(p, all->rects, sizeof(Rect), sectors, selected, n, layer);
+    rects->colors = (const Color *) p;
+    p = level_stream_copy(p, all->colors, sizeof(Color), sectors, selected, n, layer);
+    rects->actions = (const Action *) p;
+    level_stream_copy(p, all->actions, sizeof(Action), sectors, selected, n, layer);
+
+    return block;
+}
+
+static void *level_stream_gather_labels(const LevelStream *stream,
+                                        const size_t *selected, size_t n,
+                                        LevelLabels *labels)
+{
+    const LevelSectors *sectors = &stream->level_file.sectors;
+    const LevelLabels *all = &stream->level_file.labels;
+    const LevelSectorLayer layer = LEVEL_SECTOR_LABELS;
+    const size_t count = level_stream_count(sectors, selected, n, layer);
+
+    uint8_t *block = nth_calloc(
+        1,
+        count * (ENTITY_MAX_ID_SIZE + sizeof(Vec2f) + sizeof(Color) + LEVEL_FILE_LABEL_TEXT_MAX_SIZE) + 1);
+    if (block == NULL) {
+        return NULL;
+    }
+
+    uint8_t *p = block;
+    labels->count = count;
+    labels->ids = (const char *) p;
+    p = level_stream_copy(p, all->ids, ENTITY_MAX_ID_SIZE, sectors, selected, n, layer);
+    labels->positions = (const Vec2f *) p;
+    p = level_stream_copy(p, all->positions, sizeof(Vec2f), sectors, selected, n, layer);
+    labels->colors = (const Color *) p;
+    p = level_stream_copy(p, all->colors, sizeof(Color), sectors, selected, n, layer);
+    labels->texts = (const char *) p;
+    level_stream_copy(p, all->texts, LEVEL_FILE_LABEL_TEXT_MAX_SIZE, sectors, selected, n, layer);
+
+    return block;
+}
+
+static Platforms *level_stream_platforms(const LevelStream *stream,
+                                         const size_t *selected, size_t n,
+                                         LevelSectorLayer layer,
+                                         const LevelRects *all)
+{
+    LevelRects rects;
+    void *block = level_stream_gather_rects(stream, selected, n, layer, all, &rects);
+    if (block == NULL) {
+        return NULL;
+    }
+
+    Platforms *platforms = create_platforms(&rects);
+    free(block);
+
+    return platforms;
+}
+
+static int level_stream_build(const LevelStream *stream,
+                              const size_t *selected, size_t n,
+                              LevelChunk *chunk)
+{
+    const LevelFile *level_file = &stream->level_file;
+
+    chunk->platforms = level_stream_platforms(
+        stream, selected, n, LEVEL_SECTOR_PLATFORMS, &level_file->platforms);
+    if (chunk->platforms == NULL) {
+        return -1;
+    }
+
+    chunk->back_platforms = level_stream_platforms(
+        stream, selected, n, LEVEL_SECTOR_BACK_PLATFORMS, &level_file->back_platforms);
+    if (chunk->back_platforms == NULL) {
+        return -1;
+    }
+    platforms_cull_occluded(chunk->back_platforms, chunk->platforms);
+
+    LevelRects lava;
+    void *lava_block = level_stream_gather_rects(
+        stream, selected, n, LEVEL_SECTOR_LAVA, &level_file->lava, &lava);
+    if (lava_block == NULL) {
+        return -1;
+    }
+    chunk->lava = create_lava(&lava);
+    free(lava_block);
+    if (chunk->lava == NULL) {
+        return -1;
+    }
+
+    LevelLabels labels;
+    void *labels_block = level_stream_gather_labels(stream, selected, n, &labels);
+    if (labels_block == NULL) {
+        return -1;
+    }
+    chunk->labels = create_labels(&labels);
+    free(labels_block);
+    if (chunk->labels == NULL) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int level_stream_load(LevelStream *stream, Vec2f center, LevelChunk *chunk)
+{
+    trace_assert(stream);
+    trace_assert(chunk);
+
+    memset(chunk, 0, sizeof(*chunk));
+    chunk->area = rect(
+        center.x - LEVEL_STREAM_RADIUS,
+        center.y - LEVEL_STREAM_RADIUS,
+        2.0f * LEVEL_STREAM_RADIUS,
+        2.0f * LEVEL_STREAM_RADIUS);
+
+    const LevelSectors *sectors = &stream->level_file.sectors;
+    size_t *selected = nth_calloc(sectors->count + 1, sizeof(size_t));
+    if (selected == NULL) {
+        return -1;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < sectors->count; ++i) {
+        if (rects_overlap(sectors->sectors[i].bounds, chunk->area)) {
+            selected[n++] = i;
+        }
+    }
+
+    const int result = level_stream_build(stream, selected, n, chunk);
+    free(selected);
+
+    if (result < 0) {
+        destroy_level_chunk(chunk);
+    }
+
+    return result;
+}
+
+static int level_stream_run(void *data)
+{
+    LevelStream *stream = data;
+
+    SDL_LockMutex(stream->mutex);
+    while (!stream->quit) {
+        if (!stream->requested) {
+            SDL_CondWait(stream->requested_cond, stream->mutex);
+            continue;
+        }
+
+        const Vec2f center = stream->request;
+        stream->requested = false;
+        stream->building = true;
+        SDL_UnlockMutex(stream->mutex);
+
+        LevelChunk chunk;
+        const int result = level_stream_load(stream, center, &chunk);
+
+        SDL_LockMutex(stream->mutex);
+        // Nobody took the previous chunk and nobody is going to
+        if (stream->built) {
+            destroy_level_chunk(&stream->chunk);
+        }
+        stream->chunk = chunk;
+        stream->built_result = result;
+        stream->built = true;
+        stream->building = false;
+        SDL_CondSignal(stream->built_cond);
+    }
+    SDL_UnlockMutex(stream->mutex);
+
+    return 0;
+}
+
+LevelStream *create_level_stream(const LevelFile *level_file)
+{
+    trace_assert(level_file);
+    trace_assert(level_file->sectors.count > 0);
+
+    Lt *lt = create_lt();
+
+    LevelStream *stream = PUSH_LT(lt, nth_calloc(1, sizeof(LevelStream)), free);
+    if (stream == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+    stream->lt = lt;
+
+    stream->mutex = PUSH_LT(lt, SDL_CreateMutex(), SDL_DestroyMutex);
+    if (stream->mutex == NULL) {
+        log_fail("SDL_CreateMutex: %s\n", SDL_GetError());
+        RETURN_LT(lt, NULL);
+    }
+
+    stream->requested_cond = PUSH_LT(lt, SDL_CreateCond(), SDL_DestroyCond);
+    if (stream->requested_cond == NULL) {
+        log_fail("SDL_CreateCond: %s\n", SDL_GetError());
+        RETURN_LT(lt, NULL);
+    }
+
+    stream->built_cond = PUSH_LT(lt, SDL_CreateCond(), SDL_DestroyCond);
+    if (stream->built_cond == NULL) {
+        log_fail("SDL_CreateCond: %s\n", SDL_GetError());
+        RETURN_LT(lt, NULL);
+    }
+
+    stream->labels = PUSH_LT(lt, create_labels(&level_file->labels), destroy_labels);
+    if (stream->labels == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    // The file may be rewritten or truncated while the level is
+    // played, so the stream never reads the mapped file
+    if (level_file_copy(&stream->level_file, level_file) < 0) {
+        RETURN_LT(lt, NULL);
+    }
+
+    stream->thread = SDL_CreateThread(level_stream_run, "level stream", stream);
+    if (stream->thread == NULL) {
+        log_fail("Could not create the level stream thread: %s\n", SDL_GetError());
+        level_file_unload(&stream->level_file);
+        RETURN_LT(lt, NULL);
+    }
+
+    return stream;
+}
+
+void destroy_level_stream(LevelStream *stream)
+{
+    trace_assert(stream);
+
+    SDL_LockMutex(stream->mutex);
+    stream->quit = true;
+    SDL_CondSignal(stream->requested_cond);
+    SDL_UnlockMutex(stream->mutex);
+
+    SDL_WaitThread(stream->thread, NULL);
+
+    if (stream->built) {
+        destroy_level_chunk(&stream->chunk);
+    }
+
+    level_file_unload(&stream->level_file);
+
+    RETURN_LT0(stream->lt);
+}
+
+void level_stream_request(LevelStream *stream, Vec2f center)
+{
+    trace_assert(stream);
+
+    SDL_LockMutex(stream->mutex);
+    stream->request = center;
+    stream->requested = true;
+    SDL_CondSignal(stream->requested_cond);
+    SDL_UnlockMutex(stream->mutex);
+}
+
+int level_stream_take(LevelStream *stream, LevelChunk *chunk, bool wait)
+{
+    trace_assert(stream);
+    trace_assert(chunk);
+
+    int result = 0;
+
+    SDL_LockMutex(stream->mutex);
+    while (wait && !stream->built && (stream->requested || stream->building)) {
+        SDL_CondWait(stream->built_cond, stream->mutex);
+    }
+
+    if (stream->built) {
+        *chunk = stream->chunk;
+        memset(&stream->chunk, 0, sizeof(stream->chunk));
+        result = stream->built_result < 0 ? -1 : 1;
+        stream->built = false;
+    }
+    SDL_UnlockMutex(stream->mutex);
+
+    return result;
+}
+
+void level_stream_swap_labels(LevelStream *stream, Labels *labels, const Labels *previous)
+{
+    trace_assert(stream);
+    trace_assert(labels);
+    trace_assert(previous);
+
+    labels_copy_state(stream->labels, previous);
+    labels_copy_state(labels, stream->labels);
+}
@@ -0,0 +1,49 @@
+#ifndef LEVEL_STREAM_H_
+#define LEVEL_STREAM_H_
+
+#include <stdbool.h>
+
+#include "game/level/labels.h"
+#include "game/level/lava.h"
+#include "game/level/level_file.h"
+#include "game/level/platforms.h"
+
+// Half of the side of the square around the player the sectors are
+// loaded for
+#define LEVEL_STREAM_RADIUS 4096.0f
+
+// The entities of the sectors around a point of a sectored level
+typedef struct {
+    Platforms *platforms;
+    Platforms *back_platforms;
+    Lava *lava;
+    Labels *labels;
+    // Every entity that overlaps the area is in the chunk
+    Rect area;
+} LevelChunk;
+
+void destroy_level_chunk(LevelChunk *chunk);
+
+// Builds the chunks of a sectored level on a background thread
+typedef struct LevelStream LevelStream;
+
+// Keeps a copy of level_file (see level_file_copy), so the level file
+// may be unloaded right after
+LevelStream *create_level_stream(const LevelFile *level_file);
+void destroy_level_stream(LevelStream *stream);
+
+// Builds the chunk around center right away on the calling thread
+int level_stream_load(LevelStream *stream, Vec2f center, LevelChunk *chunk);
+// Asks the background thread for the chunk around center. Replaces
+// the request that was not picked up yet.
+void level_stream_request(LevelStream *stream, Vec2f center);
+// Takes the latest chunk built by the background thread. Returns 1
+// when there was one, 0 when there was not. With wait it blocks
+// until the requested chunk is built.
+int level_stream_take(LevelStream *stream, LevelChunk *chunk, bool wait);
+// The labels of the chunk replace previous. The state of previous is
+// kept for when its labels are streamed back, so a label hidden by a
+// region stays hidden.
+void level_stream_swap_labels(LevelStream *stream, Labels *labels, const Labels *previous);
+
+#endif  // LEVEL_STREAM_H_
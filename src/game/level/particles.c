@@ -0,0 +1,276 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include <SDL.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "./particles.h"
+#include "math/affine.h"
+#include "math/pi.h"
+#include "math/rand.h"
+#include "math/triangle.h"
+#include "system/lt.h"
+#include "system/nth_alloc.h"
+#include "system/stacktrace.h"
+
+#define PARTICLES_EMITTERS_CAPACITY 64
+#define PARTICLES_RENDER_BATCH 64
+#define PARTICLE_SIZE 20.0f
+
+typedef struct {
+    size_t begin;
+    size_t count;
+    Color color;
+    float duration;
+    float time_passed;
+} ParticleEmitter;
+
+struct Particles
+{
+    Lt *lt;
+    size_t capacity;
+    size_t count;
+
+    float *xs;
+    float *ys;
+    float *dxs;
+    float *dys;
+    float *angles;
+    float *angle_velocities;
+    Triangle *bodies;
+
+    ParticleEmitter *emitters;
+    size_t emitters_count;
+};
+
+static float *particles_alloc_floats(Lt *lt, size_t capacity)
+{
+    return PUSH_LT(lt, nth_calloc(capacity, sizeof(float)), free);
+}
+
+Particles *create_particles(size_t capacity)
+{
+    Lt *lt = create_lt();
+
+    Particles *particles = PUSH_LT(lt, nth_calloc(1, sizeof(Particles)), free);
+    if (particles == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+    particles->lt = lt;
+
+    particles->capacity = capacity;
+    particles->count = 0;
+
+    particles->xs = particles_alloc_floats(lt, capacity);
+    if (particles->xs == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    particles->ys = particles_alloc_floats(lt, capacity);
+    if (particles->ys == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    particles->dxs = particles_alloc_floats(lt, capacity);
+    if (particles->dxs == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    particles->dys = particles_alloc_floats(lt, capacity);
+    if (particles->dys == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    particles->angles = particles_alloc_floats(lt, capacity);
+    if (particles->angles == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    particles->angle_velocities = particles_alloc_floats(lt, capacity);
+    if (particles->angle_velocities == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    particles->bodies = PUSH_LT(lt, nth_calloc(capacity, sizeof(Triangle)), free);
+    if (particles->bodies == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    particles->emitters = PUSH_LT(
+        lt,
+        nth_calloc(PARTICLES_EMITTERS_CAPACITY, sizeof(ParticleEmitter)),
+        free);
+    if (particles->emitters == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    return particles;
+}
+
+void destroy_particles(Particles *particles)
+{
+    trace_assert(particles);
+    RETURN_LT0(particles->lt);
+}
+
+ParticleEmitterId particles_add_emitter(Particles *particles,
+                                        size_t count,
+                                        Color color,
+                                        float duration)
+{
+    trace_assert(particles);
+    trace_assert(particles->count + count <= particles->capacity);
+    trace_assert(particles->emitters_count < PARTICLES_EMITTERS_CAPACITY);
+    trace_assert(duration > 0.0f);
+
+    const ParticleEmitterId id = particles->emitters_count++;
+    ParticleEmitter *emitter = &particles->emitters[id];
+    emitter->begin = particles->count;
+    emitter->count = count;
+    emitter->color = color;
+    emitter->duration = duration;
+    emitter->time_passed = duration;
+
+    particles->count += count;
+
+    return id;
+}
+
+void particles_burst(Particles *particles,
+                     ParticleEmitterId id,
+                     Vec2f position)
+{
+    trace_assert(particles);
+    trace_assert(id < particles->emitters_count);
+
+    ParticleEmitter *emitter = &particles->emitters[id];
+    emitter->time_passed = 0.0f;
+
+    for (size_t i = emitter->begin; i < emitter->begin + emitter->count; ++i) {
+        const Vec2f direction = vec_from_polar(
+            rand_float_range(-PI, 0.0f),
+            rand_float_range(100.0f, 300.0f));
+
+        particles->xs[i] = position.x;
+        particles->ys[i] = position.y;
+        particles->dxs[i] = direction.x;
+        particles->dys[i] = direction.y;
+        particles->angles[i] = rand_float(2 * PI);
+        particles->angle_velocities[i] = rand_float(8.0f);
+        particles->bodies[i] = random_triangle(PARTICLE_SIZE);
+    }
+}
+
+int particles_emitter_done(const Particles *particles,
+                           ParticleEmitterId id)
+{
+    trace_assert(particles);
+    trace_assert(id < particles->emitters_count);
+
+    const ParticleEmitter *emitter = &particles->emitters[id];
+    return emitter->time_passed >= emitter->duration;
+}
+
+// The angle velocities are never negative and a single step never
+// turns a particle more than a full turn, so wrapping the angle is
+// just a conditional subtraction
+static void particles_update_range(Particles *particles,
+                                   size_t begin, size_t end,
+                                   float delta_time)
+{
+    float *xs = particles->xs;
+    float *ys = particles->ys;
+    float *angles = particles->angles;
+    const float *dxs = particles->dxs;
+    const float *dys = particles->dys;
+    const float *angle_velocities = particles->angle_velocities;
+
+    size_t i = begin;
+
+#ifdef __SSE2__
+    const __m128 dt = _mm_set1_ps(delta_time);
+    const __m128 full_turn = _mm_set1_ps(2.0f * PI);
+
+    for (; i + 4 <= end; i += 4) {
+        const __m128 x = _mm_add_ps(_mm_loadu_ps(xs + i), _mm_mul_ps(_mm_loadu_ps(dxs + i), dt));
+        const __m128 y = _mm_add_ps(_mm_loadu_ps(ys + i), _mm_mul_ps(_mm_loadu_ps(dys + i), dt));
+        __m128 angle = _mm_add_ps(
+            _mm_loadu_ps(angles + i),
+            _mm_mul_ps(_mm_loadu_ps(angle_velocities + i), dt));
+        angle = _mm_sub_ps(angle, _mm_and_ps(_mm_cmpge_ps(angle, full_turn), full_turn));
+
+        _mm_storeu_ps(xs + i, x);
+        _mm_storeu_ps(ys + i, y);
+        _mm_storeu_ps(angles + i, angle);
+    }
+#endif
+
+    for (; i < end; ++i) {
+        xs[i] += dxs[i] * delta_time;
+        ys[i] += dys[i] * delta_time;
+        angles[i] += angle_velocities[i] * delta_time;
+        if (angles[i] >= 2.0f * PI) {
+            angles[i] -= 2.0f * PI;
+        }
+    }
+}
+
+void particles_update(Particles *particles, float delta_time)
+{
+    trace_assert(particles);
+    trace_assert(delta_time > 0.0f);
+
+    for (size_t id = 0; id < particles->emitters_count; ++id) {
+        ParticleEmitter *emitter = &particles->emitters[id];
+        if (emitter->time_passed >= emitter->duration) {
+            continue;
+        }
+
+        emitter->time_passed += delta_time;
+        particles_update_range(
+            particles,
+            emitter->begin,
+            emitter->begin + emitter->count,
+            delta_time);
+    }
+}
+
+int particles_render(const Particles *particles,
+                     const Camera *camera)
+{
+    trace_assert(particles);
+    trace_assert(camera);
+
+    Triangle batch[PARTICLES_RENDER_BATCH];
+
+    for (size_t id = 0; id < particles->emitters_count; ++id) {
+        const ParticleEmitter *emitter = &particles->emitters[id];
+        if (emitter->time_passed >= emitter->duration) {
+            continue;
+        }
+
+        Color color = emitter->color;
+        color.a = fminf(1.0f, 4.0f - emitter->time_passed / emitter->duration * 4.0f);
+
+        const size_t end = emitter->begin + emitter->count;
+        size_t n = 0;
+        for (size_t i = emitter->begin; i < end; ++i) {
+            Affine m = affine_rotate(particles->angles[i]);
+            m.tx = particles->xs[i];
+            m.ty = particles->ys[i];
+            batch[n++] = affine_triangle(m, particles->bodies[i]);
+
+            if (n == PARTICLES_RENDER_BATCH || i + 1 == end) {
+                if (camera_fill_triangles(camera, batch, n, color) < 0) {
+                    return -1;
+                }
+                n = 0;
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,36 @@
+#ifndef PARTICLES_H_
+#define PARTICLES_H_
+
+#include "color.h"
+#include "game/camera.h"
+#include "math/vec.h"
+
+// Level-wide pool of the triangle particles. The particles are
+// stored as separate arrays per attribute so the update step goes
+// through them four at a time. Every effect (player death, etc)
+// owns an emitter which is just a range of the pool reserved when
+// the level is created.
+typedef struct Particles Particles;
+
+typedef size_t ParticleEmitterId;
+
+Particles *create_particles(size_t capacity);
+void destroy_particles(Particles *particles);
+
+ParticleEmitterId particles_add_emitter(Particles *particles,
+                                        size_t count,
+                                        Color color,
+                                        float duration);
+
+// Restarts the emitter: scatters all of its particles from position
+void particles_burst(Particles *particles,
+                     ParticleEmitterId id,
+                     Vec2f position);
+int particles_emitter_done(const Particles *particles,
+                           ParticleEmitterId id);
+
+void particles_update(Particles *particles, float delta_time);
+int particles_render(const Particles *particles,
+                     const Camera *camera);
+
+#endif  // PARTICLES_H_
@@ -4,7 +4,8 @@
 #include <stdlib.h>
 #include "math/rect.h"
 #include "color.h"
-#include "game/level/level_editor/rect_layer.h"
+#include "game/camera.h"
+#include "game/level/level_file.h"
 
 typedef struct {
     size_t size;
@@ -13,7 +14,7 @@ typedef struct {
     int *hiding;
 } Phantom_Platforms;
 
-Phantom_Platforms create_phantom_platforms(RectLayer *rect_layer);
+Phantom_Platforms create_phantom_platforms(const LevelRects *level_rects);
 void destroy_phantom_platforms(Phantom_Platforms pp);
 
 void phantom_platforms_render(const Phantom_Platforms *pp, const Camera *camera);
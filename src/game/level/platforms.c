@@ -9,7 +9,6 @@
 #include "system/lt.h"
 #include "system/nth_alloc.h"
 #include "system/log.h"
-#include "game/level/level_editor/rect_layer.h"
 #include "math/extrema.h"
 
 struct Platforms {
@@ -20,9 +19,9 @@ struct Platforms {
     size_t rects_size;
 };
 
-Platforms *create_platforms_from_rect_layer(const RectLayer *layer)
+Platforms *create_platforms(const LevelRects *rects)
 {
-    trace_assert(layer);
+    trace_assert(rects);
 
     Lt *lt = create_lt();
 
@@ -35,20 +34,20 @@ Platforms *create_platforms_from_rect_layer(const RectLayer *layer)
     }
     platforms->lt = lt;
 
-    platforms->rects_size = rect_layer_count(layer);
+    platforms->rects_size = rects->count;
 
     platforms->rects = PUSH_LT(lt, nth_calloc(1, sizeof(Rect) * platforms->rects_size), free);
     if (platforms->rects == NULL) {
         RETURN_LT(lt, NULL);
     }
-    memcpy(platforms->rects, rect_layer_rects(layer), sizeof(Rect) * platforms->rects_size);
+    memcpy(platforms->rects, rects->rects, sizeof(Rect) * platforms->rects_size);
 
 
     platforms->colors = PUSH_LT(lt, nth_calloc(1, sizeof(Color) * platforms->rects_size), free);
     if (platforms->colors == NULL) {
         RETURN_LT(lt, NULL);
     }
-    memcpy(platforms->colors, rect_layer_colors(layer), sizeof(Color) * platforms->rects_size);
+    memcpy(platforms->colors, rects->colors, sizeof(Color) * platforms->rects_size);
 
     return platforms;
 }
@@ -59,6 +58,101 @@ void destroy_platforms(Platforms *platforms)
     RETURN_LT0(platforms->lt);
 }
 
+// Trims the part of rect covered by occluder if the occluder covers
+// it across the whole width or height. Returns 1 if rect changed.
+static int platforms_trim_rect(Rect *rect, Rect occluder)
+{
+    const float x2 = rect->x + rect->w;
+    const float y2 = rect->y + rect->h;
+    const float ox2 = occluder.x + occluder.w;
+    const float oy2 = occluder.y + occluder.h;
+
+    if (occluder.y <= rect->y && y2 <= oy2) {
+        if (occluder.x <= rect->x && rect->x < ox2) {
+            rect->w = x2 - ox2;
+            rect->x = ox2;
+            return 1;
+        }
+
+        if (occluder.x < x2 && x2 <= ox2) {
+            rect->w = occluder.x - rect->x;
+            return 1;
+        }
+    }
+
+    if (occluder.x <= rect->x && x2 <= ox2) {
+        if (occluder.y <= rect->y && rect->y < oy2) {
+            rect->h = y2 - oy2;
+            rect->y = oy2;
+            return 1;
+        }
+
+        if (occluder.y < y2 && y2 <= oy2) {
+            rect->h = occluder.y - rect->y;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+void platforms_cull_occluded(Platforms *platforms,
+                             const Platforms *occluders)
+{
+    trace_assert(platforms);
+    trace_assert(occluders);
+
+    size_t count = 0;
+
+    for (size_t i = 0; i < platforms->rects_size; ++i) {
+        Rect rect = platforms->rects[i];
+        int hidden = 0;
+        int trimmed = 1;
+
+        // Trimming by one occluder may let another one hide the
+        // rest, so keep going until nothing changes
+        while (trimmed && !hidden) {
+            trimmed = 0;
+            for (size_t j = 0; j < occluders->rects_size && !hidden; ++j) {
+                if (occluders->colors[j].a < 1.0f) {
+                    continue;
+                }
+
+                if (rect_contains_rect(occluders->rects[j], rect)) {
+                    hidden = 1;
+                } else if (platforms_trim_rect(&rect, occluders->rects[j])) {
+                    trimmed = 1;
+                }
+            }
+        }
+
+        if (!hidden) {
+            platforms->rects[count] = rect;
+            platforms->colors[count] = platforms->colors[i];
+            count += 1;
+        }
+    }
+
+    platforms->rects_size = count;
+}
+
+int platforms_occlude_screen_rect(const Platforms *platforms,
+                                  const Camera *camera,
+                                  Rect rect)
+{
+    trace_assert(platforms);
+    trace_assert(camera);
+
+    for (size_t i = 0; i < platforms->rects_size; ++i) {
+        if (platforms->colors[i].a >= 1.0f &&
+            rect_contains_rect(camera_rect(camera, platforms->rects[i]), rect)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
 int platforms_render(const Platforms *platforms,
                      const Camera *camera)
 {
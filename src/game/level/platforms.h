@@ -4,14 +4,27 @@
 #include <SDL.h>
 
 #include "game/camera.h"
+#include "game/level/level_file.h"
 #include "math/rect.h"
 
 typedef struct Platforms Platforms;
-typedef struct RectLayer RectLayer;
 
-Platforms *create_platforms_from_rect_layer(const RectLayer *layer);
+Platforms *create_platforms(const LevelRects *rects);
 void destroy_platforms(Platforms *platforms);
 
+// Removes the rects that are entirely hidden behind the opaque rects
+// of occluders and trims the ones that are partially hidden along a
+// whole side. Only for the platforms that are rendered before the
+// occluders and never collide with anything (back platforms).
+void platforms_cull_occluded(Platforms *platforms,
+                             const Platforms *occluders);
+
+// Whether rect (in screen coordinates) is entirely hidden behind a
+// single opaque platform
+int platforms_occlude_screen_rect(const Platforms *platforms,
+                                  const Camera *camera,
+                                  Rect rect);
+
 int platforms_render(const Platforms *platforms,
                      const Camera *camera);
 
@@ -3,7 +3,7 @@
 
 #include <SDL.h>
 
-#include "game/level/explosion.h"
+#include "game/level/particles.h"
 #include "game/level/rigid_bodies.h"
 #include "goals.h"
 #include "math/vec.h"
@@ -20,6 +20,7 @@
 #define PLAYER_SPEED 500.0f
 #define PLAYER_JUMP 32000.0f
 #define PLAYER_DEATH_DURATION 0.75f
+#define PLAYER_DEATH_PARTICLES 20
 #define PLAYER_MAX_JUMP_THRESHOLD 2
 
 typedef enum Player_state {
@@ -34,7 +35,9 @@ struct Player {
     RigidBodies *rigid_bodies;
 
     RigidBodyId alive_body_id;
-    Explosion *dying_body;
+
+    Particles *particles;
+    ParticleEmitterId dying_body;
 
     int jump_threshold;
     Color color;
@@ -44,11 +47,13 @@ struct Player {
     int play_die_cue;
 };
 
-Player *create_player_from_player_layer(const PlayerLayer *player_layer,
-                                        RigidBodies *rigid_bodies)
+Player *create_player(Vec2f position,
+                      Color color,
+                      RigidBodies *rigid_bodies,
+                      Particles *particles)
 {
-    trace_assert(player_layer);
     trace_assert(rigid_bodies);
+    trace_assert(particles);
 
     Lt *lt = create_lt();
 
@@ -63,24 +68,21 @@ Player *create_player_from_player_layer(const PlayerLayer *player_layer,
     player->alive_body_id = rigid_bodies_add(
         rigid_bodies,
         rect(
-            player_layer->position.x,
-            player_layer->position.y,
+            position.x,
+            position.y,
             PLAYER_WIDTH,
             PLAYER_HEIGHT));
 
-    player->dying_body = PUSH_LT(
-        lt,
-        create_explosion(
-            color_picker_rgba(&player_layer->color_picker),
-            PLAYER_DEATH_DURATION),
-        destroy_explosion);
-    if (player->dying_body == NULL) {
-        RETURN_LT(lt, NULL);
-    }
+    player->particles = particles;
+    player->dying_body = particles_add_emitter(
+        particles,
+        PLAYER_DEATH_PARTICLES,
+        color,
+        PLAYER_DEATH_DURATION);
 
     player->jump_threshold = 0;
-    player->color = color_picker_rgba(&player_layer->color_picker);
-    player->checkpoint = player_layer->position;
+    player->color = color;
+    player->checkpoint = position;
     player->play_die_cue = 0;
     player->state = PLAYER_STATE_ALIVE;
 
@@ -117,9 +119,7 @@ int player_render(const Player * player,
             camera);
     }
 
-    case PLAYER_STATE_DYING:
-        return explosion_render(player->dying_body, camera);
-
+    // The dying body is rendered with the rest of the level particles
     default: {}
     }
 
@@ -144,9 +144,7 @@ void player_update(Player *player,
     } break;
 
     case PLAYER_STATE_DYING: {
-        explosion_update(player->dying_body, delta_time);
-
-        if (explosion_is_done(player->dying_body)) {
+        if (particles_emitter_done(player->particles, player->dying_body)) {
             rigid_bodies_disable(player->rigid_bodies, player->alive_body_id, false);
             rigid_bodies_transform_velocity(
                 player->rigid_bodies,
@@ -221,7 +219,7 @@ void player_die(Player *player)
 
         player->play_die_cue = 1;
         player->jump_threshold = 0;
-        explosion_start(player->dying_body, vec(hitbox.x, hitbox.y));
+        particles_burst(player->particles, player->dying_body, vec(hitbox.x, hitbox.y));
         player->state = PLAYER_STATE_DYING;
         rigid_bodies_disable(player->rigid_bodies, player->alive_body_id, true);
     }
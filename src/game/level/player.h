@@ -8,14 +8,16 @@
 #include "lava.h"
 #include "platforms.h"
 #include "boxes.h"
-#include "game/level/level_editor/player_layer.h"
 
 typedef struct Player Player;
 typedef struct Goals Goals;
 typedef struct RigidBodies RigidBodies;
+typedef struct Particles Particles;
 
-Player *create_player_from_player_layer(const PlayerLayer *player_layer,
-                                        RigidBodies *rigid_bodies);
+Player *create_player(Vec2f position,
+                      Color color,
+                      RigidBodies *rigid_bodies,
+                      Particles *particles);
 void destroy_player(Player * player);
 
 int player_render(const Player * player,
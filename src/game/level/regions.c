@@ -7,7 +7,6 @@
 #include "system/log.h"
 #include "system/lt.h"
 #include "system/nth_alloc.h"
-#include "game/level/level_editor/rect_layer.h"
 #include "game/level/labels.h"
 #include "game/level/goals.h"
 
@@ -29,11 +28,11 @@ struct Regions {
     Goals *goals;
 };
 
-Regions *create_regions_from_rect_layer(const RectLayer *rect_layer,
-                                        Labels *labels,
-                                        Goals *goals)
+Regions *create_regions(const LevelRects *level_rects,
+                        Labels *labels,
+                        Goals *goals)
 {
-    trace_assert(rect_layer);
+    trace_assert(level_rects);
     trace_assert(labels);
 
     Lt *lt = create_lt();
@@ -47,7 +46,7 @@ Regions *create_regions_from_rect_layer(const RectLayer *rect_layer,
     }
     regions->lt = lt;
 
-    regions->count = rect_layer_count(rect_layer);
+    regions->count = level_rects->count;
 
     regions->ids = PUSH_LT(
         lt,
@@ -57,7 +56,7 @@ Regions *create_regions_from_rect_layer(const RectLayer *rect_layer,
         RETURN_LT(lt, NULL);
     }
     memcpy(regions->ids,
-           rect_layer_ids(rect_layer),
+           level_rects->ids,
            regions->count * ENTITY_MAX_ID_SIZE * sizeof(char));
 
 
@@ -69,7 +68,7 @@ Regions *create_regions_from_rect_layer(const RectLayer *rect_layer,
         RETURN_LT(lt, NULL);
     }
     memcpy(regions->rects,
-           rect_layer_rects(rect_layer),
+           level_rects->rects,
            regions->count * sizeof(Rect));
 
 
@@ -81,7 +80,7 @@ Regions *create_regions_from_rect_layer(const RectLayer *rect_layer,
         RETURN_LT(lt, NULL);
     }
     memcpy(regions->colors,
-           rect_layer_colors(rect_layer),
+           level_rects->colors,
            regions->count * sizeof(Color));
 
     regions->states = PUSH_LT(
@@ -100,7 +99,7 @@ Regions *create_regions_from_rect_layer(const RectLayer *rect_layer,
         RETURN_LT(lt, NULL);
     }
     memcpy(regions->actions,
-           rect_layer_actions(rect_layer),
+           level_rects->actions,
            regions->count * sizeof(Action));
 
     // TODO(#1108): impossible to change the region action from the Level Editor
@@ -164,6 +163,13 @@ void regions_player_leave(Regions *regions, Player *player)
     }
 }
 
+void regions_set_labels(Regions *regions, Labels *labels)
+{
+    trace_assert(regions);
+    trace_assert(labels);
+    regions->labels = labels;
+}
+
 int regions_render(Regions *regions, const Camera *camera)
 {
     trace_assert(regions);
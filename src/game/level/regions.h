@@ -3,16 +3,18 @@
 
 #include "math/rect.h"
 #include "action.h"
+#include "game/level/level_file.h"
 
 typedef struct Regions Regions;
 typedef struct Player Player;
 typedef struct Level Level;
-typedef struct RectLayer RectLayer;
 typedef struct Labels Labels;
 typedef struct Goals Goals;
 
-Regions *create_regions_from_rect_layer(const RectLayer *rect_layer, Labels *labels, Goals *goals);
+Regions *create_regions(const LevelRects *level_rects, Labels *labels, Goals *goals);
 void destroy_regions(Regions *regions);
+// The labels the regions hide were replaced (see LevelStream)
+void regions_set_labels(Regions *regions, Labels *labels);
 
 int regions_render(Regions *regions, const Camera *camera);
 
@@ -245,10 +245,26 @@ RigidBodyId rigid_bodies_add(RigidBodies *rigid_bodies,
                              Rect rect)
 {
     trace_assert(rigid_bodies);
-    trace_assert(rigid_bodies->count < rigid_bodies->capacity);
 
-    RigidBodyId id = rigid_bodies->count++;
+    // The removed bodies are reused, so the boxes that are recreated
+    // on every reload of the level do not run out of bodies
+    RigidBodyId id = 0;
+    while (id < rigid_bodies->count && !rigid_bodies->deleted[id]) {
+        id++;
+    }
+
+    if (id == rigid_bodies->count) {
+        trace_assert(rigid_bodies->count < rigid_bodies->capacity);
+        rigid_bodies->count++;
+    }
+
     rigid_bodies->bodies[id] = rect;
+    rigid_bodies->velocities[id] = vec(0.0f, 0.0f);
+    rigid_bodies->movements[id] = vec(0.0f, 0.0f);
+    rigid_bodies->grounded[id] = false;
+    rigid_bodies->forces[id] = vec(0.0f, 0.0f);
+    rigid_bodies->deleted[id] = false;
+    rigid_bodies->disabled[id] = false;
 
     return id;
 }
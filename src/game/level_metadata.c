@@ -0,0 +1,585 @@
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "dynarray.h"
+#include "game/level/level_file.h"
+#include "game/level_metadata.h"
+#include "sdl/draw_list.h"
+#include "sdl/raster.h"
+#include "system/log.h"
+#include "system/lt.h"
+#include "system/nth_alloc.h"
+#include "system/stacktrace.h"
+
+#define LEVEL_METADATA_INDEX_VERSION 2
+
+typedef struct {
+    uint32_t version;
+    // So an index written by a build with a different LevelMetadata
+    // is never read
+    uint32_t entry_size;
+    uint32_t count;
+    uint32_t reserved;
+} LevelMetadataIndexHeader;
+
+typedef struct {
+    LevelMetadata metadata;
+    bool ready;
+} LevelMetadataEntry;
+
+struct LevelMetadataIndex
+{
+    Lt *lt;
+    SDL_Thread *thread;
+    char index_path[METADATA_FILEPATH_MAX_SIZE];
+    // Only touched by the background thread
+    Memory staging;
+    LevelMetadata building;
+
+    SDL_mutex *mutex;
+    SDL_cond *cond;
+
+    // Everything below is guarded by the mutex. Only the background
+    // thread changes the entries, so it reads them without the mutex.
+    Dynarray entries;
+    // The paths of the levels to look at again, the ones before
+    // requests_begin are done
+    Dynarray requests;
+    size_t requests_begin;
+    size_t version;
+    bool quit;
+};
+
+// Loads the entries of the index file. A missing or outdated index
+// file is just empty.
+static LevelMetadata *level_metadata_index_read(const char *index_path, size_t *count)
+{
+    *count = 0;
+
+    FILE *stream = fopen(index_path, "rb");
+    if (stream == NULL) {
+        return NULL;
+    }
+
+    LevelMetadataIndexHeader header;
+    if (fread(&header, sizeof(header), 1, stream) != 1
+        || header.version != LEVEL_METADATA_INDEX_VERSION
+        || header.entry_size != sizeof(LevelMetadata)) {
+        log_warn("Ignoring outdated level index %s\n", index_path);
+        fclose(stream);
+        return NULL;
+    }
+
+    LevelMetadata *entries = nth_calloc((size_t) header.count + 1, sizeof(LevelMetadata));
+    if (entries == NULL) {
+        fclose(stream);
+        return NULL;
+    }
+
+    if (fread(entries, sizeof(LevelMetadata), header.count, stream) != header.count) {
+        log_warn("Ignoring truncated level index %s\n", index_path);
+        free(entries);
+        fclose(stream);
+        return NULL;
+    }
+    fclose(stream);
+
+    for (size_t i = 0; i < header.count; ++i) {
+        entries[i].file_path[METADATA_FILEPATH_MAX_SIZE - 1] = '\0';
+        entries[i].title[METADATA_TITLE_MAX_SIZE - 1] = '\0';
+    }
+
+    *count = header.count;
+    return entries;
+}
+
+static int level_metadata_index_write(const LevelMetadataIndex *index)
+{
+    FILE *stream = fopen(index->index_path, "wb");
+    if (stream == NULL) {
+        log_warn("Could not write level index %s: %s\n",
+                 index->index_path, strerror(errno));
+        return -1;
+    }
+
+    const LevelMetadataEntry *entries = index->entries.data;
+
+    LevelMetadataIndexHeader header = {
+        .version = LEVEL_METADATA_INDEX_VERSION,
+        .entry_size = sizeof(LevelMetadata),
+    };
+    for (size_t i = 0; i < index->entries.count; ++i) {
+        header.count += entries[i].ready;
+    }
+    fwrite(&header, sizeof(header), 1, stream);
+
+    for (size_t i = 0; i < index->entries.count; ++i) {
+        if (entries[i].ready) {
+            fwrite(&entries[i].metadata, sizeof(LevelMetadata), 1, stream);
+        }
+    }
+
+    const int result = ferror(stream) ? -1 : 0;
+    fclose(stream);
+
+    return result;
+}
+
+typedef struct {
+    Rect bounds;
+    float scale;
+    Vec2f offset;
+} LevelThumbnailView;
+
+static SDL_Rect level_thumbnail_project(const LevelThumbnailView *view, Rect rect)
+{
+    const float x1 = view->offset.x + (rect.x - view->bounds.x) * view->scale;
+    const float y1 = view->offset.y + (rect.y - view->bounds.y) * view->scale;
+    const float x2 = x1 + rect.w * view->scale;
+    const float y2 = y1 + rect.h * view->scale;
+
+    // Even the smallest entity leaves a pixel behind
+    SDL_Rect result = {
+        .x = (int) floorf(x1),
+        .y = (int) floorf(y1),
+    };
+    result.w = (int) ceilf(x2) - result.x;
+    result.h = (int) ceilf(y2) - result.y;
+    if (result.w < 1) result.w = 1;
+    if (result.h < 1) result.h = 1;
+
+    return result;
+}
+
+static void level_thumbnail_rects(DrawList *draw_list,
+                                  const LevelThumbnailView *view,
+                                  const LevelRects *rects)
+{
+    for (size_t i = 0; i < rects->count; ++i) {
+        draw_list_color(draw_list, color_for_sdl(rects->colors[i]));
+        draw_list_fill_rect(draw_list, level_thumbnail_project(view, rects->rects[i]));
+    }
+}
+
+static Rect level_metadata_bounds(const LevelFile *level_file)
+{
+    Rect bounds = rect(level_file->player_position.x, level_file->player_position.y, 0.0f, 0.0f);
+
+    const LevelRects *layers[] = {
+        &level_file->platforms,
+        &level_file->back_platforms,
+        &level_file->lava,
+        &level_file->boxes,
+    };
+    for (size_t layer = 0; layer < sizeof(layers) / sizeof(layers[0]); ++layer) {
+        for (size_t i = 0; i < layers[layer]->count; ++i) {
+            bounds = rect_boundary2(bounds, layers[layer]->rects[i]);
+        }
+    }
+
+    for (size_t i = 0; i < level_file->goals.count; ++i) {
+        const Vec2f position = level_file->goals.positions[i];
+        bounds = rect_boundary2(bounds, rect(position.x, position.y, 0.0f, 0.0f));
+    }
+
+    return bounds;
+}
+
+// The whole level scaled down to fit the thumbnail, drawn by the
+// software rasteriser, so no renderer is needed off the main thread
+static int level_metadata_thumbnail(const LevelFile *level_file,
+                                    Rect bounds,
+                                    DrawList *draw_list,
+                                    Raster *raster,
+                                    uint32_t *thumbnail)
+{
+    const float width = LEVEL_METADATA_THUMBNAIL_WIDTH;
+    const float height = LEVEL_METADATA_THUMBNAIL_HEIGHT;
+
+    LevelThumbnailView view = {
+        .bounds = bounds,
+        .scale = fminf(width / fmaxf(bounds.w, 1.0f), height / fmaxf(bounds.h, 1.0f)),
+    };
+    view.offset = vec((width - bounds.w * view.scale) * 0.5f,
+                      (height - bounds.h * view.scale) * 0.5f);
+
+    draw_list_reset(draw_list);
+    draw_list->view_port = (SDL_Rect) {
+        0, 0, LEVEL_METADATA_THUMBNAIL_WIDTH, LEVEL_METADATA_THUMBNAIL_HEIGHT
+    };
+
+    draw_list_color(draw_list, color_for_sdl(level_file->background_color));
+    draw_list_clear(draw_list);
+
+    level_thumbnail_rects(draw_list, &view, &level_file->back_platforms);
+    level_thumbnail_rects(draw_list, &view, &level_file->platforms);
+    level_thumbnail_rects(draw_list, &view, &level_file->boxes);
+    level_thumbnail_rects(draw_list, &view, &level_file->lava);
+
+    for (size_t i = 0; i < level_file->goals.count; ++i) {
+        const Vec2f position = level_file->goals.positions[i];
+        draw_list_color(draw_list, color_for_sdl(level_file->goals.colors[i]));
+        draw_list_fill_rect(draw_list, level_thumbnail_project(
+                                &view, rect(position.x, position.y, 0.0f, 0.0f)));
+    }
+
+    draw_list_color(draw_list, color_for_sdl(level_file->player_color));
+    draw_list_fill_rect(draw_list, level_thumbnail_project(
+                            &view,
+                            rect(level_file->player_position.x,
+                                 level_file->player_position.y,
+                                 0.0f, 0.0f)));
+
+    if (raster_draw_list(raster, draw_list) < 0) {
+        return -1;
+    }
+
+    memcpy(thumbnail, raster->pixels,
+           sizeof(uint32_t) * LEVEL_METADATA_THUMBNAIL_WIDTH * LEVEL_METADATA_THUMBNAIL_HEIGHT);
+
+    return 0;
+}
+
+static int level_metadata_build(LevelMetadataIndex *index,
+                                LevelMetadata *entry,
+                                DrawList *draw_list,
+                                Raster *raster)
+{
+    // The title is the name of the file without the folder and the
+    // extensions. The level format does not have one of its own.
+    const char *name = strrchr(entry->file_path, '/');
+    name = name ? name + 1 : entry->file_path;
+    snprintf(entry->title, METADATA_TITLE_MAX_SIZE, "%.*s",
+             (int) strcspn(name, "."), name);
+
+    memory_clean(&index->staging);
+
+    LevelFile level_file;
+    if (level_file_load(&level_file, &index->staging, entry->file_path) < 0) {
+        memory_clean(&index->staging);
+        return -1;
+    }
+
+    entry->platforms = (uint32_t) level_file.platforms.count;
+    entry->goals = (uint32_t) level_file.goals.count;
+    entry->lava = (uint32_t) level_file.lava.count;
+    entry->boxes = (uint32_t) level_file.boxes.count;
+    entry->labels = (uint32_t) level_file.labels.count;
+    entry->bounds = level_metadata_bounds(&level_file);
+
+    const int result = level_metadata_thumbnail(
+        &level_file, entry->bounds, draw_list, raster, entry->thumbnail);
+
+    level_file_unload(&level_file);
+    memory_clean(&index->staging);
+
+    return result;
+}
+
+// Returns -1 when the level is not in the index
+static int level_metadata_index_find(const LevelMetadataIndex *index, const char *file_path)
+{
+    const LevelMetadataEntry *entries = index->entries.data;
+    for (size_t i = 0; i < index->entries.count; ++i) {
+        if (strcmp(entries[i].metadata.file_path, file_path) == 0) {
+            return (int) i;
+        }
+    }
+
+    return -1;
+}
+
+static void level_metadata_index_publish(LevelMetadataIndex *index, const LevelMetadata *metadata)
+{
+    SDL_LockMutex(index->mutex);
+    const int found = level_metadata_index_find(index, metadata->file_path);
+    LevelMetadataEntry *entry = NULL;
+    if (found < 0) {
+        dynarray_push_empty(&index->entries);
+        entry = dynarray_pointer_at(&index->entries, index->entries.count - 1);
+    } else {
+        entry = dynarray_pointer_at(&index->entries, (size_t) found);
+    }
+    entry->metadata = *metadata;
+    entry->ready = true;
+    index->version++;
+    SDL_UnlockMutex(index->mutex);
+}
+
+static void level_metadata_index_remove(LevelMetadataIndex *index, size_t i)
+{
+    SDL_LockMutex(index->mutex);
+    dynarray_delete_at(&index->entries, i);
+    index->version++;
+    SDL_UnlockMutex(index->mutex);
+}
+
+// Brings the entry of the level up to date with the file. Returns
+// whether the entry changed.
+static bool level_metadata_index_refresh(LevelMetadataIndex *index,
+                                         const char *file_path,
+                                         const LevelMetadata *cached,
+                                         size_t cached_count,
+                                         DrawList *draw_list,
+                                         Raster *raster)
+{
+    const int found = level_metadata_index_find(index, file_path);
+
+    LevelMetadata *building = &index->building;
+    snprintf(building->file_path, METADATA_FILEPATH_MAX_SIZE, "%s", file_path);
+    if (file_stamp(&building->stamp, file_path) < 0) {
+        // The level is gone
+        if (found >= 0) {
+            level_metadata_index_remove(index, (size_t) found);
+            return true;
+        }
+        return false;
+    }
+
+    if (found >= 0) {
+        const LevelMetadataEntry *entry = dynarray_pointer_at(&index->entries, (size_t) found);
+        if (entry->ready && file_stamps_equal(entry->metadata.stamp, building->stamp)) {
+            return false;
+        }
+    }
+
+    for (size_t j = 0; j < cached_count; ++j) {
+        if (file_stamps_equal(cached[j].stamp, building->stamp)
+            && strcmp(cached[j].file_path, file_path) == 0) {
+            level_metadata_index_publish(index, &cached[j]);
+            return true;
+        }
+    }
+
+    if (level_metadata_build(index, building, draw_list, raster) < 0) {
+        return false;
+    }
+
+    level_metadata_index_publish(index, building);
+    return true;
+}
+
+static int level_metadata_index_run(void *data)
+{
+    LevelMetadataIndex *index = data;
+
+    size_t cached_count = 0;
+    LevelMetadata *cached = level_metadata_index_read(index->index_path, &cached_count);
+
+    DrawList draw_list = {0};
+    Raster raster = {0};
+    char file_path[METADATA_FILEPATH_MAX_SIZE];
+
+    // Everything that did not change is ready right away
+    size_t cached_hits = 0;
+    for (size_t i = 0;; ++i) {
+        SDL_LockMutex(index->mutex);
+        const bool done = i >= index->requests.count;
+        if (!done) {
+            memcpy(file_path, dynarray_pointer_at(&index->requests, i), METADATA_FILEPATH_MAX_SIZE);
+        }
+        SDL_UnlockMutex(index->mutex);
+        if (done) {
+            break;
+        }
+
+        FileStamp stamp;
+        if (file_stamp(&stamp, file_path) < 0) {
+            continue;
+        }
+
+        for (size_t j = 0; j < cached_count; ++j) {
+            if (file_stamps_equal(cached[j].stamp, stamp)
+                && strcmp(cached[j].file_path, file_path) == 0) {
+                level_metadata_index_publish(index, &cached[j]);
+                cached_hits++;
+                break;
+            }
+        }
+    }
+    // The cache keeps levels that are gone
+    bool changed = cached_hits != cached_count;
+
+    // The index file is rewritten once there is nothing left to do,
+    // or when the thread quits early, so it keeps whatever is ready
+    SDL_LockMutex(index->mutex);
+    for (;;) {
+        while (!index->quit
+               && index->requests_begin == index->requests.count
+               && !changed) {
+            SDL_CondWait(index->cond, index->mutex);
+        }
+
+        if (index->quit || index->requests_begin == index->requests.count) {
+            SDL_UnlockMutex(index->mutex);
+            if (changed) {
+                level_metadata_index_write(index);
+                changed = false;
+            }
+            SDL_LockMutex(index->mutex);
+
+            if (index->quit) {
+                break;
+            }
+            continue;
+        }
+
+        memcpy(file_path,
+               dynarray_pointer_at(&index->requests, index->requests_begin++),
+               METADATA_FILEPATH_MAX_SIZE);
+        if (index->requests_begin == index->requests.count) {
+            dynarray_clear(&index->requests);
+            index->requests_begin = 0;
+        }
+        SDL_UnlockMutex(index->mutex);
+
+        if (level_metadata_index_refresh(index, file_path, cached, cached_count, &draw_list, &raster)) {
+            changed = true;
+        }
+
+        SDL_LockMutex(index->mutex);
+    }
+    SDL_UnlockMutex(index->mutex);
+
+    destroy_raster(&raster);
+    destroy_draw_list(&draw_list);
+    free(cached);
+
+    return 0;
+}
+
+LevelMetadataIndex *create_level_metadata_index(const char *dirpath,
+                                                const char *files,
+                                                size_t count)
+{
+    trace_assert(dirpath);
+    trace_assert(files || count == 0);
+
+    Lt *lt = create_lt();
+
+    LevelMetadataIndex *index = PUSH_LT(lt, nth_calloc(1, sizeof(LevelMetadataIndex)), free);
+    if (index == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+    index->lt = lt;
+
+    snprintf(index->index_path, METADATA_FILEPATH_MAX_SIZE,
+             "%s%s", dirpath, LEVEL_METADATA_INDEX_EXTENSION);
+
+    index->staging.capacity = LEVEL_EDITOR_MEMORY_CAPACITY;
+    index->staging.buffer = PUSH_LT(
+        lt,
+        nth_calloc(LEVEL_EDITOR_MEMORY_CAPACITY, sizeof(uint8_t)),
+        free);
+    if (index->staging.buffer == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    index->mutex = PUSH_LT(lt, SDL_CreateMutex(), SDL_DestroyMutex);
+    if (index->mutex == NULL) {
+        log_fail("SDL_CreateMutex: %s\n", SDL_GetError());
+        RETURN_LT(lt, NULL);
+    }
+
+    index->cond = PUSH_LT(lt, SDL_CreateCond(), SDL_DestroyCond);
+    if (index->cond == NULL) {
+        log_fail("SDL_CreateCond: %s\n", SDL_GetError());
+        RETURN_LT(lt, NULL);
+    }
+
+    // Every level is requested, the ones in the index file are ready
+    // right away
+    index->entries = create_dynarray_malloc(sizeof(LevelMetadataEntry));
+    index->requests = create_dynarray_malloc(METADATA_FILEPATH_MAX_SIZE);
+    dynarray_reserve(&index->requests, count);
+    for (size_t i = 0; i < count; ++i) {
+        dynarray_push(&index->requests, files + i * METADATA_FILEPATH_MAX_SIZE);
+    }
+
+    index->thread = SDL_CreateThread(level_metadata_index_run, "level metadata index", index);
+    if (index->thread == NULL) {
+        log_fail("Could not create the level metadata index thread: %s\n", SDL_GetError());
+        free(index->entries.data);
+        free(index->requests.data);
+        RETURN_LT(lt, NULL);
+    }
+
+    return index;
+}
+
+void destroy_level_metadata_index(LevelMetadataIndex *index)
+{
+    trace_assert(index);
+
+    SDL_LockMutex(index->mutex);
+    index->quit = true;
+    SDL_CondSignal(index->cond);
+    SDL_UnlockMutex(index->mutex);
+
+    SDL_WaitThread(index->thread, NULL);
+
+    memory_clean(&index->staging);
+    free(index->entries.data);
+    free(index->requests.data);
+
+    RETURN_LT0(index->lt);
+}
+
+void level_metadata_index_invalidate(LevelMetadataIndex *index, const char *file_path)
+{
+    trace_assert(index);
+    trace_assert(file_path);
+
+    char request[METADATA_FILEPATH_MAX_SIZE];
+    snprintf(request, METADATA_FILEPATH_MAX_SIZE, "%s", file_path);
+
+    // The same file is often written several times in a row
+    SDL_LockMutex(index->mutex);
+    bool pending = false;
+    for (size_t i = index->requests_begin; i < index->requests.count && !pending; ++i) {
+        pending = strcmp(dynarray_pointer_at(&index->requests, i), request) == 0;
+    }
+    if (!pending) {
+        dynarray_push(&index->requests, request);
+        SDL_CondSignal(index->cond);
+    }
+    SDL_UnlockMutex(index->mutex);
+}
+
+bool level_metadata_index_get(LevelMetadataIndex *index,
+                              const char *file_path,
+                              LevelMetadata *metadata)
+{
+    trace_assert(index);
+    trace_assert(file_path);
+    trace_assert(metadata);
+
+    SDL_LockMutex(index->mutex);
+    const int found = level_metadata_index_find(index, file_path);
+    const LevelMetadataEntry *entry = found < 0
+        ? NULL
+        : dynarray_pointer_at(&index->entries, (size_t) found);
+    const bool ready = entry != NULL && entry->ready;
+    if (ready) {
+        *metadata = entry->metadata;
+    }
+    SDL_UnlockMutex(index->mutex);
+
+    return ready;
+}
+
+size_t level_metadata_index_version(LevelMetadataIndex *index)
+{
+    trace_assert(index);
+
+    SDL_LockMutex(index->mutex);
+    const size_t version = index->version;
+    SDL_UnlockMutex(index->mutex);
+
+    return version;
+}
@@ -0,0 +1,59 @@
+#ifndef LEVEL_METADATA_H_
+#define LEVEL_METADATA_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "math/rect.h"
+#include "system/file.h"
+
+// The index of a level folder lives next to it: ./assets/levels.index
+#define LEVEL_METADATA_INDEX_EXTENSION ".index"
+#define LEVEL_METADATA_THUMBNAIL_WIDTH 64
+#define LEVEL_METADATA_THUMBNAIL_HEIGHT 36
+
+// Everything the level picker shows about a level without loading it
+typedef struct {
+    // The key of the index entry: the entry is stale as soon as the
+    // stamp of the file changes
+    char file_path[METADATA_FILEPATH_MAX_SIZE];
+    FileStamp stamp;
+
+    char title[METADATA_TITLE_MAX_SIZE];
+    uint32_t platforms;
+    uint32_t goals;
+    uint32_t lava;
+    uint32_t boxes;
+    uint32_t labels;
+    Rect bounds;
+
+    // ARGB8888, the whole level scaled down into it
+    uint32_t thumbnail[LEVEL_METADATA_THUMBNAIL_WIDTH * LEVEL_METADATA_THUMBNAIL_HEIGHT];
+} LevelMetadata;
+
+// Keeps the metadata of the levels of a folder up to date. The index
+// file is read and the changed levels are reloaded on a background
+// thread, the entries become available one by one as they are ready.
+typedef struct LevelMetadataIndex LevelMetadataIndex;
+
+// files are count paths of METADATA_FILEPATH_MAX_SIZE bytes each,
+// the levels the level picker lists
+LevelMetadataIndex *create_level_metadata_index(const char *dirpath,
+                                                const char *files,
+                                                size_t count);
+void destroy_level_metadata_index(LevelMetadataIndex *index);
+
+// The level was written, added or removed. Only its entry is looked
+// at again, the rest of the index stays ready.
+void level_metadata_index_invalidate(LevelMetadataIndex *index, const char *file_path);
+// Copies the metadata of the level into metadata. Returns false
+// while it is not ready yet.
+bool level_metadata_index_get(LevelMetadataIndex *index,
+                              const char *file_path,
+                              LevelMetadata *metadata);
+// Bumped every time an entry becomes ready or goes away, so the
+// caller knows when to redraw
+size_t level_metadata_index_version(LevelMetadataIndex *index);
+
+#endif  // LEVEL_METADATA_H_
@@ -1,4 +1,6 @@
+#include <ctype.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "./level_picker.h"
 
@@ -21,18 +23,85 @@
 #define SCROLLBAR_WIDTH 20
 #define SCROLLING_SPEED_FRACTION 0.25f
 
+#define LEVEL_PICKER_PREVIEW_SCALE 4
+#define LEVEL_PICKER_PREVIEW_PADDING 20.0f
+#define LEVEL_PICKER_PREVIEW_FONT_SCALE vec(2.5f, 2.5f)
+
+#define LEVEL_PICKER_SEARCH_FONT_SCALE vec(3.0f, 3.0f)
+#define LEVEL_PICKER_ITEMS_INITIAL_CAPACITY 256
+
+static const char *level_picker_item(const LevelPicker *level_picker, size_t i)
+{
+    trace_assert(i < level_picker->items_count);
+    return level_picker->items + i * METADATA_FILEPATH_MAX_SIZE;
+}
+
+static void level_picker_push_item(LevelPicker *level_picker,
+                                   const char *filepath,
+                                   const char *file_name)
+{
+    if (level_picker->items_count >= level_picker->items_capacity) {
+        level_picker->items_capacity = level_picker->items_capacity == 0
+            ? LEVEL_PICKER_ITEMS_INITIAL_CAPACITY
+            : level_picker->items_capacity * 2;
+        level_picker->items = realloc(
+            level_picker->items,
+            level_picker->items_capacity * METADATA_FILEPATH_MAX_SIZE);
+        level_picker->search_key_offsets = realloc(
+            level_picker->search_key_offsets,
+            level_picker->items_capacity * sizeof(size_t));
+        level_picker->matches = realloc(
+            level_picker->matches,
+            level_picker->items_capacity * sizeof(size_t));
+        trace_assert(level_picker->items);
+        trace_assert(level_picker->search_key_offsets);
+        trace_assert(level_picker->matches);
+    }
+
+    const size_t key_size = strlen(file_name) + 1;
+    while (level_picker->search_keys_size + key_size > level_picker->search_keys_capacity) {
+        level_picker->search_keys_capacity = level_picker->search_keys_capacity == 0
+            ? LEVEL_PICKER_ITEMS_INITIAL_CAPACITY * 16
+            : level_picker->search_keys_capacity * 2;
+        level_picker->search_keys = realloc(
+            level_picker->search_keys,
+            level_picker->search_keys_capacity);
+        trace_assert(level_picker->search_keys);
+    }
+
+    char *key = level_picker->search_keys + level_picker->search_keys_size;
+    for (size_t i = 0; i < key_size; ++i) {
+        key[i] = (char) tolower((unsigned char) file_name[i]);
+    }
+
+    const size_t i = level_picker->items_count++;
+    snprintf(level_picker->items + i * METADATA_FILEPATH_MAX_SIZE,
+             METADATA_FILEPATH_MAX_SIZE, "%s", filepath);
+    const size_t length = strlen(level_picker_item(level_picker, i));
+    if (length > level_picker->items_max_length) {
+        level_picker->items_max_length = length;
+    }
+    level_picker->search_key_offsets[i] = level_picker->search_keys_size;
+    level_picker->search_keys_size += key_size;
+    level_picker->matches[level_picker->matches_count++] = i;
+}
+
 void level_picker_populate(LevelPicker *level_picker,
                            const char *dirpath)
 {
     trace_assert(level_picker);
     trace_assert(dirpath);
 
+    snprintf(level_picker->dirpath, METADATA_FILEPATH_MAX_SIZE, "%s", dirpath);
     level_picker->background.base_color = hexstr("073642");
     level_picker->camera_position = vec(0.0f, 0.0f);
+    level_picker->layout_width = 0.0f;
 
     {
-        dynarray_clear(&level_picker->items);
-        level_picker->items = create_dynarray_malloc(METADATA_FILEPATH_MAX_SIZE);
+        level_picker->items_count = 0;
+        level_picker->items_max_length = 0;
+        level_picker->search_keys_size = 0;
+        level_picker->matches_count = 0;
 
         DIR *level_dir = opendir(dirpath);
         if (level_dir == NULL) {
@@ -48,11 +117,23 @@ void level_picker_populate(LevelPicker *level_picker,
 
             snprintf(filepath, METADATA_FILEPATH_MAX_SIZE,
                      "%s/%s", dirpath, d->d_name);
-            dynarray_push(&level_picker->items, filepath);
+            level_picker_push_item(level_picker, filepath, d->d_name);
         }
         closedir(level_dir);
     }
 
+    level_picker->searching = false;
+    level_picker->search_query[0] = '\0';
+    edit_field_clean(&level_picker->search);
+    edit_field_restyle(&level_picker->search, LEVEL_PICKER_SEARCH_FONT_SCALE, COLOR_WHITE);
+
+    if (level_picker->metadata) {
+        destroy_level_metadata_index(level_picker->metadata);
+    }
+    level_picker->metadata = create_level_metadata_index(
+        dirpath, level_picker->items, level_picker->items_count);
+    level_picker->metadata_version = 0;
+
     level_picker->wiggly_text = (WigglyText) {
         .text = "Select Level",
         .scale = {10.0f, 10.0f},
@@ -60,6 +141,269 @@ void level_picker_populate(LevelPicker *level_picker,
     };
 }
 
+void destroy_level_picker(LevelPicker level_picker)
+{
+    if (level_picker.metadata) {
+        destroy_level_metadata_index(level_picker.metadata);
+    }
+    free(level_picker.items);
+    free(level_picker.search_keys);
+    free(level_picker.search_key_offsets);
+    free(level_picker.matches);
+}
+
+// Every character of the query shows up in the key in the same order
+static bool level_picker_fuzzy_match(const char *key, const char *query)
+{
+    for (; *query != '\0'; ++query) {
+        key = strchr(key, *query);
+        if (key == NULL) {
+            return false;
+        }
+        key++;
+    }
+
+    return true;
+}
+
+static void level_picker_filter(LevelPicker *level_picker)
+{
+    char query[EDIT_FIELD_CAPACITY + 1];
+    const char *text = edit_field_as_text(&level_picker->search);
+    size_t n = 0;
+    for (; text[n] != '\0' && n < EDIT_FIELD_CAPACITY; ++n) {
+        query[n] = (char) tolower((unsigned char) text[n]);
+    }
+    query[n] = '\0';
+
+    if (strcmp(query, level_picker->search_query) == 0) {
+        return;
+    }
+
+    const size_t cursor_item = level_picker->items_cursor < level_picker->matches_count
+        ? level_picker->matches[level_picker->items_cursor]
+        : 0;
+
+    // Whatever matches the longer query matches the shorter one too,
+    // so typing only ever filters the current matches
+    const size_t previous_length = strlen(level_picker->search_query);
+    const bool narrowing = strncmp(query, level_picker->search_query, previous_length) == 0;
+    const size_t candidates_count = narrowing
+        ? level_picker->matches_count
+        : level_picker->items_count;
+
+    size_t matches_count = 0;
+    for (size_t i = 0; i < candidates_count; ++i) {
+        const size_t item = narrowing ? level_picker->matches[i] : i;
+        const char *key = level_picker->search_keys + level_picker->search_key_offsets[item];
+        if (level_picker_fuzzy_match(key, query)) {
+            level_picker->matches[matches_count++] = item;
+        }
+    }
+    level_picker->matches_count = matches_count;
+    memcpy(level_picker->search_query, query, n + 1);
+
+    // The cursor stays on its level while it still matches
+    level_picker->items_cursor = 0;
+    for (size_t i = 0; i < matches_count; ++i) {
+        if (level_picker->matches[i] == cursor_item) {
+            level_picker->items_cursor = i;
+            break;
+        }
+    }
+}
+
+static int level_picker_find_item(const LevelPicker *level_picker,
+                                  const char *filepath)
+{
+    for (size_t i = 0; i < level_picker->items_count; ++i) {
+        if (strcmp(level_picker_item(level_picker, i), filepath) == 0) {
+            return (int) i;
+        }
+    }
+
+    return -1;
+}
+
+// Returns -1 when the path of the file does not fit into filepath
+static int level_picker_filepath(const LevelPicker *level_picker,
+                                 const char *file_name,
+                                 char filepath[METADATA_FILEPATH_MAX_SIZE])
+{
+    const int n = snprintf(filepath, METADATA_FILEPATH_MAX_SIZE,
+                           "%s/%s", level_picker->dirpath, file_name);
+    if (n < 0 || n >= METADATA_FILEPATH_MAX_SIZE) {
+        log_fail("Level file path is too long: %s/%s\n",
+                 level_picker->dirpath, file_name);
+        return -1;
+    }
+
+    return 0;
+}
+
+void level_picker_file_written(LevelPicker *level_picker, const char *file_name)
+{
+    trace_assert(level_picker);
+    trace_assert(file_name);
+
+    char filepath[METADATA_FILEPATH_MAX_SIZE];
+    if (level_picker_filepath(level_picker, file_name, filepath) < 0) {
+        return;
+    }
+
+    // Even if the level is already listed its metadata is stale now
+    if (level_picker->metadata) {
+        level_metadata_index_invalidate(level_picker->metadata, filepath);
+    }
+
+    if (level_picker_find_item(level_picker, filepath) >= 0) {
+        return;
+    }
+
+    level_picker_push_item(level_picker, filepath, file_name);
+
+    // The new level is shown only if it matches the search
+    const size_t i = level_picker->items_count - 1;
+    const char *key = level_picker->search_keys + level_picker->search_key_offsets[i];
+    if (!level_picker_fuzzy_match(key, level_picker->search_query)) {
+        level_picker->matches_count--;
+    }
+}
+
+void level_picker_file_removed(LevelPicker *level_picker, const char *file_name)
+{
+    trace_assert(level_picker);
+    trace_assert(file_name);
+
+    char filepath[METADATA_FILEPATH_MAX_SIZE];
+    if (level_picker_filepath(level_picker, file_name, filepath) < 0) {
+        return;
+    }
+    if (level_picker->metadata) {
+        level_metadata_index_invalidate(level_picker->metadata, filepath);
+    }
+
+    const int found = level_picker_find_item(level_picker, filepath);
+    if (found < 0) {
+        return;
+    }
+    const size_t removed = (size_t) found;
+
+    // The key stays in the pool until the folder is populated again
+    const size_t tail = level_picker->items_count - removed - 1;
+    memmove(level_picker->items + removed * METADATA_FILEPATH_MAX_SIZE,
+            level_picker->items + (removed + 1) * METADATA_FILEPATH_MAX_SIZE,
+            tail * METADATA_FILEPATH_MAX_SIZE);
+    memmove(level_picker->search_key_offsets + removed,
+            level_picker->search_key_offsets + removed + 1,
+            tail * sizeof(size_t));
+    level_picker->items_count--;
+
+    // The matches keep the folder order, so shifting them is enough
+    size_t matches_count = 0;
+    for (size_t i = 0; i < level_picker->matches_count; ++i) {
+        const size_t item = level_picker->matches[i];
+        if (item == removed) {
+            if (level_picker->items_cursor > i) {
+                level_picker->items_cursor--;
+            }
+            continue;
+        }
+        level_picker->matches[matches_count++] = item > removed ? item - 1 : item;
+    }
+    level_picker->matches_count = matches_count;
+    if (level_picker->items_cursor >= matches_count && matches_count > 0) {
+        level_picker->items_cursor = matches_count - 1;
+    }
+
+    if (level_picker->selected_item == (int) removed) {
+        level_picker->selected_item = -1;
+    } else if (level_picker->selected_item > (int) removed) {
+        level_picker->selected_item--;
+    }
+}
+
+// Runs of the same color of a thumbnail row become a single rect
+static void level_picker_render_thumbnail(const LevelMetadata *metadata,
+                                          const Camera *camera,
+                                          Vec2f position)
+{
+    const int scale = LEVEL_PICKER_PREVIEW_SCALE;
+
+    for (int y = 0; y < LEVEL_METADATA_THUMBNAIL_HEIGHT; ++y) {
+        const uint32_t *row = metadata->thumbnail + y * LEVEL_METADATA_THUMBNAIL_WIDTH;
+
+        int x = 0;
+        while (x < LEVEL_METADATA_THUMBNAIL_WIDTH) {
+            int end = x + 1;
+            while (end < LEVEL_METADATA_THUMBNAIL_WIDTH && row[end] == row[x]) {
+                end++;
+            }
+
+            const SDL_Color color = {
+                (Uint8) (row[x] >> 16), (Uint8) (row[x] >> 8), (Uint8) row[x], 255
+            };
+            draw_list_color(camera->draw_list, color);
+            draw_list_fill_rect(camera->draw_list, (SDL_Rect) {
+                (int) position.x + x * scale, (int) position.y + y * scale,
+                (end - x) * scale, scale
+            });
+
+            x = end;
+        }
+    }
+}
+
+// The metadata of the level under the cursor in the bottom right
+// corner. Just the frame until the metadata is ready.
+static void level_picker_render_preview(const LevelPicker *level_picker,
+                                        const Camera *camera,
+                                        Rect viewport)
+{
+    if (level_picker->metadata == NULL
+        || level_picker->items_cursor >= level_picker->matches_count) {
+        return;
+    }
+
+    const Vec2f size = vec(
+        (float) (LEVEL_METADATA_THUMBNAIL_WIDTH * LEVEL_PICKER_PREVIEW_SCALE),
+        (float) (LEVEL_METADATA_THUMBNAIL_HEIGHT * LEVEL_PICKER_PREVIEW_SCALE));
+    const Vec2f position = vec(
+        viewport.w - size.x - LEVEL_PICKER_PREVIEW_PADDING,
+        viewport.h - size.y - LEVEL_PICKER_PREVIEW_PADDING);
+
+    LevelMetadata metadata;
+    if (level_metadata_index_get(
+            level_picker->metadata,
+            level_picker_item(level_picker, level_picker->matches[level_picker->items_cursor]),
+            &metadata)) {
+        level_picker_render_thumbnail(&metadata, camera, position);
+
+        const float line_height = FONT_CHAR_HEIGHT * LEVEL_PICKER_PREVIEW_FONT_SCALE.y * 1.5f;
+        char stats[2][METADATA_TITLE_MAX_SIZE];
+        snprintf(stats[0], METADATA_TITLE_MAX_SIZE, "platforms %u  boxes %u",
+                 metadata.platforms, metadata.boxes);
+        snprintf(stats[1], METADATA_TITLE_MAX_SIZE, "goals %u  lava %u  labels %u",
+                 metadata.goals, metadata.lava, metadata.labels);
+
+        const char *lines[] = {metadata.title, stats[0], stats[1]};
+        const size_t lines_count = sizeof(lines) / sizeof(lines[0]);
+        for (size_t i = 0; i < lines_count; ++i) {
+            camera_render_text_screen(
+                camera,
+                lines[i],
+                LEVEL_PICKER_PREVIEW_FONT_SCALE,
+                COLOR_WHITE,
+                vec(position.x,
+                    position.y - (float) (lines_count - i) * line_height));
+        }
+    }
+
+    const SDL_Color white = {255, 255, 255, 255};
+    draw_list_color(camera->draw_list, white);
+    draw_list_draw_rect(camera->draw_list, rect_for_sdl(rect_from_vecs(position, size)));
+}
+
 int level_picker_render(const LevelPicker *level_picker,
                         const Camera *camera)
 {
@@ -67,7 +411,7 @@ int level_picker_render(const LevelPicker *level_picker,
 
     const Rect viewport = camera_view_port_screen(camera);
 
-    if (background_render(&level_picker->background, camera) < 0) {
+    if (background_render(&level_picker->background, camera, NULL) < 0) {
         return -1;
     }
 
@@ -79,11 +423,14 @@ int level_picker_render(const LevelPicker *level_picker,
         camera,
         vec(viewport.w * 0.5f - title_size.x * 0.5f, TITLE_MARGIN_TOP));
 
+    // The list is drawn straight into the draw list in the screen coordinates
+    draw_list_pass(camera->draw_list, DRAW_PASS_SCREEN);
+
     const float proportional_scroll = level_picker->items_scroll.y * scrolling_area_height / level_picker->items_size.y;
     const float number_of_items_in_scrolling_area = scrolling_area_height / ITEM_HEIGHT;
-    const float percent_of_visible_items = number_of_items_in_scrolling_area / ((float) level_picker->items.count - 1);
+    const float percent_of_visible_items = number_of_items_in_scrolling_area / ((float) level_picker->matches_count - 1);
 
-    if(level_picker->items.count > 0 && percent_of_visible_items < 1) {
+    if(level_picker->matches_count > 0 && percent_of_visible_items < 1) {
         SDL_Rect scrollbar = rect_for_sdl(
             rect_from_vecs(
                 vec(level_picker->items_position.x + level_picker->items_size.x, level_picker->items_position.y),
@@ -94,34 +441,33 @@ int level_picker_render(const LevelPicker *level_picker,
                 vec(level_picker->items_position.x + level_picker->items_size.x, level_picker->items_position.y - proportional_scroll),
                 vec(SCROLLBAR_WIDTH, scrolling_area_height * percent_of_visible_items)));
 
-        if (SDL_SetRenderDrawColor(camera->renderer, 255, 255, 255, 255) < 0) {
-            return -1;
-        }
-
-        if (SDL_RenderDrawRect(camera->renderer, &scrollbar) < 0) {
-            return -1;
-        }
-
-        if (SDL_RenderFillRect(camera->renderer, &scrollbar_thumb) < 0) {
-            return -1;
-        }
+        const SDL_Color white = {255, 255, 255, 255};
+        draw_list_color(camera->draw_list, white);
+        draw_list_draw_rect(camera->draw_list, scrollbar);
+        draw_list_fill_rect(camera->draw_list, scrollbar_thumb);
     }
 
-    for (size_t i = 0; i < level_picker->items.count; ++i) {
+    // Only the rows inside of the scrolling area are visited
+    const float first_row = ceilf(-level_picker->items_scroll.y / ITEM_HEIGHT);
+    const size_t begin = first_row > 0.0f ? (size_t) first_row : 0;
+    for (size_t i = begin; i < level_picker->matches_count; ++i) {
         const Vec2f current_position = vec_sum(
             level_picker->items_position,
             vec(0.0f, (float) i * ITEM_HEIGHT + level_picker->items_scroll.y));
 
-        if(current_position.y > level_picker->items_position.y + scrolling_area_height ||
-            current_position.y < level_picker->items_position.y) {
+        if (current_position.y > level_picker->items_position.y + scrolling_area_height) {
+            break;
+        }
+
+        if (current_position.y < level_picker->items_position.y) {
             continue;
         }
 
-        const char *item_text = dynarray_pointer_at(&level_picker->items, i);
+        const char *item_text = level_picker_item(level_picker, level_picker->matches[i]);
 
         sprite_font_render_text(
             &camera->font,
-            camera->renderer,
+            camera->draw_list,
             current_position,
             LEVEL_PICKER_LIST_FONT_SCALE,
             rgba(1.0f, 1.0f, 1.0f, 1.0f),
@@ -133,16 +479,47 @@ int level_picker_render(const LevelPicker *level_picker,
                     current_position,
                     LEVEL_PICKER_LIST_FONT_SCALE,
                     item_text));
-            if (SDL_SetRenderDrawColor(camera->renderer, 255, 255, 255, 255) < 0) {
-                return -1;
-            }
+            const SDL_Color white = {255, 255, 255, 255};
+            draw_list_color(camera->draw_list, white);
+            draw_list_draw_rect(camera->draw_list, boundary_box);
+        }
+    }
+
+    if (level_picker->searching || level_picker->search_query[0] != '\0') {
+        const Vec2f position = vec(
+            level_picker->items_position.x,
+            level_picker->items_position.y
+            - TITLE_MARGIN_BOTTOM * 0.5f
+            - FONT_CHAR_HEIGHT * LEVEL_PICKER_SEARCH_FONT_SCALE.y * 0.5f);
+
+        char matches[64];
+        snprintf(matches, sizeof(matches), "%zu/%zu",
+                 level_picker->matches_count, level_picker->items_count);
+        camera_render_text_screen(
+            camera,
+            matches,
+            LEVEL_PICKER_SEARCH_FONT_SCALE,
+            COLOR_WHITE,
+            vec(position.x + level_picker->items_size.x
+                - (float) strlen(matches) * FONT_CHAR_WIDTH * LEVEL_PICKER_SEARCH_FONT_SCALE.x,
+                position.y));
 
-            if (SDL_RenderDrawRect(camera->renderer, &boundary_box) < 0) {
+        if (level_picker->searching) {
+            if (edit_field_render_screen(&level_picker->search, camera, position) < 0) {
                 return -1;
             }
+        } else {
+            camera_render_text_screen(
+                camera,
+                edit_field_as_text(&level_picker->search),
+                LEVEL_PICKER_SEARCH_FONT_SCALE,
+                COLOR_WHITE,
+                position);
         }
     }
 
+    level_picker_render_preview(level_picker, camera, viewport);
+
     {
         /* CSS */
         const float padding = 20.0f;
@@ -152,7 +529,7 @@ int level_picker_render(const LevelPicker *level_picker,
         /* HTML */
         camera_render_text_screen(
             camera,
-            "Press 'N' to create new level",
+            "Press 'N' to create new level, '/' to search",
             size,
             COLOR_WHITE,
             vec(position.x + padding,
@@ -162,6 +539,18 @@ int level_picker_render(const LevelPicker *level_picker,
     return 0;
 }
 
+// The font is monospace, so the size of the list does not need the
+// boundary box of every item
+static
+Vec2f level_picker_list_size(const LevelPicker *level_picker)
+{
+    trace_assert(level_picker);
+
+    return vec(
+        (float) level_picker->items_max_length * FONT_CHAR_WIDTH * LEVEL_PICKER_LIST_FONT_SCALE.x,
+        (float) level_picker->matches_count * ITEM_HEIGHT);
+}
+
 int level_picker_update(LevelPicker *level_picker,
                         Camera *camera,
                         float delta_time)
@@ -169,7 +558,30 @@ int level_picker_update(LevelPicker *level_picker,
     trace_assert(level_picker);
 
     const Rect viewport = camera_view_port_screen(camera);
+
+    level_picker->items_size = level_picker_list_size(level_picker);
+
+    // The layout only depends on the width of the view port, so we
+    // only redo it when the window is resized.
+    if (level_picker->layout_width != viewport.w) {
+        const Vec2f title_size = wiggly_text_size(&level_picker->wiggly_text);
+        level_picker->items_position =
+            vec(viewport.w * 0.5f - level_picker->items_size.x * 0.5f,
+                TITLE_MARGIN_TOP + title_size.y + TITLE_MARGIN_BOTTOM);
+        level_picker->layout_width = viewport.w;
+    }
+
     const float scrolling_area_height = viewport.h - ITEM_HEIGHT - level_picker->items_position.y;
+    const float cursor_y = (float) level_picker->items_cursor * ITEM_HEIGHT;
+
+    // The search may move the cursor far away, scrolling there row by
+    // row would take forever
+    if (cursor_y + level_picker->items_scroll.y > 2.0f * scrolling_area_height) {
+        level_picker->items_scroll.y = scrolling_area_height - cursor_y;
+    }
+    if (cursor_y + level_picker->items_scroll.y < -scrolling_area_height) {
+        level_picker->items_scroll.y = -cursor_y;
+    }
 
     if ((float) level_picker->items_cursor * ITEM_HEIGHT + level_picker->items_scroll.y > scrolling_area_height) {
         level_picker->items_scroll.y -= ITEM_HEIGHT * SCROLLING_SPEED_FRACTION;
@@ -178,6 +590,11 @@ int level_picker_update(LevelPicker *level_picker,
         level_picker->items_scroll.y += ITEM_HEIGHT * SCROLLING_SPEED_FRACTION;
     }
 
+    if (level_picker->metadata) {
+        level_picker->metadata_version =
+            level_metadata_index_version(level_picker->metadata);
+    }
+
     vec_add(&level_picker->camera_position,
             vec(50.0f * delta_time, 0.0f));
 
@@ -188,61 +605,88 @@ int level_picker_update(LevelPicker *level_picker,
     return 0;
 }
 
-static
-Vec2f level_picker_list_size(const LevelPicker *level_picker)
+static void level_picker_stop_search(LevelPicker *level_picker)
 {
-    trace_assert(level_picker);
+    level_picker->searching = false;
+    SDL_StopTextInput();
+}
 
-    Vec2f result = vec(0.0f, 0.0f);
+// While searching every key goes into the search field except the
+// ones that move the cursor or pick the level
+static int level_picker_search_event(LevelPicker *level_picker,
+                                     const SDL_Event *event)
+{
+    switch (event->type) {
+    case SDL_KEYDOWN: {
+        switch (event->key.keysym.sym) {
+        case SDLK_ESCAPE: {
+            level_picker_stop_search(level_picker);
+            edit_field_clean(&level_picker->search);
+            level_picker_filter(level_picker);
+        } return 0;
 
-    for (size_t i = 0; i < level_picker->items.count; ++i) {
-        const char *item_text = dynarray_pointer_at(
-            &level_picker->items,
-            i);
+        case SDLK_RETURN: {
+            level_picker_stop_search(level_picker);
+        } return 1;
 
-        Rect boundary_box = sprite_font_boundary_box(
-            vec(0.0f, 0.0f),
-            LEVEL_PICKER_LIST_FONT_SCALE,
-            item_text);
+        case SDLK_UP: {
+            level_picker_cursor_up(level_picker);
+        } return 0;
+
+        case SDLK_DOWN: {
+            level_picker_cursor_down(level_picker);
+        } return 0;
+        }
+    } /* fall through */
 
-        result.x = fmaxf(result.x, boundary_box.w);
-        result.y += boundary_box.h + LEVEL_PICKER_LIST_PADDING_BOTTOM;
+    case SDL_TEXTINPUT: {
+        if (edit_field_event(&level_picker->search, event) < 0) {
+            return -1;
+        }
+        level_picker_filter(level_picker);
+    } return 0;
     }
 
-    return result;
+    return 1;
 }
 
-
 int level_picker_event(LevelPicker *level_picker,
                        const SDL_Event *event)
 {
     trace_assert(level_picker);
     trace_assert(event);
 
-    switch (event->type) {
-    case SDL_WINDOWEVENT: {
-        switch (event->window.event) {
-        case SDL_WINDOWEVENT_SHOWN:
-        case SDL_WINDOWEVENT_SIZE_CHANGED: {
-            int width;
-            SDL_GetRendererOutputSize(SDL_GetRenderer(SDL_GetWindowFromID(event->window.windowID)), &width, NULL);
-            const Vec2f title_size = wiggly_text_size(&level_picker->wiggly_text);
-            level_picker->items_size = level_picker_list_size(level_picker);
-
-            level_picker->items_position =
-                vec((float)width * 0.5f - level_picker->items_size.x * 0.5f,
-                    TITLE_MARGIN_TOP + title_size.y + TITLE_MARGIN_BOTTOM);
-        } break;
+    if (level_picker->searching) {
+        // 1 means the event is not for the search field
+        const int result = level_picker_search_event(level_picker, event);
+        if (result <= 0) {
+            return result;
         }
-    } break;
+    }
 
+    switch (event->type) {
     case SDL_KEYDOWN: {
         switch (event->key.keysym.sym) {
         case SDLK_RETURN: {
-            if (level_picker->items_cursor < level_picker->items.count) {
-                level_picker->selected_item = (int) level_picker->items_cursor;
+            if (level_picker->items_cursor < level_picker->matches_count) {
+                level_picker->selected_item =
+                    (int) level_picker->matches[level_picker->items_cursor];
             }
         } break;
+
+        case SDLK_ESCAPE: {
+            edit_field_clean(&level_picker->search);
+            level_picker_filter(level_picker);
+        } break;
+        }
+    } break;
+
+    case SDL_KEYUP: {
+        // Not on the key down, so the slash does not end up in the
+        // search field
+        if (event->key.keysym.sym == SDLK_SLASH && !level_picker->searching) {
+            level_picker->searching = true;
+            SDL_StartTextInput();
         }
     } break;
 
@@ -258,25 +702,25 @@ int level_picker_event(LevelPicker *level_picker,
         switch (event->button.button) {
         case SDL_BUTTON_LEFT: {
             const Vec2f mouse_pos = vec((float) event->button.x, (float) event->button.y);
-            Vec2f position = vec_sum(
+            const Vec2f position = vec_sum(
                 level_picker->items_position,
                 level_picker->items_scroll);
 
-            for (size_t i = 0; i < level_picker->items.count; ++i) {
-                const char *item_text = dynarray_pointer_at(
-                    &level_picker->items,
-                    i);
-
-                Rect boundary_box = sprite_font_boundary_box(
-                    position,
-                    LEVEL_PICKER_LIST_FONT_SCALE,
-                    item_text);
+            // All the rows have the same height, so the row under the
+            // mouse is found right away
+            const float row = floorf((mouse_pos.y - position.y) / ITEM_HEIGHT);
+            if (row < 0.0f || row >= (float) level_picker->matches_count) {
+                break;
+            }
+            const size_t i = (size_t) row;
 
-                if (rect_contains_point(boundary_box, mouse_pos)) {
-                    level_picker->items_cursor = i;
-                }
+            const Rect boundary_box = sprite_font_boundary_box(
+                vec(position.x, position.y + (float) i * ITEM_HEIGHT),
+                LEVEL_PICKER_LIST_FONT_SCALE,
+                level_picker_item(level_picker, level_picker->matches[i]));
 
-                position.y += boundary_box.h + LEVEL_PICKER_LIST_PADDING_BOTTOM;
+            if (rect_contains_point(boundary_box, mouse_pos)) {
+                level_picker->items_cursor = i;
             }
         } break;
         }
@@ -288,7 +732,7 @@ int level_picker_event(LevelPicker *level_picker,
             // check if the click position was actually inside...
             // note: make sure there's actually stuff in the list! tsoding likes
             // to remove all levels and change title to "SMOL BREAK"...
-            if (level_picker->items.count == 0)
+            if (level_picker->matches_count == 0)
                 break;
 
             // note: this assumes that all list items are the same height!
@@ -301,10 +745,9 @@ int level_picker_event(LevelPicker *level_picker,
                 level_picker->items_scroll);
             vec_add(&position, vec(0.0f, (float) level_picker->items_cursor * single_item_height));
 
-            const char *item_text =
-                dynarray_pointer_at(
-                    &level_picker->items,
-                    level_picker->items_cursor);
+            const char *item_text = level_picker_item(
+                level_picker,
+                level_picker->matches[level_picker->items_cursor]);
 
             Rect boundary_box = sprite_font_boundary_box(
                 position,
@@ -313,7 +756,8 @@ int level_picker_event(LevelPicker *level_picker,
 
             const Vec2f mouse_pos = vec((float) event->motion.x, (float) event->motion.y);
             if (rect_contains_point(boundary_box, mouse_pos)) {
-                level_picker->selected_item = (int) level_picker->items_cursor;
+                level_picker->selected_item =
+                    (int) level_picker->matches[level_picker->items_cursor];
             }
         } break;
         }
@@ -341,9 +785,20 @@ const char *level_picker_selected_level(const LevelPicker *level_picker)
         return NULL;
     }
 
-    return dynarray_pointer_at(
-        &level_picker->items,
-        (size_t)level_picker->selected_item);
+    return level_picker_item(level_picker, (size_t) level_picker->selected_item);
+}
+
+const char *level_picker_cursor_level(const LevelPicker *level_picker)
+{
+    trace_assert(level_picker);
+
+    if (level_picker->items_cursor >= level_picker->matches_count) {
+        return NULL;
+    }
+
+    return level_picker_item(
+        level_picker,
+        level_picker->matches[level_picker->items_cursor]);
 }
 
 void level_picker_clean_selection(LevelPicker *level_picker)
@@ -370,7 +825,7 @@ void level_picker_cursor_up(LevelPicker *level_picker)
 void level_picker_cursor_down(LevelPicker *level_picker)
 {
     trace_assert(level_picker);
-    if (level_picker->items_cursor + 1 < level_picker->items.count) {
+    if (level_picker->items_cursor + 1 < level_picker->matches_count) {
         level_picker->items_cursor++;
     }
 }
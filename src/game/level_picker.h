@@ -1,23 +1,59 @@
 #ifndef LEVEL_PICKER_H_
 #define LEVEL_PICKER_H_
 
+#include <stdbool.h>
+
 #include <SDL.h>
 
 #include "game/camera.h"
 #include "game/level/background.h"
+#include "game/level_metadata.h"
+#include "ui/edit_field.h"
 #include "ui/wiggly_text.h"
-#include "dynarray.h"
 
 typedef struct {
     Background background;
     Vec2f camera_position;
     WigglyText wiggly_text;
-    Dynarray items;
+
+    // Every level of the folder, METADATA_FILEPATH_MAX_SIZE bytes per
+    // path
+    char *items;
+    size_t items_count;
+    size_t items_capacity;
+    // The longest path, so the layout does not walk the items
+    size_t items_max_length;
+
+    // The lower case file names of the items the search runs on, one
+    // after another, each terminated with zero
+    char *search_keys;
+    size_t search_keys_size;
+    size_t search_keys_capacity;
+    size_t *search_key_offsets;
+    // The items matching the search in the folder order. The list
+    // shows only them and the cursor moves over them.
+    size_t *matches;
+    size_t matches_count;
+    // The lower case query the matches are for
+    char search_query[EDIT_FIELD_CAPACITY + 1];
+    Edit_field search;
+    bool searching;
+
+    // Index into the matches
     size_t items_cursor;
+    // Index into the items
     int selected_item;
     Vec2f items_scroll;
     Vec2f items_position;
     Vec2f items_size;
+    float layout_width;
+    // NULL when the index could not be created. The picker works
+    // without the metadata then.
+    LevelMetadataIndex *metadata;
+    // The version of the index at the last update, changes when the
+    // preview has to be redrawn
+    size_t metadata_version;
+    char dirpath[METADATA_FILEPATH_MAX_SIZE];
 } LevelPicker;
 
 // TODO(#1221): Level Picker scroll does not support mouse wheel
@@ -25,12 +61,11 @@ typedef struct {
 
 void level_picker_populate(LevelPicker *level_picker,
                            const char *dirpath);
-
-static inline
-void destroy_level_picker(LevelPicker level_picker)
-{
-    free(level_picker.items.data);
-}
+void destroy_level_picker(LevelPicker level_picker);
+// The file name of the folder was written or removed (see
+// FileWatcher). Updates the list without rescanning the folder.
+void level_picker_file_written(LevelPicker *level_picker, const char *file_name);
+void level_picker_file_removed(LevelPicker *level_picker, const char *file_name);
 
 int level_picker_render(const LevelPicker *level_picker,
                         const Camera *camera);
@@ -48,6 +83,8 @@ void level_picker_cursor_up(LevelPicker *level_picker);
 void level_picker_cursor_down(LevelPicker *level_picker);
 
 const char *level_picker_selected_level(const LevelPicker *level_picker);
+// The level the cursor is on. NULL when there are no levels.
+const char *level_picker_cursor_level(const LevelPicker *level_picker);
 void level_picker_clean_selection(LevelPicker *level_picker);
 
 
@@ -0,0 +1,182 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "config.h"
+#include "game/level_preloader.h"
+#include "system/log.h"
+#include "system/lt.h"
+#include "system/nth_alloc.h"
+#include "system/stacktrace.h"
+
+struct LevelPreloader
+{
+    Lt *lt;
+    SDL_Thread *thread;
+    // Only touched by the background thread
+    Memory staging;
+
+    SDL_mutex *mutex;
+    SDL_cond *requested_cond;
+    SDL_cond *built_cond;
+
+    // Everything below is guarded by the mutex
+    //
+    // The file the preload is for. Empty when there is none.
+    char file_name[METADATA_FILEPATH_MAX_SIZE];
+    bool requested;
+    bool building;
+    Level *level;
+    bool quit;
+};
+
+static int level_preloader_run(void *data)
+{
+    LevelPreloader *preloader = data;
+    char file_name[METADATA_FILEPATH_MAX_SIZE];
+
+    SDL_LockMutex(preloader->mutex);
+    while (!preloader->quit) {
+        if (!preloader->requested) {
+            SDL_CondWait(preloader->requested_cond, preloader->mutex);
+            continue;
+        }
+
+        memcpy(file_name, preloader->file_name, METADATA_FILEPATH_MAX_SIZE);
+        preloader->requested = false;
+        preloader->building = true;
+        SDL_UnlockMutex(preloader->mutex);
+
+        memory_clean(&preloader->staging);
+        Level *level = create_level_from_file(file_name, &preloader->staging);
+        memory_clean(&preloader->staging);
+
+        SDL_LockMutex(preloader->mutex);
+        preloader->building = false;
+        if (preloader->requested || strcmp(file_name, preloader->file_name) != 0) {
+            // The cursor moved on while the level was being built
+            if (level) {
+                destroy_level(level);
+            }
+        } else {
+            preloader->level = level;
+        }
+        SDL_CondBroadcast(preloader->built_cond);
+    }
+    SDL_UnlockMutex(preloader->mutex);
+
+    return 0;
+}
+
+LevelPreloader *create_level_preloader(void)
+{
+    Lt *lt = create_lt();
+
+    LevelPreloader *preloader = PUSH_LT(lt, nth_calloc(1, sizeof(LevelPreloader)), free);
+    if (preloader == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+    preloader->lt = lt;
+
+    preloader->staging.capacity = LEVEL_EDITOR_MEMORY_CAPACITY;
+    preloader->staging.buffer = PUSH_LT(
+        lt,
+        nth_calloc(LEVEL_EDITOR_MEMORY_CAPACITY, sizeof(uint8_t)),
+        free);
+    if (preloader->staging.buffer == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    preloader->mutex = PUSH_LT(lt, SDL_CreateMutex(), SDL_DestroyMutex);
+    if (preloader->mutex == NULL) {
+        log_fail("SDL_CreateMutex: %s\n", SDL_GetError());
+        RETURN_LT(lt, NULL);
+    }
+
+    preloader->requested_cond = PUSH_LT(lt, SDL_CreateCond(), SDL_DestroyCond);
+    if (preloader->requested_cond == NULL) {
+        log_fail("SDL_CreateCond: %s\n", SDL_GetError());
+        RETURN_LT(lt, NULL);
+    }
+
+    preloader->built_cond = PUSH_LT(lt, SDL_CreateCond(), SDL_DestroyCond);
+    if (preloader->built_cond == NULL) {
+        log_fail("SDL_CreateCond: %s\n", SDL_GetError());
+        RETURN_LT(lt, NULL);
+    }
+
+    preloader->thread = SDL_CreateThread(level_preloader_run, "level preloader", preloader);
+    if (preloader->thread == NULL) {
+        log_fail("Could not create the level preloader thread: %s\n", SDL_GetError());
+        RETURN_LT(lt, NULL);
+    }
+
+    return preloader;
+}
+
+void destroy_level_preloader(LevelPreloader *preloader)
+{
+    trace_assert(preloader);
+
+    SDL_LockMutex(preloader->mutex);
+    preloader->quit = true;
+    SDL_CondSignal(preloader->requested_cond);
+    SDL_UnlockMutex(preloader->mutex);
+
+    SDL_WaitThread(preloader->thread, NULL);
+
+    if (preloader->level) {
+        destroy_level(preloader->level);
+    }
+
+    memory_clean(&preloader->staging);
+
+    RETURN_LT0(preloader->lt);
+}
+
+void level_preloader_request(LevelPreloader *preloader, const char *file_name)
+{
+    trace_assert(preloader);
+    trace_assert(file_name);
+
+    Level *stale = NULL;
+
+    SDL_LockMutex(preloader->mutex);
+    if (strcmp(file_name, preloader->file_name) != 0) {
+        snprintf(preloader->file_name, METADATA_FILEPATH_MAX_SIZE, "%s", file_name);
+        stale = preloader->level;
+        preloader->level = NULL;
+        preloader->requested = true;
+        SDL_CondSignal(preloader->requested_cond);
+    }
+    SDL_UnlockMutex(preloader->mutex);
+
+    if (stale) {
+        destroy_level(stale);
+    }
+}
+
+Level *level_preloader_take(LevelPreloader *preloader, const char *file_name)
+{
+    trace_assert(preloader);
+    trace_assert(file_name);
+
+    Level *level = NULL;
+
+    SDL_LockMutex(preloader->mutex);
+    if (strcmp(file_name, preloader->file_name) == 0) {
+        while (preloader->level == NULL && (preloader->requested || preloader->building)) {
+            SDL_CondWait(preloader->built_cond, preloader->mutex);
+        }
+
+        level = preloader->level;
+        preloader->level = NULL;
+        // The next request of the same file preloads it again
+        preloader->file_name[0] = '\0';
+    }
+    SDL_UnlockMutex(preloader->mutex);
+
+    return level;
+}
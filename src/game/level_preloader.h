@@ -0,0 +1,21 @@
+#ifndef LEVEL_PRELOADER_H_
+#define LEVEL_PRELOADER_H_
+
+#include "game/level.h"
+
+// Builds the level the cursor of the level picker is on in the
+// background, so picking it does not block the frame
+typedef struct LevelPreloader LevelPreloader;
+
+LevelPreloader *create_level_preloader(void);
+void destroy_level_preloader(LevelPreloader *preloader);
+
+// Starts preloading file_name unless it is already being preloaded.
+// The preload of any other file is cancelled.
+void level_preloader_request(LevelPreloader *preloader, const char *file_name);
+// Gives away the preloaded level of file_name. Waits for it if it is
+// still being built. NULL if file_name was not requested or could not
+// be loaded.
+Level *level_preloader_take(LevelPreloader *preloader, const char *file_name);
+
+#endif  // LEVEL_PRELOADER_H_
@@ -0,0 +1,176 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "config.h"
+#include "game/level_reloader.h"
+#include "system/log.h"
+#include "system/lt.h"
+#include "system/nth_alloc.h"
+#include "system/stacktrace.h"
+
+struct LevelReloader
+{
+    Lt *lt;
+    SDL_Thread *thread;
+    // Holds the parsed level file until it is released
+    Memory staging;
+
+    SDL_mutex *mutex;
+    SDL_cond *cond;
+
+    // Everything below is guarded by the mutex
+    char requested_file_name[METADATA_FILEPATH_MAX_SIZE];
+    bool requested;
+    char parsed_file_name[METADATA_FILEPATH_MAX_SIZE];
+    LevelFile parsed;
+    bool ready;
+    // Taken by the main thread and not released yet
+    bool taken;
+    bool quit;
+};
+
+static int level_reloader_run(void *data)
+{
+    LevelReloader *reloader = data;
+    char file_name[METADATA_FILEPATH_MAX_SIZE];
+
+    SDL_LockMutex(reloader->mutex);
+    while (!reloader->quit) {
+        // The staging memory belongs to the parsed level file until
+        // it is released
+        if (!reloader->requested || reloader->ready) {
+            SDL_CondWait(reloader->cond, reloader->mutex);
+            continue;
+        }
+
+        memcpy(file_name, reloader->requested_file_name, METADATA_FILEPATH_MAX_SIZE);
+        reloader->requested = false;
+        SDL_UnlockMutex(reloader->mutex);
+
+        LevelFile level_file;
+        memory_clean(&reloader->staging);
+        const int result = level_file_load(&level_file, &reloader->staging, file_name);
+
+        SDL_LockMutex(reloader->mutex);
+        if (result < 0) {
+            log_warn("Could not reload level %s\n", file_name);
+        } else if (reloader->requested &&
+                   strcmp(file_name, reloader->requested_file_name) == 0) {
+            // The file was changed once again while it was parsed
+            level_file_unload(&level_file);
+        } else {
+            memcpy(reloader->parsed_file_name, file_name, METADATA_FILEPATH_MAX_SIZE);
+            reloader->parsed = level_file;
+            reloader->ready = true;
+        }
+    }
+    SDL_UnlockMutex(reloader->mutex);
+
+    return 0;
+}
+
+LevelReloader *create_level_reloader(void)
+{
+    Lt *lt = create_lt();
+
+    LevelReloader *reloader = PUSH_LT(lt, nth_calloc(1, sizeof(LevelReloader)), free);
+    if (reloader == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+    reloader->lt = lt;
+
+    reloader->staging.capacity = LEVEL_EDITOR_MEMORY_CAPACITY;
+    reloader->staging.buffer = PUSH_LT(
+        lt,
+        nth_calloc(LEVEL_EDITOR_MEMORY_CAPACITY, sizeof(uint8_t)),
+        free);
+    if (reloader->staging.buffer == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    reloader->mutex = PUSH_LT(lt, SDL_CreateMutex(), SDL_DestroyMutex);
+    if (reloader->mutex == NULL) {
+        log_fail("SDL_CreateMutex: %s\n", SDL_GetError());
+        RETURN_LT(lt, NULL);
+    }
+
+    reloader->cond = PUSH_LT(lt, SDL_CreateCond(), SDL_DestroyCond);
+    if (reloader->cond == NULL) {
+        log_fail("SDL_CreateCond: %s\n", SDL_GetError());
+        RETURN_LT(lt, NULL);
+    }
+
+    reloader->thread = SDL_CreateThread(level_reloader_run, "level reloader", reloader);
+    if (reloader->thread == NULL) {
+        log_fail("Could not create the level reloader thread: %s\n", SDL_GetError());
+        RETURN_LT(lt, NULL);
+    }
+
+    return reloader;
+}
+
+void destroy_level_reloader(LevelReloader *reloader)
+{
+    trace_assert(reloader);
+
+    SDL_LockMutex(reloader->mutex);
+    reloader->quit = true;
+    SDL_CondSignal(reloader->cond);
+    SDL_UnlockMutex(reloader->mutex);
+
+    SDL_WaitThread(reloader->thread, NULL);
+
+    if (reloader->ready) {
+        level_file_unload(&reloader->parsed);
+    }
+
+    memory_clean(&reloader->staging);
+
+    RETURN_LT0(reloader->lt);
+}
+
+void level_reloader_request(LevelReloader *reloader, const char *file_name)
+{
+    trace_assert(reloader);
+    trace_assert(file_name);
+
+    SDL_LockMutex(reloader->mutex);
+    snprintf(reloader->requested_file_name, METADATA_FILEPATH_MAX_SIZE, "%s", file_name);
+    reloader->requested = true;
+    SDL_CondSignal(reloader->cond);
+    SDL_UnlockMutex(reloader->mutex);
+}
+
+const LevelFile *level_reloader_take(LevelReloader *reloader, const char **file_name)
+{
+    trace_assert(reloader);
+    trace_assert(file_name);
+
+    const LevelFile *result = NULL;
+
+    SDL_LockMutex(reloader->mutex);
+    if (reloader->ready && !reloader->taken) {
+        reloader->taken = true;
+        *file_name = reloader->parsed_file_name;
+        result = &reloader->parsed;
+    }
+    SDL_UnlockMutex(reloader->mutex);
+
+    return result;
+}
+
+void level_reloader_release(LevelReloader *reloader)
+{
+    trace_assert(reloader);
+
+    SDL_LockMutex(reloader->mutex);
+    trace_assert(reloader->taken);
+    level_file_unload(&reloader->parsed);
+    reloader->taken = false;
+    reloader->ready = false;
+    SDL_CondSignal(reloader->cond);
+    SDL_UnlockMutex(reloader->mutex);
+}
@@ -0,0 +1,24 @@
+#ifndef LEVEL_RELOADER_H_
+#define LEVEL_RELOADER_H_
+
+#include "game/level/level_file.h"
+
+// Parses the level files that were changed on disk in the background,
+// so the running level and the level editor can pick up the changes
+// without blocking the frame
+typedef struct LevelReloader LevelReloader;
+
+LevelReloader *create_level_reloader(void);
+void destroy_level_reloader(LevelReloader *reloader);
+
+// Starts parsing file_name. A request that was not picked up yet is
+// replaced by it.
+void level_reloader_request(LevelReloader *reloader, const char *file_name);
+// Never blocks. The parsed file or NULL if there is none yet. The
+// level file stays valid until level_reloader_release() and nothing
+// else is parsed meanwhile. file_name is set to the name it was
+// requested with.
+const LevelFile *level_reloader_take(LevelReloader *reloader, const char **file_name);
+void level_reloader_release(LevelReloader *reloader);
+
+#endif  // LEVEL_RELOADER_H_
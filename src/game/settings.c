@@ -32,7 +32,7 @@ void settings_render(const Settings *settings, const Camera *camera)
     trace_assert(settings);
     trace_assert(camera);
 
-    background_render(&settings->background, camera);
+    background_render(&settings->background, camera, NULL);
 
     const Rect viewport = camera_view_port_screen(camera);
 
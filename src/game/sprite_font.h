@@ -4,19 +4,20 @@
 #include "color.h"
 #include "math/vec.h"
 #include "math/rect.h"
+#include "sdl/draw_list.h"
 
 #define FONT_CHAR_WIDTH 7
 #define FONT_CHAR_HEIGHT 9
 
 typedef struct {
     SDL_Texture *texture;
+    SDL_Surface *surface;
+    // Where the charmap is within the texture (see sdl/atlas.h)
+    SDL_Rect charmap;
 } Sprite_font;
 
-SDL_Texture *load_bmp_font_texture(SDL_Renderer *renderer,
-                                   const char *bmp_file_path);
-
 void sprite_font_render_text(const Sprite_font *sprite_font,
-                             SDL_Renderer *renderer,
+                             DrawList *draw_list,
                              Vec2f position,
                              Vec2f size,
                              Color color,
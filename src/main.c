@@ -9,6 +9,8 @@
 #include "game.h"
 #include "game/level/platforms.h"
 #include "game/level/player.h"
+#include "game/level/level_editor.h"
+#include "game/level/level_editor/level_load_bench.h"
 #include "game/sound_samples.h"
 #include "game/sprite_font.h"
 #include "math/extrema.h"
@@ -16,15 +18,42 @@
 #include "sdl/renderer.h"
 #include "system/log.h"
 #include "system/lt.h"
+#include "system/frame_scheduler.h"
+#include "system/render_scaler.h"
+#include "sdl/draw_list.h"
+#include "sdl/event_queue.h"
+#include "sdl/raster.h"
 
 #define SCREEN_WIDTH 800
 #define SCREEN_HEIGHT 600
 
+#define SIMULATION_FPS 60
+// How many simulation steps we are allowed to catch up in a single
+// frame before we start dropping time on the floor
+#define SIMULATION_MAX_STEPS 5
+
+#define HEADLESS_DEFAULT_FRAMES 600
+#define HEADLESS_DUMP_CAPACITY 64
+
 static void print_usage(FILE *stream)
 {
-    fprintf(stream, "Usage: nothing [--fps <fps>]\n");
+    fprintf(stream, "Usage: nothing [--fps <fps>] [--uncapped] [--threaded] [--raster] [--render-scale <fraction>|auto]\n");
+    fprintf(stream, "       nothing --headless <level-file> [--raster] [--frames <n>] [--dump <frame>]... [--dump-prefix <prefix>]\n");
+    fprintf(stream, "       nothing --bench-load\n");
+    fprintf(stream, "       nothing --convert-level <input> <output>    (<output> ending with .bin is saved in the binary format, with .sectors.bin in the sectored one)\n");
 }
 
+// Headless mode renders a level without a display into an
+// SDL_Surface with the software renderer. Used for the render
+// performance regression tests on CI.
+typedef struct {
+    const char *level_file;
+    int frames;
+    int dumps[HEADLESS_DUMP_CAPACITY];
+    size_t dumps_count;
+    const char *dump_prefix;
+} Headless;
+
 static float current_display_scale = 1.0f;
 
 
@@ -77,6 +106,372 @@ void maybe_fixup_input_for_display_scale(SDL_Window* win, SDL_Renderer* rend, SD
 }
 
 
+// With --threaded the simulation runs on its own thread and only
+// talks to the render thread (the main one, which owns the window and
+// the renderer) through the event queue and the draw list buffer.
+//
+// The editor still reads the keyboard state, starts and stops the
+// text input and uses the clipboard right from the simulation, which
+// SDL only allows on the main thread, so the simulation runs on the
+// main thread by default.
+typedef struct {
+    Game *game;
+    EventQueue *events;
+    DrawList draw_list;
+    DrawListBuffer frames;
+    FrameScheduler scheduler;
+    float simulation_time;
+
+    // Software rasteriser used instead of replaying the draw lists
+    // through SDL, or NULL. Owned by the render thread.
+    Raster *raster;
+    // Offscreen target of the world pass. Owned by the render thread.
+    DrawTarget target;
+
+    RenderScaler scaler;
+    // How long the last frame took to render in microseconds, 0 when
+    // the simulation has already seen it
+    SDL_atomic_t render_time;
+
+    // Copy of the keyboard state the event queue got from the thread
+    // that pumps the events, taken at every step
+    Uint8 keyboard_state[SDL_NUM_SCANCODES];
+    SDL_Joystick *the_stick_of_joy;
+
+    // Custom SDL event type that wakes up the render thread when a
+    // new frame is published or the simulation is over
+    Uint32 frame_event;
+    SDL_atomic_t frame_event_pending;
+    SDL_atomic_t done;
+} Simulation;
+
+static
+void simulation_wake_renderer(Simulation *simulation)
+{
+    if (SDL_AtomicCAS(&simulation->frame_event_pending, 0, 1)) {
+        SDL_Event event;
+        memset(&event, 0, sizeof(event));
+        event.type = simulation->frame_event;
+        if (SDL_PushEvent(&event) < 0) {
+            log_warn("Could not wake up the render thread: %s\n", SDL_GetError());
+        }
+    }
+}
+
+static
+int simulation_step(Simulation *simulation)
+{
+    trace_assert(simulation);
+
+    Game *game = simulation->game;
+    const float simulation_dt = 1.0f / (float) SIMULATION_FPS;
+
+    simulation->simulation_time = fminf(
+        simulation->simulation_time + frame_scheduler_begin(&simulation->scheduler),
+        simulation_dt * SIMULATION_MAX_STEPS);
+
+    simulation->draw_list.view_port = event_queue_view_port(simulation->events);
+
+    const int render_time = SDL_AtomicSet(&simulation->render_time, 0);
+    if (render_time > 0) {
+        render_scaler_push(&simulation->scaler, (float) render_time * 1e-6f);
+    }
+    simulation->draw_list.render_scale = simulation->scaler.scale;
+
+    SDL_Event e;
+    while (!game_over_check(game) && event_queue_pop(simulation->events, &e)) {
+        if (game_event(game, &e) < 0) {
+            return -1;
+        }
+    }
+
+    event_queue_keyboard_state(simulation->events, simulation->keyboard_state);
+    for (; simulation->simulation_time >= simulation_dt; simulation->simulation_time -= simulation_dt) {
+        if (game_input(game, simulation->keyboard_state, simulation->the_stick_of_joy) < 0) {
+            return -1;
+        }
+
+        if (game_update(game, simulation_dt) < 0) {
+            return -1;
+        }
+    }
+
+    if (game_sound(game) < 0) {
+        return -1;
+    }
+
+    if (game_needs_render(game)) {
+        if (game_render(game) < 0) {
+            return -1;
+        }
+        game_mark_rendered(game);
+        draw_list_buffer_publish(&simulation->frames, &simulation->draw_list);
+        simulation_wake_renderer(simulation);
+    }
+
+    return 0;
+}
+
+static
+int simulation_run(void *data)
+{
+    Simulation *simulation = data;
+    trace_assert(simulation);
+
+    int result = 0;
+
+    frame_scheduler_reset(&simulation->scheduler);
+    while (!game_over_check(simulation->game) &&
+           !event_queue_quit_check(simulation->events)) {
+        // Nothing on the screen is going to change until the next
+        // input event, so block on the event queue instead of spinning.
+        if (game_idle_check(simulation->game)) {
+            event_queue_wait(simulation->events, RENDER_ON_DEMAND_WAIT_TIMEOUT);
+            frame_scheduler_reset(&simulation->scheduler);
+        }
+
+        if (simulation_step(simulation) < 0) {
+            result = -1;
+            break;
+        }
+
+        frame_scheduler_wait(&simulation->scheduler);
+    }
+
+    SDL_AtomicSet(&simulation->done, 1);
+    simulation_wake_renderer(simulation);
+
+    return result;
+}
+
+static
+int present_frame(Simulation *simulation,
+                  const DrawList *frame,
+                  SDL_Renderer *renderer)
+{
+    const Uint64 begin = SDL_GetPerformanceCounter();
+
+    if (simulation->raster) {
+        if (raster_render(simulation->raster, frame, renderer) < 0) {
+            return -1;
+        }
+    } else {
+        if (draw_list_render_scaled(frame, renderer, &simulation->target) < 0) {
+            return -1;
+        }
+    }
+
+    const Uint64 render_time =
+        (SDL_GetPerformanceCounter() - begin) * 1000000 / SDL_GetPerformanceFrequency();
+    SDL_AtomicSet(&simulation->render_time, (int) (render_time > 0 ? render_time : 1));
+
+    SDL_RenderPresent(renderer);
+
+    return 0;
+}
+
+static
+void forward_event(Simulation *simulation,
+                   SDL_Window *window,
+                   SDL_Renderer *renderer,
+                   SDL_Event *e)
+{
+    // this function potentially fixes mouse events by scaling them according
+    // to the window DPI scale. (eg. *2 on retina displays). it also updates
+    // the cached DPI scale on window scale/move events.
+    maybe_fixup_input_for_display_scale(window, renderer, e);
+
+    if (e->type == SDL_WINDOWEVENT) {
+        SDL_Rect view_port;
+        SDL_RenderGetViewport(renderer, &view_port);
+        event_queue_set_view_port(simulation->events, view_port);
+    }
+
+    event_queue_push(simulation->events, e);
+}
+
+static
+int render_thread_run(Simulation *simulation,
+                      SDL_Window *window,
+                      SDL_Renderer *renderer)
+{
+    SDL_Thread *simulation_thread = SDL_CreateThread(simulation_run, "simulation", simulation);
+    if (simulation_thread == NULL) {
+        log_fail("Could not create the simulation thread: %s\n", SDL_GetError());
+        return -1;
+    }
+
+    int result = 0;
+    SDL_Event e;
+    while (!SDL_AtomicGet(&simulation->done)) {
+        if (!SDL_WaitEvent(&e)) {
+            log_fail("SDL_WaitEvent: %s\n", SDL_GetError());
+            result = -1;
+            break;
+        }
+
+        do {
+            if (e.type == simulation->frame_event) {
+                SDL_AtomicSet(&simulation->frame_event_pending, 0);
+            } else {
+                forward_event(simulation, window, renderer, &e);
+            }
+        } while (SDL_PollEvent(&e));
+        event_queue_set_keyboard_state(simulation->events, SDL_GetKeyboardState(NULL));
+
+        const DrawList *frame = draw_list_buffer_acquire(&simulation->frames);
+        if (frame != NULL && present_frame(simulation, frame, renderer) < 0) {
+            result = -1;
+            break;
+        }
+    }
+
+    event_queue_quit(simulation->events);
+
+    int simulation_result = 0;
+    SDL_WaitThread(simulation_thread, &simulation_result);
+
+    return result < 0 ? result : simulation_result;
+}
+
+static
+int single_thread_run(Simulation *simulation,
+                      SDL_Window *window,
+                      SDL_Renderer *renderer)
+{
+    SDL_Event e;
+
+    frame_scheduler_reset(&simulation->scheduler);
+    while (!game_over_check(simulation->game)) {
+        if (game_idle_check(simulation->game)) {
+            if (SDL_WaitEventTimeout(&e, RENDER_ON_DEMAND_WAIT_TIMEOUT)) {
+                forward_event(simulation, window, renderer, &e);
+            }
+            frame_scheduler_reset(&simulation->scheduler);
+        }
+
+        while (SDL_PollEvent(&e)) {
+            forward_event(simulation, window, renderer, &e);
+        }
+        event_queue_set_keyboard_state(simulation->events, SDL_GetKeyboardState(NULL));
+
+        if (simulation_step(simulation) < 0) {
+            return -1;
+        }
+
+        const DrawList *frame = draw_list_buffer_acquire(&simulation->frames);
+        if (frame != NULL && present_frame(simulation, frame, renderer) < 0) {
+            return -1;
+        }
+
+        frame_scheduler_wait(&simulation->scheduler);
+    }
+
+    return 0;
+}
+
+static
+int headless_dump_check(const Headless *headless, int frame)
+{
+    for (size_t i = 0; i < headless->dumps_count; ++i) {
+        if (headless->dumps[i] == frame) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static
+int headless_run(Simulation *simulation,
+                 const Headless *headless,
+                 SDL_Renderer *renderer,
+                 SDL_Surface *surface)
+{
+    Game *game = simulation->game;
+    const float simulation_dt = 1.0f / (float) SIMULATION_FPS;
+
+    if (game_load_level(game, headless->level_file) < 0) {
+        return -1;
+    }
+
+    if (!game_level_check(game)) {
+        log_fail("Could not load level %s\n", headless->level_file);
+        return -1;
+    }
+
+    FrameStats update_stats;
+    FrameStats record_stats;
+    FrameStats replay_stats;
+    memset(&update_stats, 0, sizeof(update_stats));
+    memset(&record_stats, 0, sizeof(record_stats));
+    memset(&replay_stats, 0, sizeof(replay_stats));
+    DrawStats draw_stats;
+    memset(&draw_stats, 0, sizeof(draw_stats));
+
+    const double frequency = (double) SDL_GetPerformanceFrequency();
+    const Uint64 begin = SDL_GetPerformanceCounter();
+
+    for (int frame = 0; frame < headless->frames && !game_over_check(game); ++frame) {
+        const Uint64 t0 = SDL_GetPerformanceCounter();
+
+        if (game_input(game, simulation->keyboard_state, NULL) < 0) {
+            return -1;
+        }
+
+        if (game_update(game, simulation_dt) < 0) {
+            return -1;
+        }
+
+        const Uint64 t1 = SDL_GetPerformanceCounter();
+
+        simulation->draw_list.render_scale = simulation->scaler.scale;
+        if (game_render(game) < 0) {
+            return -1;
+        }
+        game_mark_rendered(game);
+
+        const Uint64 t2 = SDL_GetPerformanceCounter();
+
+        if (present_frame(simulation, &simulation->draw_list, renderer) < 0) {
+            return -1;
+        }
+        draw_list_reset(&simulation->draw_list);
+
+        const Uint64 t3 = SDL_GetPerformanceCounter();
+
+        frame_stats_push(&update_stats, (float) ((double) (t1 - t0) / frequency));
+        frame_stats_push(&record_stats, (float) ((double) (t2 - t1) / frequency));
+        frame_stats_push(&replay_stats, (float) ((double) (t3 - t2) / frequency));
+        render_scaler_push(&simulation->scaler, (float) ((double) (t3 - t2) / frequency));
+        draw_stats_add(&draw_stats, game_draw_stats(game));
+
+        if (headless_dump_check(headless, frame)) {
+            char filepath[METADATA_FILEPATH_MAX_SIZE];
+            snprintf(filepath, METADATA_FILEPATH_MAX_SIZE,
+                     "%s%05d.bmp", headless->dump_prefix, frame);
+
+            if (SDL_SaveBMP(surface, filepath) < 0) {
+                log_fail("Could not save frame %d to %s: %s\n", frame, filepath, SDL_GetError());
+                return -1;
+            }
+            log_info("Saved frame %d to %s\n", frame, filepath);
+        }
+    }
+
+    const double total = (double) (SDL_GetPerformanceCounter() - begin) / frequency;
+    log_info("Rendered %lu frames of %s in %.3fs (%.1f fps)\n",
+             (unsigned long) update_stats.total_count,
+             headless->level_file,
+             total,
+             (double) update_stats.total_count / total);
+    frame_stats_log(&update_stats, "Update");
+    frame_stats_log(&record_stats, "Record");
+    frame_stats_log(&replay_stats, "Replay");
+    draw_stats_log(&draw_stats, update_stats.total_count);
+
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
     srand((unsigned int) time(NULL));
@@ -84,9 +479,92 @@ int main(int argc, char *argv[])
     Lt *lt = create_lt();
 
     int fps = 60;
+    int uncapped = 0;
+    int threaded = 0;
+    int raster = 0;
+    int bench_load = 0;
+    const char *convert_input = NULL;
+    const char *convert_output = NULL;
+    // 0 means automatic
+    float render_scale = 1.0f;
+    Headless headless = {
+        .frames = HEADLESS_DEFAULT_FRAMES,
+        .dump_prefix = "./frame-"
+    };
 
     for (int i = 1; i < argc;) {
-        if (strcmp(argv[i], "--fps") == 0) {
+        if (strcmp(argv[i], "--headless") == 0 ||
+            strcmp(argv[i], "--frames") == 0 ||
+            strcmp(argv[i], "--dump") == 0 ||
+            strcmp(argv[i], "--dump-prefix") == 0) {
+            if (i + 1 >= argc) {
+                log_fail("Value of %s is not provided\n", argv[i]);
+                print_usage(stderr);
+                RETURN_LT(lt, -1);
+            }
+
+            if (strcmp(argv[i], "--headless") == 0) {
+                headless.level_file = argv[i + 1];
+            } else if (strcmp(argv[i], "--dump-prefix") == 0) {
+                headless.dump_prefix = argv[i + 1];
+            } else {
+                int value = 0;
+                if (sscanf(argv[i + 1], "%d", &value) != 1 || value < 0) {
+                    log_fail("Cannot parse %s: %s is not a number\n", argv[i], argv[i + 1]);
+                    print_usage(stderr);
+                    RETURN_LT(lt, -1);
+                }
+
+                if (strcmp(argv[i], "--frames") == 0) {
+                    headless.frames = value;
+                } else if (headless.dumps_count < HEADLESS_DUMP_CAPACITY) {
+                    headless.dumps[headless.dumps_count++] = value;
+                } else {
+                    log_warn("Too many frames to dump. Ignoring frame %d\n", value);
+                }
+            }
+
+            i += 2;
+        } else if (strcmp(argv[i], "--render-scale") == 0) {
+            if (i + 1 >= argc) {
+                log_fail("Value of %s is not provided\n", argv[i]);
+                print_usage(stderr);
+                RETURN_LT(lt, -1);
+            }
+
+            if (strcmp(argv[i + 1], "auto") == 0) {
+                render_scale = 0.0f;
+            } else if (sscanf(argv[i + 1], "%f", &render_scale) != 1 ||
+                       render_scale <= 0.0f || render_scale > 1.0f) {
+                log_fail("Render scale must be a number in (0, 1] or `auto`: %s\n", argv[i + 1]);
+                print_usage(stderr);
+                RETURN_LT(lt, -1);
+            }
+
+            i += 2;
+        } else if (strcmp(argv[i], "--raster") == 0) {
+            raster = 1;
+            i += 1;
+        } else if (strcmp(argv[i], "--convert-level") == 0) {
+            if (i + 2 >= argc) {
+                log_fail("Input and output of %s are not provided\n", argv[i]);
+                print_usage(stderr);
+                RETURN_LT(lt, -1);
+            }
+
+            convert_input = argv[i + 1];
+            convert_output = argv[i + 2];
+            i += 3;
+        } else if (strcmp(argv[i], "--bench-load") == 0) {
+            bench_load = 1;
+            i += 1;
+        } else if (strcmp(argv[i], "--uncapped") == 0) {
+            uncapped = 1;
+            i += 1;
+        } else if (strcmp(argv[i], "--threaded") == 0) {
+            threaded = 1;
+            i += 1;
+        } else if (strcmp(argv[i], "--fps") == 0) {
             if (i + 1 < argc) {
                 if (sscanf(argv[i + 1], "%d", &fps) == 0) {
                     log_fail("Cannot parse FPS: %s is not a number\n", argv[i + 1]);
@@ -106,6 +584,23 @@ int main(int argc, char *argv[])
         }
     }
 
+    // The level parsing benchmark and the conversion need neither
+    // the window nor the audio
+    if (bench_load) {
+        setlocale(LC_NUMERIC, "C");
+        RETURN_LT(lt, level_load_bench());
+    }
+
+    if (convert_input) {
+        setlocale(LC_NUMERIC, "C");
+        RETURN_LT(lt, level_editor_convert_file(convert_input, convert_output));
+    }
+
+    if (headless.level_file) {
+        SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+        SDL_SetHint(SDL_HINT_AUDIODRIVER, "dummy");
+    }
+
     if (SDL_Init(SDL_INIT_EVERYTHING & ~SDL_INIT_HAPTIC) < 0) {
         log_fail("Could not initialize SDL: %s\n", SDL_GetError());
         RETURN_LT(lt, -1);
@@ -114,35 +609,113 @@ int main(int argc, char *argv[])
 
     setlocale(LC_NUMERIC, "C");
 
-    SDL_ShowCursor(SDL_DISABLE);
+    SDL_Window *window = NULL;
+    SDL_Surface *surface = NULL;
+    SDL_Renderer *renderer = NULL;
+
+    if (headless.level_file) {
+        surface = PUSH_LT(
+            lt,
+            SDL_CreateRGBSurfaceWithFormat(
+                0, SCREEN_WIDTH, SCREEN_HEIGHT, 32,
+                SDL_PIXELFORMAT_ARGB8888),
+            SDL_FreeSurface);
+        if (surface == NULL) {
+            log_fail("Could not create SDL surface: %s\n", SDL_GetError());
+            RETURN_LT(lt, -1);
+        }
 
-    SDL_Window *const window = PUSH_LT(
-        lt,
-        SDL_CreateWindow(
-            "Nothing",
-            100, 100,
-            SCREEN_WIDTH, SCREEN_HEIGHT,
-            SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI),
-        SDL_DestroyWindow);
-
-    if (window == NULL) {
-        log_fail("Could not create SDL window: %s\n", SDL_GetError());
-        RETURN_LT(lt, -1);
-    }
+        renderer = PUSH_LT(
+            lt,
+            SDL_CreateSoftwareRenderer(surface),
+            SDL_DestroyRenderer);
+        if (renderer == NULL) {
+            log_fail("Could not create SDL software renderer: %s\n", SDL_GetError());
+            RETURN_LT(lt, -1);
+        }
+    } else {
+        SDL_ShowCursor(SDL_DISABLE);
+
+        window = PUSH_LT(
+            lt,
+            SDL_CreateWindow(
+                "Nothing",
+                100, 100,
+                SCREEN_WIDTH, SCREEN_HEIGHT,
+                SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI),
+            SDL_DestroyWindow);
+
+        if (window == NULL) {
+            log_fail("Could not create SDL window: %s\n", SDL_GetError());
+            RETURN_LT(lt, -1);
+        }
 
-    SDL_Renderer *const renderer = PUSH_LT(
-        lt,
-        SDL_CreateRenderer(window, -1, RENDERER_CONFIG),
-        SDL_DestroyRenderer);
-    if (renderer == NULL) {
-        log_fail("Could not create SDL renderer: %s\n", SDL_GetError());
-        RETURN_LT(lt, -1);
+        renderer = PUSH_LT(
+            lt,
+            SDL_CreateRenderer(
+                window, -1,
+                uncapped
+                ? (RENDERER_CONFIG & ~SDL_RENDERER_PRESENTVSYNC)
+                : RENDERER_CONFIG),
+            SDL_DestroyRenderer);
+        if (renderer == NULL) {
+            log_fail("Could not create SDL renderer: %s\n", SDL_GetError());
+            RETURN_LT(lt, -1);
+        }
     }
 
     SDL_RendererInfo info;
     SDL_GetRendererInfo(renderer, &info);
     log_info("Using SDL Renderer: %s\n", info.name);
 
+    Simulation simulation;
+    memset(&simulation, 0, sizeof(simulation));
+    draw_list_buffer_init(&simulation.frames);
+    PUSH_LT(lt, &simulation.frames, destroy_draw_list_buffer);
+    PUSH_LT(lt, &simulation.draw_list, destroy_draw_list);
+
+    PUSH_LT(lt, &simulation.target, destroy_draw_target);
+
+    Raster framebuffer;
+    memset(&framebuffer, 0, sizeof(framebuffer));
+    if (raster) {
+        PUSH_LT(lt, &framebuffer, destroy_raster);
+        simulation.raster = &framebuffer;
+
+        if (render_scale < 1.0f) {
+            log_warn("The software rasteriser always renders at the native resolution\n");
+            render_scale = 1.0f;
+        }
+    }
+
+    simulation.scheduler = create_frame_scheduler(uncapped ? 0 : fps);
+    // With a separate render thread SDL_RenderPresent never blocks
+    // the simulation, so the vsync only matters in the single thread mode.
+    if (!threaded && (info.flags & SDL_RENDERER_PRESENTVSYNC)) {
+        SDL_DisplayMode display_mode;
+        if (SDL_GetWindowDisplayMode(window, &display_mode) < 0) {
+            log_warn("Could not get the display mode of the window: %s\n", SDL_GetError());
+        } else {
+            frame_scheduler_vsync(&simulation.scheduler, display_mode.refresh_rate);
+        }
+    }
+
+    simulation.scaler = render_scale > 0.0f
+        ? create_render_scaler(render_scale)
+        : create_auto_render_scaler(
+            RENDER_SCALE_BUDGET / (float) (uncapped || fps <= 0 ? SIMULATION_FPS : fps));
+
+    simulation.events = PUSH_LT(lt, create_event_queue(), destroy_event_queue);
+    if (simulation.events == NULL) {
+        RETURN_LT(lt, -1);
+    }
+
+    simulation.frame_event = SDL_RegisterEvents(1);
+    if (simulation.frame_event == (Uint32) -1) {
+        log_fail("Could not register the frame event: %s\n", SDL_GetError());
+        RETURN_LT(lt, -1);
+    }
+
     if (SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND) < 0) {
         log_fail("Could not set up blending mode for the renderer: %s\n", SDL_GetError());
         RETURN_LT(lt, -1);
@@ -150,7 +723,9 @@ int main(int argc, char *argv[])
 
     SDL_Joystick *the_stick_of_joy = NULL;
 
-    if (SDL_NumJoysticks() > 0) {
+    if (headless.level_file) {
+        // No input in the headless mode
+    } else if (SDL_NumJoysticks() > 0) {
         the_stick_of_joy = PUSH_LT(lt, SDL_JoystickOpen(0), SDL_JoystickClose);
 
         if (the_stick_of_joy == NULL) {
@@ -186,60 +761,43 @@ int main(int argc, char *argv[])
             "./assets/levels/",
             sound_sample_files,
             sound_sample_files_count,
-            renderer),
+            renderer,
+            &simulation.draw_list),
         destroy_game);
     if (game == NULL) {
         RETURN_LT(lt, -1);
     }
 
-    // calculate the display scale for the first time.
-    recalculate_display_scale(window, renderer);
-
-    const Uint8 *const keyboard_state = SDL_GetKeyboardState(NULL);
-
-    SDL_StopTextInput();
-    SDL_Event e;
-    const int64_t delta_time = (int64_t) roundf(1000.0f / 60.0f);
-    int64_t render_timer = (int64_t) roundf(1000.0f / (float) fps);
-    while (!game_over_check(game)) {
-        const int64_t begin_frame_time = (int64_t) SDL_GetTicks();
-
-        while (!game_over_check(game) && SDL_PollEvent(&e)) {
+    if (window) {
+        // calculate the display scale for the first time.
+        recalculate_display_scale(window, renderer);
+    }
 
-            // this function potentially fixes mouse events by scaling them according
-            // to the window DPI scale. (eg. *2 on retina displays). it also updates
-            // the cached DPI scale on window scale/move events.
-            maybe_fixup_input_for_display_scale(window, renderer, &e);
+    SDL_Rect view_port;
+    SDL_RenderGetViewport(renderer, &view_port);
+    event_queue_set_view_port(simulation.events, view_port);
+    simulation.draw_list.view_port = view_port;
 
-            if (game_event(game, &e) < 0) {
-                RETURN_LT(lt, -1);
-            }
-        }
+    simulation.game = game;
+    simulation.the_stick_of_joy = the_stick_of_joy;
 
-        if (game_input(game, keyboard_state, the_stick_of_joy) < 0) {
-            RETURN_LT(lt, -1);
-        }
-
-        if (game_update(game, (float) delta_time * 0.001f) < 0) {
-            RETURN_LT(lt, -1);
-        }
+    SDL_StopTextInput();
 
-        if (game_sound(game) < 0) {
+    if (headless.level_file) {
+        if (headless_run(&simulation, &headless, renderer, surface) < 0) {
             RETURN_LT(lt, -1);
         }
+        RETURN_LT(lt, 0);
+    }
 
-        render_timer -= delta_time;
-        if (render_timer <= 0) {
-            if (game_render(game) < 0) {
-                RETURN_LT(lt, -1);
-            }
-            SDL_RenderPresent(renderer);
-            render_timer = (int64_t) roundf(1000.0f / (float) fps);
-        }
-
-        const int64_t end_frame_time = (int64_t) SDL_GetTicks();
-        SDL_Delay((unsigned int) MAX(int64_t, 10, delta_time - (end_frame_time - begin_frame_time)));
+    const int result = threaded
+        ? render_thread_run(&simulation, window, renderer)
+        : single_thread_run(&simulation, window, renderer);
+    if (result < 0) {
+        RETURN_LT(lt, -1);
     }
 
+    frame_stats_log(&simulation.scheduler.stats, "Frame time");
+
     RETURN_LT(lt, 0);
 }
@@ -0,0 +1,44 @@
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "./affine.h"
+
+// Transforms n points stored as interleaved x, y floats
+static void affine_transform_xys(Affine m, const float *in, float *out, size_t n)
+{
+    size_t i = 0;
+
+#ifdef __SSE2__
+    // Two points per register: (x0 y0 x1 y1)
+    const __m128 ac = _mm_setr_ps(m.a, m.c, m.a, m.c);
+    const __m128 bd = _mm_setr_ps(m.b, m.d, m.b, m.d);
+    const __m128 t = _mm_setr_ps(m.tx, m.ty, m.tx, m.ty);
+
+    for (; i + 2 <= n; i += 2) {
+        const __m128 p = _mm_loadu_ps(in + 2 * i);
+        const __m128 xs = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 0, 0));
+        const __m128 ys = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 1, 1));
+        _mm_storeu_ps(
+            out + 2 * i,
+            _mm_add_ps(_mm_add_ps(_mm_mul_ps(xs, ac), _mm_mul_ps(ys, bd)), t));
+    }
+#endif
+
+    for (; i < n; ++i) {
+        const float x = in[2 * i];
+        const float y = in[2 * i + 1];
+        out[2 * i] = m.a * x + m.b * y + m.tx;
+        out[2 * i + 1] = m.c * x + m.d * y + m.ty;
+    }
+}
+
+void affine_transform_points(Affine m, const Vec2f *in, Vec2f *out, size_t n)
+{
+    affine_transform_xys(m, &in->x, &out->x, n);
+}
+
+void affine_transform_triangles(Affine m, const Triangle *in, Triangle *out, size_t n)
+{
+    affine_transform_xys(m, &in->p1.x, &out->p1.x, 3 * n);
+}
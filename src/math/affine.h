@@ -0,0 +1,102 @@
+#ifndef AFFINE_H_
+#define AFFINE_H_
+
+#include <stddef.h>
+
+#include "math/triangle.h"
+#include "math/vec.h"
+
+// 2D affine transformation. The bottom row of the 3x3 matrix is
+// always (0 0 1), so it is not stored:
+//
+// | a b tx |
+// | c d ty |
+typedef struct {
+    float a, b, tx;
+    float c, d, ty;
+} Affine;
+
+static inline
+Affine affine(float a, float b, float tx,
+              float c, float d, float ty)
+{
+    const Affine m = {
+        .a = a, .b = b, .tx = tx,
+        .c = c, .d = d, .ty = ty
+    };
+
+    return m;
+}
+
+static inline
+Affine affine_identity(void)
+{
+    return affine(1.0f, 0.0f, 0.0f,
+                  0.0f, 1.0f, 0.0f);
+}
+
+static inline
+Affine affine_translate(float x, float y)
+{
+    return affine(1.0f, 0.0f, x,
+                  0.0f, 1.0f, y);
+}
+
+static inline
+Affine affine_translate_vec(Vec2f v)
+{
+    return affine_translate(v.x, v.y);
+}
+
+static inline
+Affine affine_rotate(float angle)
+{
+    const float c = cosf(angle);
+    const float s = sinf(angle);
+
+    return affine(c, -s, 0.0f,
+                  s, c, 0.0f);
+}
+
+static inline
+Affine affine_scale(float x, float y)
+{
+    return affine(x, 0.0f, 0.0f,
+                  0.0f, y, 0.0f);
+}
+
+// m1 * m2, that is m2 is applied first
+static inline
+Affine affine_compose(Affine m1, Affine m2)
+{
+    return affine(
+        m1.a * m2.a + m1.b * m2.c,
+        m1.a * m2.b + m1.b * m2.d,
+        m1.a * m2.tx + m1.b * m2.ty + m1.tx,
+        m1.c * m2.a + m1.d * m2.c,
+        m1.c * m2.b + m1.d * m2.d,
+        m1.c * m2.tx + m1.d * m2.ty + m1.ty);
+}
+
+static inline
+Vec2f affine_point(Affine m, Vec2f p)
+{
+    return vec(m.a * p.x + m.b * p.y + m.tx,
+               m.c * p.x + m.d * p.y + m.ty);
+}
+
+static inline
+Triangle affine_triangle(Affine m, Triangle t)
+{
+    return triangle(
+        affine_point(m, t.p1),
+        affine_point(m, t.p2),
+        affine_point(m, t.p3));
+}
+
+// Batch versions of affine_point() and affine_triangle(). `in` and
+// `out` may be the same array.
+void affine_transform_points(Affine m, const Vec2f *in, Vec2f *out, size_t n);
+void affine_transform_triangles(Affine m, const Triangle *in, Triangle *out, size_t n);
+
+#endif  // AFFINE_H_
@@ -69,6 +69,13 @@ static inline Rect rect_pad(Rect rect, float d)
 
 int rect_contains_point(Rect rect, Vec2f p);
 
+static inline
+int rect_contains_rect(Rect outer, Rect inner)
+{
+    return outer.x <= inner.x && inner.x + inner.w <= outer.x + outer.w
+        && outer.y <= inner.y && inner.y + inner.h <= outer.y + outer.h;
+}
+
 int rects_overlap(Rect rect1, Rect rect2);
 
 void rect_object_impact(Rect object,
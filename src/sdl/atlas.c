@@ -0,0 +1,152 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "./atlas.h"
+#include "./texture.h"
+#include "system/log.h"
+#include "system/nth_alloc.h"
+#include "system/stacktrace.h"
+
+#define ATLAS_WIDTH 256
+#define ATLAS_PADDING 1
+
+// Shelf packing: the images go left to right in rows, tallest
+// first. rects are expected to be zeroed, the images that are not
+// packed yet have zero height. Returns the height of the atlas.
+static int atlas_pack(SDL_Rect *rects, SDL_Surface **images, size_t count, int width)
+{
+    int x = 0;
+    int y = 0;
+    int shelf_height = 0;
+
+    for (size_t n = 0; n < count; ++n) {
+        size_t k = count;
+        for (size_t i = 0; i < count; ++i) {
+            if (rects[i].h == 0 && (k == count || images[i]->h > images[k]->h)) {
+                k = i;
+            }
+        }
+
+        if (x > 0 && x + images[k]->w > width) {
+            x = 0;
+            y += shelf_height + ATLAS_PADDING;
+            shelf_height = 0;
+        }
+
+        rects[k].x = x;
+        rects[k].y = y;
+        rects[k].w = images[k]->w;
+        rects[k].h = images[k]->h;
+
+        x += images[k]->w + ATLAS_PADDING;
+        if (images[k]->h > shelf_height) {
+            shelf_height = images[k]->h;
+        }
+    }
+
+    return y + shelf_height;
+}
+
+int atlas_load_bmps(Atlas *atlas,
+                    SDL_Renderer *renderer,
+                    const char *const *files,
+                    size_t count)
+{
+    trace_assert(atlas);
+    trace_assert(renderer);
+    trace_assert(files);
+    trace_assert(count > 0);
+
+    memset(atlas, 0, sizeof(*atlas));
+
+    SDL_Surface **images = nth_calloc(count, sizeof(SDL_Surface*));
+    if (images == NULL) {
+        return -1;
+    }
+
+    atlas->rects = nth_calloc(count, sizeof(SDL_Rect));
+    if (atlas->rects == NULL) {
+        goto fail;
+    }
+    atlas->count = count;
+
+    int width = ATLAS_WIDTH;
+    for (size_t i = 0; i < count; ++i) {
+        images[i] = surface_from_bmp(files[i]);
+        if (images[i] == NULL) {
+            goto fail;
+        }
+
+        if (images[i]->w > width) {
+            width = images[i]->w;
+        }
+    }
+
+    const int height = atlas_pack(atlas->rects, images, count, width);
+
+    atlas->surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (atlas->surface == NULL) {
+        log_fail("SDL_CreateRGBSurfaceWithFormat: %s\n", SDL_GetError());
+        goto fail;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        // Copy the pixels as they are, alpha included
+        if (SDL_SetSurfaceBlendMode(images[i], SDL_BLENDMODE_NONE) < 0) {
+            log_fail("SDL_SetSurfaceBlendMode: %s\n", SDL_GetError());
+            goto fail;
+        }
+
+        if (SDL_BlitSurface(images[i], NULL, atlas->surface, &atlas->rects[i]) < 0) {
+            log_fail("SDL_BlitSurface: %s\n", SDL_GetError());
+            goto fail;
+        }
+    }
+
+    atlas->texture = SDL_CreateTextureFromSurface(renderer, atlas->surface);
+    if (atlas->texture == NULL) {
+        log_fail("SDL_CreateTextureFromSurface: %s\n", SDL_GetError());
+        goto fail;
+    }
+
+    if (SDL_SetTextureBlendMode(atlas->texture, SDL_BLENDMODE_BLEND) < 0) {
+        log_fail("SDL_SetTextureBlendMode: %s\n", SDL_GetError());
+        goto fail;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        SDL_FreeSurface(images[i]);
+    }
+    free(images);
+
+    return 0;
+
+fail:
+    for (size_t i = 0; i < count; ++i) {
+        if (images[i] != NULL) {
+            SDL_FreeSurface(images[i]);
+        }
+    }
+    free(images);
+    destroy_atlas(atlas);
+
+    return -1;
+}
+
+void destroy_atlas(Atlas *atlas)
+{
+    trace_assert(atlas);
+
+    if (atlas->texture != NULL) {
+        SDL_DestroyTexture(atlas->texture);
+    }
+
+    if (atlas->surface != NULL) {
+        SDL_FreeSurface(atlas->surface);
+    }
+
+    free(atlas->rects);
+    memset(atlas, 0, sizeof(*atlas));
+}
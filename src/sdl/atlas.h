@@ -0,0 +1,35 @@
+#ifndef ATLAS_H_
+#define ATLAS_H_
+
+#include <SDL.h>
+
+#include "system/stacktrace.h"
+
+// Several BMP images packed into a single texture so drawing them
+// does not switch textures. The black color key of the images
+// becomes transparent pixels (see surface_from_bmp()).
+typedef struct {
+    SDL_Texture *texture;
+    // ARGB8888 copy of the texture for the software rasteriser
+    SDL_Surface *surface;
+    // Where every image ended up within the atlas, in the order of
+    // the files
+    SDL_Rect *rects;
+    size_t count;
+} Atlas;
+
+int atlas_load_bmps(Atlas *atlas,
+                    SDL_Renderer *renderer,
+                    const char *const *files,
+                    size_t count);
+void destroy_atlas(Atlas *atlas);
+
+static inline
+SDL_Rect atlas_rect(const Atlas *atlas, size_t index)
+{
+    trace_assert(atlas);
+    trace_assert(index < atlas->count);
+    return atlas->rects[index];
+}
+
+#endif  // ATLAS_H_
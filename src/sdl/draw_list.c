@@ -0,0 +1,512 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./draw_list.h"
+#include "./renderer.h"
+#include "system/log.h"
+#include "system/stacktrace.h"
+
+#define DRAW_LIST_INITIAL_CAPACITY 1024
+
+void destroy_draw_list(DrawList *draw_list)
+{
+    trace_assert(draw_list);
+    free(draw_list->commands);
+    draw_list->commands = NULL;
+    draw_list->count = 0;
+    draw_list->capacity = 0;
+}
+
+void draw_list_reset(DrawList *draw_list)
+{
+    trace_assert(draw_list);
+    draw_list->count = 0;
+}
+
+void draw_list_subsystem(DrawList *draw_list, DrawSubsystem subsystem)
+{
+    trace_assert(draw_list);
+    trace_assert(subsystem < DRAW_SUBSYSTEM_N);
+    draw_list->subsystem = subsystem;
+}
+
+void draw_list_pass(DrawList *draw_list, DrawPass pass)
+{
+    trace_assert(draw_list);
+    draw_list->pass = pass;
+}
+
+static DrawCommand *draw_list_push(DrawList *draw_list, DrawCommandType type)
+{
+    trace_assert(draw_list);
+
+    if (draw_list->count >= draw_list->capacity) {
+        draw_list->capacity = draw_list->capacity == 0
+            ? DRAW_LIST_INITIAL_CAPACITY
+            : draw_list->capacity * 2;
+        draw_list->commands = realloc(
+            draw_list->commands,
+            sizeof(DrawCommand) * draw_list->capacity);
+        trace_assert(draw_list->commands);
+    }
+
+    DrawCommand *command = &draw_list->commands[draw_list->count++];
+    command->type = type;
+    command->subsystem = draw_list->subsystem;
+    command->pass = draw_list->pass;
+    return command;
+}
+
+void draw_list_color(DrawList *draw_list, SDL_Color color)
+{
+    draw_list_push(draw_list, DRAW_COMMAND_COLOR)->color = color;
+}
+
+void draw_list_clear(DrawList *draw_list)
+{
+    draw_list_push(draw_list, DRAW_COMMAND_CLEAR);
+}
+
+void draw_list_fill_rect(DrawList *draw_list, SDL_Rect rect)
+{
+    draw_list_push(draw_list, DRAW_COMMAND_FILL_RECT)->rect = rect;
+}
+
+void draw_list_draw_rect(DrawList *draw_list, SDL_Rect rect)
+{
+    draw_list_push(draw_list, DRAW_COMMAND_DRAW_RECT)->rect = rect;
+}
+
+void draw_list_line(DrawList *draw_list, int x1, int y1, int x2, int y2)
+{
+    DrawCommand *command = draw_list_push(draw_list, DRAW_COMMAND_LINE);
+    command->line.x1 = x1;
+    command->line.y1 = y1;
+    command->line.x2 = x2;
+    command->line.y2 = y2;
+}
+
+void draw_list_draw_triangle(DrawList *draw_list, Triangle t)
+{
+    draw_list_push(draw_list, DRAW_COMMAND_DRAW_TRIANGLE)->triangle = t;
+}
+
+void draw_list_fill_triangle(DrawList *draw_list, Triangle t)
+{
+    draw_list_push(draw_list, DRAW_COMMAND_FILL_TRIANGLE)->triangle = t;
+}
+
+static DrawCopy *draw_list_push_copy(DrawList *draw_list,
+                                     SDL_Texture *texture,
+                                     SDL_Surface *surface,
+                                     SDL_Rect src,
+                                     SDL_Rect dst)
+{
+    trace_assert(texture);
+    trace_assert(surface);
+
+    DrawCopy *copy = &draw_list_push(draw_list, DRAW_COMMAND_COPY)->copy;
+    copy->texture = texture;
+    copy->surface = surface;
+    copy->invert = 0;
+    copy->src = src;
+    copy->dst = dst;
+    return copy;
+}
+
+void draw_list_copy(DrawList *draw_list,
+                    SDL_Texture *texture,
+                    SDL_Surface *surface,
+                    SDL_Rect src,
+                    SDL_Rect dst,
+                    SDL_Color mod)
+{
+    draw_list_push_copy(draw_list, texture, surface, src, dst)->mod = mod;
+}
+
+void draw_list_freeze(DrawList *draw_list, Uint32 id)
+{
+    trace_assert(id > 0);
+    draw_list_push(draw_list, DRAW_COMMAND_FREEZE)->freeze = id;
+}
+
+size_t draw_list_freeze_index(const DrawList *draw_list)
+{
+    trace_assert(draw_list);
+
+    for (size_t i = 0; i < draw_list->count; ++i) {
+        if (draw_list->commands[i].type == DRAW_COMMAND_FREEZE) {
+            return i;
+        }
+    }
+
+    return draw_list->count;
+}
+
+void draw_list_invert_copy(DrawList *draw_list,
+                           SDL_Texture *texture,
+                           SDL_Surface *surface,
+                           SDL_Rect src,
+                           SDL_Rect dst)
+{
+    DrawCopy *copy = draw_list_push_copy(draw_list, texture, surface, src, dst);
+    copy->invert = 1;
+    copy->mod.r = 255;
+    copy->mod.g = 255;
+    copy->mod.b = 255;
+    copy->mod.a = 255;
+}
+
+static SDL_BlendMode draw_list_invert_blend_mode(void)
+{
+    return SDL_ComposeCustomBlendMode(
+        SDL_BLENDFACTOR_ONE_MINUS_DST_COLOR,
+        SDL_BLENDFACTOR_ONE_MINUS_SRC_COLOR,
+        SDL_BLENDOPERATION_ADD,
+        SDL_BLENDFACTOR_ONE,
+        SDL_BLENDFACTOR_ZERO,
+        SDL_BLENDOPERATION_ADD);
+}
+
+static int draw_list_render_command(const DrawCommand *command, SDL_Renderer *renderer)
+{
+    switch (command->type) {
+    case DRAW_COMMAND_COLOR: {
+        if (SDL_SetRenderDrawColor(
+                renderer,
+                command->color.r, command->color.g,
+                command->color.b, command->color.a) < 0) {
+            log_fail("SDL_SetRenderDrawColor: %s\n", SDL_GetError());
+            return -1;
+        }
+    } break;
+
+    case DRAW_COMMAND_CLEAR: {
+        if (SDL_RenderClear(renderer) < 0) {
+            log_fail("SDL_RenderClear: %s\n", SDL_GetError());
+            return -1;
+        }
+    } break;
+
+    case DRAW_COMMAND_FILL_RECT: {
+        if (SDL_RenderFillRect(renderer, &command->rect) < 0) {
+            log_fail("SDL_RenderFillRect: %s\n", SDL_GetError());
+            return -1;
+        }
+    } break;
+
+    case DRAW_COMMAND_DRAW_RECT: {
+        if (SDL_RenderDrawRect(renderer, &command->rect) < 0) {
+            log_fail("SDL_RenderDrawRect: %s\n", SDL_GetError());
+            return -1;
+        }
+    } break;
+
+    case DRAW_COMMAND_LINE: {
+        if (SDL_RenderDrawLine(
+                renderer,
+                command->line.x1, command->line.y1,
+                command->line.x2, command->line.y2) < 0) {
+            log_fail("SDL_RenderDrawLine: %s\n", SDL_GetError());
+            return -1;
+        }
+    } break;
+
+    case DRAW_COMMAND_DRAW_TRIANGLE: {
+        if (draw_triangle(renderer, command->triangle) < 0) {
+            return -1;
+        }
+    } break;
+
+    case DRAW_COMMAND_FILL_TRIANGLE: {
+        if (fill_triangle(renderer, command->triangle) < 0) {
+            return -1;
+        }
+    } break;
+
+    case DRAW_COMMAND_COPY: {
+        const DrawCopy *copy = &command->copy;
+
+        if (SDL_SetTextureColorMod(copy->texture, copy->mod.r, copy->mod.g, copy->mod.b) < 0) {
+            log_fail("SDL_SetTextureColorMod: %s\n", SDL_GetError());
+            return -1;
+        }
+
+        if (SDL_SetTextureAlphaMod(copy->texture, copy->mod.a) < 0) {
+            log_fail("SDL_SetTextureAlphaMod: %s\n", SDL_GetError());
+            return -1;
+        }
+
+        // Not every renderer supports custom blend modes. The
+        // copy is just blended there.
+        const int inverted =
+            copy->invert &&
+            SDL_SetTextureBlendMode(copy->texture, draw_list_invert_blend_mode()) == 0;
+
+        if (SDL_RenderCopy(renderer, copy->texture, &copy->src, &copy->dst) < 0) {
+            log_fail("SDL_RenderCopy: %s\n", SDL_GetError());
+            return -1;
+        }
+
+        if (inverted &&
+            SDL_SetTextureBlendMode(copy->texture, SDL_BLENDMODE_BLEND) < 0) {
+            log_fail("SDL_SetTextureBlendMode: %s\n", SDL_GetError());
+            return -1;
+        }
+    } break;
+
+    case DRAW_COMMAND_FREEZE: {
+        // Only draw_list_render_scaled() knows what to do with it
+    } break;
+    }
+
+    return 0;
+}
+
+// Replays the commands [begin, end) of the given pass or of all
+// passes if pass is NULL
+static int draw_list_render_range(const DrawList *draw_list,
+                                  SDL_Renderer *renderer,
+                                  size_t begin, size_t end,
+                                  const DrawPass *pass)
+{
+    for (size_t i = begin; i < end; ++i) {
+        const DrawCommand *command = &draw_list->commands[i];
+        if ((pass == NULL || command->pass == *pass) &&
+            draw_list_render_command(command, renderer) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int draw_list_render(const DrawList *draw_list, SDL_Renderer *renderer)
+{
+    trace_assert(draw_list);
+    trace_assert(renderer);
+
+    return draw_list_render_range(draw_list, renderer, 0, draw_list->count, NULL);
+}
+
+void destroy_draw_target(DrawTarget *target)
+{
+    trace_assert(target);
+
+    if (target->texture != NULL) {
+        SDL_DestroyTexture(target->texture);
+    }
+
+    if (target->frozen != NULL) {
+        SDL_DestroyTexture(target->frozen);
+    }
+
+    memset(target, 0, sizeof(*target));
+}
+
+static int draw_target_resize(SDL_Renderer *renderer,
+                              SDL_Texture **texture,
+                              int *width, int *height,
+                              int new_width, int new_height)
+{
+    if (*texture != NULL && *width == new_width && *height == new_height) {
+        return 0;
+    }
+
+    if (*texture != NULL) {
+        SDL_DestroyTexture(*texture);
+    }
+
+    *width = 0;
+    *height = 0;
+    *texture = SDL_CreateTexture(
+        renderer,
+        SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_TARGET,
+        new_width, new_height);
+    if (*texture == NULL) {
+        log_warn("Could not create the render target: %s\n", SDL_GetError());
+        return -1;
+    }
+
+    *width = new_width;
+    *height = new_height;
+
+    return 0;
+}
+
+static int draw_target_begin(SDL_Renderer *renderer, SDL_Texture *texture)
+{
+    if (SDL_SetRenderTarget(renderer, texture) < 0) {
+        log_fail("SDL_SetRenderTarget: %s\n", SDL_GetError());
+        return -1;
+    }
+
+    // The content of a fresh target is undefined
+    if (texture != NULL) {
+        if (SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255) < 0) {
+            log_fail("SDL_SetRenderDrawColor: %s\n", SDL_GetError());
+            return -1;
+        }
+
+        if (SDL_RenderClear(renderer) < 0) {
+            log_fail("SDL_RenderClear: %s\n", SDL_GetError());
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int draw_list_render_range_scaled(const DrawList *draw_list,
+                                         SDL_Renderer *renderer,
+                                         DrawTarget *target,
+                                         size_t begin, size_t end)
+{
+    const float render_scale = draw_list_render_scale(draw_list);
+    if (render_scale >= 1.0f) {
+        return draw_list_render_range(draw_list, renderer, begin, end, NULL);
+    }
+
+    const int width = (int) ceilf((float) draw_list->view_port.w * render_scale);
+    const int height = (int) ceilf((float) draw_list->view_port.h * render_scale);
+    if (width <= 0 || height <= 0) {
+        return 0;
+    }
+
+    if (draw_target_resize(
+            renderer,
+            &target->texture, &target->width, &target->height,
+            width, height) < 0) {
+        return draw_list_render_range(draw_list, renderer, begin, end, NULL);
+    }
+
+    SDL_Texture *previous = SDL_GetRenderTarget(renderer);
+    const DrawPass world = DRAW_PASS_WORLD;
+    const DrawPass screen = DRAW_PASS_SCREEN;
+
+    if (draw_target_begin(renderer, target->texture) < 0) {
+        return -1;
+    }
+
+    if (draw_list_render_range(draw_list, renderer, begin, end, &world) < 0) {
+        return -1;
+    }
+
+    if (SDL_SetRenderTarget(renderer, previous) < 0) {
+        log_fail("SDL_SetRenderTarget: %s\n", SDL_GetError());
+        return -1;
+    }
+
+    if (SDL_RenderCopy(renderer, target->texture, NULL, NULL) < 0) {
+        log_fail("SDL_RenderCopy: %s\n", SDL_GetError());
+        return -1;
+    }
+
+    return draw_list_render_range(draw_list, renderer, begin, end, &screen);
+}
+
+int draw_list_render_scaled(const DrawList *draw_list,
+                            SDL_Renderer *renderer,
+                            DrawTarget *target)
+{
+    trace_assert(draw_list);
+    trace_assert(renderer);
+    trace_assert(target);
+
+    const size_t freeze = draw_list_freeze_index(draw_list);
+    if (freeze >= draw_list->count) {
+        return draw_list_render_range_scaled(draw_list, renderer, target, 0, draw_list->count);
+    }
+
+    const Uint32 id = draw_list->commands[freeze].freeze;
+    const int width = draw_list->view_port.w;
+    const int height = draw_list->view_port.h;
+
+    if (target->frozen == NULL || target->frozen_id != id ||
+        target->frozen_width != width || target->frozen_height != height) {
+        target->frozen_id = 0;
+
+        if (draw_target_resize(
+                renderer,
+                &target->frozen, &target->frozen_width, &target->frozen_height,
+                width, height) < 0) {
+            return draw_list_render_range_scaled(draw_list, renderer, target, 0, draw_list->count);
+        }
+
+        if (draw_target_begin(renderer, target->frozen) < 0) {
+            return -1;
+        }
+
+        if (draw_list_render_range_scaled(draw_list, renderer, target, 0, freeze) < 0) {
+            return -1;
+        }
+
+        if (draw_target_begin(renderer, NULL) < 0) {
+            return -1;
+        }
+
+        target->frozen_id = id;
+    }
+
+    if (SDL_RenderCopy(renderer, target->frozen, NULL, NULL) < 0) {
+        log_fail("SDL_RenderCopy: %s\n", SDL_GetError());
+        return -1;
+    }
+
+    return draw_list_render_range_scaled(draw_list, renderer, target, freeze + 1, draw_list->count);
+}
+
+#define DRAW_LIST_BUFFER_INDEX_MASK 3
+
+void draw_list_buffer_init(DrawListBuffer *buffer)
+{
+    trace_assert(buffer);
+    memset(buffer, 0, sizeof(*buffer));
+    buffer->writer = 0;
+    buffer->reader = 1;
+    SDL_AtomicSet(&buffer->spare, 2);
+}
+
+void destroy_draw_list_buffer(DrawListBuffer *buffer)
+{
+    trace_assert(buffer);
+    for (size_t i = 0; i < 3; ++i) {
+        destroy_draw_list(&buffer->lists[i]);
+    }
+}
+
+void draw_list_buffer_publish(DrawListBuffer *buffer, DrawList *draw_list)
+{
+    trace_assert(buffer);
+    trace_assert(draw_list);
+
+    // The recorded commands go into the writer's slot and the
+    // recorder keeps reusing the storage that used to be there.
+    DrawList *slot = &buffer->lists[buffer->writer];
+    const DrawList published = *draw_list;
+    *draw_list = *slot;
+    *slot = published;
+    draw_list->view_port = published.view_port;
+    draw_list_reset(draw_list);
+
+    const int spare = SDL_AtomicSet(
+        &buffer->spare,
+        buffer->writer | DRAW_LIST_BUFFER_FRESH);
+    buffer->writer = spare & DRAW_LIST_BUFFER_INDEX_MASK;
+}
+
+const DrawList *draw_list_buffer_acquire(DrawListBuffer *buffer)
+{
+    trace_assert(buffer);
+
+    if (!(SDL_AtomicGet(&buffer->spare) & DRAW_LIST_BUFFER_FRESH)) {
+        return NULL;
+    }
+
+    const int spare = SDL_AtomicSet(&buffer->spare, buffer->reader);
+    buffer->reader = spare & DRAW_LIST_BUFFER_INDEX_MASK;
+
+    return &buffer->lists[buffer->reader];
+}
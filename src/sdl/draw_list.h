@@ -0,0 +1,183 @@
+#ifndef DRAW_LIST_H_
+#define DRAW_LIST_H_
+
+#include <SDL.h>
+
+#include "math/triangle.h"
+
+typedef enum {
+    DRAW_COMMAND_COLOR = 0,
+    DRAW_COMMAND_CLEAR,
+    DRAW_COMMAND_FILL_RECT,
+    DRAW_COMMAND_DRAW_RECT,
+    DRAW_COMMAND_LINE,
+    DRAW_COMMAND_DRAW_TRIANGLE,
+    DRAW_COMMAND_FILL_TRIANGLE,
+    DRAW_COMMAND_COPY,
+    DRAW_COMMAND_FREEZE
+} DrawCommandType;
+
+// Which part of the game recorded a command. Only used for the
+// statistics (see sdl/draw_stats.h)
+typedef enum {
+    DRAW_SUBSYSTEM_OTHER = 0,
+    DRAW_SUBSYSTEM_BACKGROUND,
+    DRAW_SUBSYSTEM_PLATFORMS,
+    DRAW_SUBSYSTEM_PLAYER,
+    DRAW_SUBSYSTEM_PARTICLES,
+    DRAW_SUBSYSTEM_BOXES,
+    DRAW_SUBSYSTEM_LAVA,
+    DRAW_SUBSYSTEM_GOALS,
+    DRAW_SUBSYSTEM_LABELS,
+    DRAW_SUBSYSTEM_REGIONS,
+    DRAW_SUBSYSTEM_EDITOR_LAYERS,
+    DRAW_SUBSYSTEM_CONSOLE,
+    DRAW_SUBSYSTEM_DEBUG,
+
+    DRAW_SUBSYSTEM_N
+} DrawSubsystem;
+
+// With the dynamic resolution scaling the world is rendered into an
+// offscreen target at a fraction of the view port and upscaled, while
+// everything in the screen pass (UI text, console, cursor) stays at
+// the native resolution and goes on top of it.
+typedef enum {
+    DRAW_PASS_SCREEN = 0,
+    DRAW_PASS_WORLD
+} DrawPass;
+
+typedef struct {
+    SDL_Texture *texture;
+    // CPU copy of the texture pixels (ARGB8888) for the software
+    // rasteriser, see sdl/raster.h
+    SDL_Surface *surface;
+    // The texture inverts whatever is underneath it instead of
+    // blending (the mouse cursor). The textures are expected to have
+    // SDL_BLENDMODE_BLEND otherwise, they may be shared between
+    // both kinds of copies (see sdl/atlas.h).
+    int invert;
+    SDL_Rect src;
+    SDL_Rect dst;
+    SDL_Color mod;
+} DrawCopy;
+
+typedef struct {
+    int x1, y1;
+    int x2, y2;
+} DrawLine;
+
+typedef struct {
+    DrawCommandType type;
+    DrawSubsystem subsystem;
+    DrawPass pass;
+    union {
+        SDL_Color color;
+        SDL_Rect rect;
+        DrawLine line;
+        Triangle triangle;
+        DrawCopy copy;
+        Uint32 freeze;
+    };
+} DrawCommand;
+
+// Everything a frame wants to put on the screen, recorded by the
+// simulation and replayed by whoever owns the SDL_Renderer.
+typedef struct {
+    // View port of the renderer the list is going to be replayed on
+    SDL_Rect view_port;
+    // Fraction of the view port the world pass is rendered at
+    float render_scale;
+    // Subsystem the following commands are attributed to
+    DrawSubsystem subsystem;
+    // Pass the following commands belong to
+    DrawPass pass;
+    DrawCommand *commands;
+    size_t count;
+    size_t capacity;
+} DrawList;
+
+void destroy_draw_list(DrawList *draw_list);
+
+void draw_list_reset(DrawList *draw_list);
+void draw_list_subsystem(DrawList *draw_list, DrawSubsystem subsystem);
+void draw_list_pass(DrawList *draw_list, DrawPass pass);
+
+static inline
+float draw_list_render_scale(const DrawList *draw_list)
+{
+    return (0.0f < draw_list->render_scale && draw_list->render_scale < 1.0f)
+        ? draw_list->render_scale
+        : 1.0f;
+}
+void draw_list_color(DrawList *draw_list, SDL_Color color);
+void draw_list_clear(DrawList *draw_list);
+void draw_list_fill_rect(DrawList *draw_list, SDL_Rect rect);
+void draw_list_draw_rect(DrawList *draw_list, SDL_Rect rect);
+void draw_list_line(DrawList *draw_list, int x1, int y1, int x2, int y2);
+void draw_list_draw_triangle(DrawList *draw_list, Triangle t);
+void draw_list_fill_triangle(DrawList *draw_list, Triangle t);
+void draw_list_copy(DrawList *draw_list,
+                    SDL_Texture *texture,
+                    SDL_Surface *surface,
+                    SDL_Rect src,
+                    SDL_Rect dst,
+                    SDL_Color mod);
+// Everything recorded before the freeze is the same for every draw
+// list with the same id (the world of a paused level), so the
+// renderer captures it once and keeps reusing the capture.
+void draw_list_freeze(DrawList *draw_list, Uint32 id);
+void draw_list_invert_copy(DrawList *draw_list,
+                           SDL_Texture *texture,
+                           SDL_Surface *surface,
+                           SDL_Rect src,
+                           SDL_Rect dst);
+
+// Index of the freeze command or the amount of commands if there is none
+size_t draw_list_freeze_index(const DrawList *draw_list);
+
+int draw_list_render(const DrawList *draw_list, SDL_Renderer *renderer);
+
+// Offscreen targets the render thread keeps between the frames
+typedef struct {
+    // The world pass of the scaled draw lists
+    SDL_Texture *texture;
+    int width;
+    int height;
+
+    // Capture of everything before the freeze command
+    SDL_Texture *frozen;
+    int frozen_width;
+    int frozen_height;
+    Uint32 frozen_id;
+} DrawTarget;
+
+void destroy_draw_target(DrawTarget *target);
+
+// Same as draw_list_render() unless the render scale of the draw
+// list is below 1 or the draw list is frozen. Falls back to
+// draw_list_render() if the renderer does not support render targets.
+int draw_list_render_scaled(const DrawList *draw_list,
+                            SDL_Renderer *renderer,
+                            DrawTarget *target);
+
+// Triple buffer for handing draw lists from the simulation thread
+// over to the render thread. The writer and the reader each own one
+// of the lists and exchange it with the spare one atomically, so
+// neither of them ever waits for the other.
+typedef struct {
+    DrawList lists[3];
+    // Index of the spare list, plus DRAW_LIST_BUFFER_FRESH if it
+    // holds a frame the reader has not seen yet
+    SDL_atomic_t spare;
+    int writer;
+    int reader;
+} DrawListBuffer;
+
+#define DRAW_LIST_BUFFER_FRESH 4
+
+void draw_list_buffer_init(DrawListBuffer *buffer);
+void destroy_draw_list_buffer(DrawListBuffer *buffer);
+void draw_list_buffer_publish(DrawListBuffer *buffer, DrawList *draw_list);
+const DrawList *draw_list_buffer_acquire(DrawListBuffer *buffer);
+
+#endif  // DRAW_LIST_H_
@@ -0,0 +1,359 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./draw_stats.h"
+#include "system/log.h"
+#include "system/stacktrace.h"
+
+static const char *const draw_subsystem_names[DRAW_SUBSYSTEM_N] = {
+    [DRAW_SUBSYSTEM_OTHER] = "other",
+    [DRAW_SUBSYSTEM_BACKGROUND] = "background",
+    [DRAW_SUBSYSTEM_PLATFORMS] = "platforms",
+    [DRAW_SUBSYSTEM_PLAYER] = "player",
+    [DRAW_SUBSYSTEM_PARTICLES] = "particles",
+    [DRAW_SUBSYSTEM_BOXES] = "boxes",
+    [DRAW_SUBSYSTEM_LAVA] = "lava",
+    [DRAW_SUBSYSTEM_GOALS] = "goals",
+    [DRAW_SUBSYSTEM_LABELS] = "labels",
+    [DRAW_SUBSYSTEM_REGIONS] = "regions",
+    [DRAW_SUBSYSTEM_EDITOR_LAYERS] = "editor layers",
+    [DRAW_SUBSYSTEM_CONSOLE] = "console",
+    [DRAW_SUBSYSTEM_DEBUG] = "debug"
+};
+
+const char *draw_subsystem_name(DrawSubsystem subsystem)
+{
+    trace_assert(subsystem < DRAW_SUBSYSTEM_N);
+    return draw_subsystem_names[subsystem];
+}
+
+static size_t draw_stats_area(SDL_Rect rect, SDL_Rect view_port)
+{
+    const int x1 = rect.x < 0 ? 0 : rect.x;
+    const int y1 = rect.y < 0 ? 0 : rect.y;
+    const int x2 = rect.x + rect.w > view_port.w ? view_port.w : rect.x + rect.w;
+    const int y2 = rect.y + rect.h > view_port.h ? view_port.h : rect.y + rect.h;
+
+    if (x1 >= x2 || y1 >= y2) {
+        return 0;
+    }
+
+    return (size_t) (x2 - x1) * (size_t) (y2 - y1);
+}
+
+static size_t draw_stats_line_length(float x1, float y1, float x2, float y2)
+{
+    return (size_t) fmaxf(fabsf(roundf(x2) - roundf(x1)), fabsf(roundf(y2) - roundf(y1))) + 1;
+}
+
+void draw_stats_collect(DrawStats *stats, const DrawList *draw_list)
+{
+    trace_assert(stats);
+    trace_assert(draw_list);
+
+    memset(stats, 0, sizeof(*stats));
+
+    const SDL_Rect view_port = draw_list->view_port;
+    SDL_Color color = {0, 0, 0, 0};
+    int color_set = 0;
+    const DrawCopy *last_copy = NULL;
+
+    for (size_t i = 0; i < draw_list->count; ++i) {
+        const DrawCommand *command = &draw_list->commands[i];
+        size_t calls = 1;
+
+        switch (command->type) {
+        case DRAW_COMMAND_COLOR: {
+            stats->color_changes += 1;
+            if (color_set && memcmp(&color, &command->color, sizeof(color)) == 0) {
+                stats->redundant_changes += 1;
+            }
+            color = command->color;
+            color_set = 1;
+        } break;
+
+        case DRAW_COMMAND_CLEAR: {
+            stats->draw_calls += 1;
+            stats->pixels += (size_t) view_port.w * (size_t) view_port.h;
+        } break;
+
+        case DRAW_COMMAND_FILL_RECT: {
+            stats->draw_calls += 1;
+            stats->pixels += draw_stats_area(command->rect, view_port);
+        } break;
+
+        case DRAW_COMMAND_DRAW_RECT: {
+            stats->draw_calls += 1;
+            stats->pixels += 2 * (size_t) abs(command->rect.w) + 2 * (size_t) abs(command->rect.h);
+        } break;
+
+        case DRAW_COMMAND_LINE: {
+            stats->draw_calls += 1;
+            stats->pixels += draw_stats_line_length(
+                (float) command->line.x1, (float) command->line.y1,
+                (float) command->line.x2, (float) command->line.y2);
+        } break;
+
+        case DRAW_COMMAND_DRAW_TRIANGLE: {
+            const Triangle t = command->triangle;
+            calls = 3;
+            stats->draw_calls += calls;
+            stats->pixels +=
+                draw_stats_line_length(t.p1.x, t.p1.y, t.p2.x, t.p2.y) +
+                draw_stats_line_length(t.p2.x, t.p2.y, t.p3.x, t.p3.y) +
+                draw_stats_line_length(t.p3.x, t.p3.y, t.p1.x, t.p1.y);
+        } break;
+
+        case DRAW_COMMAND_FILL_TRIANGLE: {
+            // sdl/renderer.c fills triangles one scanline at a time
+            const Triangle t = triangle_sorted_by_y(command->triangle);
+            calls = (size_t) fmaxf(roundf(t.p3.y) - roundf(t.p1.y), 0.0f) + 1;
+            stats->draw_calls += calls;
+            stats->pixels += (size_t) (fabsf(
+                (t.p2.x - t.p1.x) * (t.p3.y - t.p1.y) -
+                (t.p3.x - t.p1.x) * (t.p2.y - t.p1.y)) * 0.5f);
+        } break;
+
+        case DRAW_COMMAND_COPY: {
+            const DrawCopy *copy = &command->copy;
+
+            // SDL_SetTextureColorMod + SDL_SetTextureAlphaMod + SDL_RenderCopy
+            calls = 3;
+            stats->texture_mod_changes += 2;
+            if (last_copy != NULL &&
+                last_copy->texture == copy->texture &&
+                memcmp(&last_copy->mod, &copy->mod, sizeof(copy->mod)) == 0) {
+                stats->redundant_changes += 2;
+            }
+            last_copy = copy;
+
+            stats->draw_calls += 1;
+            stats->pixels += draw_stats_area(copy->dst, view_port);
+        } break;
+
+        case DRAW_COMMAND_FREEZE: {
+            // Everything before the freeze turns into a single copy
+            // of the captured frame
+            memset(stats, 0, sizeof(*stats));
+            stats->draw_calls += 1;
+            stats->pixels += (size_t) view_port.w * (size_t) view_port.h;
+        } break;
+        }
+
+        stats->subsystem_calls[command->subsystem] += calls;
+    }
+}
+
+static void draw_overdraw_cell(DrawOverdraw *overdraw, int column, int row)
+{
+    if (overdraw->cells[row][column] < 255) {
+        overdraw->cells[row][column] += 1;
+    }
+}
+
+// Cells of the grid whose centers are within [a, b) for the view
+// port dimension `size` split into `n` cells
+static void draw_overdraw_span(float a, float b, int size, int n, int *first, int *last)
+{
+    const float k = (float) n / (float) size;
+    *first = (int) fmaxf(ceilf(a * k - 0.5f), 0.0f);
+    *last = (int) fminf(ceilf(b * k - 0.5f), (float) n);
+}
+
+static void draw_overdraw_rect(DrawOverdraw *overdraw,
+                               float x, float y, float w, float h)
+{
+    int x1, x2, y1, y2;
+    draw_overdraw_span(x, x + w, overdraw->view_port.w, DRAW_OVERDRAW_COLUMNS, &x1, &x2);
+    draw_overdraw_span(y, y + h, overdraw->view_port.h, DRAW_OVERDRAW_ROWS, &y1, &y2);
+
+    for (int row = y1; row < y2; ++row) {
+        for (int column = x1; column < x2; ++column) {
+            draw_overdraw_cell(overdraw, column, row);
+        }
+    }
+}
+
+static float draw_overdraw_edge(Vec2f a, Vec2f b, Vec2f p)
+{
+    return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+}
+
+static void draw_overdraw_triangle(DrawOverdraw *overdraw, Triangle t)
+{
+    const float x1 = fminf(t.p1.x, fminf(t.p2.x, t.p3.x));
+    const float y1 = fminf(t.p1.y, fminf(t.p2.y, t.p3.y));
+    const float x2 = fmaxf(t.p1.x, fmaxf(t.p2.x, t.p3.x));
+    const float y2 = fmaxf(t.p1.y, fmaxf(t.p2.y, t.p3.y));
+
+    int c1, c2, r1, r2;
+    draw_overdraw_span(x1, x2, overdraw->view_port.w, DRAW_OVERDRAW_COLUMNS, &c1, &c2);
+    draw_overdraw_span(y1, y2, overdraw->view_port.h, DRAW_OVERDRAW_ROWS, &r1, &r2);
+
+    const float cell_w = (float) overdraw->view_port.w / DRAW_OVERDRAW_COLUMNS;
+    const float cell_h = (float) overdraw->view_port.h / DRAW_OVERDRAW_ROWS;
+
+    for (int row = r1; row < r2; ++row) {
+        for (int column = c1; column < c2; ++column) {
+            const Vec2f p = vec(((float) column + 0.5f) * cell_w, ((float) row + 0.5f) * cell_h);
+            const float e1 = draw_overdraw_edge(t.p1, t.p2, p);
+            const float e2 = draw_overdraw_edge(t.p2, t.p3, p);
+            const float e3 = draw_overdraw_edge(t.p3, t.p1, p);
+
+            if ((e1 >= 0.0f && e2 >= 0.0f && e3 >= 0.0f) ||
+                (e1 <= 0.0f && e2 <= 0.0f && e3 <= 0.0f)) {
+                draw_overdraw_cell(overdraw, column, row);
+            }
+        }
+    }
+}
+
+void draw_overdraw_collect(DrawOverdraw *overdraw, const DrawList *draw_list)
+{
+    trace_assert(overdraw);
+    trace_assert(draw_list);
+
+    memset(overdraw->cells, 0, sizeof(overdraw->cells));
+    overdraw->view_port = draw_list->view_port;
+
+    if (overdraw->view_port.w <= 0 || overdraw->view_port.h <= 0) {
+        return;
+    }
+
+    const float world_scale = 1.0f / draw_list_render_scale(draw_list);
+
+    for (size_t i = 0; i < draw_list->count; ++i) {
+        const DrawCommand *command = &draw_list->commands[i];
+        if (command->subsystem == DRAW_SUBSYSTEM_DEBUG) {
+            continue;
+        }
+
+        // Everything is counted in the native view port coordinates
+        const float k = command->pass == DRAW_PASS_WORLD ? world_scale : 1.0f;
+
+        switch (command->type) {
+        case DRAW_COMMAND_CLEAR: {
+            draw_overdraw_rect(
+                overdraw, 0.0f, 0.0f,
+                (float) overdraw->view_port.w,
+                (float) overdraw->view_port.h);
+        } break;
+
+        case DRAW_COMMAND_FILL_RECT: {
+            const SDL_Rect r = command->rect;
+            draw_overdraw_rect(
+                overdraw,
+                (float) r.x * k, (float) r.y * k,
+                (float) r.w * k, (float) r.h * k);
+        } break;
+
+        case DRAW_COMMAND_COPY: {
+            const SDL_Rect r = command->copy.dst;
+            draw_overdraw_rect(
+                overdraw,
+                (float) r.x * k, (float) r.y * k,
+                (float) r.w * k, (float) r.h * k);
+        } break;
+
+        case DRAW_COMMAND_FILL_TRIANGLE: {
+            const Triangle t = command->triangle;
+            draw_overdraw_triangle(
+                overdraw,
+                triangle(vec_scala_mult(t.p1, k),
+                         vec_scala_mult(t.p2, k),
+                         vec_scala_mult(t.p3, k)));
+        } break;
+
+        case DRAW_COMMAND_FREEZE: {
+            // Everything before the freeze is a single copy
+            memset(overdraw->cells, 1, sizeof(overdraw->cells));
+        } break;
+
+        case DRAW_COMMAND_COLOR:
+        case DRAW_COMMAND_DRAW_RECT:
+        case DRAW_COMMAND_LINE:
+        case DRAW_COMMAND_DRAW_TRIANGLE:
+            break;
+        }
+    }
+}
+
+void draw_stats_add(DrawStats *total, const DrawStats *stats)
+{
+    trace_assert(total);
+    trace_assert(stats);
+
+    total->draw_calls += stats->draw_calls;
+    total->color_changes += stats->color_changes;
+    total->texture_mod_changes += stats->texture_mod_changes;
+    total->redundant_changes += stats->redundant_changes;
+    total->pixels += stats->pixels;
+    for (size_t i = 0; i < DRAW_SUBSYSTEM_N; ++i) {
+        total->subsystem_calls[i] += stats->subsystem_calls[i];
+    }
+}
+
+int draw_stats_format(const DrawStats *stats, char *buffer, size_t size)
+{
+    trace_assert(stats);
+    trace_assert(buffer);
+
+    int n = snprintf(
+        buffer, size,
+        "Draw calls: %lu\n"
+        "Color changes: %lu\n"
+        "Texture mod changes: %lu\n"
+        "Redundant changes: %lu\n"
+        "Pixels: %lu\n",
+        (unsigned long) stats->draw_calls,
+        (unsigned long) stats->color_changes,
+        (unsigned long) stats->texture_mod_changes,
+        (unsigned long) stats->redundant_changes,
+        (unsigned long) stats->pixels);
+
+    for (size_t i = 0; i < DRAW_SUBSYSTEM_N && n >= 0 && (size_t) n < size; ++i) {
+        if (stats->subsystem_calls[i] == 0) {
+            continue;
+        }
+
+        const int m = snprintf(
+            buffer + n, size - (size_t) n,
+            "%s: %lu\n",
+            draw_subsystem_names[i],
+            (unsigned long) stats->subsystem_calls[i]);
+        if (m < 0) {
+            return -1;
+        }
+        n += m;
+    }
+
+    return n;
+}
+
+void draw_stats_log(const DrawStats *total, size_t frames)
+{
+    trace_assert(total);
+
+    if (frames == 0) {
+        return;
+    }
+
+    const double k = 1.0 / (double) frames;
+
+    log_info("Draw calls per frame: %.1f, color changes: %.1f, texture mod changes: %.1f, redundant changes: %.1f, pixels: %.0f\n",
+             (double) total->draw_calls * k,
+             (double) total->color_changes * k,
+             (double) total->texture_mod_changes * k,
+             (double) total->redundant_changes * k,
+             (double) total->pixels * k);
+
+    for (size_t i = 0; i < DRAW_SUBSYSTEM_N; ++i) {
+        if (total->subsystem_calls[i] > 0) {
+            log_info("    %s: %.1f calls per frame\n",
+                     draw_subsystem_names[i],
+                     (double) total->subsystem_calls[i] * k);
+        }
+    }
+}
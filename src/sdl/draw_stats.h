@@ -0,0 +1,45 @@
+#ifndef DRAW_STATS_H_
+#define DRAW_STATS_H_
+
+#include "sdl/draw_list.h"
+
+// How much a recorded frame costs the SDL renderer. The numbers are
+// estimated from the draw list with the same SDL calls
+// draw_list_render() makes for every command.
+typedef struct {
+    size_t draw_calls;
+    size_t color_changes;
+    size_t texture_mod_changes;
+    // State changes that set exactly what was already set. These
+    // are the ones batching would get rid of.
+    size_t redundant_changes;
+    size_t pixels;
+    // Draw calls plus state changes
+    size_t subsystem_calls[DRAW_SUBSYSTEM_N];
+} DrawStats;
+
+#define DRAW_OVERDRAW_COLUMNS 64
+#define DRAW_OVERDRAW_ROWS 36
+
+// How many times the center of every cell of a coarse grid over the
+// view port gets filled within a frame. The debug commands are not
+// counted so the heatmap does not count itself.
+typedef struct {
+    SDL_Rect view_port;
+    Uint8 cells[DRAW_OVERDRAW_ROWS][DRAW_OVERDRAW_COLUMNS];
+} DrawOverdraw;
+
+const char *draw_subsystem_name(DrawSubsystem subsystem);
+
+void draw_stats_collect(DrawStats *stats, const DrawList *draw_list);
+void draw_stats_add(DrawStats *total, const DrawStats *stats);
+
+void draw_overdraw_collect(DrawOverdraw *overdraw, const DrawList *draw_list);
+
+// Text for the debug overlay
+int draw_stats_format(const DrawStats *stats, char *buffer, size_t size);
+
+// Average per frame over `frames` collected frames
+void draw_stats_log(const DrawStats *total, size_t frames);
+
+#endif  // DRAW_STATS_H_
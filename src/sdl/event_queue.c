@@ -0,0 +1,144 @@
+#include <string.h>
+
+#include "./event_queue.h"
+#include "system/log.h"
+#include "system/nth_alloc.h"
+#include "system/stacktrace.h"
+
+EventQueue *create_event_queue(void)
+{
+    Lt *lt = create_lt();
+
+    EventQueue *queue = PUSH_LT(lt, nth_calloc(1, sizeof(EventQueue)), free);
+    if (queue == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+    queue->lt = lt;
+
+    queue->mutex = PUSH_LT(lt, SDL_CreateMutex(), SDL_DestroyMutex);
+    if (queue->mutex == NULL) {
+        log_fail("SDL_CreateMutex: %s\n", SDL_GetError());
+        RETURN_LT(lt, NULL);
+    }
+
+    queue->cond = PUSH_LT(lt, SDL_CreateCond(), SDL_DestroyCond);
+    if (queue->cond == NULL) {
+        log_fail("SDL_CreateCond: %s\n", SDL_GetError());
+        RETURN_LT(lt, NULL);
+    }
+
+    return queue;
+}
+
+void destroy_event_queue(EventQueue *queue)
+{
+    trace_assert(queue);
+    RETURN_LT0(queue->lt);
+}
+
+void event_queue_push(EventQueue *queue, const SDL_Event *event)
+{
+    trace_assert(queue);
+    trace_assert(event);
+
+    SDL_LockMutex(queue->mutex);
+    if (queue->count < EVENT_QUEUE_CAPACITY) {
+        queue->events[(queue->begin + queue->count) % EVENT_QUEUE_CAPACITY] = *event;
+        queue->count++;
+    } else {
+        log_warn("Event queue is full. Dropping event %u\n", event->type);
+    }
+    SDL_CondSignal(queue->cond);
+    SDL_UnlockMutex(queue->mutex);
+}
+
+int event_queue_pop(EventQueue *queue, SDL_Event *event)
+{
+    trace_assert(queue);
+    trace_assert(event);
+
+    int result = 0;
+
+    SDL_LockMutex(queue->mutex);
+    if (queue->count > 0) {
+        *event = queue->events[queue->begin];
+        queue->begin = (queue->begin + 1) % EVENT_QUEUE_CAPACITY;
+        queue->count--;
+        result = 1;
+    }
+    SDL_UnlockMutex(queue->mutex);
+
+    return result;
+}
+
+void event_queue_wait(EventQueue *queue, Uint32 timeout)
+{
+    trace_assert(queue);
+
+    SDL_LockMutex(queue->mutex);
+    if (queue->count == 0 && !queue->quit) {
+        SDL_CondWaitTimeout(queue->cond, queue->mutex, timeout);
+    }
+    SDL_UnlockMutex(queue->mutex);
+}
+
+void event_queue_set_view_port(EventQueue *queue, SDL_Rect view_port)
+{
+    trace_assert(queue);
+
+    SDL_LockMutex(queue->mutex);
+    queue->view_port = view_port;
+    SDL_UnlockMutex(queue->mutex);
+}
+
+SDL_Rect event_queue_view_port(EventQueue *queue)
+{
+    trace_assert(queue);
+
+    SDL_LockMutex(queue->mutex);
+    const SDL_Rect view_port = queue->view_port;
+    SDL_UnlockMutex(queue->mutex);
+
+    return view_port;
+}
+
+void event_queue_set_keyboard_state(EventQueue *queue, const Uint8 *keyboard_state)
+{
+    trace_assert(queue);
+    trace_assert(keyboard_state);
+
+    SDL_LockMutex(queue->mutex);
+    memcpy(queue->keyboard_state, keyboard_state, sizeof(queue->keyboard_state));
+    SDL_UnlockMutex(queue->mutex);
+}
+
+void event_queue_keyboard_state(EventQueue *queue, Uint8 keyboard_state[SDL_NUM_SCANCODES])
+{
+    trace_assert(queue);
+    trace_assert(keyboard_state);
+
+    SDL_LockMutex(queue->mutex);
+    memcpy(keyboard_state, queue->keyboard_state, sizeof(queue->keyboard_state));
+    SDL_UnlockMutex(queue->mutex);
+}
+
+void event_queue_quit(EventQueue *queue)
+{
+    trace_assert(queue);
+
+    SDL_LockMutex(queue->mutex);
+    queue->quit = 1;
+    SDL_CondSignal(queue->cond);
+    SDL_UnlockMutex(queue->mutex);
+}
+
+int event_queue_quit_check(EventQueue *queue)
+{
+    trace_assert(queue);
+
+    SDL_LockMutex(queue->mutex);
+    const int quit = queue->quit;
+    SDL_UnlockMutex(queue->mutex);
+
+    return quit;
+}
@@ -0,0 +1,47 @@
+#ifndef EVENT_QUEUE_H_
+#define EVENT_QUEUE_H_
+
+#include <SDL.h>
+
+#include "system/lt.h"
+
+#define EVENT_QUEUE_CAPACITY 1024
+
+// Hands the SDL events over from the thread that pumps them (it
+// has to be the one that created the window) to the simulation
+// thread.
+typedef struct {
+    Lt *lt;
+    SDL_mutex *mutex;
+    SDL_cond *cond;
+    SDL_Event events[EVENT_QUEUE_CAPACITY];
+    size_t begin;
+    size_t count;
+    // Latest view port of the renderer, so the simulation never has
+    // to touch the renderer itself
+    SDL_Rect view_port;
+    // Copy of the SDL keyboard state (the modifier keys included)
+    // made by the pumping thread after every pump, since SDL writes
+    // the state itself while pumping
+    Uint8 keyboard_state[SDL_NUM_SCANCODES];
+    int quit;
+} EventQueue;
+
+EventQueue *create_event_queue(void);
+void destroy_event_queue(EventQueue *queue);
+
+void event_queue_push(EventQueue *queue, const SDL_Event *event);
+int event_queue_pop(EventQueue *queue, SDL_Event *event);
+void event_queue_wait(EventQueue *queue, Uint32 timeout);
+
+void event_queue_set_view_port(EventQueue *queue, SDL_Rect view_port);
+SDL_Rect event_queue_view_port(EventQueue *queue);
+
+// Called by the thread that pumps the events
+void event_queue_set_keyboard_state(EventQueue *queue, const Uint8 *keyboard_state);
+void event_queue_keyboard_state(EventQueue *queue, Uint8 keyboard_state[SDL_NUM_SCANCODES]);
+
+void event_queue_quit(EventQueue *queue);
+int event_queue_quit_check(EventQueue *queue);
+
+#endif  // EVENT_QUEUE_H_
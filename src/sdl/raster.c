@@ -0,0 +1,512 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "./raster.h"
+#include "system/log.h"
+#include "system/stacktrace.h"
+
+#define RASTER_OPAQUE 0xFF000000u
+
+static inline
+Uint32 raster_pixel(Uint32 r, Uint32 g, Uint32 b)
+{
+    return RASTER_OPAQUE | (r << 16) | (g << 8) | b;
+}
+
+// x / 255 rounded to the nearest integer for x in [0, 255 * 255]
+static inline
+Uint32 raster_div255(Uint32 x)
+{
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+static inline
+Uint32 raster_blend_pixel(Uint32 dst, Uint32 src, Uint32 alpha)
+{
+    Uint32 result = RASTER_OPAQUE;
+    for (Uint32 shift = 0; shift < 24; shift += 8) {
+        const Uint32 s = (src >> shift) & 0xFF;
+        const Uint32 d = (dst >> shift) & 0xFF;
+        result |= raster_div255(s * alpha + d * (255 - alpha)) << shift;
+    }
+    return result;
+}
+
+// Same thing the custom blend mode of the cursor textures does:
+// src * (1 - dst) + dst * (1 - src)
+static inline
+Uint32 raster_invert_pixel(Uint32 dst, Uint32 src)
+{
+    Uint32 result = RASTER_OPAQUE;
+    for (Uint32 shift = 0; shift < 24; shift += 8) {
+        const Uint32 s = (src >> shift) & 0xFF;
+        const Uint32 d = (dst >> shift) & 0xFF;
+        result |= raster_div255(s * (255 - d) + d * (255 - s)) << shift;
+    }
+    return result;
+}
+
+static void raster_fill_span(Uint32 *dst, int n, Uint32 pixel)
+{
+    int i = 0;
+
+#ifdef __SSE2__
+    const __m128i p = _mm_set1_epi32((int) pixel);
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_si128((__m128i*) (dst + i), p);
+    }
+#endif
+
+    for (; i < n; ++i) {
+        dst[i] = pixel;
+    }
+}
+
+static void raster_blend_span(Uint32 *dst, int n, Uint32 pixel, Uint32 alpha)
+{
+    int i = 0;
+
+#ifdef __SSE2__
+    // Four pixels at a time, unpacked into 16 bit channels. The
+    // math is exactly the same as in raster_blend_pixel() so the
+    // result does not depend on the alignment of the span.
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i inv_alpha = _mm_set1_epi16((short) (255 - alpha));
+    const __m128i half = _mm_set1_epi16(128);
+    const __m128i src = _mm_add_epi16(
+        _mm_mullo_epi16(
+            _mm_unpacklo_epi8(_mm_set1_epi32((int) pixel), zero),
+            _mm_set1_epi16((short) alpha)),
+        half);
+
+    for (; i + 4 <= n; i += 4) {
+        const __m128i d = _mm_loadu_si128((const __m128i*) (dst + i));
+
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), inv_alpha), src);
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), inv_alpha), src);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+
+        _mm_storeu_si128((__m128i*) (dst + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for (; i < n; ++i) {
+        dst[i] = raster_blend_pixel(dst[i], pixel, alpha);
+    }
+}
+
+static void raster_span(Uint32 *dst, int n, Uint32 pixel, Uint32 alpha)
+{
+    if (alpha == 255) {
+        raster_fill_span(dst, n, pixel);
+    } else if (alpha > 0) {
+        raster_blend_span(dst, n, pixel, alpha);
+    }
+}
+
+static void raster_color_span(Raster *raster, int x, int y, int n)
+{
+    raster_span(
+        raster->pixels + y * raster->width + x, n,
+        raster_pixel(raster->color.r, raster->color.g, raster->color.b),
+        raster->color.a);
+}
+
+static void raster_hline(Raster *raster, int x1, int x2, int y)
+{
+    if (y < 0 || y >= raster->height) {
+        return;
+    }
+
+    if (x1 > x2) {
+        const int t = x1;
+        x1 = x2;
+        x2 = t;
+    }
+
+    x1 = x1 < 0 ? 0 : x1;
+    x2 = x2 >= raster->width ? raster->width - 1 : x2;
+
+    if (x1 <= x2) {
+        raster_color_span(raster, x1, y, x2 - x1 + 1);
+    }
+}
+
+static void raster_plot(Raster *raster, int x, int y)
+{
+    if (0 <= x && x < raster->width && 0 <= y && y < raster->height) {
+        raster_color_span(raster, x, y, 1);
+    }
+}
+
+static void raster_fill_rect(Raster *raster, SDL_Rect rect)
+{
+    const int x1 = rect.x < 0 ? 0 : rect.x;
+    const int y1 = rect.y < 0 ? 0 : rect.y;
+    const int x2 = rect.x + rect.w > raster->width ? raster->width : rect.x + rect.w;
+    const int y2 = rect.y + rect.h > raster->height ? raster->height : rect.y + rect.h;
+
+    for (int y = y1; y < y2 && x1 < x2; ++y) {
+        raster_color_span(raster, x1, y, x2 - x1);
+    }
+}
+
+static void raster_draw_rect(Raster *raster, SDL_Rect rect)
+{
+    if (rect.w <= 0 || rect.h <= 0) {
+        return;
+    }
+
+    raster_hline(raster, rect.x, rect.x + rect.w - 1, rect.y);
+    if (rect.h > 1) {
+        raster_hline(raster, rect.x, rect.x + rect.w - 1, rect.y + rect.h - 1);
+    }
+
+    for (int y = rect.y + 1; y < rect.y + rect.h - 1; ++y) {
+        raster_plot(raster, rect.x, y);
+        if (rect.w > 1) {
+            raster_plot(raster, rect.x + rect.w - 1, y);
+        }
+    }
+}
+
+static void raster_line(Raster *raster, int x1, int y1, int x2, int y2)
+{
+    if (y1 == y2) {
+        raster_hline(raster, x1, x2, y1);
+        return;
+    }
+
+    const int dx = abs(x2 - x1);
+    const int dy = -abs(y2 - y1);
+    const int sx = x1 < x2 ? 1 : -1;
+    const int sy = y1 < y2 ? 1 : -1;
+    int err = dx + dy;
+
+    for (;;) {
+        raster_plot(raster, x1, y1);
+
+        if (x1 == x2 && y1 == y2) {
+            break;
+        }
+
+        const int e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
+            x1 += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            y1 += sy;
+        }
+    }
+}
+
+static void raster_line_f(Raster *raster, Vec2f begin, Vec2f end)
+{
+    raster_line(
+        raster,
+        (int) roundf(begin.x), (int) roundf(begin.y),
+        (int) roundf(end.x), (int) roundf(end.y));
+}
+
+// The triangle filling follows sdl/renderer.c scanline by scanline
+// so both backends produce the same picture.
+static void raster_fill_bottom_flat_triangle(Raster *raster, Triangle t)
+{
+    const float invslope1 = (t.p2.x - t.p1.x) / (t.p2.y - t.p1.y);
+    const float invslope2 = (t.p3.x - t.p1.x) / (t.p3.y - t.p1.y);
+
+    const int y0 = (int) roundf(t.p1.y);
+    const int y1 = (int) roundf(t.p2.y);
+
+    float curx1 = t.p1.x;
+    float curx2 = t.p1.x;
+
+    for (int scanline = y0; scanline < y1; scanline++) {
+        raster_hline(raster, (int) roundf(curx1), (int) roundf(curx2), scanline);
+        curx1 += invslope1;
+        curx2 += invslope2;
+    }
+}
+
+static void raster_fill_top_flat_triangle(Raster *raster, Triangle t)
+{
+    const float invslope1 = (t.p3.x - t.p1.x) / (t.p3.y - t.p1.y);
+    const float invslope2 = (t.p3.x - t.p2.x) / (t.p3.y - t.p2.y);
+
+    const int y0 = (int) roundf(t.p3.y);
+    const int y1 = (int) roundf(t.p1.y);
+
+    float curx1 = t.p3.x;
+    float curx2 = t.p3.x;
+
+    for (int scanline = y0; scanline > y1; --scanline) {
+        raster_hline(raster, (int) roundf(curx1), (int) roundf(curx2), scanline);
+        curx1 -= invslope1;
+        curx2 -= invslope2;
+    }
+}
+
+static void raster_fill_triangle(Raster *raster, Triangle t)
+{
+    t = triangle_sorted_by_y(t);
+
+    if (fabs(t.p2.y - t.p3.y) < 1e-6) {
+        raster_fill_bottom_flat_triangle(raster, t);
+    } else if (fabs(t.p1.y - t.p2.y) < 1e-6) {
+        raster_fill_top_flat_triangle(raster, t);
+    } else {
+        const Vec2f p4 = vec(t.p1.x + ((t.p2.y - t.p1.y) / (t.p3.y - t.p1.y)) * (t.p3.x - t.p1.x), t.p2.y);
+        raster_fill_bottom_flat_triangle(raster, triangle(t.p1, t.p2, p4));
+        raster_fill_top_flat_triangle(raster, triangle(t.p2, p4, t.p3));
+        raster_line_f(raster, t.p2, p4);
+    }
+}
+
+static void raster_copy_span(Uint32 *dst, int n, Uint32 texel, const DrawCopy *copy)
+{
+    const Uint32 alpha = raster_div255((texel >> 24) * copy->mod.a);
+    if (alpha == 0) {
+        return;
+    }
+
+    const Uint32 pixel = raster_pixel(
+        raster_div255(((texel >> 16) & 0xFF) * copy->mod.r),
+        raster_div255(((texel >> 8) & 0xFF) * copy->mod.g),
+        raster_div255((texel & 0xFF) * copy->mod.b));
+
+    if (copy->invert) {
+        for (int i = 0; i < n; ++i) {
+            dst[i] = raster_invert_pixel(dst[i], pixel);
+        }
+    } else {
+        raster_span(dst, n, pixel, alpha);
+    }
+}
+
+// Nearest neighbour scaling. The glyphs are usually scaled up a lot,
+// so every texel turns into a span of identical pixels.
+static void raster_copy(Raster *raster, const DrawCopy *copy)
+{
+    const SDL_Surface *surface = copy->surface;
+    const SDL_Rect src = copy->src;
+    const SDL_Rect dst = copy->dst;
+
+    if (src.w <= 0 || src.h <= 0 || dst.w <= 0 || dst.h <= 0) {
+        return;
+    }
+
+    trace_assert(0 <= src.x && src.x + src.w <= surface->w);
+    trace_assert(0 <= src.y && src.y + src.h <= surface->h);
+
+    const int x1 = dst.x < 0 ? 0 : dst.x;
+    const int y1 = dst.y < 0 ? 0 : dst.y;
+    const int x2 = dst.x + dst.w > raster->width ? raster->width : dst.x + dst.w;
+    const int y2 = dst.y + dst.h > raster->height ? raster->height : dst.y + dst.h;
+
+    for (int y = y1; y < y2; ++y) {
+        const int sy = src.y + (y - dst.y) * src.h / dst.h;
+        const Uint32 *texels = (const Uint32*) ((const Uint8*) surface->pixels + sy * surface->pitch) + src.x;
+        Uint32 *row = raster->pixels + y * raster->width;
+
+        for (int x = x1; x < x2;) {
+            const int sx = (x - dst.x) * src.w / dst.w;
+            int next = dst.x + ((sx + 1) * dst.w + src.w - 1) / src.w;
+            next = next > x2 ? x2 : next;
+
+            raster_copy_span(row + x, next - x, texels[sx], copy);
+            x = next;
+        }
+    }
+}
+
+static int raster_resize(Raster *raster, int width, int height)
+{
+    trace_assert(raster);
+
+    if (raster->width == width && raster->height == height) {
+        return 0;
+    }
+
+    free(raster->pixels);
+    raster->pixels = NULL;
+    free(raster->frozen);
+    raster->frozen = NULL;
+    raster->frozen_id = 0;
+    raster->width = 0;
+    raster->height = 0;
+
+    // The streaming texture has to match the framebuffer
+    if (raster->texture != NULL) {
+        SDL_DestroyTexture(raster->texture);
+        raster->texture = NULL;
+    }
+
+    if (width <= 0 || height <= 0) {
+        return 0;
+    }
+
+    raster->pixels = malloc(sizeof(Uint32) * (size_t) width * (size_t) height);
+    if (raster->pixels == NULL) {
+        log_fail("Could not allocate %dx%d framebuffer\n", width, height);
+        return -1;
+    }
+    raster->width = width;
+    raster->height = height;
+
+    return 0;
+}
+
+void destroy_raster(Raster *raster)
+{
+    trace_assert(raster);
+    raster_resize(raster, 0, 0);
+}
+
+static void raster_draw_range(Raster *raster,
+                              const DrawList *draw_list,
+                              size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; ++i) {
+        const DrawCommand *command = &draw_list->commands[i];
+
+        switch (command->type) {
+        case DRAW_COMMAND_COLOR: {
+            raster->color = command->color;
+        } break;
+
+        case DRAW_COMMAND_CLEAR: {
+            raster_fill_span(
+                raster->pixels,
+                raster->width * raster->height,
+                raster_pixel(raster->color.r, raster->color.g, raster->color.b));
+        } break;
+
+        case DRAW_COMMAND_FILL_RECT: {
+            raster_fill_rect(raster, command->rect);
+        } break;
+
+        case DRAW_COMMAND_DRAW_RECT: {
+            raster_draw_rect(raster, command->rect);
+        } break;
+
+        case DRAW_COMMAND_LINE: {
+            raster_line(
+                raster,
+                command->line.x1, command->line.y1,
+                command->line.x2, command->line.y2);
+        } break;
+
+        case DRAW_COMMAND_DRAW_TRIANGLE: {
+            raster_line_f(raster, command->triangle.p1, command->triangle.p2);
+            raster_line_f(raster, command->triangle.p2, command->triangle.p3);
+            raster_line_f(raster, command->triangle.p3, command->triangle.p1);
+        } break;
+
+        case DRAW_COMMAND_FILL_TRIANGLE: {
+            raster_fill_triangle(raster, command->triangle);
+        } break;
+
+        case DRAW_COMMAND_COPY: {
+            raster_copy(raster, &command->copy);
+        } break;
+
+        case DRAW_COMMAND_FREEZE: {
+        } break;
+        }
+    }
+}
+
+int raster_draw_list(Raster *raster, const DrawList *draw_list)
+{
+    trace_assert(raster);
+    trace_assert(draw_list);
+
+    if (raster_resize(raster, draw_list->view_port.w, draw_list->view_port.h) < 0) {
+        return -1;
+    }
+
+    if (raster->pixels == NULL) {
+        return 0;
+    }
+
+    const size_t freeze = draw_list_freeze_index(draw_list);
+    if (freeze >= draw_list->count) {
+        raster_draw_range(raster, draw_list, 0, draw_list->count);
+        return 0;
+    }
+
+    const size_t size = sizeof(Uint32) * (size_t) raster->width * (size_t) raster->height;
+    const Uint32 id = draw_list->commands[freeze].freeze;
+
+    if (raster->frozen_id == id) {
+        memcpy(raster->pixels, raster->frozen, size);
+    } else {
+        raster_draw_range(raster, draw_list, 0, freeze);
+
+        if (raster->frozen == NULL) {
+            raster->frozen = malloc(size);
+        }
+
+        if (raster->frozen != NULL) {
+            memcpy(raster->frozen, raster->pixels, size);
+            raster->frozen_id = id;
+        }
+    }
+
+    raster_draw_range(raster, draw_list, freeze + 1, draw_list->count);
+
+    return 0;
+}
+
+int raster_render(Raster *raster,
+                  const DrawList *draw_list,
+                  SDL_Renderer *renderer)
+{
+    trace_assert(raster);
+    trace_assert(renderer);
+
+    if (raster_draw_list(raster, draw_list) < 0) {
+        return -1;
+    }
+
+    if (raster->pixels == NULL) {
+        return 0;
+    }
+
+    if (raster->texture == NULL) {
+        raster->texture = SDL_CreateTexture(
+            renderer,
+            SDL_PIXELFORMAT_ARGB8888,
+            SDL_TEXTUREACCESS_STREAMING,
+            raster->width,
+            raster->height);
+        if (raster->texture == NULL) {
+            log_fail("SDL_CreateTexture: %s\n", SDL_GetError());
+            return -1;
+        }
+    }
+
+    if (SDL_UpdateTexture(
+            raster->texture, NULL,
+            raster->pixels,
+            raster->width * (int) sizeof(Uint32)) < 0) {
+        log_fail("SDL_UpdateTexture: %s\n", SDL_GetError());
+        return -1;
+    }
+
+    if (SDL_RenderCopy(renderer, raster->texture, NULL, NULL) < 0) {
+        log_fail("SDL_RenderCopy: %s\n", SDL_GetError());
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,41 @@
+#ifndef RASTER_H_
+#define RASTER_H_
+
+#include <SDL.h>
+
+#include "sdl/draw_list.h"
+
+// Software rasteriser for the draw lists. Instead of going through
+// SDL one primitive at a time it fills spans of a CPU framebuffer
+// directly (with SSE2 where available) and uploads the whole frame
+// into a streaming texture once per frame.
+//
+// Meant for the machines where SDL ends up with its own software
+// renderer anyway.
+typedef struct {
+    // ARGB8888, always opaque
+    Uint32 *pixels;
+    int width;
+    int height;
+    SDL_Texture *texture;
+    SDL_Color color;
+
+    // Copy of the framebuffer at the freeze command of the draw list
+    // with frozen_id (see draw_list_freeze())
+    Uint32 *frozen;
+    Uint32 frozen_id;
+} Raster;
+
+void destroy_raster(Raster *raster);
+
+// Rasterises the draw list into the framebuffer. The framebuffer is
+// resized to the view port of the draw list if needed.
+int raster_draw_list(Raster *raster, const DrawList *draw_list);
+
+// raster_draw_list() plus uploading the framebuffer and copying it
+// into the view port of the renderer
+int raster_render(Raster *raster,
+                  const DrawList *draw_list,
+                  SDL_Renderer *renderer);
+
+#endif  // RASTER_H_
@@ -4,39 +4,37 @@
 #include "system/log.h"
 #include "texture.h"
 
-SDL_Texture *texture_from_bmp(const char *bmp_file_name,
-                              SDL_Renderer *renderer)
+SDL_Surface *surface_from_bmp(const char *bmp_file_name)
 {
     trace_assert(bmp_file_name);
-    trace_assert(renderer);
 
-    SDL_Surface * surface = SDL_LoadBMP(bmp_file_name);
-    if (surface == NULL) {
+    SDL_Surface *bmp = SDL_LoadBMP(bmp_file_name);
+    if (bmp == NULL) {
         log_fail("Could not load %s: %s\n", bmp_file_name, SDL_GetError());
-        goto fail;
+        return NULL;
     }
 
-    if (SDL_SetColorKey(surface,
-                        SDL_TRUE,
-                        SDL_MapRGB(surface->format, 0, 0, 0)) < 0) {
-        log_fail("SDL_SetColorKey: %s\n", SDL_GetError());
-        goto fail;
+    SDL_Surface *surface = SDL_ConvertSurfaceFormat(bmp, SDL_PIXELFORMAT_ARGB8888, 0);
+    SDL_FreeSurface(bmp);
+    if (surface == NULL) {
+        log_fail("SDL_ConvertSurfaceFormat: %s\n", SDL_GetError());
+        return NULL;
     }
 
-    SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surface);
-    if (texture == NULL) {
-        log_fail("SDL_CreateTextureFromSurface: %s\n", SDL_GetError());
-        goto fail;
+    if (SDL_LockSurface(surface) < 0) {
+        log_fail("SDL_LockSurface: %s\n", SDL_GetError());
+        SDL_FreeSurface(surface);
+        return NULL;
     }
 
-    SDL_FreeSurface(surface);
-
-    return texture;
-
-fail:
-    if (surface != NULL) {
-        SDL_FreeSurface(surface);
+    for (int y = 0; y < surface->h; ++y) {
+        Uint32 *row = (Uint32*) ((Uint8*) surface->pixels + y * surface->pitch);
+        for (int x = 0; x < surface->w; ++x) {
+            row[x] = (row[x] & 0xFFFFFF) ? (row[x] | 0xFF000000) : 0;
+        }
     }
 
-    return NULL;
+    SDL_UnlockSurface(surface);
+
+    return surface;
 }
@@ -1,7 +1,8 @@
 #ifndef TEXTURE_H_
 #define TEXTURE_H_
 
-SDL_Texture *texture_from_bmp(const char *bmp_file_name,
-                              SDL_Renderer *renderer);
+// Loads a BMP image into an ARGB8888 surface. The black color key
+// becomes transparent pixels.
+SDL_Surface *surface_from_bmp(const char *bmp_file_name);
 
 #endif  // TEXTURE_H_
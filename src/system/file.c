@@ -1,12 +1,31 @@
+// st_mtim is only declared for POSIX.1-2008 and the build asks for
+// plain C11. macOS has st_mtimespec as long as this is not defined.
+#if !defined(_WIN32) && !defined(__APPLE__) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "file.h"
 #include "system/nth_alloc.h"
 #include "system/stacktrace.h"
+#include "system/log.h"
 #include "lt_adapters.h"
 
+#define FILE_PATH_MAX_SIZE 512
+
 #ifdef _WIN32
 
 struct DIR
@@ -96,3 +115,256 @@ end:
     if (f) fclose(f);
     return result;
 }
+
+#ifdef _WIN32
+
+int map_whole_file(MappedFile *file, const char *filepath)
+{
+    trace_assert(file);
+    trace_assert(filepath);
+
+    file->data = NULL;
+    file->size = 0;
+
+    HANDLE handle = CreateFileA(
+        filepath, GENERIC_READ, FILE_SHARE_READ, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (handle == INVALID_HANDLE_VALUE) {
+        log_fail("Could not open file %s\n", filepath);
+        return -1;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size)) {
+        log_fail("Could not get the size of file %s\n", filepath);
+        CloseHandle(handle);
+        return -1;
+    }
+
+    if (size.QuadPart == 0) {
+        CloseHandle(handle);
+        return 0;
+    }
+
+    // The view keeps the mapping and the file alive after the
+    // handles are closed
+    HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(handle);
+    if (mapping == NULL) {
+        log_fail("Could not map file %s\n", filepath);
+        return -1;
+    }
+
+    void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (data == NULL) {
+        log_fail("Could not map file %s\n", filepath);
+        return -1;
+    }
+
+    file->data = data;
+    file->size = (size_t) size.QuadPart;
+
+    return 0;
+}
+
+void unmap_whole_file(MappedFile *file)
+{
+    trace_assert(file);
+
+    if (file->data) {
+        UnmapViewOfFile(file->data);
+        file->data = NULL;
+    }
+}
+
+int file_stamp(FileStamp *stamp, const char *filepath)
+{
+    trace_assert(stamp);
+    trace_assert(filepath);
+
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(filepath, GetFileExInfoStandard, &data)) {
+        log_fail("Could not get the attributes of file %s\n", filepath);
+        return -1;
+    }
+
+    stamp->mtime = (int64_t) (((uint64_t) data.ftLastWriteTime.dwHighDateTime << 32)
+                              | data.ftLastWriteTime.dwLowDateTime);
+    stamp->size = (int64_t) (((uint64_t) data.nFileSizeHigh << 32) | data.nFileSizeLow);
+
+    return 0;
+}
+
+static int file_write_synced(const char *filepath, const void *data, size_t size)
+{
+    FILE *f = fopen(filepath, "wb");
+    if (f == NULL) {
+        log_fail("Could not open file %s: %s\n", filepath, strerror(errno));
+        return -1;
+    }
+
+    int result = 0;
+    if ((size > 0 && fwrite(data, 1, size, f) != size)
+        || fflush(f) != 0
+        || _commit(_fileno(f)) < 0) {
+        log_fail("Could not write file %s: %s\n", filepath, strerror(errno));
+        result = -1;
+    }
+
+    if (fclose(f) != 0 && result == 0) {
+        log_fail("Could not close file %s: %s\n", filepath, strerror(errno));
+        result = -1;
+    }
+
+    return result;
+}
+
+static int file_replace(const char *from, const char *to)
+{
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) ? 0 : -1;
+}
+
+#else
+
+int map_whole_file(MappedFile *file, const char *filepath)
+{
+    trace_assert(file);
+    trace_assert(filepath);
+
+    file->data = NULL;
+    file->size = 0;
+
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0) {
+        log_fail("Could not open file %s: %s\n", filepath, strerror(errno));
+        return -1;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) < 0) {
+        log_fail("Could not stat file %s: %s\n", filepath, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    if (file_stat.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+
+    // The mapping keeps the file alive after the descriptor is closed
+    void *data = mmap(NULL, (size_t) file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        log_fail("Could not map file %s: %s\n", filepath, strerror(errno));
+        return -1;
+    }
+
+    file->data = data;
+    file->size = (size_t) file_stat.st_size;
+
+    return 0;
+}
+
+void unmap_whole_file(MappedFile *file)
+{
+    trace_assert(file);
+
+    if (file->data) {
+        munmap(file->data, file->size);
+        file->data = NULL;
+    }
+}
+
+int file_stamp(FileStamp *stamp, const char *filepath)
+{
+    trace_assert(stamp);
+    trace_assert(filepath);
+
+    struct stat file_stat;
+    if (stat(filepath, &file_stat) < 0) {
+        log_fail("Could not stat file %s: %s\n", filepath, strerror(errno));
+        return -1;
+    }
+
+#ifdef __APPLE__
+    const struct timespec mtime = file_stat.st_mtimespec;
+#else
+    const struct timespec mtime = file_stat.st_mtim;
+#endif
+    stamp->mtime = (int64_t) mtime.tv_sec * 1000000000 + (int64_t) mtime.tv_nsec;
+    stamp->size = (int64_t) file_stat.st_size;
+
+    return 0;
+}
+
+static int file_write_synced(const char *filepath, const void *data, size_t size)
+{
+    int fd = open(filepath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        log_fail("Could not open file %s: %s\n", filepath, strerror(errno));
+        return -1;
+    }
+
+    const char *bytes = data;
+    while (size > 0) {
+        const ssize_t n = write(fd, bytes, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            log_fail("Could not write file %s: %s\n", filepath, strerror(errno));
+            close(fd);
+            return -1;
+        }
+        bytes += n;
+        size -= (size_t) n;
+    }
+
+    if (fsync(fd) < 0) {
+        log_fail("Could not write file %s: %s\n", filepath, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    if (close(fd) < 0) {
+        log_fail("Could not close file %s: %s\n", filepath, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+static int file_replace(const char *from, const char *to)
+{
+    return rename(from, to);
+}
+
+#endif
+
+int write_whole_file_atomic(const char *filepath, const void *data, size_t size)
+{
+    trace_assert(filepath);
+    trace_assert(data || size == 0);
+
+    // Hidden, so the file watchers and the level picker skip it
+    char temppath[FILE_PATH_MAX_SIZE];
+    const char *slash = strrchr(filepath, '/');
+    const int dir_len = slash ? (int) (slash - filepath + 1) : 0;
+    if (snprintf(temppath, FILE_PATH_MAX_SIZE, "%.*s.%s.tmp",
+                 dir_len, filepath, filepath + dir_len) >= FILE_PATH_MAX_SIZE) {
+        log_fail("Path %s is too long\n", filepath);
+        return -1;
+    }
+
+    int result = file_write_synced(temppath, data, size);
+    if (result == 0 && file_replace(temppath, filepath) < 0) {
+        log_fail("Could not replace file %s: %s\n", filepath, strerror(errno));
+        result = -1;
+    }
+
+    if (result < 0) {
+        remove(temppath);
+    }
+
+    return result;
+}
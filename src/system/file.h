@@ -1,6 +1,7 @@
 #ifndef FILE_H_
 #define FILE_H_
 
+#include <stdint.h>
 #include <time.h>
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
@@ -27,4 +28,41 @@ void closedir(DIR *dirp);
 
 String read_whole_file(Memory *memory, const char *filepath);
 
+// The whole file mapped into memory read-only instead of being
+// read. An empty file is not mapped at all and has NULL data.
+typedef struct {
+    void *data;
+    size_t size;
+} MappedFile;
+
+int map_whole_file(MappedFile *file, const char *filepath);
+void unmap_whole_file(MappedFile *file);
+
+static inline
+String mapped_file_content(const MappedFile *file)
+{
+    return string(file->size, file->data);
+}
+
+// What tells one version of a file from another without reading it
+typedef struct {
+    // Nanoseconds since the epoch, 100 nanosecond ticks on Windows,
+    // so two writes within the same second still differ
+    int64_t mtime;
+    int64_t size;
+} FileStamp;
+
+int file_stamp(FileStamp *stamp, const char *filepath);
+
+// Writes a hidden file next to filepath, flushes it to the disk and
+// renames it over filepath. Whoever reads filepath sees either the
+// old or the new file, never a half written one.
+int write_whole_file_atomic(const char *filepath, const void *data, size_t size);
+
+static inline
+int file_stamps_equal(FileStamp a, FileStamp b)
+{
+    return a.mtime == b.mtime && a.size == b.size;
+}
+
 #endif  // FILE_H_
@@ -0,0 +1,274 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#include <time.h>
+#endif
+
+#include "file_watcher.h"
+#include "system/file.h"
+#include "system/log.h"
+#include "system/lt.h"
+#include "system/nth_alloc.h"
+#include "system/stacktrace.h"
+
+#ifdef __linux__
+
+struct FileWatcher
+{
+    Lt *lt;
+    int fd;
+    // The events read from the inotify descriptor that were not
+    // handed out yet
+    _Alignas(struct inotify_event) char buffer[4096];
+    size_t size;
+    size_t offset;
+};
+
+FileWatcher *create_file_watcher(const char *dirpath)
+{
+    trace_assert(dirpath);
+
+    Lt *lt = create_lt();
+
+    FileWatcher *watcher = PUSH_LT(lt, nth_calloc(1, sizeof(FileWatcher)), free);
+    if (watcher == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+    watcher->lt = lt;
+
+    watcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watcher->fd < 0) {
+        log_fail("Could not initialize inotify: %s\n", strerror(errno));
+        RETURN_LT(lt, NULL);
+    }
+
+    if (inotify_add_watch(watcher->fd, dirpath,
+                          IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM) < 0) {
+        log_fail("Could not watch %s: %s\n", dirpath, strerror(errno));
+        close(watcher->fd);
+        RETURN_LT(lt, NULL);
+    }
+
+    return watcher;
+}
+
+void destroy_file_watcher(FileWatcher *watcher)
+{
+    trace_assert(watcher);
+    close(watcher->fd);
+    RETURN_LT0(watcher->lt);
+}
+
+int file_watcher_poll(FileWatcher *watcher, FileWatchEvent *event)
+{
+    trace_assert(watcher);
+    trace_assert(event);
+
+    for (;;) {
+        if (watcher->offset >= watcher->size) {
+            const ssize_t n = read(watcher->fd, watcher->buffer, sizeof(watcher->buffer));
+            if (n <= 0) {
+                return 0;
+            }
+            watcher->size = (size_t) n;
+            watcher->offset = 0;
+        }
+
+        const struct inotify_event *inotify_event =
+            (const void *) (watcher->buffer + watcher->offset);
+        watcher->offset += sizeof(struct inotify_event) + inotify_event->len;
+
+        // The events of the folder itself do not have a name
+        if (inotify_event->len == 0) {
+            if (inotify_event->mask & IN_Q_OVERFLOW) {
+                log_warn("Some of the file changes were lost\n");
+            }
+            continue;
+        }
+
+        if (*inotify_event->name == '.') {
+            continue;
+        }
+
+        event->type = (inotify_event->mask & (IN_DELETE | IN_MOVED_FROM))
+            ? FILE_WATCH_REMOVED
+            : FILE_WATCH_WRITTEN;
+        snprintf(event->name, FILE_WATCHER_NAME_MAX_SIZE, "%s", inotify_event->name);
+
+        return 1;
+    }
+}
+
+#else
+
+#define FILE_WATCHER_PATH_MAX_SIZE 512
+
+typedef struct {
+    char name[FILE_WATCHER_NAME_MAX_SIZE];
+    FileStamp stamp;
+    bool seen;
+} FileWatchEntry;
+
+struct FileWatcher
+{
+    Lt *lt;
+    char dirpath[FILE_WATCHER_PATH_MAX_SIZE];
+    time_t scanned_at;
+
+    // The files of the last scan sorted by name
+    FileWatchEntry *entries;
+    size_t entries_count;
+    size_t entries_capacity;
+
+    // The differences found by the last scan
+    FileWatchEvent *events;
+    size_t events_begin;
+    size_t events_count;
+    size_t events_capacity;
+};
+
+static int file_watch_entry_compare(const void *a, const void *b)
+{
+    return strcmp(((const FileWatchEntry *) a)->name, ((const FileWatchEntry *) b)->name);
+}
+
+static void file_watcher_push_event(FileWatcher *watcher,
+                                    FileWatchEventType type,
+                                    const char *name)
+{
+    if (watcher->events_count >= watcher->events_capacity) {
+        watcher->events_capacity = watcher->events_capacity == 0 ? 16 : watcher->events_capacity * 2;
+        watcher->events = realloc(watcher->events, watcher->events_capacity * sizeof(FileWatchEvent));
+        trace_assert(watcher->events);
+    }
+
+    FileWatchEvent *event = &watcher->events[watcher->events_count++];
+    event->type = type;
+    snprintf(event->name, FILE_WATCHER_NAME_MAX_SIZE, "%s", name);
+}
+
+static void file_watcher_scan(FileWatcher *watcher, bool report)
+{
+    watcher->scanned_at = time(NULL);
+    watcher->events_begin = 0;
+    watcher->events_count = 0;
+
+    DIR *dir = opendir(watcher->dirpath);
+    if (dir == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < watcher->entries_count; ++i) {
+        watcher->entries[i].seen = false;
+    }
+
+    const size_t known_count = watcher->entries_count;
+    char filepath[FILE_WATCHER_PATH_MAX_SIZE + FILE_WATCHER_NAME_MAX_SIZE];
+    for (struct dirent *d = readdir(dir); d != NULL; d = readdir(dir)) {
+        if (*d->d_name == '.') continue;
+
+        FileWatchEntry key;
+        snprintf(key.name, FILE_WATCHER_NAME_MAX_SIZE, "%s", d->d_name);
+        snprintf(filepath, sizeof(filepath), "%s/%s", watcher->dirpath, key.name);
+        if (file_stamp(&key.stamp, filepath) < 0) {
+            continue;
+        }
+        key.seen = true;
+
+        FileWatchEntry *entry = known_count == 0 ? NULL : bsearch(
+            &key, watcher->entries, known_count,
+            sizeof(FileWatchEntry), file_watch_entry_compare);
+
+        if (entry == NULL) {
+            if (watcher->entries_count >= watcher->entries_capacity) {
+                watcher->entries_capacity = watcher->entries_capacity == 0
+                    ? 64
+                    : watcher->entries_capacity * 2;
+                watcher->entries = realloc(
+                    watcher->entries,
+                    watcher->entries_capacity * sizeof(FileWatchEntry));
+                trace_assert(watcher->entries);
+            }
+            watcher->entries[watcher->entries_count++] = key;
+        } else if (!file_stamps_equal(entry->stamp, key.stamp)) {
+            *entry = key;
+        } else {
+            entry->seen = true;
+            continue;
+        }
+
+        if (report) {
+            file_watcher_push_event(watcher, FILE_WATCH_WRITTEN, key.name);
+        }
+    }
+    closedir(dir);
+
+    size_t n = 0;
+    for (size_t i = 0; i < watcher->entries_count; ++i) {
+        if (watcher->entries[i].seen) {
+            watcher->entries[n++] = watcher->entries[i];
+        } else if (report) {
+            file_watcher_push_event(watcher, FILE_WATCH_REMOVED, watcher->entries[i].name);
+        }
+    }
+    watcher->entries_count = n;
+
+    qsort(watcher->entries, watcher->entries_count,
+          sizeof(FileWatchEntry), file_watch_entry_compare);
+}
+
+FileWatcher *create_file_watcher(const char *dirpath)
+{
+    trace_assert(dirpath);
+
+    Lt *lt = create_lt();
+
+    FileWatcher *watcher = PUSH_LT(lt, nth_calloc(1, sizeof(FileWatcher)), free);
+    if (watcher == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+    watcher->lt = lt;
+
+    snprintf(watcher->dirpath, FILE_WATCHER_PATH_MAX_SIZE, "%s", dirpath);
+
+    // Whatever is in the folder already is not a change
+    file_watcher_scan(watcher, false);
+
+    return watcher;
+}
+
+void destroy_file_watcher(FileWatcher *watcher)
+{
+    trace_assert(watcher);
+    free(watcher->entries);
+    free(watcher->events);
+    RETURN_LT0(watcher->lt);
+}
+
+int file_watcher_poll(FileWatcher *watcher, FileWatchEvent *event)
+{
+    trace_assert(watcher);
+    trace_assert(event);
+
+    if (watcher->events_begin >= watcher->events_count
+        && time(NULL) - watcher->scanned_at >= FILE_WATCHER_POLL_INTERVAL) {
+        file_watcher_scan(watcher, true);
+    }
+
+    if (watcher->events_begin >= watcher->events_count) {
+        return 0;
+    }
+
+    *event = watcher->events[watcher->events_begin++];
+
+    return 1;
+}
+
+#endif
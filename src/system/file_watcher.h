@@ -0,0 +1,34 @@
+#ifndef FILE_WATCHER_H_
+#define FILE_WATCHER_H_
+
+#define FILE_WATCHER_NAME_MAX_SIZE 256
+// How often (in seconds) the folder is rescanned where there is no
+// way to be notified about the changes
+#define FILE_WATCHER_POLL_INTERVAL 1
+
+typedef enum {
+    // The file is complete: it was closed after writing or renamed
+    // into the folder
+    FILE_WATCH_WRITTEN = 0,
+    FILE_WATCH_REMOVED
+} FileWatchEventType;
+
+typedef struct {
+    FileWatchEventType type;
+    // Relative to the watched folder
+    char name[FILE_WATCHER_NAME_MAX_SIZE];
+} FileWatchEvent;
+
+// Tells about the files of a folder being written and removed. Uses
+// inotify on Linux and rescans the folder anywhere else. The hidden
+// files (the name starts with a dot) are left out.
+typedef struct FileWatcher FileWatcher;
+
+FileWatcher *create_file_watcher(const char *dirpath);
+void destroy_file_watcher(FileWatcher *watcher);
+
+// Never blocks. Returns 1 and fills event when something happened,
+// 0 when nothing did.
+int file_watcher_poll(FileWatcher *watcher, FileWatchEvent *event);
+
+#endif  // FILE_WATCHER_H_
@@ -0,0 +1,165 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./frame_scheduler.h"
+#include "system/log.h"
+#include "system/stacktrace.h"
+
+// SDL_Delay is only precise up to the granularity of the OS
+// scheduler. We sleep until we are this close to the deadline and
+// spin for the rest of the frame.
+#define FRAME_SCHEDULER_SPIN_MS 2
+
+void frame_stats_push(FrameStats *stats, float frame_time)
+{
+    trace_assert(stats);
+
+    const size_t i = (stats->begin + stats->count) % FRAME_STATS_CAPACITY;
+    stats->samples[i] = frame_time;
+    if (stats->count < FRAME_STATS_CAPACITY) {
+        stats->count += 1;
+    } else {
+        stats->begin = (stats->begin + 1) % FRAME_STATS_CAPACITY;
+    }
+
+    if (stats->total_count == 0) {
+        stats->min = frame_time;
+        stats->max = frame_time;
+    } else {
+        stats->min = fminf(stats->min, frame_time);
+        stats->max = fmaxf(stats->max, frame_time);
+    }
+    stats->total_count += 1;
+    stats->total_time += frame_time;
+}
+
+static int frame_stats_compare(const void *a, const void *b)
+{
+    const float x = *(const float *) a;
+    const float y = *(const float *) b;
+    return (x > y) - (x < y);
+}
+
+float frame_stats_percentile(const FrameStats *stats, float percentile)
+{
+    trace_assert(stats);
+    trace_assert(0.0f <= percentile && percentile <= 1.0f);
+
+    if (stats->count == 0) {
+        return 0.0f;
+    }
+
+    float sorted[FRAME_STATS_CAPACITY];
+    memcpy(sorted, stats->samples, sizeof(float) * stats->count);
+    qsort(sorted, stats->count, sizeof(float), frame_stats_compare);
+
+    return sorted[(size_t) (percentile * (float) (stats->count - 1))];
+}
+
+void frame_stats_log(const FrameStats *stats, const char *name)
+{
+    trace_assert(stats);
+    trace_assert(name);
+
+    if (stats->total_count == 0) {
+        return;
+    }
+
+    log_info("%s over %lu frames: avg %.3fms, min %.3fms, max %.3fms, p50 %.3fms, p99 %.3fms\n",
+             name,
+             (unsigned long) stats->total_count,
+             stats->total_time / (double) stats->total_count * 1000.0,
+             stats->min * 1000.0f,
+             stats->max * 1000.0f,
+             frame_stats_percentile(stats, 0.50f) * 1000.0f,
+             frame_stats_percentile(stats, 0.99f) * 1000.0f);
+}
+
+FrameScheduler create_frame_scheduler(int fps)
+{
+    FrameScheduler result;
+    memset(&result, 0, sizeof(result));
+
+    result.frequency = SDL_GetPerformanceFrequency();
+    if (fps > 0) {
+        result.frame_duration = result.frequency / (Uint64) fps;
+    }
+    frame_scheduler_reset(&result);
+
+    return result;
+}
+
+void frame_scheduler_vsync(FrameScheduler *scheduler, int refresh_rate)
+{
+    trace_assert(scheduler);
+    scheduler->vsync_period = refresh_rate > 0
+        ? scheduler->frequency / (Uint64) refresh_rate
+        : 0;
+}
+
+void frame_scheduler_reset(FrameScheduler *scheduler)
+{
+    trace_assert(scheduler);
+    scheduler->last_frame = SDL_GetPerformanceCounter();
+    scheduler->deadline = scheduler->last_frame + scheduler->frame_duration;
+    scheduler->fresh = 1;
+}
+
+float frame_scheduler_begin(FrameScheduler *scheduler)
+{
+    trace_assert(scheduler);
+
+    const Uint64 now = SDL_GetPerformanceCounter();
+    const float frame_time = (float) ((double) (now - scheduler->last_frame) / (double) scheduler->frequency);
+    scheduler->last_frame = now;
+
+    // The first frame after a reset measures the time spent idling
+    // rather than a frame, so it does not go into the stats.
+    if (scheduler->fresh) {
+        scheduler->fresh = 0;
+    } else {
+        frame_stats_push(&scheduler->stats, frame_time);
+    }
+
+    return frame_time;
+}
+
+void frame_scheduler_wait(FrameScheduler *scheduler)
+{
+    trace_assert(scheduler);
+
+    if (scheduler->frame_duration == 0) {
+        return;
+    }
+
+    // SDL_RenderPresent already blocks until the next vertical blank,
+    // so waiting on top of it only makes us miss the next one.
+    if (scheduler->vsync_period > 0 && scheduler->frame_duration <= scheduler->vsync_period) {
+        return;
+    }
+
+    // Wake up half a refresh early so the present still lands on the
+    // vertical blank we are aiming for.
+    const Uint64 deadline = scheduler->deadline - scheduler->vsync_period / 2;
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (now < deadline) {
+        const Uint64 remaining_ms = (deadline - now) * 1000 / scheduler->frequency;
+        if (remaining_ms > FRAME_SCHEDULER_SPIN_MS) {
+            SDL_Delay((Uint32) (remaining_ms - FRAME_SCHEDULER_SPIN_MS));
+        }
+
+        do {
+            now = SDL_GetPerformanceCounter();
+        } while (now < deadline);
+    }
+
+    scheduler->deadline += scheduler->frame_duration;
+
+    // We are late by more than a frame. Do not try to catch up with a
+    // burst of frames, just schedule the next one from now.
+    if (scheduler->deadline < now) {
+        scheduler->deadline = now + scheduler->frame_duration;
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef FRAME_SCHEDULER_H_
+#define FRAME_SCHEDULER_H_
+
+#include <SDL.h>
+
+#define FRAME_STATS_CAPACITY 1024
+
+typedef struct {
+    // Last FRAME_STATS_CAPACITY frame times in seconds
+    float samples[FRAME_STATS_CAPACITY];
+    size_t begin;
+    size_t count;
+
+    size_t total_count;
+    double total_time;
+    float min;
+    float max;
+} FrameStats;
+
+void frame_stats_push(FrameStats *stats, float frame_time);
+float frame_stats_percentile(const FrameStats *stats, float percentile);
+void frame_stats_log(const FrameStats *stats, const char *name);
+
+typedef struct {
+    Uint64 frequency;
+    // Target duration of a frame in performance counter ticks. 0 means uncapped.
+    Uint64 frame_duration;
+    // Refresh period of the display in ticks when the renderer presents with vsync. 0 otherwise.
+    Uint64 vsync_period;
+    Uint64 deadline;
+    Uint64 last_frame;
+    int fresh;
+
+    FrameStats stats;
+} FrameScheduler;
+
+FrameScheduler create_frame_scheduler(int fps);
+void frame_scheduler_vsync(FrameScheduler *scheduler, int refresh_rate);
+void frame_scheduler_reset(FrameScheduler *scheduler);
+float frame_scheduler_begin(FrameScheduler *scheduler);
+void frame_scheduler_wait(FrameScheduler *scheduler);
+
+#endif  // FRAME_SCHEDULER_H_
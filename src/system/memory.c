@@ -0,0 +1,141 @@
+#include <stdlib.h>
+
+#include "system/memory.h"
+#include "system/nth_alloc.h"
+
+void *memory_alloc_block(Memory *memory, size_t size)
+{
+    assert(memory);
+
+    // The blocks are as big as the buffer they follow, so a memory
+    // that keeps growing does not chain too many of them
+    const size_t capacity = size > memory->capacity ? size : memory->capacity;
+    if (capacity > SIZE_MAX - sizeof(MemoryBlock)) {
+        return NULL;
+    }
+
+    MemoryBlock *block = nth_calloc(1, sizeof(MemoryBlock) + capacity);
+    if (block == NULL) {
+        return NULL;
+    }
+
+    // Whatever is left in the full buffer can still be reused
+    memory_free(memory, memory->buffer + memory->size, memory->capacity - memory->size);
+
+    block->prev = memory->blocks;
+    block->buffer = memory->buffer;
+    block->capacity = memory->capacity;
+    block->size = memory->size;
+
+    memory->blocks = block;
+    memory->blocks_size += memory->size;
+    memory->buffer = (uint8_t *) (block + 1);
+    memory->capacity = capacity;
+    memory->size = 0;
+
+    memory->blocks_count += 1;
+    if (memory->blocks_count > memory->blocks_high_water) {
+        memory->blocks_high_water = memory->blocks_count;
+    }
+
+    return memory_try_alloc(memory, size);
+}
+
+static void memory_pop_block(Memory *memory)
+{
+    MemoryBlock *block = memory->blocks;
+    assert(block);
+
+    memory->blocks = block->prev;
+    memory->blocks_size -= block->size;
+    memory->buffer = block->buffer;
+    memory->capacity = block->capacity;
+    memory->size = block->size;
+    memory->blocks_count -= 1;
+
+    free(block);
+}
+
+void memory_clean(Memory *memory)
+{
+    assert(memory);
+
+    while (memory->blocks != NULL) {
+        memory_pop_block(memory);
+    }
+
+    memory->size = 0;
+    memory->free_blocks = NULL;
+}
+
+static int memory_buffer_holds(const uint8_t *buffer, size_t size,
+                               const uint8_t *bytes, size_t bytes_size)
+{
+    const uintptr_t begin = (uintptr_t) buffer;
+    const uintptr_t it = (uintptr_t) bytes;
+    return begin <= it && it - begin <= size && bytes_size <= size - (it - begin);
+}
+
+// Whether the freed block lies below the mark, either in the buffer of
+// the mark or in one of the buffers chained before it
+static int memory_below_mark(const Memory *memory, MemoryMark mark,
+                             const uint8_t *bytes, size_t size)
+{
+    if (memory_buffer_holds(mark.buffer, mark.size, bytes, size)) {
+        return 1;
+    }
+
+    const MemoryBlock *block = memory->blocks;
+    if (memory->buffer != mark.buffer) {
+        while (block->buffer != mark.buffer) {
+            block = block->prev;
+        }
+        block = block->prev;
+    }
+
+    for (; block != NULL; block = block->prev) {
+        if (memory_buffer_holds(block->buffer, block->capacity, bytes, size)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+void memory_rollback(Memory *memory, MemoryMark mark)
+{
+    assert(memory);
+
+    // Only the freed blocks above the mark go away with it. They are
+    // dropped before their buffers are, since the list runs through
+    // them.
+    uint8_t *kept = NULL;
+    uint8_t *last = NULL;
+    for (uint8_t *it = memory->free_blocks; it != NULL;) {
+        MemoryFreeBlock header;
+        memcpy(&header, it, sizeof(header));
+
+        if (memory_below_mark(memory, mark, it, header.size)) {
+            if (last == NULL) {
+                kept = it;
+            } else {
+                memcpy(last + offsetof(MemoryFreeBlock, next), &it, sizeof(it));
+            }
+            last = it;
+        }
+
+        it = header.next;
+    }
+    if (last != NULL) {
+        uint8_t *const end = NULL;
+        memcpy(last + offsetof(MemoryFreeBlock, next), &end, sizeof(end));
+    }
+    memory->free_blocks = kept;
+
+    while (memory->buffer != mark.buffer) {
+        memory_pop_block(memory);
+    }
+
+    assert(mark.size <= memory->size);
+    memory->size = mark.size;
+}
@@ -2,35 +2,195 @@
 #define MEMORY_H_
 
 #include <assert.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 #define KILO 1024L
 #define MEGA (1024L * KILO)
 #define GIGA (1024L * MEGA)
 
+// The header memory_free() writes into the block it gives back. The
+// blocks are not aligned, so it is only ever memcpy-ed.
 typedef struct {
+    uint8_t *next;
+    size_t size;
+} MemoryFreeBlock;
+
+// The header of a block the memory chains when its buffer is full.
+// Remembers the buffer that was full.
+typedef struct MemoryBlock MemoryBlock;
+struct MemoryBlock {
+    MemoryBlock *prev;
+    uint8_t *buffer;
+    size_t capacity;
+    size_t size;
+};
+
+// The buffer of the memory belongs to whoever made the memory. When
+// it is full the memory allocates blocks of its own, which go away
+// with memory_clean() and memory_rollback().
+typedef struct {
+    // The block the memory allocates from
     size_t capacity;
     size_t size;
     uint8_t *buffer;
+    // The blocks given back with memory_free(), reused by
+    // memory_realloc()
+    uint8_t *free_blocks;
+
+    // The blocks chained after the first buffer, newest first
+    MemoryBlock *blocks;
+    // How many bytes the full blocks of the chain hold
+    size_t blocks_size;
+
+    // Stats over the whole life of the memory
+    size_t blocks_count;
+    size_t blocks_high_water;
+    size_t high_water;
 } Memory;
 
+// Where the memory is at the moment. memory_rollback() frees
+// everything allocated after that.
+typedef struct {
+    uint8_t *buffer;
+    size_t size;
+} MemoryMark;
+
+// Chains a block big enough for size bytes. Returns NULL when the
+// block could not be allocated.
+void *memory_alloc_block(Memory *memory, size_t size);
+void memory_clean(Memory *memory);
+void memory_rollback(Memory *memory, MemoryMark mark);
+
 static inline
-void *memory_alloc(Memory *memory, size_t size)
+size_t memory_used(const Memory *memory)
+{
+    assert(memory);
+    return memory->blocks_size + memory->size;
+}
+
+// Like memory_alloc(), but returns NULL instead of asserting when
+// the memory cannot grow anymore
+static inline
+void *memory_try_alloc(Memory *memory, size_t size)
 {
     assert(memory);
-    assert(memory->size + size <= memory->capacity);
+
+    if (size > memory->capacity - memory->size) {
+        return memory_alloc_block(memory, size);
+    }
 
     void *result = memory->buffer + memory->size;
     memory->size += size;
 
+    if (memory_used(memory) > memory->high_water) {
+        memory->high_water = memory_used(memory);
+    }
+
+    return result;
+}
+
+static inline
+void *memory_alloc(Memory *memory, size_t size)
+{
+    void *result = memory_try_alloc(memory, size);
+    assert(result);
+    return result;
+}
+
+// Gives the block back to the memory. The last allocation is undone
+// right away, the rest are remembered for memory_realloc().
+static inline
+void memory_free(Memory *memory, void *block, size_t size)
+{
+    assert(memory);
+
+    uint8_t *bytes = block;
+    if (bytes == NULL) {
+        return;
+    }
+
+    if (bytes + size == memory->buffer + memory->size) {
+        memory->size -= size;
+        return;
+    }
+
+    if (size >= sizeof(MemoryFreeBlock)) {
+        const MemoryFreeBlock header = {memory->free_blocks, size};
+        memcpy(bytes, &header, sizeof(header));
+        memory->free_blocks = bytes;
+    }
+}
+
+// Grows the block from old_size to new_size keeping its content. The
+// last allocation is grown in place if the buffer has room for it,
+// otherwise a freed block that is big enough is reused, and what is
+// left of it stays free, before a new one is allocated. Returns NULL and keeps the block when the memory
+// cannot grow anymore.
+static inline
+void *memory_realloc(Memory *memory, void *block, size_t old_size, size_t new_size)
+{
+    assert(memory);
+    assert(old_size <= new_size);
+
+    uint8_t *bytes = block;
+    if (bytes != NULL
+        && bytes + old_size == memory->buffer + memory->size
+        && new_size - old_size <= memory->capacity - memory->size) {
+        memory_alloc(memory, new_size - old_size);
+        return bytes;
+    }
+
+    uint8_t *result = NULL;
+    uint8_t *previous = NULL;
+    for (uint8_t *it = memory->free_blocks; it != NULL;) {
+        MemoryFreeBlock header;
+        memcpy(&header, it, sizeof(header));
+
+        if (header.size >= new_size) {
+            // The rest of the block stays free if it can hold a header
+            uint8_t *rest = header.next;
+            if (header.size - new_size >= sizeof(MemoryFreeBlock)) {
+                rest = it + new_size;
+                const MemoryFreeBlock rest_header = {header.next, header.size - new_size};
+                memcpy(rest, &rest_header, sizeof(rest_header));
+            }
+
+            if (previous == NULL) {
+                memory->free_blocks = rest;
+            } else {
+                memcpy(previous + offsetof(MemoryFreeBlock, next), &rest, sizeof(rest));
+            }
+            result = it;
+            break;
+        }
+
+        previous = it;
+        it = header.next;
+    }
+
+    if (result == NULL) {
+        result = memory_try_alloc(memory, new_size);
+        if (result == NULL) {
+            return NULL;
+        }
+    }
+
+    if (bytes != NULL) {
+        memcpy(result, bytes, old_size);
+        memory_free(memory, bytes, old_size);
+    }
+
     return result;
 }
 
 static inline
-void memory_clean(Memory *memory)
+MemoryMark memory_mark(const Memory *memory)
 {
     assert(memory);
-    memory->size = 0;
+    MemoryMark mark = {memory->buffer, memory->size};
+    return mark;
 }
 
 #endif  // MEMORY_H_
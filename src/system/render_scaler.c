@@ -0,0 +1,66 @@
+#include <math.h>
+
+#include "./render_scaler.h"
+#include "config.h"
+#include "system/log.h"
+#include "system/stacktrace.h"
+
+RenderScaler create_render_scaler(float scale)
+{
+    RenderScaler scaler = {
+        .scale = fminf(fmaxf(scale, RENDER_SCALE_MIN), 1.0f),
+        .automatic = 0
+    };
+
+    return scaler;
+}
+
+RenderScaler create_auto_render_scaler(float budget)
+{
+    trace_assert(budget > 0.0f);
+
+    RenderScaler scaler = {
+        .scale = 1.0f,
+        .automatic = 1,
+        .budget = budget
+    };
+
+    return scaler;
+}
+
+void render_scaler_push(RenderScaler *scaler, float render_time)
+{
+    trace_assert(scaler);
+
+    if (!scaler->automatic) {
+        return;
+    }
+
+    scaler->average = scaler->average > 0.0f
+        ? scaler->average + (render_time - scaler->average) * RENDER_SCALE_SMOOTHING
+        : render_time;
+
+    if (scaler->cooldown > 0) {
+        scaler->cooldown -= 1;
+        return;
+    }
+
+    // The render time is roughly proportional to the amount of
+    // pixels, so there is a wide dead zone between going down and
+    // going back up to keep the scale from oscillating.
+    float scale = scaler->scale;
+    if (scaler->average > scaler->budget) {
+        scale = fmaxf(scale - RENDER_SCALE_STEP, RENDER_SCALE_MIN);
+    } else if (scaler->average < scaler->budget * RENDER_SCALE_HEADROOM) {
+        scale = fminf(scale + RENDER_SCALE_STEP, 1.0f);
+    }
+
+    if (scale != scaler->scale) {
+        log_info("Render scale %.2f -> %.2f (%.2fms per frame)\n",
+                 (double) scaler->scale,
+                 (double) scale,
+                 (double) scaler->average * 1000.0);
+        scaler->scale = scale;
+        scaler->cooldown = RENDER_SCALE_COOLDOWN;
+    }
+}
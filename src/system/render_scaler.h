@@ -0,0 +1,23 @@
+#ifndef RENDER_SCALER_H_
+#define RENDER_SCALER_H_
+
+// Picks the fraction of the view port the world is rendered at
+// (see DrawList::render_scale). Either fixed or adjusted
+// automatically to keep the measured render time within the budget.
+typedef struct {
+    float scale;
+    int automatic;
+    // Render time we aim for in seconds
+    float budget;
+    // Moving average of the measured render times
+    float average;
+    // Frames left before the next adjustment
+    int cooldown;
+} RenderScaler;
+
+RenderScaler create_render_scaler(float scale);
+RenderScaler create_auto_render_scaler(float budget);
+
+void render_scaler_push(RenderScaler *scaler, float render_time);
+
+#endif  // RENDER_SCALER_H_
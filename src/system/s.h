@@ -109,6 +109,67 @@ String chop_word(String *input)
     return result;
 }
 
+// The number parsers below read the string in place. Just like
+// atol() and strtof() they skip the leading whitespace, parse the
+// longest prefix that looks like a number and return 0 if there is
+// none.
+
+static inline
+long string_to_long(String s)
+{
+    s = trim_begin(s);
+
+    size_t i = 0;
+    int negative = 0;
+    if (i < s.count && (s.data[i] == '-' || s.data[i] == '+')) {
+        negative = s.data[i] == '-';
+        i += 1;
+    }
+
+    long result = 0;
+    while (i < s.count && isdigit(s.data[i])) {
+        result = result * 10 + (s.data[i] - '0');
+        i += 1;
+    }
+
+    return negative ? -result : result;
+}
+
+static inline
+unsigned long string_hex_to_ulong(String s)
+{
+    s = trim_begin(s);
+
+    unsigned long result = 0;
+    for (size_t i = 0; i < s.count && isxdigit(s.data[i]); ++i) {
+        const char c = s.data[i];
+        const unsigned long digit =
+            isdigit(c) ? (unsigned long) (c - '0') :
+            (unsigned long) (tolower(c) - 'a' + 10);
+        result = result * 16 + digit;
+    }
+
+    return result;
+}
+
+// Longer numbers are cut, nothing in the levels comes even close
+#define STRING_FLOAT_MAX_LENGTH 63
+
+static inline
+float string_to_float(String s)
+{
+    s = trim_begin(s);
+
+    // strtof() needs a NUL-terminated string, the copy stays on the
+    // stack instead of the memory arena
+    char buffer[STRING_FLOAT_MAX_LENGTH + 1];
+    const size_t n = s.count < STRING_FLOAT_MAX_LENGTH ? s.count : STRING_FLOAT_MAX_LENGTH;
+    memcpy(buffer, s.data, n);
+    buffer[n] = '\0';
+
+    return strtof(buffer, NULL);
+}
+
 static inline
 char *string_to_cstr(Memory *memory, String s)
 {
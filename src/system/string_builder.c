@@ -0,0 +1,120 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "system/stacktrace.h"
+#include "./string_builder.h"
+
+#define SB_INITIAL_CAPACITY 4096
+// Past that the float does not fit into the integer with six
+// decimals and printf takes over
+#define SB_FLOAT_FAST_LIMIT 1e12
+
+void sb_reserve(StringBuilder *sb, size_t size)
+{
+    trace_assert(sb);
+
+    if (sb->count + size <= sb->capacity) {
+        return;
+    }
+
+    size_t capacity = sb->capacity == 0 ? SB_INITIAL_CAPACITY : sb->capacity;
+    while (sb->count + size > capacity) {
+        capacity *= 2;
+    }
+
+    sb->data = realloc(sb->data, capacity);
+    trace_assert(sb->data);
+    sb->capacity = capacity;
+}
+
+void sb_append(StringBuilder *sb, const void *data, size_t size)
+{
+    trace_assert(sb);
+    trace_assert(data || size == 0);
+
+    if (size == 0) {
+        return;
+    }
+
+    sb_reserve(sb, size);
+    memcpy(sb->data + sb->count, data, size);
+    sb->count += size;
+}
+
+void sb_append_cstr(StringBuilder *sb, const char *cstr)
+{
+    trace_assert(cstr);
+    sb_append(sb, cstr, strlen(cstr));
+}
+
+void sb_append_cstr_n(StringBuilder *sb, const char *cstr, size_t max)
+{
+    trace_assert(cstr);
+
+    size_t n = 0;
+    while (n < max && cstr[n] != '\0') {
+        n += 1;
+    }
+
+    sb_append(sb, cstr, n);
+}
+
+void sb_append_char(StringBuilder *sb, char c)
+{
+    sb_reserve(sb, 1);
+    sb->data[sb->count++] = c;
+}
+
+void sb_append_size(StringBuilder *sb, size_t n)
+{
+    char digits[32];
+    size_t i = sizeof(digits);
+    do {
+        digits[--i] = (char) ('0' + n % 10);
+        n /= 10;
+    } while (n > 0);
+
+    sb_append(sb, digits + i, sizeof(digits) - i);
+}
+
+void sb_append_float(StringBuilder *sb, float x)
+{
+    trace_assert(sb);
+
+    const double value = fabs((double) x);
+    if (!(value < SB_FLOAT_FAST_LIMIT)) {
+        char buffer[64];
+        const int n = snprintf(buffer, sizeof(buffer), "%f", x);
+        trace_assert(n > 0);
+        sb_append(sb, buffer, (size_t) n);
+        return;
+    }
+
+    // A float has 24 significant bits and a million takes 14, so the
+    // product is exact in a double. llrint() rounds the ties to even
+    // just like printf does.
+    const long long scaled = llrint(value * 1e6);
+
+    if (signbit(x)) {
+        sb_append_char(sb, '-');
+    }
+    sb_append_size(sb, (size_t) (scaled / 1000000));
+    sb_append_char(sb, '.');
+
+    char fraction[6];
+    long long rest = scaled % 1000000;
+    for (size_t i = sizeof(fraction); i-- > 0;) {
+        fraction[i] = (char) ('0' + rest % 10);
+        rest /= 10;
+    }
+    sb_append(sb, fraction, sizeof(fraction));
+}
+
+void sb_append_hex_byte(StringBuilder *sb, unsigned char byte)
+{
+    static const char digits[] = "0123456789abcdef";
+    sb_reserve(sb, 2);
+    sb->data[sb->count++] = digits[byte >> 4];
+    sb->data[sb->count++] = digits[byte & 0xf];
+}
@@ -0,0 +1,40 @@
+#ifndef STRING_BUILDER_H_
+#define STRING_BUILDER_H_
+
+#include <stdlib.h>
+
+// Grows on demand. The data is not terminated with zero.
+typedef struct {
+    size_t count;
+    size_t capacity;
+    char *data;
+} StringBuilder;
+
+static inline
+void sb_clean(StringBuilder *sb)
+{
+    sb->count = 0;
+}
+
+static inline
+void destroy_string_builder(StringBuilder *sb)
+{
+    free(sb->data);
+    sb->data = NULL;
+    sb->count = 0;
+    sb->capacity = 0;
+}
+
+void sb_reserve(StringBuilder *sb, size_t size);
+void sb_append(StringBuilder *sb, const void *data, size_t size);
+void sb_append_cstr(StringBuilder *sb, const char *cstr);
+// Stops at zero or after max characters, whatever comes first
+void sb_append_cstr_n(StringBuilder *sb, const char *cstr, size_t max);
+void sb_append_char(StringBuilder *sb, char c);
+void sb_append_size(StringBuilder *sb, size_t n);
+// Exactly what printf("%f") prints without going through printf
+void sb_append_float(StringBuilder *sb, float x);
+// Two lower case hex digits
+void sb_append_hex_byte(StringBuilder *sb, unsigned char byte);
+
+#endif  // STRING_BUILDER_H_
@@ -187,8 +187,7 @@ int console_render(const Console *console,
                    const Camera *camera)
 {
     /* TODO(#364): console doesn't have any padding around the edit fields */
-    SDL_Rect view_port;
-    SDL_RenderGetViewport(camera->renderer, &view_port);
+    const Rect view_port = camera_view_port_screen(camera);
 
     const float e = console->a * (2 - console->a);
     const float y = -(1.0f - e) * CONSOLE_HEIGHT;
@@ -196,7 +195,7 @@ int console_render(const Console *console,
     if (camera_fill_rect_screen(
             camera,
             rect(0.0f, y,
-                 (float) view_port.w,
+                 view_port.w,
                  CONSOLE_HEIGHT),
             CONSOLE_BACKGROUND) < 0) {
         return -1;
@@ -235,3 +234,9 @@ void console_slide_down(Console *console)
     trace_assert(console);
     console->a = 0.0f;
 }
+
+int console_sliding(const Console *console)
+{
+    trace_assert(console);
+    return console->a < 1.0f;
+}
@@ -20,5 +20,6 @@ int console_update(Console *console,
                    float delta_time);
 
 void console_slide_down(Console *console);
+int console_sliding(const Console *console);
 
 #endif  // CONSOLE_H_
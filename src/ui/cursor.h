@@ -3,6 +3,8 @@
 
 #include <SDL.h>
 
+#include "sdl/draw_list.h"
+
 #define CURSOR_ICON_WIDTH 32
 #define CURSOR_ICON_HEIGHT 32
 
@@ -33,10 +35,13 @@ static const int cursor_style_tex_pivots[CURSOR_STYLE_N][2] = {
 };
 
 typedef struct {
-    SDL_Texture *texs[CURSOR_STYLE_N];
+    SDL_Texture *texture;
+    SDL_Surface *surface;
+    // Where every style is within the texture (see sdl/atlas.h)
+    SDL_Rect rects[CURSOR_STYLE_N];
     Cursor_Style style;
 } Cursor;
 
-int cursor_render(const Cursor *cursor, SDL_Renderer *renderer);
+int cursor_render(const Cursor *cursor, DrawList *draw_list);
 
 #endif  // CURSOR_H_
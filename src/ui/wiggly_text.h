@@ -58,6 +58,13 @@ void fading_wiggly_text_reset(FadingWigglyText *fading_wiggly_text)
     fading_wiggly_text->wiggly_text.color.a = 1.0f;
 }
 
+static inline
+int fading_wiggly_text_visible(const FadingWigglyText *fading_wiggly_text)
+{
+    trace_assert(fading_wiggly_text);
+    return fading_wiggly_text->wiggly_text.color.a > 0.0f;
+}
+
 static inline
 Vec2f fading_wiggly_text_size(const FadingWigglyText *fading_wiggly_text)
 {